@@ -1,8 +1,56 @@
-from typing import List, Dict, Any
+import ctypes
+import os
+import sys
+from typing import List, Dict, Any, Optional, Sequence, Tuple
 from uuid import UUID
+
 import numpy as np
 from sentence_transformers import SentenceTransformer
 
+# Contiguous arrays go to C as they are, without a per-element conversion
+_FLOATS = np.ctypeslib.ndpointer(dtype=np.float32, flags="C_CONTIGUOUS")
+_UINT64S = np.ctypeslib.ndpointer(dtype=np.uint64, flags="C_CONTIGUOUS")
+
+
+def _load_vector_lib() -> Optional[ctypes.CDLL]:
+    """libvector with the signatures used here, or None if it is missing or
+    predates them (see c_vector/README.md, Bindings)"""
+    lib_name = "libvector.so" if sys.platform != "darwin" else "libvector.dylib"
+    lib_path = os.path.abspath(
+        os.path.join(os.path.dirname(__file__), "../../../c_vector", lib_name)
+    )
+    try:
+        lib = ctypes.CDLL(lib_path)
+        lib.vs_create.argtypes = [ctypes.c_size_t]
+        lib.vs_create.restype = ctypes.c_void_p
+        lib.vs_free.argtypes = [ctypes.c_void_p]
+        lib.vs_free.restype = None
+        lib.vs_add_batch.argtypes = [
+            ctypes.c_void_p,
+            _FLOATS,  # data, n x dim
+            ctypes.c_size_t,  # n
+            ctypes.c_size_t,  # dim
+            _UINT64S,  # tags
+            _FLOATS,  # weights
+            _UINT64S,  # out_ids
+        ]
+        lib.vs_add_batch.restype = ctypes.c_int
+        lib.vs_search_tag_ids.argtypes = [
+            ctypes.c_void_p,
+            ctypes.c_uint64,  # tag
+            _FLOATS,  # queries, num_queries x dim
+            ctypes.c_size_t,  # num_queries
+            ctypes.c_size_t,  # dim
+            ctypes.c_size_t,  # k
+            _UINT64S,  # out_ids
+            _FLOATS,  # out_scores
+        ]
+        lib.vs_search_tag_ids.restype = ctypes.c_int
+    except (OSError, AttributeError) as e:
+        print(f"⚠️ Could not load C Vector Store: {e}")
+        return None
+    return lib
+
 
 class AgentMemory:
     """
@@ -12,57 +60,105 @@ class AgentMemory:
     """
 
     def __init__(self):
-        # In production, use a proper Vector DB (Chroma, Pinecone, etc.)
-        # For PoC, usage in-memory persistence
+        # Memories the C store holds: its ID -> (agent, text)
+        self.texts: Dict[int, Tuple[UUID, str]] = {}
+        # Memories scored in Python: all of them without the C store, else
+        # only those it refused
         self.memories: List[Dict[str, Any]] = []
         # Lazy load encoder on first use or init
         self.encoder = SentenceTransformer("all-MiniLM-L6-v2")
 
-        # Try to load C Vector Store
-        self.c_store = None
-        try:
-            import ctypes
-            import os
-            import sys
+        # Embeddings, weighted by importance, in one C store tagged by agent
+        self.vec_lib = _load_vector_lib()
+        self.c_store = self.vec_lib.vs_create(1024) if self.vec_lib else None
+        if self.c_store:
+            print("🚀 C Vector Store: Optimization Library Loaded")
 
-            lib_name = "libvector.so" if sys.platform != "darwin" else "libvector.dylib"
-            lib_path = os.path.abspath(
-                os.path.join(os.path.dirname(__file__), "../../../c_vector", lib_name)
-            )
+    def __del__(self):
+        if getattr(self, "c_store", None):
+            self.vec_lib.vs_free(self.c_store)
+            self.c_store = None
 
-            self.vec_lib = ctypes.CDLL(lib_path)
-            # Define signatures...
-            print("🚀 C Vector Store: Optimization Library Loaded")
-        except Exception as e:
-            print(f"⚠️ Could not load C Vector Store: {e}")
+    @staticmethod
+    def _tag(entity_id: UUID) -> int:
+        """The agent's tag in the C store: the low 64 bits of its UUID"""
+        return entity_id.int & 0xFFFFFFFFFFFFFFFF
 
     def remember(self, entity_id: UUID, text: str, importance: float = 1.0) -> None:
         """Store a new memory"""
-        embedding = self.encoder.encode(text)
-        self.memories.append(
-            {
-                "entity_id": entity_id,
-                "text": text,
-                "embedding": embedding,
-                "importance": importance,
-            }
+        self.remember_many(entity_id, [text], [importance])
+
+    def remember_many(
+        self,
+        entity_id: UUID,
+        texts: Sequence[str],
+        importances: Optional[Sequence[float]] = None,
+    ) -> None:
+        """Store several memories, encoded and added in one batch each"""
+        if not texts:
+            return
+        if importances is None:
+            importances = [1.0] * len(texts)
+        embeddings = np.ascontiguousarray(
+            self.encoder.encode(list(texts)), dtype=np.float32
         )
+        added = 0
+        if self.c_store:
+            n, dim = embeddings.shape
+            tags = np.full(n, self._tag(entity_id), dtype=np.uint64)
+            weights = np.ascontiguousarray(importances, dtype=np.float32)
+            ids = np.empty(n, dtype=np.uint64)
+            added = max(
+                self.vec_lib.vs_add_batch(
+                    self.c_store, embeddings, n, dim, tags, weights, ids
+                ),
+                0,
+            )
+            for i in range(added):
+                self.texts[int(ids[i])] = (entity_id, texts[i])
+        # The store stops at a vector it refuses; the rest are kept here
+        for i in range(added, len(texts)):
+            self.memories.append(
+                {
+                    "entity_id": entity_id,
+                    "text": texts[i],
+                    "embedding": embeddings[i],
+                    "importance": importances[i],
+                }
+            )
 
     def recall(self, entity_id: UUID, query: str, top_k: int = 3) -> List[str]:
         """Retrieve relevant memories for this agent context"""
-        if not self.memories:
+        if top_k <= 0 or (not self.texts and not self.memories):
             return []
 
-        # Filter by agent
-        agent_memories = [m for m in self.memories if m["entity_id"] == entity_id]
-        if not agent_memories:
-            return []
+        q_vec = np.ascontiguousarray(self.encoder.encode(query), dtype=np.float32)
+        results: List[Tuple[float, str]] = []
 
-        q_vec = self.encoder.encode(query)
+        # One pass over this agent's rows in C; scores come back as cosine
+        # similarity times importance
+        if self.texts:
+            ids = np.empty(top_k, dtype=np.uint64)
+            scores = np.empty(top_k, dtype=np.float32)
+            found = self.vec_lib.vs_search_tag_ids(
+                self.c_store,
+                self._tag(entity_id),
+                q_vec,
+                1,
+                q_vec.shape[0],
+                top_k,
+                ids,
+                scores,
+            )
+            for i in range(max(found, 0)):
+                owner, text = self.texts[int(ids[i])]
+                # Two agents' UUIDs may share their low 64 bits
+                if owner == entity_id:
+                    results.append((float(scores[i]), text))
 
-        # Calculate scores
-        results = []
-        for mem in agent_memories:
+        for mem in self.memories:
+            if mem["entity_id"] != entity_id:
+                continue
             # Cosine similarity
             score = np.dot(mem["embedding"], q_vec) / (
                 np.linalg.norm(mem["embedding"]) * np.linalg.norm(q_vec) + 1e-9
@@ -0,0 +1,135 @@
+"""
+Prometheus metrics endpoint
+
+Exposes the native physics engine's hot-path counters (libphys built with
+-DPHYS_ENABLE_STATS) in the text exposition format scraped by the
+ServiceMonitor in infra/charts/concord/templates/monitoring.yaml.
+"""
+
+import ctypes
+import os
+import sys
+from typing import List, Optional
+
+from fastapi import APIRouter
+from fastapi.responses import PlainTextResponse
+
+router = APIRouter()
+
+# Must match PHYS_LATENCY_BUCKETS in cpp_sim/EngineStats.hpp
+PHYS_LATENCY_BUCKETS = 20
+
+
+class PhysStats(ctypes.Structure):
+    """Mirror of PhysStats in cpp_sim/EngineStats.hpp"""
+
+    _fields_ = [
+        ("path_queries", ctypes.c_uint64),
+        ("nodes_expanded", ctypes.c_uint64),
+        ("open_pushes", ctypes.c_uint64),
+        ("peak_open_size", ctypes.c_uint64),
+        ("field_hits", ctypes.c_uint64),
+        ("field_misses", ctypes.c_uint64),
+        ("route_hits", ctypes.c_uint64),
+        ("route_misses", ctypes.c_uint64),
+        ("query_time_ns", ctypes.c_uint64),
+        ("latency_buckets", ctypes.c_uint64 * PHYS_LATENCY_BUCKETS),
+    ]
+
+
+_phys_lib: Optional[ctypes.CDLL] = None
+
+
+def _load_phys_lib() -> Optional[ctypes.CDLL]:
+    """Same library (and shared engine) the simulation engine loads"""
+    global _phys_lib
+    if _phys_lib is None:
+        lib_name = "libphys.so" if sys.platform != "darwin" else "libphys.dylib"
+        lib_path = os.path.abspath(
+            os.path.join(os.path.dirname(__file__), "../../../../cpp_sim", lib_name)
+        )
+        try:
+            lib = ctypes.CDLL(lib_path)
+            lib.api_get_stats.argtypes = [ctypes.POINTER(PhysStats)]
+            lib.api_get_stats.restype = ctypes.c_int
+        except (OSError, AttributeError):
+            return None
+        _phys_lib = lib
+    return _phys_lib
+
+
+def _counter(lines: List[str], name: str, help_text: str, value: int) -> None:
+    lines.append(f"# HELP {name} {help_text}")
+    lines.append(f"# TYPE {name} counter")
+    lines.append(f"{name} {value}")
+
+
+def phys_metrics() -> List[str]:
+    """Exposition lines for libphys, empty if the stats are unavailable"""
+    lib = _load_phys_lib()
+    stats = PhysStats()
+    if lib is None or lib.api_get_stats(ctypes.byref(stats)) != 0:
+        return []
+
+    lines: List[str] = []
+    _counter(
+        lines,
+        "concord_phys_path_queries_total",
+        "Path queries answered by the physics engine.",
+        stats.path_queries,
+    )
+    _counter(
+        lines,
+        "concord_phys_nodes_expanded_total",
+        "Nodes taken off the search open set.",
+        stats.nodes_expanded,
+    )
+    _counter(
+        lines,
+        "concord_phys_open_pushes_total",
+        "Nodes pushed onto the search open set.",
+        stats.open_pushes,
+    )
+    lines.append(
+        "# HELP concord_phys_peak_open_size Largest open set of any path query."
+    )
+    lines.append("# TYPE concord_phys_peak_open_size gauge")
+    lines.append(f"concord_phys_peak_open_size {stats.peak_open_size}")
+    for cache, hits, misses in (
+        ("distance_field", stats.field_hits, stats.field_misses),
+        ("route", stats.route_hits, stats.route_misses),
+    ):
+        _counter(
+            lines,
+            f"concord_phys_{cache}_cache_hits_total",
+            f"Queries served from the {cache.replace('_', ' ')} cache.",
+            hits,
+        )
+        _counter(
+            lines,
+            f"concord_phys_{cache}_cache_misses_total",
+            f"Queries that missed the {cache.replace('_', ' ')} cache.",
+            misses,
+        )
+
+    # Native buckets are disjoint; Prometheus buckets are cumulative
+    name = "concord_phys_path_query_duration_seconds"
+    lines.append(f"# HELP {name} Wall time per path query.")
+    lines.append(f"# TYPE {name} histogram")
+    cumulative = 0
+    for i in range(PHYS_LATENCY_BUCKETS - 1):
+        cumulative += stats.latency_buckets[i]
+        upper = (1 << i) * 1e-6
+        lines.append(f'{name}_bucket{{le="{upper:g}"}} {cumulative}')
+    cumulative += stats.latency_buckets[PHYS_LATENCY_BUCKETS - 1]
+    lines.append(f'{name}_bucket{{le="+Inf"}} {cumulative}')
+    lines.append(f"{name}_sum {stats.query_time_ns * 1e-9:.9f}")
+    lines.append(f"{name}_count {cumulative}")
+    return lines
+
+
+@router.get("/metrics", response_class=PlainTextResponse)
+async def metrics():
+    """Prometheus scrape endpoint"""
+    lines = phys_metrics()
+    return "\n".join(lines) + "\n" if lines else ""
@@ -17,6 +17,7 @@ from app.api.routes import (
     causality,
     agents,
     quantum,
+    metrics,
 )
 
 
@@ -137,6 +138,9 @@ app.include_router(
     tags=["Quantum Consistency"],
 )
 
+# Prometheus scrape endpoint (no API prefix; see the chart's ServiceMonitor)
+app.include_router(metrics.router, tags=["Monitoring"])
+
 
 @app.get("/")
 async def root():
@@ -5,6 +5,9 @@ import datetime
 from app.core.knowledge_graph import KnowledgeGraph
 from app.simulation.dungeon_master import DungeonMaster
 
+# TransportMode ids from cpp_sim/TransportModes.hpp
+TRANSPORT_MODES = {"walking": 0, "running": 1, "driving": 2, "flying": 3}
+
 
 class SimulationEngine:
     """
@@ -48,16 +51,16 @@ class SimulationEngine:
             )
 
             self.phys_lib = ctypes.CDLL(lib_path)
-            self.phys_lib.api_estimate_travel_time.argtypes = [
+            self.phys_lib.api_estimate_travel_time_mode.argtypes = [
                 ctypes.c_double,
                 ctypes.c_double,
                 ctypes.c_double,
                 ctypes.c_double,
                 ctypes.c_double,
                 ctypes.c_double,
-                ctypes.c_char_p,
+                ctypes.c_int32,
             ]
-            self.phys_lib.api_estimate_travel_time.restype = ctypes.c_double
+            self.phys_lib.api_estimate_travel_time_mode.restype = ctypes.c_double
 
             # Example: Calculate travel time for a "move" action
             if "walk" in action or "run" in action:
@@ -65,8 +68,8 @@ class SimulationEngine:
                 p1 = (0.0, 0.0, 0.0)
                 p2 = (5.0, 5.0, 0.0)
                 mode = "running" if "run" in action else "walking"
-                time_mins = self.phys_lib.api_estimate_travel_time(
-                    *p1, *p2, mode.encode("utf-8")
+                time_mins = self.phys_lib.api_estimate_travel_time_mode(
+                    *p1, *p2, TRANSPORT_MODES[mode]
                 )
                 print(
                     f"🚀 C++ Physics Engine: Estimated {mode} time = {time_mins:.2f} mins"
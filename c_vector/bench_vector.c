@@ -0,0 +1,606 @@
+// libvector benchmarks over all-MiniLM-L6-v2 shaped data: 384-dimension,
+// unit-length embeddings, the vectors AgentMemory stores. Workloads come
+// from a fixed seed, so every run measures the same inputs. Results go to
+// stdout as JSON (ns/op and heap allocations per op), progress to stderr:
+//
+//   ./bench_vec [--filter SUBSTRING] [--min-time SECONDS] > results.json
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// The store is compiled into this program with its heap calls routed
+// through counters; the system headers above are already included, so only
+// the store's own calls are renamed.
+static uint64_t heap_allocs = 0;
+static uint64_t heap_bytes = 0;
+
+static void *counted_malloc(size_t size) {
+  heap_allocs++;
+  heap_bytes += size;
+  return malloc(size);
+}
+
+static void *counted_aligned_alloc(size_t alignment, size_t size) {
+  heap_allocs++;
+  heap_bytes += size;
+  return aligned_alloc(alignment, size);
+}
+
+static void *counted_calloc(size_t count, size_t size) {
+  heap_allocs++;
+  heap_bytes += count * size;
+  return calloc(count, size);
+}
+
+static void *counted_realloc(void *ptr, size_t size) {
+  heap_allocs++;
+  heap_bytes += size;
+  return realloc(ptr, size);
+}
+
+#define malloc(size) counted_malloc(size)
+#define calloc(count, size) counted_calloc(count, size)
+#define realloc(ptr, size) counted_realloc(ptr, size)
+#define aligned_alloc(alignment, size) counted_aligned_alloc(alignment, size)
+#include "vector_store.c"
+#include "vs_hnsw.c"
+#include "vs_kernels.c"
+#include "vs_quant.c"
+#include "vs_file.c"
+#include "vs_pool.c"
+#undef malloc
+#undef calloc
+#undef realloc
+#undef aligned_alloc
+
+#define DIM 384
+#define NUM_QUERIES 64
+#define SEED 0x434f4e434f5244ull // "CONCORD"
+#define TWO_PI 6.28318530717958647692
+
+typedef struct {
+  char name[64];
+  uint64_t iterations;
+  size_t items;
+  double ns_per_op;
+  double allocs_per_op;
+  double bytes_per_op;
+  double recall; // Of approximate searches, -1 for the others
+  size_t memory; // Store bytes of quantized searches, 0 for the others
+} Result;
+
+static const char *filter = NULL;
+static double min_time = 0.5;
+static Result results[48];
+static size_t num_results = 0;
+static volatile double sink;
+static double recall = -1; // Copied into the next results
+static size_t memory = 0;   // Likewise
+
+// splitmix64, identical on every platform
+static uint64_t rng_state = SEED;
+
+static uint64_t rng_next(void) {
+  uint64_t z = (rng_state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+static double rng_uniform(void) { return (rng_next() >> 11) * 0x1.0p-53; }
+
+// Standard normal components make the direction uniform on the sphere
+static void random_embedding(float *v) {
+  double norm = 0.0;
+  for (size_t i = 0; i < DIM; i += 2) {
+    const double r = sqrt(-2.0 * log(1.0 - rng_uniform()));
+    const double t = TWO_PI * rng_uniform();
+    v[i] = (float)(r * cos(t));
+    v[i + 1] = (float)(r * sin(t));
+    norm += (double)v[i] * v[i] + (double)v[i + 1] * v[i + 1];
+  }
+  const float inv = (float)(1.0 / sqrt(norm));
+  for (size_t i = 0; i < DIM; i++)
+    v[i] *= inv;
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef void (*bench_fn)(void *ctx);
+
+static int selected(const char *name) {
+  return !filter || strstr(name, filter) != NULL;
+}
+
+// Times fn(ctx), which does `items` operations, until a run takes at least
+// min_time; "op" is one item.
+static void bench(const char *name, size_t items, bench_fn fn, void *ctx) {
+  if (!selected(name) || num_results == sizeof(results) / sizeof(*results))
+    return;
+  fprintf(stderr, "%-36s", name);
+  fn(ctx); // Warm caches
+
+  uint64_t iterations = 1;
+  for (;;) {
+    const uint64_t allocs = heap_allocs, bytes = heap_bytes;
+    const double start = now_seconds();
+    for (uint64_t i = 0; i < iterations; i++)
+      fn(ctx);
+    const double elapsed = now_seconds() - start;
+    if (elapsed >= min_time || iterations >= (1ull << 40)) {
+      const double ops = (double)iterations * items;
+      Result *r = &results[num_results++];
+      snprintf(r->name, sizeof(r->name), "%s", name);
+      r->iterations = iterations;
+      r->items = items;
+      r->ns_per_op = elapsed * 1e9 / ops;
+      r->allocs_per_op = (heap_allocs - allocs) / ops;
+      r->bytes_per_op = (heap_bytes - bytes) / ops;
+      r->recall = recall;
+      r->memory = memory;
+      fprintf(stderr, "%14.1f ns/op %10.3f allocs/op", r->ns_per_op,
+              r->allocs_per_op);
+      if (recall >= 0)
+        fprintf(stderr, " %6.3f recall", recall);
+      if (memory)
+        fprintf(stderr, " %7.1f MB", memory / 1e6);
+      fprintf(stderr, "\n");
+      return;
+    }
+    // Aim 40% past the target so the next run usually is the last
+    double scale = elapsed > 0 ? min_time * 1.4 / elapsed : 100.0;
+    scale = scale < 2.0 ? 2.0 : scale > 100.0 ? 100.0 : scale;
+    iterations = (uint64_t)(iterations * scale);
+  }
+}
+
+static void write_json(void) {
+  char date[32];
+  const time_t now = time(NULL);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+  printf("{\n  \"context\": {\n");
+  printf("    \"library\": \"libvector\",\n");
+  printf("    \"date\": \"%s\",\n", date);
+  printf("    \"seed\": %llu,\n", (unsigned long long)SEED);
+  printf("    \"dimension\": %d,\n", DIM);
+  printf("    \"min_time_s\": %g\n  },\n", min_time);
+  printf("  \"benchmarks\": [");
+  for (size_t i = 0; i < num_results; i++) {
+    const Result *r = &results[i];
+    printf("%s\n    {\"name\": \"%s\", \"iterations\": %llu, "
+           "\"items_per_iteration\": %zu, \"ns_per_op\": %.3f, "
+           "\"allocs_per_op\": %.4f, \"bytes_per_op\": %.1f",
+           i ? "," : "", r->name, (unsigned long long)r->iterations,
+           r->items, r->ns_per_op, r->allocs_per_op, r->bytes_per_op);
+    if (r->recall >= 0)
+      printf(", \"recall\": %.4f", r->recall);
+    if (r->memory)
+      printf(", \"memory_bytes\": %zu", r->memory);
+    printf("}");
+  }
+  printf("\n  ]\n}\n");
+}
+
+typedef struct {
+  VectorStore *store;
+  float *embeddings; // count x DIM, row-major
+  size_t count;
+  float *queries; // NUM_QUERIES x DIM
+  size_t next_query;
+} SearchContext;
+
+static void bench_add(void *ctx) {
+  SearchContext *c = (SearchContext *)ctx;
+  VectorStore *store = vs_create(16);
+  for (size_t i = 0; i < c->count; i++)
+    vs_add(store, c->embeddings + i * DIM, DIM);
+  vs_free(store);
+}
+
+static void bench_add_batch(void *ctx) {
+  SearchContext *c = (SearchContext *)ctx;
+  VectorStore *store = vs_create(16);
+  vs_add_batch(store, c->embeddings, c->count, DIM, NULL, NULL, NULL);
+  vs_free(store);
+}
+
+static void bench_find_nearest(void *ctx) {
+  SearchContext *c = (SearchContext *)ctx;
+  float *query = c->queries + c->next_query * DIM;
+  c->next_query = (c->next_query + 1) % NUM_QUERIES;
+  sink = vs_find_nearest(c->store, query, DIM);
+}
+
+#define TOP_K 10
+#define HNSW_M 16
+#define HNSW_EF_CONSTRUCTION 200
+
+static void bench_search_topk(void *ctx) {
+  SearchContext *c = (SearchContext *)ctx;
+  float *query = c->queries + c->next_query * DIM;
+  c->next_query = (c->next_query + 1) % NUM_QUERIES;
+  int idx[TOP_K];
+  float scores[TOP_K];
+  sink = vs_search_topk(c->store, query, DIM, TOP_K, idx, scores);
+}
+
+// Written by the save benchmark, then opened and searched in place
+#define STORE_FILE "bench_vector.vs"
+
+static void bench_save(void *ctx) {
+  SearchContext *c = (SearchContext *)ctx;
+  sink = vs_save(c->store, STORE_FILE);
+}
+
+static void bench_open_mmap(void *ctx) {
+  (void)ctx;
+  VectorStore *store = vs_open_mmap(STORE_FILE);
+  if (!store) {
+    fprintf(stderr, "%s: cannot open\n", STORE_FILE);
+    exit(1);
+  }
+  sink = store->count;
+  vs_free(store);
+}
+
+// Threads for the sharded-scan benchmarks, the caller included
+#define BENCH_THREADS 4
+
+// All NUM_QUERIES queries in one call; "op" is one query
+static void bench_search_batch(void *ctx) {
+  SearchContext *c = (SearchContext *)ctx;
+  static int idx[NUM_QUERIES * TOP_K];
+  static float scores[NUM_QUERIES * TOP_K];
+  sink = vs_search_batch(c->store, c->queries, NUM_QUERIES, DIM, TOP_K, idx,
+                         scores);
+}
+
+// The store is split over this many tags, like agents' memories
+#define NUM_TAGS 1000
+
+typedef struct {
+  SearchContext *search;
+  size_t ef;
+} AnnContext;
+
+static void bench_add_indexed(void *ctx) {
+  AnnContext *c = (AnnContext *)ctx;
+  VectorStore *store = vs_create(16);
+  vs_enable_index(store, HNSW_M, HNSW_EF_CONSTRUCTION);
+  for (size_t i = 0; i < c->search->count; i++)
+    vs_add(store, c->search->embeddings + i * DIM, DIM);
+  vs_free(store);
+}
+
+// The same build in bulk, on BENCH_THREADS threads
+static void bench_add_batch_indexed(void *ctx) {
+  AnnContext *c = (AnnContext *)ctx;
+  VectorStore *store = vs_create(16);
+  vs_enable_index(store, HNSW_M, HNSW_EF_CONSTRUCTION);
+  vs_set_threads(BENCH_THREADS, VS_PARALLEL_MIN_ROWS);
+  vs_add_batch(store, c->search->embeddings, c->search->count, DIM, NULL,
+               NULL, NULL);
+  vs_set_threads(1, VS_PARALLEL_MIN_ROWS);
+  vs_free(store);
+}
+
+static void bench_search_ann(void *ctx) {
+  AnnContext *c = (AnnContext *)ctx;
+  SearchContext *s = c->search;
+  float *query = s->queries + s->next_query * DIM;
+  s->next_query = (s->next_query + 1) % NUM_QUERIES;
+  int idx[TOP_K];
+  float scores[TOP_K];
+  sink = vs_search_ann(s->store, query, DIM, TOP_K, c->ef, idx, scores);
+}
+
+static void bench_search_topk_tag(void *ctx) {
+  SearchContext *c = (SearchContext *)ctx;
+  float *query = c->queries + c->next_query * DIM;
+  const uint64_t tag = c->next_query % NUM_TAGS;
+  c->next_query = (c->next_query + 1) % NUM_QUERIES;
+  int idx[TOP_K];
+  float scores[TOP_K];
+  sink = vs_search_topk_tag(c->store, tag, query, DIM, TOP_K, idx, scores);
+}
+
+typedef struct {
+  float a[DIM], b[DIM];
+} DotContext;
+
+static void bench_dot(void *ctx) {
+  DotContext *c = (DotContext *)ctx;
+  sink = vs_dot_product(c->a, c->b, DIM);
+}
+
+// Sentence embeddings are far from uniform on the sphere: they vary along
+// a few dozen directions. Structured workloads mix NUM_TOPICS random
+// directions and add a little isotropic noise, which is the regime graph
+// indexes are built for (uniform points have no near neighbours to find).
+#define NUM_TOPICS 24
+
+static float *make_basis(void) {
+  float *basis = (float *)malloc(NUM_TOPICS * DIM * sizeof(float));
+  if (!basis) {
+    fprintf(stderr, "basis: out of memory\n");
+    exit(1);
+  }
+  for (size_t t = 0; t < NUM_TOPICS; t++)
+    random_embedding(basis + t * DIM);
+  return basis;
+}
+
+static void topic_embedding(float *v, const float *basis) {
+  float mix[NUM_TOPICS];
+  random_embedding(v);
+  for (size_t i = 0; i < DIM; i++)
+    v[i] *= 0.1f;
+  // Gaussian topic weights, taken from a fresh embedding
+  float weights[DIM];
+  random_embedding(weights);
+  for (size_t t = 0; t < NUM_TOPICS; t++)
+    mix[t] = weights[t] * 4.0f;
+  double norm = 0.0;
+  for (size_t i = 0; i < DIM; i++) {
+    for (size_t t = 0; t < NUM_TOPICS; t++)
+      v[i] += mix[t] * basis[t * DIM + i];
+    norm += (double)v[i] * v[i];
+  }
+  const float inv = (float)(1.0 / sqrt(norm));
+  for (size_t i = 0; i < DIM; i++)
+    v[i] *= inv;
+}
+
+// `count` embeddings; queries are noisy copies of stored ones, like
+// recalling a memory that was paraphrased
+static SearchContext make_workload(size_t count, int structured) {
+  SearchContext c = {0};
+  c.count = count;
+  c.embeddings = (float *)malloc(count * DIM * sizeof(float));
+  c.queries = (float *)malloc(NUM_QUERIES * DIM * sizeof(float));
+  if (!c.embeddings || !c.queries) {
+    fprintf(stderr, "%zu embeddings: out of memory\n", count);
+    exit(1);
+  }
+  float *basis = structured ? make_basis() : NULL;
+  for (size_t i = 0; i < count; i++) {
+    if (basis)
+      topic_embedding(c.embeddings + i * DIM, basis);
+    else
+      random_embedding(c.embeddings + i * DIM);
+  }
+  free(basis);
+  float noise[DIM];
+  for (size_t q = 0; q < NUM_QUERIES; q++) {
+    const float *source = c.embeddings + (rng_next() % count) * DIM;
+    random_embedding(noise);
+    for (size_t i = 0; i < DIM; i++)
+      c.queries[q * DIM + i] = source[i] + 0.3f * noise[i];
+  }
+  return c;
+}
+
+static void run_size(size_t count, const char *label) {
+  char add_name[64], find_name[64], topk_name[64], tag_name[64];
+  char save_name[64], open_name[64], mapped_name[64], batch_name[64];
+  char threads_name[64], add_batch_name[64];
+  snprintf(add_name, sizeof(add_name), "vs_add/%sx%d", label, DIM);
+  snprintf(add_batch_name, sizeof(add_batch_name), "vs_add_batch/%sx%d",
+           label, DIM);
+  snprintf(find_name, sizeof(find_name), "vs_find_nearest/%sx%d", label,
+           DIM);
+  snprintf(topk_name, sizeof(topk_name), "vs_search_topk/%sx%d/k%d", label,
+           DIM, TOP_K);
+  snprintf(tag_name, sizeof(tag_name), "vs_search_topk_tag/%sx%d/k%d",
+           label, DIM, TOP_K);
+  snprintf(save_name, sizeof(save_name), "vs_save/%sx%d", label, DIM);
+  snprintf(open_name, sizeof(open_name), "vs_open_mmap/%sx%d", label, DIM);
+  snprintf(mapped_name, sizeof(mapped_name),
+           "vs_search_topk/%sx%d/k%d/mapped", label, DIM, TOP_K);
+  snprintf(batch_name, sizeof(batch_name), "vs_search_batch/%sx%d/k%d/q%d",
+           label, DIM, TOP_K, NUM_QUERIES);
+  snprintf(threads_name, sizeof(threads_name),
+           "vs_search_topk/%sx%d/k%d/t%d", label, DIM, TOP_K, BENCH_THREADS);
+  const int files = selected(save_name) || selected(open_name) ||
+                    selected(mapped_name);
+  if (!selected(add_name) && !selected(add_batch_name) &&
+      !selected(find_name) && !selected(topk_name) && !selected(tag_name) &&
+      !selected(batch_name) && !selected(threads_name) && !files)
+    return;
+
+  SearchContext c = make_workload(count, 0);
+  bench(add_name, count, bench_add, &c);
+  bench(add_batch_name, count, bench_add_batch, &c);
+  c.store = vs_create(16);
+  for (size_t i = 0; i < count; i++)
+    vs_add_tagged(c.store, c.embeddings + i * DIM, DIM, i % NUM_TAGS, 1.0f);
+  bench(find_name, 1, bench_find_nearest, &c);
+  bench(topk_name, 1, bench_search_topk, &c);
+  bench(tag_name, 1, bench_search_topk_tag, &c);
+  bench(batch_name, NUM_QUERIES, bench_search_batch, &c);
+  if (selected(threads_name) && vs_set_threads(BENCH_THREADS, 0) == 0) {
+    bench(threads_name, 1, bench_search_topk, &c);
+    vs_set_threads(1, VS_PARALLEL_MIN_ROWS);
+  }
+
+  if (files) {
+    // Saving writes (and syncs) every row; one timed run will do
+    const double saved_min_time = min_time;
+    min_time = 0;
+    bench(save_name, 1, bench_save, &c);
+    min_time = saved_min_time;
+    if (!selected(save_name))
+      vs_save(c.store, STORE_FILE);
+    bench(open_name, 1, bench_open_mmap, NULL);
+    SearchContext mapped = c;
+    mapped.store = vs_open_mmap(STORE_FILE);
+    if (mapped.store) {
+      bench(mapped_name, 1, bench_search_topk, &mapped);
+      vs_free(mapped.store);
+    }
+    remove(STORE_FILE);
+  }
+
+  vs_free(c.store);
+  free(c.embeddings);
+  free(c.queries);
+}
+
+// HNSW build and search; each search result records its recall@10
+// against the exact top 10
+static void run_ann(size_t count, const char *label) {
+  static const size_t efs[] = {16, 64, 256};
+  char build_name[64], bulk_name[64], names[3][64];
+  snprintf(build_name, sizeof(build_name), "vs_add_indexed/%sx%d/m%d",
+           label, DIM, HNSW_M);
+  snprintf(bulk_name, sizeof(bulk_name), "vs_add_batch_indexed/%sx%d/m%d/t%d",
+           label, DIM, HNSW_M, BENCH_THREADS);
+  int any = selected(build_name) || selected(bulk_name);
+  for (size_t e = 0; e < 3; e++) {
+    snprintf(names[e], sizeof(names[e]), "vs_search_ann/%sx%d/k%d/ef%zu",
+             label, DIM, TOP_K, efs[e]);
+    any |= selected(names[e]);
+  }
+  if (!any)
+    return;
+
+  SearchContext s = make_workload(count, 1);
+  AnnContext c = {&s, 0};
+  // A single timed build (after the warm-up one) is enough at this size
+  const double saved_min_time = min_time;
+  min_time = 0;
+  bench(build_name, count, bench_add_indexed, &c);
+  bench(bulk_name, count, bench_add_batch_indexed, &c);
+  min_time = saved_min_time;
+
+  s.store = vs_create(16);
+  vs_enable_index(s.store, HNSW_M, HNSW_EF_CONSTRUCTION);
+  for (size_t i = 0; i < count; i++)
+    vs_add(s.store, s.embeddings + i * DIM, DIM);
+  int exact[NUM_QUERIES][TOP_K];
+  float scores[TOP_K];
+  for (size_t q = 0; q < NUM_QUERIES; q++)
+    vs_search_topk(s.store, s.queries + q * DIM, DIM, TOP_K, exact[q],
+                   scores);
+  for (size_t e = 0; e < 3; e++) {
+    size_t hits = 0;
+    for (size_t q = 0; q < NUM_QUERIES; q++) {
+      int idx[TOP_K];
+      vs_search_ann(s.store, s.queries + q * DIM, DIM, TOP_K, efs[e], idx,
+                    scores);
+      for (size_t i = 0; i < TOP_K; i++)
+        for (size_t j = 0; j < TOP_K; j++)
+          hits += idx[i] == exact[q][j];
+    }
+    recall = (double)hits / (NUM_QUERIES * TOP_K);
+    c.ef = efs[e];
+    bench(names[e], 1, bench_search_ann, &c);
+  }
+  recall = -1;
+
+  vs_free(s.store);
+  free(s.embeddings);
+  free(s.queries);
+}
+
+// Exact top-k over each compressed format (and PQ re-ranked against the
+// floats), with recall@10 against the float scan and the store's footprint
+static void run_quant(size_t count, const char *label) {
+  static const struct {
+    const char *name;
+    int kind;
+    size_t subspaces;
+    size_t rerank;
+  } formats[] = {
+      {"f32", VS_QUANT_NONE, 0, 0},    {"int8", VS_QUANT_INT8, 0, 0},
+      {"fp16", VS_QUANT_FP16, 0, 0},   {"pq48", VS_QUANT_PQ, 48, 0},
+      {"pq48/rerank8", VS_QUANT_PQ, 48, 8},
+  };
+  const size_t num_formats = sizeof(formats) / sizeof(*formats);
+  char names[5][64];
+  int any = 0;
+  for (size_t f = 0; f < num_formats; f++) {
+    snprintf(names[f], sizeof(names[f]), "vs_search_topk/%sx%d/k%d/%s",
+             label, DIM, TOP_K, formats[f].name);
+    any |= selected(names[f]);
+  }
+  if (!any)
+    return;
+
+  SearchContext s = make_workload(count, 1);
+  int exact[NUM_QUERIES][TOP_K];
+  float scores[TOP_K];
+  for (size_t f = 0; f < num_formats; f++) {
+    s.store = vs_create(16);
+    for (size_t i = 0; i < count; i++)
+      vs_add(s.store, s.embeddings + i * DIM, DIM);
+    if (formats[f].kind != VS_QUANT_NONE) {
+      vs_quantize(s.store, formats[f].kind, formats[f].subspaces,
+                  formats[f].rerank != 0);
+      vs_set_rerank(s.store, formats[f].rerank);
+    }
+    size_t hits = 0;
+    for (size_t q = 0; q < NUM_QUERIES; q++) {
+      int idx[TOP_K];
+      vs_search_topk(s.store, s.queries + q * DIM, DIM, TOP_K, idx, scores);
+      if (f == 0)
+        memcpy(exact[q], idx, sizeof(idx));
+      for (size_t i = 0; i < TOP_K; i++)
+        for (size_t j = 0; j < TOP_K; j++)
+          hits += idx[i] == exact[q][j];
+    }
+    recall = (double)hits / (NUM_QUERIES * TOP_K);
+    memory = vs_memory_bytes(s.store);
+    bench(names[f], 1, bench_search_topk, &s);
+    vs_free(s.store);
+  }
+  recall = -1;
+  memory = 0;
+
+  free(s.embeddings);
+  free(s.queries);
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (!strcmp(argv[i], "--min-time") && i + 1 < argc) {
+      min_time = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--filter SUBSTRING] [--min-time SECONDS]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  // Every kernel this CPU supports, then the rest on the default one
+  const char *best = vs_kernel_name();
+  const char *kernel_names[] = {"scalar", "neon", "avx2", "avx512"};
+  DotContext dot;
+  random_embedding(dot.a);
+  random_embedding(dot.b);
+  for (size_t i = 0; i < 4; i++) {
+    if (vs_use_kernel(kernel_names[i]) != 0)
+      continue;
+    char name[64];
+    snprintf(name, sizeof(name), "vs_dot_product/%d/%s", DIM,
+             kernel_names[i]);
+    bench(name, 1, bench_dot, &dot);
+  }
+  vs_use_kernel(best);
+  run_size(10000, "10k");
+  run_size(1000000, "1M");
+  run_ann(100000, "100k");
+  run_quant(100000, "100k");
+  write_json();
+  return 0;
+}
@@ -1,6 +1,209 @@
+#define _POSIX_C_SOURCE 200809L // pthreads
 #include "vector_store.h"
+#include "vs_kernels.h"
 #include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A store grown by one thread while others search it
+#define LIVE_ROWS 6000
+#define LIVE_DIM 16
+
+typedef struct {
+  VectorStore *store;
+  atomic_int done;
+  atomic_int added; // Rows the churn writer has added
+} LiveStore;
+
+static void live_vector(int i, float *v) {
+  for (int j = 0; j < LIVE_DIM; j++)
+    v[j] = sinf(0.7f * j + 0.011f * i) + (j == i % LIVE_DIM);
+}
+
+static void *live_writer(void *arg) {
+  LiveStore *live = (LiveStore *)arg;
+  for (int i = 1; i < LIVE_ROWS; i++) {
+    float v[LIVE_DIM];
+    live_vector(i, v);
+    // Row 3000 brings in the first weight (and the weight arrays) mid-run
+    const float weight = i == 3000 ? 2.0f : 1.0f;
+    assert(vs_add_tagged(live->store, v, LIVE_DIM, (uint64_t)(i % 5),
+                         weight) == 0);
+  }
+  atomic_store(&live->done, 1);
+  return NULL;
+}
+
+// A row a search returned is complete: the vector added, and its tag
+static void check_live_row(const VectorStore *store, int row) {
+  float v[LIVE_DIM];
+  live_vector(row, v);
+  const float norm = sqrtf(vs_dot_product(v, v, LIVE_DIM));
+  const float *stored = vs_get(store, (size_t)row);
+  assert(stored);
+  for (int j = 0; j < LIVE_DIM; j++)
+    assert(fabsf(stored[j] - v[j] / norm) < 1e-5f);
+  uint64_t tag;
+  assert(vs_get_tag(store, (size_t)row, &tag) == 0 && tag == row % 5u);
+}
+
+static void *live_reader(void *arg) {
+  LiveStore *live = (LiveStore *)arg;
+  VectorStore *store = live->store;
+  float q[LIVE_DIM];
+  live_vector(1234, q);
+  size_t listed = 0;
+  while (!atomic_load(&live->done)) {
+    int idx[8];
+    float scores[8];
+    const size_t seen = __atomic_load_n(&store->count, __ATOMIC_ACQUIRE);
+    const int n = vs_search_topk(store, q, LIVE_DIM, 8, idx, scores);
+    assert(n >= (seen < 8 ? (int)seen : 8));
+    for (int r = 0; r < n; r++)
+      check_live_row(store, idx[r]);
+    const int tagged = vs_search_topk_tag(store, 3, q, LIVE_DIM, 8, idx,
+                                          scores);
+    for (int r = 0; r < tagged; r++) {
+      assert(idx[r] % 5 == 3);
+      check_live_row(store, idx[r]);
+    }
+    assert(vs_search_batch(store, q, 1, LIVE_DIM, 8, idx, scores) >= n);
+    check_live_row(store, idx[0]);
+    // Lists only grow
+    const size_t count = vs_count_tag(store, 3);
+    assert(count >= listed);
+    listed = count;
+  }
+  return NULL;
+}
+
+// Cosines of live_vector(1234) with every live_vector, sorted: any score a
+// search returns mid-churn must be one of them
+static float churn_scores[LIVE_ROWS];
+
+static int compare_floats(const void *a, const void *b) {
+  const float x = *(const float *)a, y = *(const float *)b;
+  return (x > y) - (x < y);
+}
+
+static int is_churn_score(float score) {
+  size_t low = 0, high = LIVE_ROWS;
+  while (high - low > 1) {
+    const size_t mid = (low + high) / 2;
+    if (churn_scores[mid] <= score)
+      low = mid;
+    else
+      high = mid;
+  }
+  return fabsf(churn_scores[low] - score) < 1e-5f ||
+         (high < LIVE_ROWS && fabsf(churn_scores[high] - score) < 1e-5f);
+}
+
+// Adds vectors 1, 2, ... tagged with their number, removes two of every
+// three a little after adding them, and compacts every 500 adds, tracking
+// where each vector is
+static void *churn_writer(void *arg) {
+  LiveStore *live = (LiveStore *)arg;
+  static int where[LIVE_ROWS], vector_at[LIVE_ROWS];
+  where[0] = vector_at[0] = 0;
+  for (int i = 1; i < LIVE_ROWS; i++) {
+    float v[LIVE_DIM];
+    live_vector(i, v);
+    assert(vs_add_tagged(live->store, v, LIVE_DIM, (uint64_t)i, 1.0f) == 0);
+    const int row = (int)live->store->count - 1;
+    where[i] = row;
+    vector_at[row] = i;
+    atomic_store(&live->added, i);
+    if (i >= 10 && (i - 10) % 3 != 0)
+      assert(vs_remove(live->store, (size_t)where[i - 10]) == 0);
+    if (i % 500 == 0) {
+      int from[64], to[64];
+      const int moves = vs_compact(live->store, 64, from, to);
+      assert(moves >= 0);
+      for (int m = 0; m < moves; m++) {
+        where[vector_at[from[m]]] = to[m];
+        vector_at[to[m]] = vector_at[from[m]];
+      }
+    }
+  }
+  atomic_store(&live->done, 1);
+  return NULL;
+}
+
+// Searches mid-churn return distinct rows, best first, each scored as one
+// of the vectors: never a half-copied or reused row
+static void *churn_reader(void *arg) {
+  LiveStore *live = (LiveStore *)arg;
+  VectorStore *store = live->store;
+  float q[LIVE_DIM];
+  live_vector(1234, q);
+  while (!atomic_load(&live->done)) {
+    int idx[8];
+    float scores[8];
+    const int n = vs_search_topk(store, q, LIVE_DIM, 8, idx, scores);
+    assert(n >= 1);
+    for (int r = 0; r < n; r++) {
+      assert(is_churn_score(scores[r]));
+      assert(r == 0 || scores[r] <= scores[r - 1]);
+      for (int o = 0; o < r; o++)
+        assert(idx[o] != idx[r]);
+    }
+    const int batched = vs_search_batch(store, q, 1, LIVE_DIM, 8, idx, scores);
+    for (int r = 0; r < batched; r++)
+      assert(is_churn_score(scores[r]));
+    // Vector i's ID is i, so each ID comes with its own vector's score
+    uint64_t ids[8];
+    const int named = vs_search_ids(store, q, 1, LIVE_DIM, 8, ids, scores);
+    assert(named >= 1);
+    for (int r = 0; r < named; r++) {
+      float v[LIVE_DIM];
+      live_vector((int)ids[r], v);
+      const float cosine = vs_dot_product(v, q, LIVE_DIM) /
+                           sqrtf(vs_dot_product(v, v, LIVE_DIM) *
+                                 vs_dot_product(q, q, LIVE_DIM));
+      assert(fabsf(scores[r] - cosine) < 1e-5f);
+    }
+    // Only vector 1234 has tag 1234, and it is the query
+    const int tagged =
+        vs_search_topk_tag(store, 1234, q, LIVE_DIM, 8, idx, scores);
+    assert(tagged <= 1 && (tagged == 0 || fabsf(scores[0] - 1.0f) < 1e-5f));
+  }
+  return NULL;
+}
+
+// A row of a saved churn store holds the vector its tag (and ID) names
+static void check_churn_row(const VectorStore *store, size_t row) {
+  uint64_t tag, id;
+  assert(vs_get_tag(store, row, &tag) == 0 && tag < LIVE_ROWS);
+  assert(vs_get_id(store, row, &id) == 0 && id == tag);
+  assert(vs_find_id(store, id) == (int)row);
+  float v[LIVE_DIM];
+  live_vector((int)tag, v);
+  const float norm = sqrtf(vs_dot_product(v, v, LIVE_DIM));
+  const float *stored = vs_get(store, row);
+  for (int j = 0; j < LIVE_DIM; j++)
+    assert(fabsf(stored[j] - v[j] / norm) < 1e-5f);
+}
+
+// vs_find_nearest agrees with a scan of the rows vs_get still returns
+static void check_nearest(VectorStore *store, float *query, size_t dim) {
+  int best = -1;
+  float best_dot = 0.0f;
+  for (size_t i = 0; i < store->count; i++) {
+    const float *row = vs_get(store, i);
+    const float dot = row ? vs_dot_product(row, query, dim) : 0.0f;
+    if (row && (best < 0 || dot > best_dot)) {
+      best = (int)i;
+      best_dot = dot;
+    }
+  }
+  assert(vs_find_nearest(store, query, dim) == best);
+}
 
 int main() {
   VectorStore *store = vs_create(10);
@@ -26,7 +229,999 @@ int main() {
   printf("Nearest to [0.5,0.5]: %d\n", idx2);
   assert(idx2 == 2);
 
+  // Stats: present only with VS_ENABLE_STATS, zeroed otherwise
+  VsStats stats;
+  if (vs_get_stats(store, &stats) == 0) {
+    assert(stats.adds == 3 && stats.searches == 2);
+    assert(stats.vectors_scanned == 6);
+    uint64_t timed = 0;
+    for (int i = 0; i < VS_LATENCY_BUCKETS; i++)
+      timed += stats.latency_buckets[i];
+    assert(timed == 2);
+    vs_reset_stats(store);
+    vs_get_stats(store, &stats);
+  }
+  assert(stats.searches == 0 && stats.adds == 0);
+
+  // Dimension is fixed by the first vector
+  float v4[] = {1.0, 0.0, 0.0};
+  assert(vs_add(store, v4, 3) == -1);
+  assert(vs_find_nearest(store, v4, 3) == -1);
+  assert(store->count == 3);
+
+  // Zero vectors have no direction
+  float zero[] = {0.0, 0.0};
+  assert(vs_add(store, zero, 2) == -1);
+  assert(store->count == 3);
+
+  // Scaling a stored vector or the query doesn't change the ranking
+  float big[] = {0.0, 250.0};
+  assert(vs_add(store, big, 2) == 0);
+  float q3[] = {0.2, 3.0};
+  assert(vs_find_nearest(store, q3, 2) == 1);
+
+  // Top-k: best first, cosine scores, ties to the lower index
+  int idx[8];
+  float scores[8];
+  float q4[] = {2.0, 0.0};
+  assert(vs_search_topk(store, q4, 2, 2, idx, scores) == 2);
+  assert(idx[0] == 0 && idx[1] == 2);
+  assert(fabsf(scores[0] - 1.0f) < 1e-6f);
+  assert(fabsf(scores[1] - 0.70710678f) < 1e-5f);
+  float q5[] = {0.0, 1.0};
+  assert(vs_search_topk(store, q5, 2, 8, idx, scores) == 4);
+  assert(idx[0] == 1 && idx[1] == 3 && idx[2] == 2 && idx[3] == 0);
+  assert(scores[0] == scores[1] && scores[2] > scores[3]);
+  assert(vs_search_topk(store, q5, 2, 0, idx, scores) == 0);
+  assert(vs_search_topk(store, v4, 3, 2, idx, scores) == -1);
+  assert(vs_search_topk(store, zero, 2, 2, idx, scores) == -1);
+  assert(vs_search_topk(store, q5, 2, 2, NULL, scores) == -1);
+
+  // Weights scale scores, so an important memory can outrank a closer one
+  assert(!store->weighted);
+  assert(vs_set_weight(store, 2, 2.0f) == 0);
+  assert(vs_search_topk(store, q5, 2, 1, idx, scores) == 1);
+  assert(idx[0] == 2 && fabsf(scores[0] - 1.41421356f) < 1e-5f);
+  assert(vs_set_weight(store, 4, 1.0f) == -1);
+  assert(vs_set_weight(store, 0, NAN) == -1);
+  float v5[] = {-1.0, 0.0};
+  assert(vs_add_weighted(store, v5, 2, INFINITY) == -1);
+  assert(vs_add_weighted(store, v5, 2, -3.0f) == 0);
+  assert(vs_search_topk(store, q4, 2, 5, idx, scores) == 5);
+  assert(idx[0] == 4 && fabsf(scores[0] - 3.0f) < 1e-6f);
+  assert(idx[1] == 2 && idx[2] == 0 && idx[3] == 1 && idx[4] == 3);
+
   vs_free(store);
+
+  // Top-k from a larger store matches a full sort by score
+  VectorStore *ranked = vs_create(0);
+  for (int i = 0; i < 200; i++) {
+    float v[3] = {cosf(0.1f * i), sinf(0.1f * i), 0.5f};
+    assert(vs_add_weighted(ranked, v, 3, 1.0f + (i % 7) * 0.1f) == 0);
+  }
+  float q6[] = {0.3f, -0.8f, 0.1f};
+  int top[10];
+  float top_scores[10];
+  assert(vs_search_topk(ranked, q6, 3, 10, top, top_scores) == 10);
+  for (int r = 0; r < 10; r++) {
+    int better = 0;
+    for (int i = 0; i < 200; i++) {
+      const float s = vs_dot_product(vs_get(ranked, (size_t)i), q6, 3) *
+                      (1.0f + (i % 7) * 0.1f);
+      better += s > top_scores[r] * sqrtf(0.74f) + 1e-6f;
+    }
+    assert(better == r);
+    assert(r == 0 || top_scores[r] <= top_scores[r - 1]);
+  }
+  vs_free(ranked);
+
+  // Tags partition the store; searches by tag see only that tag's rows
+  VectorStore *agents = vs_create(0);
+  for (int i = 0; i < 3000; i++) {
+    float v[2] = {cosf(0.0005f * i), sinf(0.0005f * i)};
+    const uint64_t tag = (uint64_t)(i % 100) << 40; // Many sparse tags
+    assert(vs_add_tagged(agents, v, 2, tag, 1.0f) == 0);
+  }
+  float untagged[] = {1.0, 0.0};
+  assert(vs_add(agents, untagged, 2) == 0);
+  assert(agents->partition_count == 100);
+  assert(vs_count_tag(agents, 7ull << 40) == 30);
+  assert(vs_count_tag(agents, 0) == 31 && vs_count_tag(agents, 12345) == 0);
+  uint64_t tag;
+  assert(vs_get_tag(agents, 1207, &tag) == 0 && tag == 7ull << 40);
+  assert(vs_get_tag(agents, 3000, &tag) == 0 && tag == 0);
+  assert(vs_get_tag(agents, 3001, &tag) == -1);
+
+  float q7[] = {1.0, 0.0};
+  assert(vs_search_topk_tag(agents, 7ull << 40, q7, 2, 3, top, top_scores) ==
+         3);
+  // Row 7 is nearest in angle, then 107 and 207
+  assert(top[0] == 7 && top[1] == 107 && top[2] == 207);
+  assert(vs_search_topk_tag(agents, 0, q7, 2, 2, top, top_scores) == 2);
+  assert(top[0] == 0 && top[1] == 3000);
+  assert(vs_search_topk_tag(agents, 42, q7, 2, 3, top, top_scores) == 0);
+  assert(vs_search_topk_tag(agents, 0, v4, 3, 3, top, top_scores) == -1);
+  vs_free(agents);
+
+  // Every kernel this CPU runs agrees with a double-precision reference,
+  // for tails of every length, and ranks a scan the same way
+  const char *kernel_names[] = {"avx512", "avx2", "neon", "scalar"};
+  const char *best = vs_kernel_name();
+  printf("Kernel: %s\n", best);
+  float a[389], b[389];
+  int8_t bytes[389];
+  uint16_t halves[389];
+  for (int i = 0; i < 389; i++) {
+    a[i] = sinf(0.37f * i);
+    b[i] = cosf(0.11f * i) - 0.2f;
+    bytes[i] = (int8_t)(i * 37 % 255 - 127);
+    halves[i] = vs_float_to_half(b[i]);
+  }
+  VectorStore *scan = vs_create(0);
+  for (int i = 0; i < 103; i++) {
+    float v[384];
+    for (int j = 0; j < 384; j++)
+      v[j] = sinf(0.37f * j + 0.05f * i);
+    assert(vs_add(scan, v, 384) == 0);
+  }
+  int first_top[10] = {-1};
+  for (int n = 0; n < 4; n++) {
+    if (vs_use_kernel(kernel_names[n]) != 0)
+      continue;
+    assert(!strcmp(vs_kernel_name(), kernel_names[n]));
+    for (size_t dim = 0; dim <= 389; dim++) {
+      double expected = 0.0, bound = 0.0;
+      for (size_t i = 0; i < dim; i++) {
+        expected += (double)a[i] * b[i];
+        bound += fabs((double)a[i] * b[i]);
+      }
+      const double got = vs_dot_product(a, b, dim);
+      assert(fabs(got - expected) <= 1e-6 * bound + 1e-7);
+      // Code kernels against the same reference on decoded codes
+      double expected_i8 = 0.0, bound_i8 = 0.0;
+      double expected_f16 = 0.0, bound_f16 = 0.0;
+      for (size_t i = 0; i < dim; i++) {
+        expected_i8 += (double)a[i] * bytes[i];
+        bound_i8 += fabs((double)a[i] * bytes[i]);
+        const double half = vs_half_to_float(halves[i]);
+        expected_f16 += a[i] * half;
+        bound_f16 += fabs(a[i] * half);
+      }
+      const VsKernel *kernel = vs_kernel();
+      assert(fabs(kernel->dot_i8(a, bytes, dim) - expected_i8) <=
+             1e-6 * bound_i8 + 1e-7);
+      assert(fabs(kernel->dot_f16(a, halves, dim) - expected_f16) <=
+             1e-6 * bound_f16 + 1e-7);
+    }
+    assert(vs_search_topk(scan, b, 384, 10, top, top_scores) == 10);
+    assert(vs_find_nearest(scan, b, 384) == top[0]);
+    if (first_top[0] == -1)
+      memcpy(first_top, top, sizeof(top));
+    assert(!memcmp(top, first_top, sizeof(top)));
+  }
+  // Batches match one search per query on every kernel, across tile and
+  // block edges (37 components, 150 rows, 70 queries)
+  VectorStore *batch = vs_create(0);
+  static float batch_queries[70][37];
+  for (int i = 0; i < 150; i++) {
+    float v[37];
+    for (int j = 0; j < 37; j++)
+      v[j] = sinf(0.91f * j + 0.37f * i) + 0.1f;
+    assert(vs_add_weighted(batch, v, 37, i % 3 ? 1.0f : 1.5f) == 0);
+  }
+  for (int q = 0; q < 70; q++) {
+    for (int j = 0; j < 37; j++)
+      batch_queries[q][j] = cosf(0.53f * j + 0.11f * q);
+  }
+  static int batch_idx[70 * 10];
+  static float batch_scores[70 * 10];
+  for (int n = 0; n < 4; n++) {
+    if (vs_use_kernel(kernel_names[n]) != 0)
+      continue;
+    assert(vs_search_batch(batch, batch_queries[0], 70, 37, 10, batch_idx,
+                           batch_scores) == 10);
+    for (int q = 0; q < 70; q++) {
+      assert(vs_search_topk(batch, batch_queries[q], 37, 10, top,
+                            top_scores) == 10);
+      assert(!memcmp(batch_idx + q * 10, top, sizeof(top)));
+      assert(!memcmp(batch_scores + q * 10, top_scores, sizeof(top_scores)));
+    }
+  }
+  vs_use_kernel(best);
+  assert(vs_search_batch(batch, batch_queries[0], 2, 36, 10, batch_idx,
+                         batch_scores) == -1);
+  memset(batch_queries[1], 0, sizeof(batch_queries[1]));
+  assert(vs_search_batch(batch, batch_queries[0], 2, 37, 10, batch_idx,
+                         batch_scores) == -1);
+  assert(vs_search_batch(batch, batch_queries[0], 1, 37, 200, batch_idx,
+                         batch_scores) == 150);
+  assert(vs_quantize(batch, VS_QUANT_FP16, 0, 1) == 0);
+  assert(vs_search_batch(batch, batch_queries[2], 3, 37, 5, batch_idx,
+                         batch_scores) == 5);
+  assert(vs_search_topk(batch, batch_queries[4], 37, 5, top, top_scores) ==
+         5);
+  assert(!memcmp(batch_idx + 10, top, 5 * sizeof(int)));
+  vs_free(batch);
+  assert(vs_use_kernel("scalar") == 0 && vs_use_kernel("sse9") == -1);
+  assert(vs_use_kernel(best) == 0 && !strcmp(vs_kernel_name(), best));
+  vs_free(scan);
+
+  // HNSW: indexed rows, existing and added later, are found with high
+  // recall; without an index vs_search_ann is exact
+  VectorStore *ann = vs_create(0);
+  uint64_t seed = 12345;
+  float points[3000][32];
+  for (int i = 0; i < 3000; i++) {
+    for (int j = 0; j < 32; j++) {
+      seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+      points[i][j] = (float)(seed >> 40) / (1 << 24) - 0.5f;
+    }
+  }
+  for (int i = 0; i < 1000; i++)
+    assert(vs_add(ann, points[i], 32) == 0);
+  assert(vs_search_ann(ann, points[5], 32, 1, 1, top, top_scores) == 1);
+  assert(top[0] == 5);
+  assert(vs_enable_index(ann, 1, 100) == -1 && ann->index == NULL);
+  assert(vs_enable_index(ann, 8, 100) == 0);
+  for (int i = 1000; i < 3000; i++)
+    assert(vs_add(ann, points[i], 32) == 0);
+  int hits = 0;
+  int exact[10];
+  float exact_scores[10];
+  for (int q = 0; q < 50; q++) {
+    float query[32];
+    for (int j = 0; j < 32; j++)
+      query[j] = points[q * 37][j] + 0.5f * points[q * 37 + 1][j];
+    assert(vs_search_topk(ann, query, 32, 10, exact, exact_scores) == 10);
+    assert(vs_search_ann(ann, query, 32, 10, 64, top, top_scores) == 10);
+    for (int r = 0; r < 10; r++) {
+      assert(r == 0 || top_scores[r] <= top_scores[r - 1]);
+      for (int e = 0; e < 10; e++)
+        hits += top[r] == exact[e];
+    }
+  }
+  printf("HNSW recall@10: %.3f\n", hits / 500.0);
+  assert(hits >= 450);
+  assert(vs_search_ann(ann, points[2999], 32, 1, 16, top, top_scores) == 1);
+  assert(top[0] == 2999 && fabsf(top_scores[0] - 1.0f) < 1e-5f);
+  assert(vs_search_ann(ann, points[0], 31, 1, 16, top, top_scores) == -1);
+  vs_free(ann);
+
+  // Quantized stores score compressed codes; re-ranking restores exact
+  // scores for the winners
+  VectorStore *quant = vs_create(0);
+  for (int i = 0; i < 2000; i++) {
+    float v[64];
+    for (int j = 0; j < 64; j++)
+      v[j] = points[i][j % 32] * (j < 32 ? 1.0f : (float)(i % 3) - 1.0f);
+    assert(vs_add(quant, v, 64) == 0);
+  }
+  assert(vs_quantize(quant, VS_QUANT_PQ, 7, 1) == -1); // 7 doesn't divide 64
+  assert(vs_quantize(quant, 9, 0, 1) == -1 && quant->quant == NULL);
+  const size_t full_bytes = vs_memory_bytes(quant);
+  const int kinds[] = {VS_QUANT_INT8, VS_QUANT_FP16, VS_QUANT_PQ};
+  const float tolerance[] = {0.02f, 0.002f, 0.25f};
+  for (int n = 0; n < 3; n++) {
+    assert(vs_quantize(quant, kinds[n], 16, 1) == 0);
+    assert(vs_set_rerank(quant, 0) == 0);
+    int self = 0;
+    for (int q = 0; q < 20; q++) {
+      const float *row = vs_get(quant, (size_t)(q * 97));
+      float query[64];
+      memcpy(query, row, sizeof(query));
+      assert(vs_search_topk(quant, query, 64, 10, top, top_scores) == 10);
+      self += top[0] == q * 97;
+      for (int r = 0; r < 10; r++) {
+        const float exact_score = vs_dot_product(vs_get(quant, top[r]), row,
+                                                 64);
+        assert(fabsf(top_scores[r] - exact_score) < tolerance[n]);
+      }
+      // Re-ranked results carry exact scores, in exact order
+      assert(vs_set_rerank(quant, 8) == 0);
+      assert(vs_search_topk(quant, query, 64, 10, top, top_scores) == 10);
+      assert(vs_search_topk(quant, query, 64, 10, exact, exact_scores) ==
+             10);
+      assert(top[0] == q * 97 && fabsf(top_scores[0] - 1.0f) < 1e-5f);
+      for (int r = 1; r < 10; r++) {
+        const float exact_score = vs_dot_product(vs_get(quant, top[r]), row,
+                                                 64);
+        assert(fabsf(top_scores[r] - exact_score) < 1e-5f);
+        assert(top_scores[r] <= top_scores[r - 1]);
+      }
+      vs_set_rerank(quant, 0);
+    }
+    assert(self >= (kinds[n] == VS_QUANT_PQ ? 15 : 20));
+  }
+  // Back to exact scores while the float rows are around
+  assert(vs_quantize(quant, VS_QUANT_NONE, 0, 1) == 0 && !quant->quant);
+  assert(vs_memory_bytes(quant) == full_bytes);
+
+  // Dropping the floats cuts memory; later adds are encoded directly
+  assert(vs_quantize(quant, VS_QUANT_INT8, 0, 0) == 0);
+  assert(vs_get(quant, 0) == NULL && quant->data[0] == NULL);
+  // Every row sheds its floats for a byte per component and a scale
+  assert(full_bytes - vs_memory_bytes(quant) >=
+         quant->capacity * (64 * sizeof(float) - 64 - sizeof(float)));
+  assert(vs_set_rerank(quant, 4) == -1);
+  assert(vs_enable_index(quant, 8, 32) == -1);
+  assert(vs_quantize(quant, VS_QUANT_NONE, 0, 1) == -1);
+  float fresh[64];
+  for (int j = 0; j < 64; j++)
+    fresh[j] = cosf(0.3f * j);
+  for (int i = 0; i < 100; i++)
+    assert(vs_add_tagged(quant, fresh, 64, 5, 1.0f) == 0);
+  assert(quant->count == 2100);
+  assert(vs_search_topk_tag(quant, 5, fresh, 64, 3, top, top_scores) == 3);
+  assert(top[0] == 2000 && fabsf(top_scores[0] - 1.0f) < 0.02f);
+  assert(vs_find_nearest(quant, fresh, 64) == 2000);
+  vs_free(quant);
+  VectorStore *empty = vs_create(0);
+  assert(vs_quantize(empty, VS_QUANT_INT8, 0, 1) == -1);
+  vs_free(empty);
+
+  // Saved stores open through a mapping and answer exactly as before
+  const char *path = "test_vector.vs";
+  VectorStore *saved = vs_create(0);
+  for (int i = 0; i < 1500; i++)
+    assert(vs_add_tagged(saved, points[i], 32, (uint64_t)(i % 7),
+                         i % 5 ? 1.0f : 2.0f) == 0);
+  assert(vs_enable_index(saved, 8, 64) == 0);
+  assert(vs_quantize(saved, VS_QUANT_INT8, 0, 1) == 0);
+  assert(vs_set_rerank(saved, 4) == 0);
+  assert(vs_save(saved, path) == 0);
+  VectorStore *mapped = vs_open_mmap(path);
+  assert(mapped && mapped->mapping && mapped->count == 1500);
+  assert(mapped->dimension == 32 && mapped->rerank == 4);
+  assert(vs_memory_bytes(mapped) < vs_memory_bytes(saved) / 20);
+  for (int q = 0; q < 20; q++) {
+    float *query = points[2000 + q];
+    int got[10];
+    float got_scores[10];
+    assert(vs_search_topk(saved, query, 32, 10, exact, exact_scores) == 10);
+    assert(vs_search_topk(mapped, query, 32, 10, got, got_scores) == 10);
+    assert(!memcmp(got, exact, sizeof(got)));
+    assert(!memcmp(got_scores, exact_scores, sizeof(got_scores)));
+    assert(vs_search_ann(saved, query, 32, 10, 32, exact, exact_scores) ==
+           10);
+    assert(vs_search_ann(mapped, query, 32, 10, 32, got, got_scores) == 10);
+    assert(!memcmp(got, exact, sizeof(got)));
+    const uint64_t query_tag = (uint64_t)(q % 7);
+    assert(vs_search_topk_tag(saved, query_tag, query, 32, 10, exact,
+                              exact_scores) == 10);
+    assert(vs_search_topk_tag(mapped, query_tag, query, 32, 10, got,
+                              got_scores) == 10);
+    assert(!memcmp(got, exact, sizeof(got)));
+  }
+  assert(vs_get_tag(mapped, 1499, &tag) == 0 && tag == 1499 % 7);
+  assert(vs_count_tag(mapped, 3) == vs_count_tag(saved, 3));
+  assert(!memcmp(vs_get(mapped, 77), vs_get(saved, 77), 32 * sizeof(float)));
+  // Read-only, but can be saved again
+  assert(vs_add(mapped, points[0], 32) == -1 && mapped->count == 1500);
+  assert(vs_set_weight(mapped, 0, 3.0f) == -1);
+  assert(vs_enable_index(mapped, 8, 64) == -1);
+  assert(vs_quantize(mapped, VS_QUANT_FP16, 0, 1) == -1);
+  assert(vs_save(mapped, path) == 0);
+  vs_free(mapped);
+  vs_free(saved);
+  mapped = vs_open_mmap(path);
+  assert(mapped && mapped->count == 1500 && mapped->index && mapped->quant);
+
+  // Codes alone, without the float rows, round-trip too
+  VectorStore *codes = vs_create(0);
+  for (int i = 0; i < 600; i++)
+    assert(vs_add(codes, points[i], 32) == 0);
+  assert(vs_quantize(codes, VS_QUANT_PQ, 8, 0) == 0);
+  assert(vs_save(codes, "test_vector_codes.vs") == 0);
+  VectorStore *mapped_codes = vs_open_mmap("test_vector_codes.vs");
+  assert(mapped_codes && !mapped_codes->data[0] && mapped_codes->quant);
+  assert(vs_search_topk(codes, points[9], 32, 5, exact, exact_scores) == 5);
+  assert(vs_search_topk(mapped_codes, points[9], 32, 5, top, top_scores) ==
+         5);
+  assert(!memcmp(top, exact, 5 * sizeof(int)));
+  vs_free(mapped_codes);
+  vs_free(codes);
+  remove("test_vector_codes.vs");
+
+  // Truncated, foreign and missing files are rejected
+  FILE *whole = fopen(path, "rb");
+  static unsigned char bytes_read[1 << 20];
+  const size_t file_size = fread(bytes_read, 1, sizeof(bytes_read), whole);
+  fclose(whole);
+  assert(file_size > 4096 && file_size < sizeof(bytes_read));
+  FILE *cut = fopen("test_vector_cut.vs", "wb");
+  fwrite(bytes_read, 1, file_size - 64, cut);
+  fclose(cut);
+  assert(vs_open_mmap("test_vector_cut.vs") == NULL);
+  bytes_read[0] ^= 1;
+  cut = fopen("test_vector_cut.vs", "wb");
+  fwrite(bytes_read, 1, file_size, cut);
+  fclose(cut);
+  assert(vs_open_mmap("test_vector_cut.vs") == NULL);
+  remove("test_vector_cut.vs");
+  assert(vs_open_mmap("no_such_store.vs") == NULL);
+  vs_free(mapped);
+  remove(path);
+  VectorStore *blank = vs_create(0);
+  assert(vs_save(blank, path) == 0);
+  vs_free(blank);
+  blank = vs_open_mmap(path);
+  assert(blank && blank->count == 0);
+  assert(vs_search_topk(blank, points[0], 32, 3, top, top_scores) == 0);
+  vs_free(blank);
+  remove(path);
+
+  // Half conversions round to nearest even
+  assert(vs_float_to_half(1.0f) == 0x3c00);
+  assert(vs_float_to_half(-2.0f) == 0xc000);
+  assert(vs_float_to_half(65504.0f) == 0x7bff);
+  assert(vs_float_to_half(1.0f + 0x1.0p-11f) == 0x3c00); // Tie, even
+  assert(vs_float_to_half(1.0f + 0x1.8p-10f) == 0x3c02); // Tie, rounds up
+  assert(vs_half_to_float(vs_float_to_half(0x1.0p-20f)) == 0x1.0p-20f);
+  assert(vs_half_to_float(0x3555) == 0x1.554p-2f);
+
+  // Sharded scans on the pool return exactly the serial results, ties,
+  // weights and codes included; small stores stay on the caller
+  VectorStore *sharded = vs_create(0);
+  for (int i = 0; i < 20000; i++) {
+    float v[48];
+    for (int j = 0; j < 48; j++)
+      v[j] = sinf(0.29f * j + 0.013f * (i % 9000)); // Rows repeat: ties
+    assert(vs_add_weighted(sharded, v, 48, i % 11 ? 1.0f : 1.25f) == 0);
+  }
+  static int serial_idx[3][100];
+  static float serial_scores[3][100];
+  const size_t ks[] = {1, 10, 100};
+  float probe[48];
+  for (int j = 0; j < 48; j++)
+    probe[j] = cosf(0.41f * j);
+  const int serial_nearest = vs_find_nearest(sharded, probe, 48);
+  for (int n = 0; n < 3; n++)
+    assert(vs_search_topk(sharded, probe, 48, ks[n], serial_idx[n],
+                          serial_scores[n]) == (int)ks[n]);
+  assert(vs_set_threads(0, 1000) == -1);
+  assert(vs_set_threads(4, 1000) == 0);
+  for (int repeat = 0; repeat < 20; repeat++) {
+    assert(vs_find_nearest(sharded, probe, 48) == serial_nearest);
+    for (int n = 0; n < 3; n++) {
+      int got[100];
+      float got_scores[100];
+      assert(vs_search_topk(sharded, probe, 48, ks[n], got, got_scores) ==
+             (int)ks[n]);
+      assert(!memcmp(got, serial_idx[n], ks[n] * sizeof(int)));
+      assert(!memcmp(got_scores, serial_scores[n], ks[n] * sizeof(float)));
+    }
+  }
+  assert(vs_set_threads(1, VS_PARALLEL_MIN_ROWS) == 0);
+  assert(vs_quantize(sharded, VS_QUANT_INT8, 0, 1) == 0);
+  assert(vs_search_topk(sharded, probe, 48, 10, serial_idx[1],
+                        serial_scores[1]) == 10);
+  assert(vs_set_threads(3, 1000) == 0);
+  assert(vs_search_topk(sharded, probe, 48, 10, top, top_scores) == 10);
+  assert(!memcmp(top, serial_idx[1], sizeof(top)));
+  VectorStore *small = vs_create(0);
+  for (int i = 0; i < 200; i++)
+    assert(vs_add(small, (float *)vs_get(sharded, (size_t)i), 48) == 0);
+  assert(vs_search_topk(small, probe, 48, 1, top, top_scores) == 1);
+  assert(vs_find_nearest(small, probe, 48) == top[0]);
+  vs_free(small);
+  assert(vs_set_threads(1, VS_PARALLEL_MIN_ROWS) == 0);
+  vs_free(sharded);
+
+  // One thread appends while others search, full-precision and then
+  // int8 (with the floats kept, to check rows): no search blocks, and every
+  // row one returns is complete. Meanwhile the main thread saves a
+  // snapshot, which must be a consistent store of its own.
+  for (int round = 0; round < 2; round++) {
+    LiveStore live;
+    live.store = vs_create(0);
+    atomic_init(&live.done, 0);
+    float v[LIVE_DIM];
+    live_vector(0, v);
+    assert(vs_add_tagged(live.store, v, LIVE_DIM, 0, 1.0f) == 0);
+    if (round == 1)
+      assert(vs_quantize(live.store, VS_QUANT_INT8, 0, 1) == 0);
+    pthread_t writer, readers[2];
+    assert(pthread_create(&writer, NULL, live_writer, &live) == 0);
+    for (int r = 0; r < 2; r++)
+      assert(pthread_create(&readers[r], NULL, live_reader, &live) == 0);
+    while (__atomic_load_n(&live.store->count, __ATOMIC_ACQUIRE) <
+           LIVE_ROWS / 2)
+      ;
+    assert(vs_save(live.store, "test_vector_live.vs") == 0);
+    pthread_join(writer, NULL);
+    for (int r = 0; r < 2; r++)
+      pthread_join(readers[r], NULL);
+    assert(live.store->count == LIVE_ROWS && live.store->segments == 9);
+    assert(vs_count_tag(live.store, 3) == LIVE_ROWS / 5);
+
+    VectorStore *snapshot = vs_open_mmap("test_vector_live.vs");
+    assert(snapshot && snapshot->count >= LIVE_ROWS / 2);
+    size_t listed = 0;
+    for (uint64_t tag = 0; tag < 5; tag++)
+      listed += vs_count_tag(snapshot, tag);
+    assert(listed == snapshot->count);
+    for (size_t i = 0; i < snapshot->count; i++)
+      check_live_row(snapshot, (int)i);
+    vs_free(snapshot);
+    remove("test_vector_live.vs");
+    vs_free(live.store);
+  }
+
+  // The same with removals and compaction alongside: searches return only
+  // whole rows, and a snapshot saved mid-churn is consistent
+  for (int i = 0; i < LIVE_ROWS; i++) {
+    float v[LIVE_DIM], q[LIVE_DIM];
+    live_vector(i, v);
+    live_vector(1234, q);
+    churn_scores[i] = vs_dot_product(v, q, LIVE_DIM) /
+                      sqrtf(vs_dot_product(v, v, LIVE_DIM) *
+                            vs_dot_product(q, q, LIVE_DIM));
+  }
+  qsort(churn_scores, LIVE_ROWS, sizeof(float), compare_floats);
+  {
+    LiveStore live;
+    live.store = vs_create(0);
+    atomic_init(&live.done, 0);
+    atomic_init(&live.added, 0);
+    float v[LIVE_DIM];
+    live_vector(0, v);
+    assert(vs_add_tagged(live.store, v, LIVE_DIM, 0, 1.0f) == 0);
+    pthread_t writer, readers[2];
+    assert(pthread_create(&writer, NULL, churn_writer, &live) == 0);
+    for (int r = 0; r < 2; r++)
+      assert(pthread_create(&readers[r], NULL, churn_reader, &live) == 0);
+    while (atomic_load(&live.added) < LIVE_ROWS / 2)
+      ;
+    assert(vs_save(live.store, "test_vector_churn.vs") == 0);
+    pthread_join(writer, NULL);
+    for (int r = 0; r < 2; r++)
+      pthread_join(readers[r], NULL);
+    assert(vs_count_tag(live.store, 1234) == 0 &&
+           vs_count_tag(live.store, 1236) == 1);
+
+    VectorStore *snapshot = vs_open_mmap("test_vector_churn.vs");
+    assert(snapshot && snapshot->count >= LIVE_ROWS / 6);
+    size_t live_rows = 0;
+    for (size_t i = 0; i < snapshot->count; i++) {
+      if (vs_get(snapshot, i)) {
+        check_churn_row(snapshot, i);
+        live_rows++;
+      }
+    }
+    assert(live_rows == snapshot->count - vs_count_removed(snapshot));
+    vs_free(snapshot);
+    remove("test_vector_churn.vs");
+    vs_free(live.store);
+  }
+
+  // Removed rows drop out of every search and accessor at once; vs_compact
+  // then moves the last rows into the holes a few at a time, reporting each
+  // move, until the store is dense again and its spare segments are freed.
+  // Vector 1000 is points[1500], which replaces vector 999.
+  VectorStore *churn = vs_create(0);
+  int where[1001]; // Row holding vector i, -1 once removed
+  static float stored[1001][32];
+  for (int i = 0; i < 1000; i++) {
+    assert(vs_add_tagged(churn, points[i], 32, (uint64_t)(i % 3),
+                         i == 999 ? 2.0f : 1.0f) == 0);
+    where[i] = i;
+  }
+  size_t removed = 0;
+  for (int i = 0; i < 999; i++) {
+    if (i % 2 == 0 || i >= 900) {
+      assert(vs_remove(churn, (size_t)i) == 0);
+      where[i] = -1;
+      removed++;
+    }
+  }
+  assert(vs_remove(churn, 4) == -1 && vs_remove(churn, 1000) == -1);
+  assert(vs_count_removed(churn) == removed && churn->count == 1000);
+  assert(!vs_get(churn, 4) && vs_get_tag(churn, 4, &tag) == -1);
+  assert(vs_set_weight(churn, 4, 2.0f) == -1);
+  assert(vs_count_tag(churn, 1) == 150);
+  for (int q = 0; q < 40; q++)
+    check_nearest(churn, points[q * 25], 32);
+  assert(vs_search_topk(churn, points[999], 32, 3, top, top_scores) == 3);
+  assert(top[0] == 999 && fabsf(top_scores[0] - 2.0f) < 1e-5f);
+  assert(vs_search_topk_tag(churn, 2, points[2], 32, 10, top, top_scores) ==
+         10);
+  for (int r = 0; r < 10; r++)
+    assert(top[r] % 3 == 2 && top[r] % 2 == 1 && top[r] < 900);
+  assert(vs_search_batch(churn, points[7], 1, 32, 10, exact, exact_scores) ==
+         10);
+  assert(vs_search_topk(churn, points[7], 32, 10, top, top_scores) == 10);
+  assert(!memcmp(top, exact, sizeof(exact)));
+
+  // An update adds the new vector, with the old tag and weight, and
+  // removes the old one
+  assert(vs_update(churn, 999, points[1500], 32) == 1000);
+  assert(vs_update(churn, 999, points[1500], 32) == -1);
+  where[999] = -1;
+  where[1000] = 1000;
+  removed++;
+  assert(!vs_get(churn, 999) && vs_get_tag(churn, 1000, &tag) == 0 &&
+         tag == 0);
+  assert(vs_search_topk(churn, points[1500], 32, 1, top, top_scores) == 1);
+  assert(top[0] == 1000 && fabsf(top_scores[0] - 2.0f) < 1e-5f);
+
+  // Saved with its removals, which a mapping keeps but cannot compact
+  assert(vs_save(churn, "test_vector_removed.vs") == 0);
+  VectorStore *reopened = vs_open_mmap("test_vector_removed.vs");
+  assert(reopened && reopened->count == 1001);
+  assert(vs_count_removed(reopened) == removed);
+  for (size_t i = 0; i < 1001; i++)
+    assert(!vs_get(reopened, i) == !vs_get(churn, i));
+  assert(vs_search_topk(churn, points[7], 32, 10, exact, exact_scores) ==
+         10);
+  assert(vs_search_topk(reopened, points[7], 32, 10, top, top_scores) == 10);
+  assert(!memcmp(top, exact, sizeof(exact)));
+  assert(vs_count_tag(reopened, 1) == 150);
+  assert(vs_remove(reopened, 1) == -1);
+  assert(vs_compact(reopened, 10, NULL, NULL) == -1);
+  vs_free(reopened);
+  remove("test_vector_removed.vs");
+
+  for (int i = 0; i <= 1000; i++) {
+    if (where[i] >= 0)
+      memcpy(stored[i], vs_get(churn, (size_t)where[i]), sizeof(stored[i]));
+  }
+  const size_t churn_bytes = vs_memory_bytes(churn);
+  int steps = 0;
+  while (vs_count_removed(churn)) {
+    int from[25], to[25];
+    const int moves = vs_compact(churn, 25, from, to);
+    assert(moves >= 0 && moves <= 25);
+    for (int m = 0; m < moves; m++) {
+      assert(to[m] < from[m]);
+      for (int i = 0; i <= 1000; i++)
+        where[i] = where[i] == from[m] ? to[m] : where[i];
+    }
+    steps++;
+    // Every vector is where the moves say, with its tag
+    for (int i = 0; i <= 1000; i++) {
+      if (where[i] < 0)
+        continue;
+      const float *row = vs_get(churn, (size_t)where[i]);
+      assert(row && !memcmp(row, stored[i], sizeof(stored[i])));
+      assert(vs_get_tag(churn, (size_t)where[i], &tag) == 0 &&
+             tag == (uint64_t)(i == 1000 ? 0 : i % 3));
+    }
+    check_nearest(churn, points[steps], 32);
+  }
+  assert(steps > 1 && vs_compact(churn, 25, NULL, NULL) == 0);
+  assert(churn->count == 451 && churn->capacity == 496);
+  assert(vs_memory_bytes(churn) < churn_bytes);
+  assert(vs_count_tag(churn, 1) == 150);
+  assert(vs_search_topk(churn, points[1500], 32, 1, top, top_scores) == 1);
+  assert(top[0] == where[1000] && fabsf(top_scores[0] - 2.0f) < 1e-5f);
+  // Freed rows are filled again
+  assert(vs_add(churn, points[1600], 32) == 0 && churn->count == 452);
+  assert(vs_find_nearest(churn, points[1600], 32) == 451);
+  vs_free(churn);
+
+  // Indexed stores route around removed rows without returning them, and
+  // compaction relinks the rows that pointed at them: recall holds
+  VectorStore *pruned = vs_create(0);
+  for (int i = 0; i < 2000; i++)
+    assert(vs_add(pruned, points[i], 32) == 0);
+  assert(vs_enable_index(pruned, 8, 100) == 0);
+  for (int i = 0; i < 2000; i++) {
+    if (i % 3 == 1 || i < 300)
+      assert(vs_remove(pruned, (size_t)i) == 0);
+  }
+  for (int q = 0; q < 20; q++) {
+    const int n = vs_search_ann(pruned, points[q], 32, 10, 64, top,
+                                top_scores);
+    for (int r = 0; r < n; r++)
+      assert(top[r] >= 300 && top[r] % 3 != 1);
+  }
+  // Saved before compaction, the removed rows keep their vectors in the
+  // file: the mapped graph walks the same route and finds the same rows
+  assert(vs_save(pruned, "test_vector_pruned.vs") == 0);
+  VectorStore *mapped_pruned = vs_open_mmap("test_vector_pruned.vs");
+  assert(mapped_pruned && vs_count_removed(mapped_pruned) == 867);
+  for (int q = 0; q < 20; q++) {
+    int mapped_top[10];
+    float mapped_scores[10];
+    const int n = vs_search_ann(pruned, points[q], 32, 10, 64, top,
+                                top_scores);
+    assert(vs_search_ann(mapped_pruned, points[q], 32, 10, 64, mapped_top,
+                         mapped_scores) == n);
+    for (int r = 0; r < n; r++)
+      assert(mapped_top[r] == top[r] && mapped_scores[r] == top_scores[r]);
+  }
+  vs_free(mapped_pruned);
+  remove("test_vector_pruned.vs");
+  assert(vs_compact(pruned, SIZE_MAX, NULL, NULL) > 0);
+  assert(vs_count_removed(pruned) == 0 && pruned->count == 1133);
+  for (int i = 2000; i < 2500; i++)
+    assert(vs_add(pruned, points[i], 32) == 0);
+  hits = 0;
+  for (int q = 0; q < 50; q++) {
+    float query[32];
+    for (int j = 0; j < 32; j++)
+      query[j] = points[q * 37][j] + 0.5f * points[q * 37 + 1][j];
+    assert(vs_search_topk(pruned, query, 32, 10, exact, exact_scores) == 10);
+    assert(vs_search_ann(pruned, query, 32, 10, 64, top, top_scores) == 10);
+    for (int r = 0; r < 10; r++) {
+      for (int e = 0; e < 10; e++)
+        hits += top[r] == exact[e];
+    }
+  }
+  assert(hits >= 450);
+  assert(vs_search_ann(pruned, points[2499], 32, 1, 16, top, top_scores) ==
+         1);
+  assert(top[0] == 1632);
+  vs_free(pruned);
+
+  // A partial compaction leaves unfilled holes in the graph; searches and
+  // saves step over them, round after round
+  VectorStore *partial = vs_create(0);
+  for (int i = 0; i < 400; i++)
+    assert(vs_add(partial, points[i], 32) == 0);
+  assert(vs_enable_index(partial, 2, 32) == 0);
+  for (int i = 0; i < 400; i++) {
+    if (i % 8 < 5 || i < 100)
+      assert(vs_remove(partial, (size_t)i) == 0);
+  }
+  for (size_t moves = 1; vs_count_removed(partial); moves *= 3) {
+    const size_t before = vs_count_removed(partial);
+    assert(vs_compact(partial, moves, NULL, NULL) > 0);
+    assert(vs_count_removed(partial) < before);
+    hits = 0;
+    for (int q = 0; q < 20; q++) {
+      assert(vs_search_topk(partial, points[q], 32, 10, exact,
+                            exact_scores) == 10);
+      assert(vs_search_ann(partial, points[q], 32, 10, 64, top,
+                           top_scores) == 10);
+      for (int r = 0; r < 10; r++) {
+        assert(vs_get(partial, (size_t)top[r]));
+        for (int e = 0; e < 10; e++)
+          hits += top[r] == exact[e];
+      }
+    }
+    assert(hits >= 180);
+    assert(vs_save(partial, "test_vector_partial.vs") == 0);
+    VectorStore *mapped_partial = vs_open_mmap("test_vector_partial.vs");
+    assert(mapped_partial);
+    assert(vs_search_ann(mapped_partial, points[0], 32, 10, 64, top,
+                         top_scores) == 10);
+    vs_free(mapped_partial);
+  }
+  assert(partial->count == 114);
+  vs_free(partial);
+  remove("test_vector_partial.vs");
+
+  // Codes move with their rows
+  VectorStore *coded = vs_create(0);
+  for (int i = 0; i < 500; i++)
+    assert(vs_add(coded, points[i], 32) == 0);
+  assert(vs_quantize(coded, VS_QUANT_INT8, 0, 0) == 0);
+  for (int i = 0; i < 250; i++)
+    assert(vs_remove(coded, (size_t)(2 * i)) == 0);
+  int from[250], to[250];
+  assert(vs_compact(coded, 250, from, to) == 125);
+  for (int m = 0; m < 125; m++)
+    assert(vs_find_nearest(coded, points[from[m]], 32) == to[m]);
+  assert(vs_find_nearest(coded, points[1], 32) == 1);
+  assert(coded->count == 250);
+  vs_free(coded);
+
+  // IDs count up in add order and stay with their vectors through updates
+  // and compaction; ID searches report them, from a mapping too
+  VectorStore *known = vs_create(0);
+  uint64_t known_ids[600], known_tags[600];
+  float known_weights[600];
+  for (int i = 0; i < 600; i++) {
+    known_tags[i] = (uint64_t)(i % 4);
+    known_weights[i] = i == 17 ? 3.0f : 1.0f;
+  }
+  assert(vs_add_batch(known, points[0], 600, 32, known_tags, known_weights,
+                      known_ids) == 600);
+  for (int i = 0; i < 600; i++) {
+    uint64_t id;
+    assert(known_ids[i] == (uint64_t)i && vs_find_id(known, i) == i);
+    assert(vs_get_id(known, (size_t)i, &id) == 0 && id == (uint64_t)i);
+  }
+  // A batch stops at the first vector vs_add would refuse
+  float rejected[3][32];
+  memcpy(rejected, points[600], sizeof(rejected));
+  memset(rejected[1], 0, sizeof(rejected[1]));
+  assert(vs_add_batch(known, rejected[0], 3, 32, NULL, NULL, known_ids) == 1);
+  assert(known_ids[0] == 600 && vs_find_id(known, 601) == -1);
+  assert(vs_add_batch(known, rejected[0], 1, 31, NULL, NULL, NULL) == 0);
+  for (int i = 0; i < 601; i += 2)
+    assert(vs_remove_id(known, (uint64_t)i) == 0);
+  assert(vs_remove_id(known, 4) == -1 && vs_find_id(known, 4) == -1);
+  assert(vs_get_id(known, 4, &tag) == -1);
+  // Updating keeps the ID, tag and weight on the new row
+  assert(vs_update_id(known, 17, points[2000], 32) == 0);
+  assert(vs_find_id(known, 17) == 601);
+  assert(vs_get_tag(known, 601, &tag) == 0 && tag == 1);
+  assert(vs_update_id(known, 4, points[2000], 32) == -1);
+  uint64_t found_ids[2 * 10];
+  float found_scores[2 * 10];
+  float queries[2][32];
+  memcpy(queries[0], points[2000], sizeof(queries[0]));
+  memcpy(queries[1], points[301], sizeof(queries[1]));
+  assert(vs_search_ids(known, queries[0], 2, 32, 10, found_ids,
+                       found_scores) == 10);
+  assert(found_ids[0] == 17 && fabsf(found_scores[0] - 3.0f) < 1e-5f);
+  assert(found_ids[10] == 301 && fabsf(found_scores[10] - 1.0f) < 1e-5f);
+  assert(vs_search_tag_ids(known, 1, queries[0], 2, 10, 32, found_ids,
+                           found_scores) == -1); // dim and k swapped
+  assert(vs_search_tag_ids(known, 1, queries[0], 2, 32, 10, found_ids,
+                           found_scores) == 10);
+  for (int r = 0; r < 20; r++)
+    assert(found_ids[r] % 4 == 1);
+  assert(found_ids[0] == 17 && found_ids[10] == 301);
+  assert(vs_search_tag_ids(known, 0, queries[0], 2, 32, 10, found_ids,
+                           found_scores) == 0); // Every even row is gone
+  assert(vs_search_tag_ids(known, 9, queries[0], 2, 32, 10, found_ids,
+                           found_scores) == 0);
+  while (vs_count_removed(known))
+    assert(vs_compact(known, 40, NULL, NULL) >= 0);
+  assert(known->count == 300 && known->id_count == 300);
+  for (int i = 1; i < 600; i += 2) {
+    const int row = vs_find_id(known, (uint64_t)i);
+    uint64_t id;
+    assert(row >= 0 && row < 300 && vs_get_id(known, (size_t)row, &id) == 0);
+    assert(id == (uint64_t)i);
+    assert(vs_find_nearest(known, points[i == 17 ? 2000 : i], 32) == row);
+  }
+  // New IDs carry on from the last one given, never reusing a removed one
+  assert(vs_add_batch(known, points[2001], 1, 32, NULL, NULL, known_ids) ==
+         1);
+  assert(known_ids[0] == 601 && vs_find_id(known, 601) == 300);
+  assert(vs_save(known, "test_vector_ids.vs") == 0);
+  VectorStore *known_map = vs_open_mmap("test_vector_ids.vs");
+  assert(known_map && known_map->next_id == 602);
+  for (uint64_t id = 0; id < 610; id++)
+    assert(vs_find_id(known_map, id) == vs_find_id(known, id));
+  assert(vs_search_tag_ids(known_map, 1, queries[0], 2, 32, 10, found_ids,
+                           found_scores) == 10);
+  assert(found_ids[0] == 17 && found_ids[10] == 301);
+  assert(vs_remove_id(known_map, 17) == -1);
+  vs_free(known_map);
+  remove("test_vector_ids.vs");
+  vs_free(known);
+
+  // A batch stores exactly what one add per vector would (rows, codes,
+  // tags, weights and IDs) whatever the thread count, and the index it
+  // builds in rounds depends on the rows only
+  VectorStore *serial = vs_create(0), *bulk = vs_create(0);
+  uint64_t bulk_tags[3000];
+  float bulk_weights[3000];
+  for (int i = 0; i < 3000; i++) {
+    bulk_tags[i] = (uint64_t)(i % 7);
+    bulk_weights[i] = i % 5 ? 1.0f : 2.0f;
+  }
+  for (int i = 0; i < 100; i++) {
+    assert(vs_add_tagged(serial, points[i], 32, bulk_tags[i],
+                         bulk_weights[i]) == 0);
+  }
+  assert(vs_add_batch(bulk, points[0], 100, 32, bulk_tags, bulk_weights,
+                      NULL) == 100);
+  assert(bulk->segments == 1 && bulk->capacity == 128); // Sized for all 100
+  assert(vs_quantize(serial, VS_QUANT_INT8, 0, 1) == 0);
+  assert(vs_quantize(bulk, VS_QUANT_INT8, 0, 1) == 0);
+  assert(vs_enable_index(serial, 8, 100) == 0);
+  assert(vs_enable_index(bulk, 8, 100) == 0);
+  for (int i = 100; i < 3000; i++) {
+    assert(vs_add_tagged(serial, points[i], 32, bulk_tags[i],
+                         bulk_weights[i]) == 0);
+  }
+  assert(vs_set_threads(4, 1000) == 0);
+  uint64_t bulk_ids[3000];
+  assert(vs_add_batch(bulk, points[100], 2900, 32, bulk_tags + 100,
+                      bulk_weights + 100, bulk_ids) == 2900);
+  assert(vs_set_threads(1, VS_PARALLEL_MIN_ROWS) == 0);
+  assert(bulk->count == 3000 && bulk->next_id == 3000);
+  for (int i = 0; i < 3000; i++) {
+    uint64_t serial_tag, bulk_tag;
+    assert(!memcmp(vs_get(serial, (size_t)i), vs_get(bulk, (size_t)i),
+                   32 * sizeof(float)));
+    assert(vs_get_tag(serial, (size_t)i, &serial_tag) == 0);
+    assert(vs_get_tag(bulk, (size_t)i, &bulk_tag) == 0);
+    assert(serial_tag == bulk_tag && vs_find_id(bulk, (uint64_t)i) == i);
+    assert(i < 100 || bulk_ids[i - 100] == (uint64_t)i);
+  }
+  for (int q = 0; q < 20; q++) {
+    int serial_top[10];
+    float serial_scores[10];
+    assert(vs_set_rerank(serial, 0) == 0 && vs_set_rerank(bulk, 0) == 0);
+    assert(vs_search_topk(serial, points[q * 151], 32, 10, serial_top,
+                          serial_scores) == 10);
+    assert(vs_search_topk(bulk, points[q * 151], 32, 10, top, top_scores) ==
+           10);
+    assert(!memcmp(serial_top, top, sizeof(serial_top)));
+    assert(!memcmp(serial_scores, top_scores, sizeof(serial_scores)));
+  }
+  // Built on four threads or one, the index is the same graph
+  float threaded_scores[10 * 10];
+  int threaded_top[10 * 10];
+  assert(vs_set_threads(4, 1000) == 0);
+  assert(vs_enable_index(bulk, 8, 100) == 0);
+  assert(vs_set_threads(1, VS_PARALLEL_MIN_ROWS) == 0);
+  for (int q = 0; q < 10; q++) {
+    assert(vs_search_ann(bulk, points[q * 299], 32, 10, 32,
+                         threaded_top + 10 * q,
+                         threaded_scores + 10 * q) == 10);
+  }
+  assert(vs_enable_index(bulk, 8, 100) == 0);
+  for (int q = 0; q < 10; q++) {
+    assert(vs_search_ann(bulk, points[q * 299], 32, 10, 32, top,
+                         top_scores) == 10);
+    assert(!memcmp(threaded_top + 10 * q, top, sizeof(int) * 10));
+  }
+  vs_free(serial);
+
+  // vs_reserve makes room ahead; vs_add_file streams a raw float32 file in
+  // through the same batches, and the index built from them in rounds finds
+  // about as much as one built a row at a time
+  VectorStore *loaded = vs_create(0);
+  assert(vs_reserve(loaded, (size_t)1 << 31) == -1);
+  assert(vs_reserve(loaded, 5000) == 0 && loaded->segments == 0);
+  assert(vs_enable_index(loaded, 8, 100) == 0);
+  FILE *raw = fopen("test_vector_raw.f32", "wb");
+  assert(raw && fwrite(points, sizeof(points), 1, raw) == 1);
+  assert(fclose(raw) == 0);
+  assert(vs_set_threads(4, 1000) == 0);
+  assert(vs_add_file(loaded, "test_vector_raw.f32", 32) == 3000);
+  assert(vs_set_threads(1, VS_PARALLEL_MIN_ROWS) == 0);
+  assert(loaded->segments == 1 && loaded->capacity == 8192);
+  for (int i = 0; i < 3000; i++) {
+    assert(!memcmp(vs_get(loaded, (size_t)i), vs_get(bulk, (size_t)i),
+                   32 * sizeof(float)));
+  }
+  hits = 0;
+  for (int q = 0; q < 50; q++) {
+    float query[32];
+    for (int j = 0; j < 32; j++)
+      query[j] = points[q * 37][j] + 0.5f * points[q * 37 + 1][j];
+    assert(vs_search_topk(loaded, query, 32, 10, exact, exact_scores) == 10);
+    assert(vs_search_ann(loaded, query, 32, 10, 64, top, top_scores) == 10);
+    for (int r = 0; r < 10; r++) {
+      for (int e = 0; e < 10; e++)
+        hits += top[r] == exact[e];
+    }
+  }
+  printf("HNSW recall@10, built in bulk: %.3f\n", hits / 500.0);
+  assert(hits >= 450);
+  assert(vs_reserve(loaded, 10000) == 0 && loaded->capacity >= 10000);
+  assert(loaded->count == 3000);
+  assert(vs_add_file(loaded, "test_vector_raw.f32", 64) == 0); // Other dim
+  assert(vs_add_file(loaded, "test_vector_raw.f32", 7) == -1); // Part rows
+  assert(vs_add_file(loaded, "test_vector_missing.f32", 32) == -1);
+  remove("test_vector_raw.f32");
+  vs_free(loaded);
+  vs_free(bulk);
+
+  // Growth adds aligned segments of 16, 32, ... rows; no row ever moves
+  VectorStore *slab = vs_create(1);
+  const float *first = NULL;
+  for (int i = 0; i < 1000; i++) {
+    float v[5] = {(float)i, 1.0f, 2.0f, 3.0f, -(float)i};
+    assert(vs_add(slab, v, 5) == 0);
+    if (i == 0)
+      first = vs_get(slab, 0);
+  }
+  assert(slab->count == 1000 && slab->capacity == 1008);
+  assert(slab->segments == 6 && vs_get(slab, 0) == first);
+  for (size_t s = 0; s < slab->segments; s++)
+    assert((uintptr_t)slab->data[s] % VS_ALIGNMENT == 0);
+  for (int i = 0; i < 1000; i++) {
+    // Rows are stored unit-length, back to back within a segment
+    const float *row = vs_get(slab, (size_t)i);
+    const int starts_segment = ((i + 16) & (i + 15)) == 0;
+    assert(starts_segment || row == vs_get(slab, (size_t)i - 1) + 5);
+    assert(fabsf(vs_dot_product(row, row, 5) - 1.0f) < 1e-5f);
+    assert(fabsf(row[3] - 3.0f * row[1]) < 1e-5f);
+    assert(fabsf(row[0] + row[4]) < 1e-6f);
+  }
+  assert(vs_get(slab, 1000) == NULL);
+  vs_free(slab);
+
   printf("ALL TESTS PASSED\n");
   return 0;
 }
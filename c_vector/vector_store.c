@@ -1,82 +1,1642 @@
+#ifdef VS_ENABLE_STATS
+#define _POSIX_C_SOURCE 200809L // clock_gettime
+#endif
 #include "vector_store.h"
+#include "vs_epoch.h"
+#include "vs_file.h"
+#include "vs_hnsw.h"
+#include "vs_ids.h"
+#include "vs_kernels.h"
+#include "vs_pool.h"
+#include "vs_quant.h"
+#include "vs_segments.h"
 #include <float.h>
+#include <limits.h>
 #include <math.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef VS_ENABLE_STATS
+#include <time.h>
+#define VS_STAT(statement) statement
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// Counters are bumped by concurrent searches (and an add), never read back
+// by them, so relaxed order is enough
+static void stat_add(uint64_t *counter, uint64_t n) {
+  __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+static void record_latency(VsStats *stats, uint64_t start_ns) {
+  const uint64_t ns = now_ns() - start_ns;
+  const uint64_t us = ns / 1000u;
+  stat_add(&stats->search_time_ns, ns);
+  int bucket = 0;
+  while (bucket < VS_LATENCY_BUCKETS - 1 && us >= ((uint64_t)1 << bucket))
+    bucket++;
+  stat_add(&stats->latency_buckets[bucket], 1);
+}
+#else
+#define VS_STAT(statement)
+#endif
+
+// Smallest first segment, in vectors
+#define VS_MIN_CAPACITY 16
+
 VectorStore *vs_create(size_t initial_capacity) {
-  VectorStore *store = (VectorStore *)malloc(sizeof(VectorStore));
-  store->vectors = (Vector *)malloc(sizeof(Vector) * initial_capacity);
-  store->count = 0;
-  store->capacity = initial_capacity;
+  // Zeroed: no segments, tags or index yet, and all counts 0
+  VectorStore *store = (VectorStore *)calloc(1, sizeof(VectorStore));
+  if (!store)
+    return NULL;
+  // Segments are allocated from the first add, when the dimension is known;
+  // the first holds initial_capacity vectors, rounded up to a power of two
+  if (initial_capacity < VS_MIN_CAPACITY)
+    initial_capacity = VS_MIN_CAPACITY;
+  store->segment_shift =
+      vs_segment_shift(initial_capacity < INT_MAX ? initial_capacity : INT_MAX);
+  store->full_precision = 1;
   return store;
 }
 
-void vs_add(VectorStore *store, float *data, size_t dim) {
-  if (store->count >= store->capacity) {
-    // Simple expansion
-    store->capacity *= 2;
-    store->vectors =
-        (Vector *)realloc(store->vectors, sizeof(Vector) * store->capacity);
+// Rows a search may read: it loads the count once, first, and reads nothing
+// beyond it. The acquire pairs with the release in vs_add_tagged, so those
+// rows (and the segments, tags and weights behind them) are complete.
+static size_t published_count(const VectorStore *store) {
+  return __atomic_load_n(&store->count, __ATOMIC_ACQUIRE);
+}
+
+static const float *row_data(const VectorStore *store, size_t row) {
+  size_t offset;
+  const size_t s = vs_segment_of(row, store->segment_shift, &offset);
+  return store->data[s] + offset * store->dimension;
+}
+
+static float row_weight(const VectorStore *store, size_t row) {
+  size_t offset;
+  const size_t s = vs_segment_of(row, store->segment_shift, &offset);
+  return store->weights[s][offset];
+}
+
+// Whether vs_remove took the row; acquire pairs with the release that
+// brings a compacted slot back, so its new contents are seen
+static int row_removed(const VectorStore *store, size_t row) {
+  return vs_row_marked(store->tombstones, store->segment_shift, row);
+}
+
+static void mark_removed(VectorStore *store, size_t row, int removed) {
+  size_t offset;
+  const size_t s = vs_segment_of(row, store->segment_shift, &offset);
+  uint64_t *word = &store->tombstones[s][offset / 64];
+  const uint64_t bit = (uint64_t)1 << offset % 64;
+  if (removed)
+    __atomic_fetch_or(word, bit, __ATOMIC_RELEASE);
+  else
+    __atomic_fetch_and(word, ~bit, __ATOMIC_RELEASE);
+}
+
+static uint64_t row_id(const VectorStore *store, size_t row) {
+  return vs_row_value(store->ids, store->segment_shift, row);
+}
+
+static VsRows store_rows(const VectorStore *store) {
+  const VsRows rows = {store->data, store->segment_shift, store->dimension};
+  return rows;
+}
+
+// Adds the next segment: its rows, tags, IDs, weights (once weighted) and
+// codes.
+// Nothing stored moves, so searches carry on meanwhile.
+static int add_segment(VectorStore *store) {
+  const size_t s = store->segments;
+  const size_t row_bytes = sizeof(float) * store->dimension;
+  if (s == VS_MAX_SEGMENTS ||
+      vs_segment_rows(s, store->segment_shift) > SIZE_MAX / row_bytes - 1)
+    return -1;
+  const size_t rows = vs_segment_rows(s, store->segment_shift);
+  float *data = NULL;
+  if (store->full_precision) {
+    // aligned_alloc wants a size that is a multiple of the alignment
+    const size_t bytes =
+        (rows * row_bytes + VS_ALIGNMENT - 1) / VS_ALIGNMENT * VS_ALIGNMENT;
+    data = (float *)aligned_alloc(VS_ALIGNMENT, bytes);
+    if (!data)
+      return -1;
+  }
+  uint64_t *tags = (uint64_t *)malloc(sizeof(uint64_t) * rows);
+  uint64_t *ids = (uint64_t *)malloc(sizeof(uint64_t) * rows);
+  uint64_t *tombstones =
+      (uint64_t *)calloc((rows + 63) / 64, sizeof(uint64_t));
+  float *weights =
+      store->weighted ? (float *)malloc(sizeof(float) * rows) : NULL;
+  if (!tags || !ids || !tombstones || (store->weighted && !weights) ||
+      (store->quant &&
+       vs_quant_reserve(store->quant, store->capacity + rows) != 0)) {
+    free(data);
+    free(tags);
+    free(ids);
+    free(tombstones);
+    free(weights);
+    return -1;
+  }
+  store->data[s] = data;
+  store->tags[s] = tags;
+  store->ids[s] = ids;
+  store->tombstones[s] = tombstones;
+  store->weights[s] = weights;
+  store->segments++;
+  store->capacity += rows;
+  return 0;
+}
+
+int vs_add(VectorStore *store, float *data, size_t dim) {
+  return vs_add_tagged(store, data, dim, 0, 1.0f);
+}
+
+int vs_add_weighted(VectorStore *store, float *data, size_t dim,
+                    float weight) {
+  return vs_add_tagged(store, data, dim, 0, weight);
+}
+
+// Smallest partition table, in slots; it doubles at 3/4 full
+#define VS_MIN_PARTITION_SLOTS 16
+
+// splitmix64's finalizer, so sequential tags spread over the table
+static size_t tag_slot(uint64_t tag, size_t slots) {
+  tag = (tag ^ (tag >> 30)) * 0xbf58476d1ce4e5b9ull;
+  tag = (tag ^ (tag >> 27)) * 0x94d049bb133111ebull;
+  return (size_t)(tag ^ (tag >> 31)) & (slots - 1);
+}
+
+// Safe alongside vs_add_tagged: the table and a slot's list are loaded
+// with acquire order, pairing with the releases that publish them
+static const VsPartition *find_partition(const VectorStore *store,
+                                         uint64_t tag) {
+  const VsPartitionTable *table =
+      __atomic_load_n(&store->partitions, __ATOMIC_ACQUIRE);
+  if (!table)
+    return NULL;
+  size_t slot = tag_slot(tag, table->slots);
+  while (__atomic_load_n(&table->entries[slot].rows, __ATOMIC_ACQUIRE)) {
+    if (table->entries[slot].tag == tag)
+      return &table->entries[slot];
+    slot = (slot + 1) & (table->slots - 1);
+  }
+  return NULL;
+}
+
+// A partition's rows as a search sees them. The count is loaded first: any
+// list at least that recent holds that many rows, and an older list stays
+// allocated (retired) for whoever still has it.
+static const int *partition_rows(const VsPartition *p, size_t *count) {
+  *count = __atomic_load_n(&p->count, __ATOMIC_ACQUIRE);
+  return __atomic_load_n(&p->rows, __ATOMIC_ACQUIRE);
+}
+
+static size_t table_bytes(size_t slots) {
+  return sizeof(VsPartitionTable) + slots * sizeof(VsPartition);
+}
+
+// Room to retire `n` more blocks, so replacing a list or table cannot fail
+// halfway
+static int reserve_retired(VectorStore *store, size_t n) {
+  if (store->retired_count + n <= store->retired_capacity)
+    return 0;
+  const size_t capacity = 2 * store->retired_capacity + n;
+  void **retired =
+      (void **)realloc(store->retired, sizeof(void *) * capacity);
+  if (!retired)
+    return -1;
+  store->retired = retired;
+  store->retired_capacity = capacity;
+  return 0;
+}
+
+// Keeps a replaced block until the next vs_compact (or vs_free): a search
+// may have loaded it just before it was replaced
+static void retire(VectorStore *store, void *block, size_t bytes) {
+  store->retired[store->retired_count++] = block;
+  store->retired_bytes += bytes;
+}
+
+static int grow_partitions(VectorStore *store) {
+  VsPartitionTable *old = store->partitions;
+  const size_t slots = old ? 2 * old->slots : VS_MIN_PARTITION_SLOTS;
+  VsPartitionTable *table = (VsPartitionTable *)calloc(1, table_bytes(slots));
+  if (!table)
+    return -1;
+  table->slots = slots;
+  for (size_t i = 0; old && i < old->slots; i++) {
+    const VsPartition *p = &old->entries[i];
+    if (!p->rows)
+      continue;
+    size_t slot = tag_slot(p->tag, slots);
+    while (table->entries[slot].rows)
+      slot = (slot + 1) & (slots - 1);
+    table->entries[slot] = *p;
+  }
+  if (old)
+    retire(store, old, table_bytes(old->slots));
+  __atomic_store_n(&store->partitions, table, __ATOMIC_RELEASE);
+  return 0;
+}
+
+// The partition for `tag`, created if needed, with room for one more row;
+// NULL when out of memory
+static VsPartition *partition_reserve(VectorStore *store, uint64_t tag) {
+  // At most the table and the list are replaced
+  if (reserve_retired(store, 2) != 0)
+    return NULL;
+  VsPartition *p = (VsPartition *)find_partition(store, tag);
+  if (!p) {
+    const size_t slots = store->partitions ? store->partitions->slots : 0;
+    if (4 * (store->partition_count + 1) > 3 * slots &&
+        grow_partitions(store) != 0)
+      return NULL;
+    VsPartitionTable *table = store->partitions;
+    size_t slot = tag_slot(tag, table->slots);
+    while (table->entries[slot].rows)
+      slot = (slot + 1) & (table->slots - 1);
+    int *rows = (int *)malloc(sizeof(int) * 4);
+    if (!rows)
+      return NULL;
+    p = &table->entries[slot];
+    p->tag = tag;
+    p->count = p->live = 0;
+    p->capacity = 4;
+    // Publishing the list makes the slot (with its tag) visible
+    __atomic_store_n(&p->rows, rows, __ATOMIC_RELEASE);
+    store->partition_count++;
+  } else if (p->count == p->capacity) {
+    // A copy, not realloc: searches may be reading the old list
+    int *rows = (int *)malloc(sizeof(int) * 2 * p->capacity);
+    if (!rows)
+      return NULL;
+    memcpy(rows, p->rows, sizeof(int) * p->count);
+    retire(store, p->rows, sizeof(int) * p->capacity);
+    __atomic_store_n(&p->rows, rows, __ATOMIC_RELEASE);
+    p->capacity *= 2;
+  }
+  return p;
+}
+
+// Gives every segment a weight per row, all 1 so far
+static int allocate_weights(VectorStore *store) {
+  for (size_t s = 0; s < store->segments; s++) {
+    const size_t rows = vs_segment_rows(s, store->segment_shift);
+    store->weights[s] = (float *)malloc(sizeof(float) * rows);
+    if (!store->weights[s]) {
+      for (size_t t = 0; t <= s; t++) {
+        free(store->weights[t]);
+        store->weights[t] = NULL;
+      }
+      return -1;
+    }
+    for (size_t i = 0; i < rows; i++)
+      store->weights[s][i] = 1.0f;
+  }
+  // Searches loading the flag see the arrays
+  __atomic_store_n(&store->weighted, 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+// Slot of `id` in the store's ID table (which must exist), or the empty
+// one where it would go
+static size_t id_slot(const VectorStore *store, uint64_t id) {
+  return vs_id_probe(store->id_slots, store->id_slot_count, store->ids,
+                     store->segment_shift, store->count, id);
+}
+
+// The ID table with room for n more IDs, rehashed into more slots once 3/4
+// full; writer only, like everything the table holds. Rows being added
+// must not be in it yet: the rehash only finds rows below the count.
+static int id_reserve(VectorStore *store, size_t n) {
+  if (4 * (store->id_count + n) <= 3 * store->id_slot_count)
+    return 0;
+  const size_t slots = vs_id_slots_for(store->id_count + n);
+  uint32_t *table = (uint32_t *)calloc(slots, sizeof(uint32_t));
+  if (!table)
+    return -1;
+  for (size_t i = 0; i < store->id_slot_count; i++) {
+    const uint32_t entry = store->id_slots[i];
+    if (entry) {
+      const uint64_t id = row_id(store, entry - 1);
+      table[vs_id_probe(table, slots, store->ids, store->segment_shift,
+                        store->count, id)] = entry;
+    }
+  }
+  free(store->id_slots);
+  store->id_slots = table;
+  store->id_slot_count = slots;
+  return 0;
+}
+
+// Points `id` at `row`, whose ID it already is; vs_add_tagged calls it
+// before counting the row, so the probe counts it here
+static void id_set(VectorStore *store, uint64_t id, size_t row) {
+  const size_t count = row < store->count ? store->count : row + 1;
+  uint32_t *slot =
+      &store->id_slots[vs_id_probe(store->id_slots, store->id_slot_count,
+                                   store->ids, store->segment_shift, count,
+                                   id)];
+  store->id_count += !*slot;
+  *slot = (uint32_t)(row + 1);
+}
+
+// Drops `id` if it is still at `row` (vs_update has moved it otherwise),
+// shifting later entries of its probe run back over the gap
+static void id_forget(VectorStore *store, uint64_t id, size_t row) {
+  const size_t mask = store->id_slot_count - 1;
+  uint32_t *table = store->id_slots;
+  size_t gap = id_slot(store, id);
+  if (table[gap] != row + 1)
+    return;
+  for (size_t next = (gap + 1) & mask; table[next]; next = (next + 1) & mask) {
+    // An entry may fill the gap unless its probe starts after the gap
+    const size_t home =
+        vs_id_home(row_id(store, table[next] - 1), store->id_slot_count);
+    if (((next - home) & mask) >= ((next - gap) & mask)) {
+      table[gap] = table[next];
+      gap = next;
+    }
+  }
+  table[gap] = 0;
+  store->id_count--;
+}
+
+// 1 / |data|, or 0 for a vector the store refuses: cosine is undefined for
+// zero (and non-finite) vectors
+static double inverse_norm(const float *data, size_t dim) {
+  double norm2 = 0.0;
+  for (size_t i = 0; i < dim; i++)
+    norm2 += (double)data[i] * data[i];
+  return norm2 > 0.0 && isfinite(norm2) ? 1.0 / sqrt(norm2) : 0.0;
+}
+
+// Stores row's vector, scaled by inv_norm to unit length so search is a
+// plain dot product per row, and its code. Touches nothing of other rows,
+// so rows can be stored in parallel.
+static void store_vector(VectorStore *store, size_t row, const float *data,
+                         double inv_norm) {
+  const size_t dim = store->dimension;
+  if (store->full_precision) {
+    size_t offset;
+    const size_t s = vs_segment_of(row, store->segment_shift, &offset);
+    float *out = store->data[s] + offset * dim;
+    for (size_t i = 0; i < dim; i++)
+      out[i] = (float)(data[i] * inv_norm);
+  }
+  if (store->quant)
+    vs_quant_encode(store->quant, row, data, inv_norm);
+}
+
+// Everything listing `row` needs besides its slot and ID table room: its
+// weight array, index node and partition. NULL when out of memory.
+static VsPartition *reserve_row(VectorStore *store, size_t row, uint64_t tag,
+                                float weight) {
+  // Unweighted stores never allocate (or scan) weight arrays
+  if (weight != 1.0f && !store->weighted && allocate_weights(store) != 0)
+    return NULL;
+  if (store->index && vs_hnsw_reserve(store->index, row + 1) != 0)
+    return NULL;
+  // Last, so a failure cannot leave an empty partition behind
+  return partition_reserve(store, tag);
+}
+
+// Gives `row` its weight, tag and ID and lists it under the tag. No search
+// reads it until the count passes it: searches skip listed rows past their
+// count, and vs_save finds every row below it listed.
+static void list_row(VectorStore *store, VsPartition *p, size_t row,
+                     uint64_t tag, float weight, uint64_t id) {
+  size_t offset;
+  const size_t s = vs_segment_of(row, store->segment_shift, &offset);
+  if (store->weighted)
+    store->weights[s][offset] = weight;
+  store->tags[s][offset] = tag;
+  store->ids[s][offset] = id;
+  id_set(store, id, row);
+  p->rows[p->count] = (int)row;
+  __atomic_store_n(&p->count, p->count + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&p->live, p->live + 1, __ATOMIC_RELAXED);
+  // A slot vs_compact dropped off the end is still marked
+  if (row_removed(store, row))
+    mark_removed(store, row, 0);
+}
+
+// vs_add_tagged for a vector that keeps the ID *replaces, or (NULL) that
+// takes the next one
+static int add_row(VectorStore *store, const float *data, size_t dim,
+                   uint64_t tag, float weight, const uint64_t *replaces) {
+  if (store->mapping || dim == 0 ||
+      (store->dimension && dim != store->dimension) || !isfinite(weight) ||
+      store->count >= INT_MAX)
+    return -1;
+  const double inv_norm = inverse_norm(data, dim);
+  if (inv_norm == 0.0)
+    return -1;
+  if (!store->dimension) {
+    store->dimension = dim;
+    if (add_segment(store) != 0) {
+      store->dimension = 0;
+      return -1;
+    }
+  } else if (store->count == store->capacity && add_segment(store) != 0) {
+    return -1;
+  }
+  const size_t row = store->count;
+  if (id_reserve(store, 1) != 0)
+    return -1;
+  VsPartition *p = reserve_row(store, row, tag, weight);
+  if (!p)
+    return -1;
+
+  // Raised before the count, so vs_save never writes a lower next ID than
+  // one of its rows has
+  const uint64_t id = replaces ? *replaces : store->next_id;
+  if (!replaces)
+    __atomic_store_n(&store->next_id, id + 1, __ATOMIC_RELAXED);
+  list_row(store, p, row, tag, weight, id);
+  store_vector(store, row, data, inv_norm);
+  if (store->index) {
+    const VsRows rows = store_rows(store);
+    vs_hnsw_insert(store->index, &rows, (int)row);
+  }
+  __atomic_store_n(&store->count, row + 1, __ATOMIC_RELEASE);
+  VS_STAT(stat_add(&store->stats.adds, 1));
+  return 0;
+}
+
+int vs_add_tagged(VectorStore *store, float *data, size_t dim, uint64_t tag,
+                  float weight) {
+  return add_row(store, data, dim, tag, weight, NULL);
+}
+
+int vs_reserve(VectorStore *store, size_t rows) {
+  if (store->mapping || rows > INT_MAX)
+    return -1;
+  // Until the first segment, one can be made big enough for every row; a
+  // quantizer keeps the layout it was created with
+  if (!store->segments && !store->quant &&
+      vs_segment_shift(rows) > store->segment_shift)
+    store->segment_shift = vs_segment_shift(rows);
+  if (!store->dimension)
+    return 0; // Allocated by the first add
+  while (store->capacity < rows) {
+    if (add_segment(store) != 0)
+      return -1;
+  }
+  return 0;
+}
+
+// Rows vs_add_batch stores per step, and per claim within one
+#define VS_BATCH_ROWS 4096
+#define VS_BATCH_CLAIM 64
+
+// A vs_add_batch step: vectors data[0 .. n - 1] become rows row ..
+// row + n - 1. Each row's 1 / norm goes to inv_norm, 0 for one the store
+// refuses, which is left unstored.
+typedef struct {
+  VectorStore *store;
+  const float *data;
+  const float *weights;
+  size_t row, n;
+  size_t next; // Vectors claimed
+  double *inv_norm;
+} BatchStep;
+
+static void store_step(void *ctx, size_t worker) {
+  BatchStep *step = (BatchStep *)ctx;
+  const size_t dim = step->store->dimension;
+  (void)worker;
+  for (;;) {
+    const size_t first =
+        __atomic_fetch_add(&step->next, VS_BATCH_CLAIM, __ATOMIC_RELAXED);
+    if (first >= step->n)
+      return;
+    const size_t end =
+        step->n - first < VS_BATCH_CLAIM ? step->n : first + VS_BATCH_CLAIM;
+    for (size_t i = first; i < end; i++) {
+      const float *data = step->data + i * dim;
+      step->inv_norm[i] =
+          step->weights && !isfinite(step->weights[i])
+              ? 0.0
+              : inverse_norm(data, dim);
+      if (step->inv_norm[i] != 0.0)
+        store_vector(step->store, step->row + i, data, step->inv_norm[i]);
+    }
+  }
+}
+
+int vs_add_batch(VectorStore *store, const float *data, size_t n, size_t dim,
+                 const uint64_t *tags, const float *weights,
+                 uint64_t *out_ids) {
+  if (store->mapping || dim == 0 ||
+      (store->dimension && dim != store->dimension) || n == 0)
+    return 0;
+  if (!store->dimension) {
+    // As vs_add_tagged would, refuse the first vector before fixing the
+    // dimension. The first segment takes the whole batch if memory allows,
+    // else it is the size vs_create chose.
+    if ((weights && !isfinite(weights[0])) || inverse_norm(data, dim) == 0.0)
+      return 0;
+    const unsigned shift = store->segment_shift;
+    vs_reserve(store, n < INT_MAX ? n : INT_MAX);
+    store->dimension = dim;
+    if (add_segment(store) != 0) {
+      store->segment_shift = shift;
+      if (add_segment(store) != 0) {
+        store->dimension = 0;
+        return 0;
+      }
+    }
   }
 
-  Vector *v = &store->vectors[store->count];
-  v->dimension = dim;
-  v->data = (float *)malloc(sizeof(float) * dim);
-  memcpy(v->data, data, sizeof(float) * dim);
+  double inv_norm[VS_BATCH_ROWS];
+  size_t added = 0;
+  while (added < n && store->count < INT_MAX) {
+    const size_t count = store->count;
+    size_t step_rows = n - added < VS_BATCH_ROWS ? n - added : VS_BATCH_ROWS;
+    if (step_rows > INT_MAX - count)
+      step_rows = INT_MAX - count;
+    // Short of memory for the whole step, take what fits
+    if (vs_reserve(store, count + step_rows) != 0)
+      step_rows = store->capacity - count;
+    if (step_rows == 0 || id_reserve(store, step_rows) != 0)
+      break;
+
+    // Normalizing and encoding, the bulk of the work, in parallel; then
+    // the bookkeeping, in order, up to the first row refused
+    BatchStep step = {store, data + added * dim,
+                      weights ? weights + added : NULL,
+                      count, step_rows, 0, inv_norm};
+    if (step_rows > VS_BATCH_CLAIM)
+      vs_pool_run(store_step, &step);
+    else
+      store_step(&step, 0);
+    size_t listed = 0;
+    for (; listed < step_rows && inv_norm[listed] != 0.0; listed++) {
+      const size_t i = added + listed;
+      const uint64_t tag = tags ? tags[i] : 0;
+      const float weight = weights ? weights[i] : 1.0f;
+      VsPartition *p = reserve_row(store, count + listed, tag, weight);
+      if (!p)
+        break;
+      const uint64_t id = store->next_id;
+      __atomic_store_n(&store->next_id, id + 1, __ATOMIC_RELAXED);
+      list_row(store, p, count + listed, tag, weight, id);
+      if (out_ids)
+        out_ids[i] = id;
+    }
+    if (store->index && listed) {
+      const VsRows rows = store_rows(store);
+      vs_hnsw_insert_batch(store->index, &rows, (int)count, listed);
+    }
+    // One release publishes the step
+    __atomic_store_n(&store->count, count + listed, __ATOMIC_RELEASE);
+    VS_STAT(stat_add(&store->stats.adds, listed));
+    added += listed;
+    if (listed < step_rows)
+      break;
+  }
+  return (int)added;
+}
+
+int vs_set_weight(VectorStore *store, size_t index, float weight) {
+  if (store->mapping || index >= store->count || row_removed(store, index) ||
+      !isfinite(weight))
+    return -1;
+  if (!store->weighted && allocate_weights(store) != 0)
+    return -1;
+  size_t offset;
+  const size_t s = vs_segment_of(index, store->segment_shift, &offset);
+  store->weights[s][offset] = weight;
+  return 0;
+}
+
+int vs_get_tag(const VectorStore *store, size_t index, uint64_t *out) {
+  if (index >= published_count(store) || row_removed(store, index))
+    return -1;
+  size_t offset;
+  const size_t s = vs_segment_of(index, store->segment_shift, &offset);
+  *out = store->tags[s][offset];
+  return 0;
+}
+
+size_t vs_count_tag(const VectorStore *store, uint64_t tag) {
+  const VsPartition *p = find_partition(store, tag);
+  return p ? __atomic_load_n(&p->live, __ATOMIC_RELAXED) : 0;
+}
+
+int vs_get_id(const VectorStore *store, size_t index, uint64_t *out) {
+  if (index >= published_count(store) || row_removed(store, index))
+    return -1;
+  *out = row_id(store, index);
+  return 0;
+}
+
+int vs_find_id(const VectorStore *store, uint64_t id) {
+  if (!store->id_slot_count)
+    return -1;
+  const uint32_t entry = store->id_slots[id_slot(store, id)];
+  return entry ? (int)(entry - 1) : -1;
+}
+
+const float *vs_get(const VectorStore *store, size_t index) {
+  return index < published_count(store) && store->full_precision &&
+                 !row_removed(store, index)
+             ? row_data(store, index)
+             : NULL;
+}
+
+float vs_dot_product(const float *v1, const float *v2, size_t dim) {
+  return vs_kernel()->dot(v1, v2, dim);
+}
+
+static float magnitude(const float *v, size_t dim) {
+  return sqrtf(vs_kernel()->dot(v, v, dim));
+}
+
+// Rows scored per block-kernel call in full scans; the scores stay in L1
+#define VS_SCAN_BLOCK 64
+
+// vs_set_threads' threshold; stores must be this large to scan in parallel
+static size_t parallel_min_rows = VS_PARALLEL_MIN_ROWS;
 
-  store->count++;
+// Rows from `offset` in segment s to score in one kernel call: at most
+// `limit` and VS_SCAN_BLOCK, and never past the segment's end
+static size_t block_rows(const VectorStore *store, size_t s, size_t offset,
+                         size_t limit) {
+  const size_t left = vs_segment_rows(s, store->segment_shift) - offset;
+  const size_t n = left < limit ? left : limit;
+  return n < VS_SCAN_BLOCK ? n : VS_SCAN_BLOCK;
 }
 
-float vs_dot_product(float *v1, float *v2, size_t dim) {
-  float sum = 0.0f;
-  for (size_t i = 0; i < dim; i++) {
-    sum += v1[i] * v2[i];
+static uint64_t low_bits(size_t n) {
+  return n < 64 ? ((uint64_t)1 << n) - 1 : ~(uint64_t)0;
+}
+
+// Tombstones of the n <= 64 rows from `offset` in segment s, bit j for row
+// offset + j
+static uint64_t removed_mask(const VectorStore *store, size_t s,
+                             size_t offset, size_t n) {
+  const uint64_t *bits = store->tombstones[s];
+  if (!bits)
+    return 0;
+  const size_t word = offset / 64, bit = offset % 64;
+  uint64_t mask = __atomic_load_n(&bits[word], __ATOMIC_ACQUIRE) >> bit;
+  if (bit && bit + n > 64)
+    mask |= __atomic_load_n(&bits[word + 1], __ATOMIC_ACQUIRE) << (64 - bit);
+  return mask & low_bits(n);
+}
+
+// The next run of live rows at or after *row and before `end`, in one
+// segment and at most VS_SCAN_BLOCK long: moves *row to its first row (at
+// *offset in segment *s) and returns its length, 0 if there is none.
+// Scans score runs, so they never read a removed row.
+static size_t live_run(const VectorStore *store, size_t *row, size_t end,
+                       size_t *s, size_t *offset) {
+  while (*row < end) {
+    *s = vs_segment_of(*row, store->segment_shift, offset);
+    const size_t n = block_rows(store, *s, *offset, end - *row);
+    const uint64_t live = ~removed_mask(store, *s, *offset, n) & low_bits(n);
+    if (!live) {
+      *row += n;
+      continue;
+    }
+    const size_t first = (size_t)__builtin_ctzll(live);
+    const uint64_t rest = ~(live >> first);
+    *row += first;
+    *offset += first;
+    return rest ? (size_t)__builtin_ctzll(rest) : 64;
   }
-  return sum;
+  return 0;
 }
 
-static float magnitude(float *v, size_t dim) {
-  float sum = 0.0f;
-  for (size_t i = 0; i < dim; i++) {
-    sum += v[i] * v[i];
+// First removed row in [row, end), or end
+static size_t next_removed(const VectorStore *store, size_t row,
+                           size_t end) {
+  while (row < end) {
+    size_t offset;
+    const size_t s = vs_segment_of(row, store->segment_shift, &offset);
+    const size_t n = block_rows(store, s, offset, end - row);
+    const uint64_t mask = removed_mask(store, s, offset, n);
+    if (mask)
+      return row + (size_t)__builtin_ctzll(mask);
+    row += n;
   }
-  return sqrtf(sum);
+  return end;
+}
+
+// `end` lowered past any removed rows just below it
+static size_t trim_removed(const VectorStore *store, size_t end) {
+  while (end > 0) {
+    size_t offset;
+    const size_t s = vs_segment_of(end - 1, store->segment_shift, &offset);
+    const size_t n = offset + 1 < 64 ? offset + 1 : 64;
+    const uint64_t live =
+        ~removed_mask(store, s, offset + 1 - n, n) & low_bits(n);
+    if (live)
+      return end - n + 64 - (size_t)__builtin_clzll(live);
+    end -= n;
+  }
+  return 0;
+}
+
+// Scores a query against rows: full-precision dot products, or the
+// compressed codes' approximations in a quantized store
+typedef struct {
+  const VectorStore *store;
+  const float *query;
+  const VsKernel *kernel;
+  VsQuantQuery codes; // Used when store->quant is set
+  int weighted;       // Loaded once per search, like the count
+} Scorer;
+
+static int scorer_init(Scorer *scorer, const VectorStore *store,
+                       const float *query) {
+  scorer->store = store;
+  scorer->query = query;
+  scorer->kernel = vs_kernel();
+  scorer->weighted = __atomic_load_n(&store->weighted, __ATOMIC_ACQUIRE);
+  return store->quant ? vs_quant_prepare(store->quant, query, &scorer->codes)
+                      : 0;
+}
+
+static void scorer_release(Scorer *scorer) {
+  if (scorer->store->quant)
+    vs_quant_release(&scorer->codes);
+}
+
+// Scores the n rows from `row`, which sits at `offset` in segment s
+static void score_block(const Scorer *scorer, size_t row, size_t s,
+                        size_t offset, size_t n, float *out) {
+  const VectorStore *store = scorer->store;
+  if (store->quant)
+    vs_quant_score_block(store->quant, &scorer->codes, row, n, out);
+  else
+    scorer->kernel->dot_block(store->data[s] + offset * store->dimension, n,
+                              store->dimension, scorer->query, out);
+}
+
+static float score_row(const Scorer *scorer, size_t row) {
+  const VectorStore *store = scorer->store;
+  if (store->quant)
+    return vs_quant_score(store->quant, &scorer->codes, row);
+  return scorer->kernel->dot(row_data(store, row), scorer->query,
+                             store->dimension);
+}
+
+static size_t collect_topk(const VectorStore *store, const Scorer *scorer,
+                           size_t count, const int *rows, size_t n, size_t k,
+                           int *idx, float *scores);
+
+static int find_nearest(VectorStore *store, const float *query, size_t dim) {
+  VS_STAT(const uint64_t start_ns = now_ns());
+  VS_STAT(stat_add(&store->stats.searches, 1));
+
+  // Rows are unit-length and the query's norm scales every score alike, so
+  // the largest dot product is the largest cosine
+  const size_t count = published_count(store);
+  Scorer scorer;
+  if (count == 0 || dim != store->dimension || magnitude(query, dim) == 0 ||
+      scorer_init(&scorer, store, query) != 0) {
+    VS_STAT(record_latency(&store->stats, start_ns));
+    return -1;
+  }
+  // Top-1 on unweighted scores; ties go to the lower index
+  scorer.weighted = 0;
+  int best_idx = -1; // Stays if every row is removed
+  float best_dot;
+  collect_topk(store, &scorer, count, NULL, count, 1, &best_idx, &best_dot);
+  scorer_release(&scorer);
+  VS_STAT(stat_add(&store->stats.vectors_scanned, count));
+
+  VS_STAT(record_latency(&store->stats, start_ns));
+  return best_idx;
 }
 
 int vs_find_nearest(VectorStore *store, float *query, size_t dim) {
-  int best_idx = -1;
-  float best_sim = -FLT_MAX;
+  const unsigned epoch = vs_read_begin(store);
+  const int best = find_nearest(store, query, dim);
+  vs_read_end(store, epoch);
+  return best;
+}
+// Bounded min-heap over the caller's buffers: the root is the worst kept
+// result. Lower scores are worse; equal scores rank the lower index first.
+static int worse(float score_a, int idx_a, float score_b, int idx_b) {
+  return score_a < score_b || (score_a == score_b && idx_a > idx_b);
+}
+
+static void sift_down(float *scores, int *idx, size_t n, size_t i) {
+  for (;;) {
+    const size_t left = 2 * i + 1, right = left + 1;
+    size_t worst = i;
+    if (left < n && worse(scores[left], idx[left], scores[worst], idx[worst]))
+      worst = left;
+    if (right < n &&
+        worse(scores[right], idx[right], scores[worst], idx[worst]))
+      worst = right;
+    if (worst == i)
+      return;
+    const float s = scores[i];
+    scores[i] = scores[worst];
+    scores[worst] = s;
+    const int t = idx[i];
+    idx[i] = idx[worst];
+    idx[worst] = t;
+    i = worst;
+  }
+}
+
+static void sift_up(float *scores, int *idx, size_t i) {
+  while (i > 0) {
+    const size_t parent = (i - 1) / 2;
+    if (!worse(scores[i], idx[i], scores[parent], idx[parent]))
+      return;
+    const float s = scores[i];
+    scores[i] = scores[parent];
+    scores[parent] = s;
+    const int t = idx[i];
+    idx[i] = idx[parent];
+    idx[parent] = t;
+    i = parent;
+  }
+}
+
+// Keeps row `i` if it beats the worst of the `*kept` results so far
+static void offer(float *scores, int *idx, size_t *kept, size_t k,
+                  float score, int i) {
+  if (*kept < k) {
+    scores[*kept] = score;
+    idx[*kept] = i;
+    sift_up(scores, idx, (*kept)++);
+  } else if (worse(scores[0], idx[0], score, i)) {
+    scores[0] = score;
+    idx[0] = i;
+    sift_down(scores, idx, *kept, 0);
+  }
+}
+
+// Heap sort leaves the best result first; scores become cosines
+static void finish_topk(float *scores, int *idx, size_t kept,
+                        float query_mag) {
+  for (size_t m = kept; m > 1; m--) {
+    const float s = scores[0];
+    scores[0] = scores[m - 1];
+    scores[m - 1] = s;
+    const int t = idx[0];
+    idx[0] = idx[m - 1];
+    idx[m - 1] = t;
+    sift_down(scores, idx, m - 1, 0);
+  }
+  const float inv_mag = 1.0f / query_mag;
+  for (size_t i = 0; i < kept; i++)
+    scores[i] *= inv_mag;
+}
+
+// Offers rows [start, end) to the heap in idx/scores
+static void scan_range(const VectorStore *store, const Scorer *scorer,
+                       size_t start, size_t end, size_t k, int *idx,
+                       float *scores, size_t *kept) {
+  float dots[VS_SCAN_BLOCK];
+  size_t i = start, s, offset;
+  for (size_t m; (m = live_run(store, &i, end, &s, &offset)) > 0; i += m) {
+    score_block(scorer, i, s, offset, m, dots);
+    const float *weights =
+        scorer->weighted ? store->weights[s] + offset : NULL;
+    for (size_t j = 0; j < m; j++) {
+      const float score = weights ? dots[j] * weights[j] : dots[j];
+      offer(scores, idx, kept, k, score, (int)(i + j));
+    }
+  }
+}
+// A full scan split into shards that the pool's participants claim in
+// turn, each into its own k-long heap
+typedef struct {
+  const VectorStore *store;
+  const Scorer *scorer;
+  size_t n, k;
+  size_t shard;      // Rows per claim, a multiple of VS_SCAN_BLOCK
+  atomic_size_t next; // First row of the next unclaimed shard
+  int *idx;          // Participant w's heap at idx/scores + w * k
+  float *scores;
+  size_t *kept;
+} ScanTask;
+
+static void scan_shards(void *ctx, size_t worker) {
+  ScanTask *task = (ScanTask *)ctx;
+  int *idx = task->idx + worker * task->k;
+  float *scores = task->scores + worker * task->k;
+  for (;;) {
+    const size_t start = atomic_fetch_add(&task->next, task->shard);
+    if (start >= task->n)
+      return;
+    const size_t end =
+        task->n - start < task->shard ? task->n : start + task->shard;
+    scan_range(task->store, task->scorer, start, end, task->k, idx, scores,
+               &task->kept[worker]);
+  }
+}
+
+// Bytes of rows per shard: a few blocks that fit in L2 with room to spare,
+// small enough that a slow participant holds up the rest only briefly
+#define VS_SHARD_BYTES (256 * 1024)
+
+// The sharded scan; returns -1 out of memory, leaving idx/scores alone
+static int scan_parallel(const VectorStore *store, const Scorer *scorer,
+                         size_t n, size_t k, int *idx, float *scores,
+                         size_t *kept) {
+  const size_t workers = vs_pool_size();
+  if (k > SIZE_MAX / sizeof(float) / workers)
+    return -1;
+  ScanTask task;
+  task.store = store;
+  task.scorer = scorer;
+  task.n = n;
+  task.k = k;
+  const size_t rows = VS_SHARD_BYTES / (sizeof(float) * store->dimension);
+  task.shard = rows > VS_SCAN_BLOCK ? rows / VS_SCAN_BLOCK * VS_SCAN_BLOCK
+                                    : VS_SCAN_BLOCK;
+  atomic_init(&task.next, 0);
+  task.idx = (int *)malloc(sizeof(int) * workers * k);
+  task.scores = (float *)malloc(sizeof(float) * workers * k);
+  task.kept = (size_t *)calloc(workers, sizeof(size_t));
+  if (!task.idx || !task.scores || !task.kept) {
+    free(task.idx);
+    free(task.scores);
+    free(task.kept);
+    return -1;
+  }
+  vs_pool_run(scan_shards, &task);
+  // Heaps merge by the same rule they were built with, so the result is
+  // the serial scan's, ties included
+  for (size_t w = 0; w < workers; w++) {
+    for (size_t j = 0; j < task.kept[w]; j++)
+      offer(scores, idx, kept, k, task.scores[w * k + j],
+            task.idx[w * k + j]);
+  }
+  free(task.idx);
+  free(task.scores);
+  free(task.kept);
+  return 0;
+}
+
+// Top-k over rows [0, n) (rows == NULL) or over the `n` listed ones into
+// the k-long idx/scores, on raw (weighted) scores; removed rows, and listed
+// ones from `count` on, are skipped
+static size_t collect_topk(const VectorStore *store, const Scorer *scorer,
+                           size_t count, const int *rows, size_t n, size_t k,
+                           int *idx, float *scores) {
+  size_t kept = 0;
+  if (k > 0 && !rows) {
+    // Falls back to one thread when out of memory
+    if (n < parallel_min_rows || vs_pool_size() == 1 ||
+        scan_parallel(store, scorer, n, k, idx, scores, &kept) != 0)
+      scan_range(store, scorer, 0, n, k, idx, scores, &kept);
+  } else if (k > 0) {
+    for (size_t j = 0; j < n; j++) {
+      const int i = rows[j];
+      // Compaction pads a shortened list with -1, past every count
+      if ((size_t)i >= count || row_removed(store, (size_t)i))
+        continue;
+      float score = score_row(scorer, (size_t)i);
+      if (scorer->weighted)
+        score *= row_weight(store, (size_t)i);
+      offer(scores, idx, &kept, k, score, i);
+    }
+  }
+  return kept;
+}
 
-  float query_mag = magnitude(query, dim);
+// Top-k over the first `count` rows (rows == NULL), or the n listed ones;
+// count is the caller's published_count
+static int search_topk(VectorStore *store, size_t count, const int *rows,
+                       size_t n, const float *query, size_t dim, size_t k,
+                       int *out_idx, float *out_scores) {
+  if (dim == 0 || (count && dim != store->dimension) || !out_idx ||
+      !out_scores)
+    return -1;
+  const float query_mag = magnitude(query, dim);
   if (query_mag == 0)
     return -1;
+  if (!rows)
+    n = count;
+  // Code matches re-scored at full precision; the code pass keeps more
+  const size_t candidates =
+      store->quant && store->rerank && k <= SIZE_MAX / store->rerank
+          ? k * store->rerank
+          : k;
+  int *idx = out_idx;
+  float *scores = out_scores;
+  if (candidates > k) {
+    idx = (int *)malloc(sizeof(int) * candidates);
+    scores = (float *)malloc(sizeof(float) * candidates);
+  }
+  Scorer scorer;
+  if (!idx || !scores || scorer_init(&scorer, store, query) != 0) {
+    if (idx != out_idx) {
+      free(idx);
+      free(scores);
+    }
+    return -1;
+  }
+  VS_STAT(const uint64_t start_ns = now_ns());
+  VS_STAT(stat_add(&store->stats.searches, 1));
+
+  // Heap on raw (weighted) dot products; the query norm is divided out at
+  // the end since it scales every score alike
+  size_t kept =
+      collect_topk(store, &scorer, count, rows, n, candidates, idx, scores);
+  scorer_release(&scorer);
+  VS_STAT(stat_add(&store->stats.vectors_scanned, n));
+  if (idx != out_idx) {
+    const size_t found = kept;
+    kept = 0;
+    for (size_t j = 0; j < found; j++) {
+      const int i = idx[j];
+      float score = scorer.kernel->dot(row_data(store, (size_t)i), query, dim);
+      if (scorer.weighted)
+        score *= row_weight(store, (size_t)i);
+      offer(out_scores, out_idx, &kept, k, score, i);
+    }
+    free(idx);
+    free(scores);
+  }
+
+  finish_topk(out_scores, out_idx, kept, query_mag);
+  VS_STAT(record_latency(&store->stats, start_ns));
+  return (int)kept;
+}
+
+int vs_search_topk(VectorStore *store, float *query, size_t dim, size_t k,
+                   int *out_idx, float *out_scores) {
+  const unsigned epoch = vs_read_begin(store);
+  const int found = search_topk(store, published_count(store), NULL, 0, query,
+                                dim, k, out_idx, out_scores);
+  vs_read_end(store, epoch);
+  return found;
+}
+
+int vs_search_topk_tag(VectorStore *store, uint64_t tag, float *query,
+                       size_t dim, size_t k, int *out_idx, float *out_scores) {
+  // An unknown tag is an empty list, not a full scan
+  static const int no_rows[1] = {0};
+  const unsigned epoch = vs_read_begin(store);
+  const VsPartition *p = find_partition(store, tag);
+  size_t n = 0;
+  const int *rows = p ? partition_rows(p, &n) : no_rows;
+  // Loaded after the list: rows listed but not yet published are past it
+  const int found = search_topk(store, published_count(store), rows, n, query,
+                                dim, k, out_idx, out_scores);
+  vs_read_end(store, epoch);
+  return found;
+}
+
+// Queries scored together against each block of rows: the block stays in
+// cache while they all pass, so a row is read from memory once per
+// VS_BATCH_QUERIES queries rather than once per query
+#define VS_BATCH_QUERIES 64
+
+static int search_batch(VectorStore *store, const float *queries,
+                        size_t num_queries, size_t dim, size_t k,
+                        int *out_idx, float *out_scores) {
+  const size_t count = published_count(store);
+  if (dim == 0 || (count && dim != store->dimension) || !queries ||
+      !out_idx || !out_scores)
+    return -1;
+  for (size_t q = 0; q < num_queries; q++) {
+    if (magnitude(queries + q * dim, dim) == 0)
+      return -1;
+  }
+  // Fewest results of any query: they differ only if a row is removed
+  // while the queries pass
+  int found = (int)(k < count ? k : count);
+  // Codes have no tile kernel; each query scans them on its own
+  if (store->quant) {
+    for (size_t q = 0; q < num_queries; q++) {
+      const int n = search_topk(store, count, NULL, 0, queries + q * dim, dim,
+                                k, out_idx + q * k, out_scores + q * k);
+      if (n < 0)
+        return -1;
+      found = n < found ? n : found;
+    }
+    return found;
+  }
+  VS_STAT(const uint64_t start_ns = now_ns());
+  VS_STAT(stat_add(&store->stats.searches, num_queries));
+
+  const VsKernel *kernel = vs_kernel();
+  const int weighted = __atomic_load_n(&store->weighted, __ATOMIC_ACQUIRE);
+  float dots[VS_BATCH_QUERIES * VS_SCAN_BLOCK];
+  size_t kept[VS_BATCH_QUERIES];
+  for (size_t first = 0; first < num_queries; first += VS_BATCH_QUERIES) {
+    const size_t nq = num_queries - first < VS_BATCH_QUERIES
+                          ? num_queries - first
+                          : VS_BATCH_QUERIES;
+    memset(kept, 0, sizeof(kept));
+    size_t i = 0, s, offset, m;
+    while (k > 0 && (m = live_run(store, &i, count, &s, &offset)) > 0) {
+      kernel->dot_tile(store->data[s] + offset * dim, m, dim,
+                       queries + first * dim, nq, dots);
+      const float *weights = weighted ? store->weights[s] + offset : NULL;
+      for (size_t q = 0; q < nq; q++) {
+        int *idx = out_idx + (first + q) * k;
+        float *scores = out_scores + (first + q) * k;
+        const float *row_dots = dots + q * m;
+        for (size_t j = 0; j < m; j++) {
+          const float score = weights ? row_dots[j] * weights[j] : row_dots[j];
+          offer(scores, idx, &kept[q], k, score, (int)(i + j));
+        }
+      }
+      i += m;
+    }
+    for (size_t q = 0; q < nq; q++) {
+      finish_topk(out_scores + (first + q) * k, out_idx + (first + q) * k,
+                  kept[q], magnitude(queries + (first + q) * dim, dim));
+      found = (int)kept[q] < found ? (int)kept[q] : found;
+    }
+  }
+  VS_STAT(stat_add(&store->stats.vectors_scanned, count * num_queries));
+
+  VS_STAT(record_latency(&store->stats, start_ns));
+  return found;
+}
+
+int vs_search_batch(VectorStore *store, const float *queries,
+                    size_t num_queries, size_t dim, size_t k, int *out_idx,
+                    float *out_scores) {
+  const unsigned epoch = vs_read_begin(store);
+  const int found = search_batch(store, queries, num_queries, dim, k, out_idx,
+                                 out_scores);
+  vs_read_end(store, epoch);
+  return found;
+}
+
+// vs_search_ids, or vs_search_tag_ids if `tag` is not NULL
+static int search_ids(VectorStore *store, const uint64_t *tag,
+                      const float *queries, size_t num_queries, size_t dim,
+                      size_t k, uint64_t *out_ids, float *out_scores) {
+  if (!queries || !out_ids || !out_scores ||
+      (num_queries && k > SIZE_MAX / sizeof(int) / num_queries))
+    return -1;
+  const size_t results = num_queries * k;
+  int *rows = (int *)malloc(sizeof(int) * (results ? results : 1));
+  if (!rows)
+    return -1;
+  const unsigned epoch = vs_read_begin(store);
+  int found;
+  if (!tag) {
+    found = search_batch(store, queries, num_queries, dim, k, rows,
+                         out_scores);
+  } else {
+    static const int no_rows[1] = {0};
+    const VsPartition *p = find_partition(store, *tag);
+    size_t n = 0;
+    const int *listed = p ? partition_rows(p, &n) : no_rows;
+    // Loaded after the list, as in vs_search_topk_tag
+    const size_t count = published_count(store);
+    found = INT_MAX;
+    for (size_t q = 0; q < num_queries && found >= 0; q++) {
+      const int kept =
+          search_topk(store, count, listed, n, queries + q * dim, dim, k,
+                      rows + q * k, out_scores + q * k);
+      found = kept < found ? kept : found;
+    }
+    if (found == INT_MAX)
+      found = 0;
+  }
+  // Before the read ends, while no row can move
+  for (size_t q = 0; q < num_queries && found > 0; q++) {
+    for (size_t j = 0; j < (size_t)found; j++)
+      out_ids[q * k + j] = row_id(store, (size_t)rows[q * k + j]);
+  }
+  vs_read_end(store, epoch);
+  free(rows);
+  return found;
+}
+
+int vs_search_ids(VectorStore *store, const float *queries,
+                  size_t num_queries, size_t dim, size_t k, uint64_t *out_ids,
+                  float *out_scores) {
+  return search_ids(store, NULL, queries, num_queries, dim, k, out_ids,
+                    out_scores);
+}
 
+int vs_search_tag_ids(VectorStore *store, uint64_t tag, const float *queries,
+                      size_t num_queries, size_t dim, size_t k,
+                      uint64_t *out_ids, float *out_scores) {
+  return search_ids(store, &tag, queries, num_queries, dim, k, out_ids,
+                    out_scores);
+}
+
+int vs_set_threads(size_t threads, size_t min_rows) {
+  if (vs_pool_resize(threads) != 0)
+    return -1;
+  parallel_min_rows = min_rows;
+  return 0;
+}
+
+int vs_enable_index(VectorStore *store, size_t m, size_t ef_construction) {
+  if (store->mapping || !store->full_precision)
+    return -1;
+  VsHnsw *index = vs_hnsw_create(m, ef_construction);
+  if (!index)
+    return -1;
   for (size_t i = 0; i < store->count; i++) {
-    Vector *v = &store->vectors[i];
-    if (v->dimension != dim)
+    if (vs_hnsw_reserve(index, i + 1) != 0) {
+      vs_hnsw_free(index);
+      return -1;
+    }
+  }
+  const VsRows rows = store_rows(store);
+  vs_hnsw_insert_batch(index, &rows, 0, store->count);
+  vs_hnsw_free(store->index);
+  store->index = index;
+  return 0;
+}
+
+int vs_search_ann(VectorStore *store, float *query, size_t dim, size_t k,
+                  size_t ef, int *out_idx, float *out_scores) {
+  if (!store->index)
+    return vs_search_topk(store, query, dim, k, out_idx, out_scores);
+  // Indexed stores are not shared with a writer, so the count is current
+  if (dim == 0 || (store->count && dim != store->dimension) || !out_idx ||
+      !out_scores)
+    return -1;
+  const float query_mag = magnitude(query, dim);
+  if (query_mag == 0)
+    return -1;
+  VS_STAT(const uint64_t start_ns = now_ns());
+  VS_STAT(stat_add(&store->stats.searches, 1));
+
+  const VsRows view = store_rows(store);
+  const int *rows;
+  const float *dots;
+  size_t scanned = 0;
+  const size_t found = vs_hnsw_search(store->index, &view, query,
+                                      ef < k ? k : ef, &rows, &dots, &scanned);
+  size_t kept = 0;
+  for (size_t j = 0; j < found && k > 0; j++) {
+    // Removed rows stay in the graph, to route through, until vs_compact
+    if (row_removed(store, (size_t)rows[j]))
       continue;
+    const float score = store->weighted
+                            ? dots[j] * row_weight(store, (size_t)rows[j])
+                            : dots[j];
+    offer(out_scores, out_idx, &kept, k, score, rows[j]);
+  }
+  VS_STAT(stat_add(&store->stats.vectors_scanned, scanned));
+  (void)scanned;
+
+  finish_topk(out_scores, out_idx, kept, query_mag);
+  VS_STAT(record_latency(&store->stats, start_ns));
+  return (int)kept;
+}
+
+int vs_remove(VectorStore *store, size_t index) {
+  if (store->mapping || index >= store->count || row_removed(store, index))
+    return -1;
+  size_t offset;
+  const size_t s = vs_segment_of(index, store->segment_shift, &offset);
+  VsPartition *p =
+      (VsPartition *)find_partition(store, store->tags[s][offset]);
+  // Searches loading the bit from now on skip the row; it stays listed and
+  // in place until vs_compact
+  mark_removed(store, index, 1);
+  __atomic_store_n(&p->live, p->live - 1, __ATOMIC_RELAXED);
+  store->removed++;
+  id_forget(store, store->ids[s][offset], index);
+  return 0;
+}
+
+int vs_update(VectorStore *store, size_t index, float *data, size_t dim) {
+  uint64_t tag;
+  if (vs_get_tag(store, index, &tag) != 0)
+    return -1;
+  const float weight = store->weighted ? row_weight(store, index) : 1.0f;
+  // The ID moves to the new row, so removing the old one leaves it
+  const uint64_t id = row_id(store, index);
+  if (add_row(store, data, dim, tag, weight, &id) != 0)
+    return -1;
+  vs_remove(store, index);
+  return (int)(store->count - 1);
+}
+
+int vs_remove_id(VectorStore *store, uint64_t id) {
+  const int index = vs_find_id(store, id);
+  return index < 0 ? -1 : vs_remove(store, (size_t)index);
+}
+
+int vs_update_id(VectorStore *store, uint64_t id, float *data, size_t dim) {
+  const int index = vs_find_id(store, id);
+  return index < 0 || vs_update(store, (size_t)index, data, dim) < 0 ? -1 : 0;
+}
 
-    float dot = vs_dot_product(v->data, query, dim);
-    float mag = magnitude(v->data, dim);
+size_t vs_count_removed(const VectorStore *store) { return store->removed; }
+
+// Copies row from's vector, weight, tag, ID and codes over row `to`
+static void copy_row(VectorStore *store, size_t from, size_t to) {
+  size_t from_offset, to_offset;
+  const size_t fs = vs_segment_of(from, store->segment_shift, &from_offset);
+  const size_t ts = vs_segment_of(to, store->segment_shift, &to_offset);
+  const size_t dim = store->dimension;
+  if (store->full_precision)
+    memcpy(store->data[ts] + to_offset * dim,
+           store->data[fs] + from_offset * dim, sizeof(float) * dim);
+  if (store->weighted)
+    store->weights[ts][to_offset] = store->weights[fs][from_offset];
+  store->tags[ts][to_offset] = store->tags[fs][from_offset];
+  store->ids[ts][to_offset] = store->ids[fs][from_offset];
+  if (store->quant)
+    vs_quant_copy(store->quant, from, to);
+}
+
+// Where moved row `row` goes; from[] is in descending order
+static int moved_to(const int *from, const int *to, size_t moves, int row) {
+  size_t low = 0, high = moves;
+  while (high - low > 1) {
+    const size_t mid = low + (high - low) / 2;
+    if (from[mid] >= row)
+      low = mid;
+    else
+      high = mid;
+  }
+  return to[low];
+}
+
+// p's list as it stands once the moves are made: removed rows dropped,
+// moved ones renumbered, padded with -1 to its old length for searches
+// that loaded the old count (see collect_topk). NULL in *out if nothing
+// changes; returns -1 when out of memory.
+static int compact_list(const VectorStore *store, const VsPartition *p,
+                        size_t end, const int *from, const int *to,
+                        size_t moves, int **out) {
+  *out = NULL;
+  int changed = p->live < p->count;
+  for (size_t j = 0; j < p->count && !changed; j++)
+    changed = (size_t)p->rows[j] >= end;
+  if (!changed)
+    return 0;
+  int *rows = (int *)malloc(sizeof(int) * p->capacity);
+  if (!rows)
+    return -1;
+  size_t n = 0;
+  for (size_t j = 0; j < p->count; j++) {
+    const int row = p->rows[j];
+    if (!row_removed(store, (size_t)row))
+      rows[n++] =
+          (size_t)row < end ? row : moved_to(from, to, moves, row);
+  }
+  for (size_t j = n; j < p->count; j++)
+    rows[j] = -1;
+  *out = rows;
+  return 0;
+}
 
-    if (mag == 0)
+// Frees the segments past those holding rows [0, count)
+static void drop_segments(VectorStore *store, size_t count) {
+  while (store->segments &&
+         vs_segments_capacity(store->segments - 1, store->segment_shift) >=
+             count) {
+    const size_t s = --store->segments;
+    free(store->data[s]);
+    free(store->weights[s]);
+    free(store->tags[s]);
+    free(store->ids[s]);
+    free(store->tombstones[s]);
+    store->data[s] = store->weights[s] = NULL;
+    store->tags[s] = store->ids[s] = store->tombstones[s] = NULL;
+    store->capacity -= vs_segment_rows(s, store->segment_shift);
+  }
+  if (store->quant)
+    vs_quant_trim(store->quant, store->capacity);
+}
+
+// Gives the moves, the row remap for the index and the new tag lists, or
+// frees what it allocated and returns -1
+static int plan_compaction(VectorStore *store, size_t count, size_t end,
+                           const int *from, const int *to, size_t moves,
+                           int **remap, int ***lists) {
+  *remap = NULL;
+  const VsPartitionTable *table = store->partitions;
+  const size_t slots = table ? table->slots : 0;
+  *lists = (int **)calloc(slots ? slots : 1, sizeof(int *));
+  int failed = !*lists;
+  size_t rebuilt = 0;
+  for (size_t i = 0; i < slots && !failed; i++) {
+    const VsPartition *p = &table->entries[i];
+    if (p->rows)
+      failed = compact_list(store, p, end, from, to, moves, &(*lists)[i]);
+    rebuilt += !failed && (*lists)[i];
+  }
+  if (!failed && store->index && end < count) {
+    *remap = (int *)malloc(sizeof(int) * count);
+    failed = !*remap;
+    for (size_t r = 0; r < count && !failed; r++)
+      (*remap)[r] = row_removed(store, r) ? -1 : (int)r;
+    for (size_t i = 0; i < moves && !failed; i++)
+      (*remap)[from[i]] = to[i];
+  }
+  if (failed || reserve_retired(store, rebuilt) != 0) {
+    for (size_t i = 0; *lists && i < slots; i++)
+      free((*lists)[i]);
+    free(*lists);
+    free(*remap);
+    return -1;
+  }
+  return 0;
+}
+
+int vs_compact(VectorStore *store, size_t max_moves, int *moved_from,
+               int *moved_to) {
+  if (store->mapping)
+    return -1;
+  const size_t count = store->count;
+  const size_t most = max_moves < store->removed ? max_moves : store->removed;
+  int *from = (int *)malloc(sizeof(int) * (most ? most : 1));
+  int *to = (int *)malloc(sizeof(int) * (most ? most : 1));
+  if (!from || !to) {
+    free(from);
+    free(to);
+    return -1;
+  }
+  // The last live rows fill the lowest holes; removed rows left past the
+  // last live one are dropped
+  size_t moves = 0, end = trim_removed(store, count);
+  for (size_t hole = next_removed(store, 0, end); hole < end && moves < most;
+       hole = next_removed(store, hole + 1, end)) {
+    from[moves] = (int)(end - 1);
+    to[moves++] = (int)hole;
+    const size_t below = trim_removed(store, end - 1);
+    end = below > hole ? below : hole + 1;
+  }
+  int *remap, **lists;
+  if ((end == count && !store->retired_count) ||
+      plan_compaction(store, count, end, from, to, moves, &remap, &lists) !=
+          0) {
+    free(from);
+    free(to);
+    return end == count && !store->retired_count ? 0 : -1;
+  }
+
+  VsPartitionTable *table = store->partitions;
+  for (size_t i = 0; table && i < table->slots; i++) {
+    VsPartition *p = &table->entries[i];
+    if (!lists[i])
       continue;
+    retire(store, p->rows, sizeof(int) * p->capacity);
+    __atomic_store_n(&p->rows, lists[i], __ATOMIC_RELEASE);
+    __atomic_store_n(&p->count, p->live, __ATOMIC_RELEASE);
+  }
+  free(lists);
+  // From here no search holds a replaced list, or is scoring a row it
+  // found live before the row was removed: holes can be overwritten
+  vs_wait_for_readers(store);
+  for (size_t i = 0; i < store->retired_count; i++)
+    free(store->retired[i]);
+  store->retired_count = store->retired_bytes = 0;
+  for (size_t i = 0; i < moves; i++) {
+    copy_row(store, (size_t)from[i], (size_t)to[i]);
+    // Gone from its old row before it appears in the new one, so no
+    // search returns it twice
+    mark_removed(store, (size_t)from[i], 1);
+    mark_removed(store, (size_t)to[i], 0);
+    id_set(store, row_id(store, (size_t)to[i]), (size_t)to[i]);
+  }
+  if (remap) {
+    const VsRows rows = store_rows(store);
+    vs_hnsw_compact(store->index, &rows, remap, end);
+    free(remap);
+  }
+  store->removed -= count - end;
+  __atomic_store_n(&store->count, end, __ATOMIC_RELEASE);
+  if (end < count) {
+    // Searches that loaded the old count may still read past the new one;
+    // once they are done, vs_add may refill those rows
+    vs_wait_for_readers(store);
+    drop_segments(store, end);
+  }
+  if (moved_from && moved_to) {
+    memcpy(moved_from, from, sizeof(int) * moves);
+    memcpy(moved_to, to, sizeof(int) * moves);
+  }
+  free(from);
+  free(to);
+  return (int)moves;
+}
 
-    float sim = dot / (mag * query_mag);
-    if (sim > best_sim) {
-      best_sim = sim;
-      best_idx = (int)i;
+int vs_quantize(VectorStore *store, int kind, size_t pq_subspaces,
+                int keep_full) {
+  if (store->mapping || !store->count || !store->full_precision ||
+      (!keep_full && store->index))
+    return -1;
+  if (kind == VS_QUANT_NONE) {
+    vs_quant_free(store->quant);
+    store->quant = NULL;
+    return 0;
+  }
+  const VsRows rows = store_rows(store);
+  VsQuant *quant = vs_quant_create(kind, store->dimension, pq_subspaces,
+                                   &rows, store->count);
+  if (!quant || vs_quant_reserve(quant, store->capacity) != 0) {
+    vs_quant_free(quant);
+    return -1;
+  }
+  // Rows are unit-length already
+  for (size_t i = 0; i < store->count; i++)
+    vs_quant_encode(quant, i, row_data(store, i), 1.0);
+  vs_quant_free(store->quant);
+  store->quant = quant;
+  if (!keep_full) {
+    for (size_t s = 0; s < store->segments; s++) {
+      free(store->data[s]);
+      store->data[s] = NULL;
     }
+    store->full_precision = 0;
+    store->rerank = 0;
   }
+  return 0;
+}
 
-  return best_idx;
+int vs_set_rerank(VectorStore *store, size_t factor) {
+  if (!store->full_precision)
+    return -1;
+  store->rerank = factor;
+  return 0;
+}
+
+size_t vs_memory_bytes(const VectorStore *store) {
+  const VsPartitionTable *table = store->partitions;
+  if (store->mapping)
+    return sizeof(VectorStore) + (table ? table_bytes(table->slots) : 0);
+  const size_t capacity = store->capacity;
+  size_t bytes = sizeof(VectorStore) + 2 * capacity * sizeof(uint64_t) +
+                 capacity / 8 + // Tags, IDs and tombstones
+                 store->id_slot_count * sizeof(uint32_t);
+  if (store->full_precision)
+    bytes += capacity * store->dimension * sizeof(float);
+  if (store->weighted)
+    bytes += capacity * sizeof(float);
+  if (store->quant)
+    bytes += capacity * vs_quant_row_bytes(store->quant) +
+             vs_quant_table_bytes(store->quant);
+  if (table) {
+    bytes += table_bytes(table->slots);
+    for (size_t i = 0; i < table->slots; i++)
+      bytes += table->entries[i].capacity * sizeof(int);
+  }
+  return bytes + store->retired_bytes +
+         store->retired_capacity * sizeof(void *);
+}
+
+int vs_get_stats(const VectorStore *store, VsStats *out) {
+#ifdef VS_ENABLE_STATS
+  // A counter at a time: searches may be bumping them meanwhile
+  const uint64_t *from = (const uint64_t *)&store->stats;
+  uint64_t *to = (uint64_t *)out;
+  for (size_t i = 0; i < sizeof(VsStats) / sizeof(uint64_t); i++)
+    to[i] = __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+  return 0;
+#else
+  (void)store;
+  memset(out, 0, sizeof(*out));
+  return -1;
+#endif
+}
+
+void vs_reset_stats(VectorStore *store) {
+#ifdef VS_ENABLE_STATS
+  memset(&store->stats, 0, sizeof(store->stats));
+#else
+  (void)store;
+#endif
 }
 
 void vs_free(VectorStore *store) {
-  for (size_t i = 0; i < store->count; i++) {
-    free(store->vectors[i].data);
+  VsPartitionTable *table = store->partitions;
+  if (!store->mapping) {
+    for (size_t s = 0; s < store->segments; s++) {
+      free(store->data[s]);
+      free(store->weights[s]);
+      free(store->tags[s]);
+      free(store->ids[s]);
+      free(store->tombstones[s]);
+    }
+    for (size_t i = 0; table && i < table->slots; i++)
+      free(table->entries[i].rows);
+    free(store->id_slots);
   }
-  free(store->vectors);
+  for (size_t i = 0; i < store->retired_count; i++)
+    free(store->retired[i]);
+  free(store->retired);
+  free(table);
+  vs_hnsw_free(store->index);
+  vs_quant_free(store->quant);
+  vs_unmap(store->mapping, store->mapping_bytes);
   free(store);
 }
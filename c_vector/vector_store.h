@@ -2,30 +2,347 @@
 #define VECTOR_STORE_H
 
 #include <stddef.h>
+#include <stdint.h>
 
+// Search latency buckets: bucket 0 counts calls under 1 us, bucket i calls
+// in [2^(i-1), 2^i) us, and the last one everything slower.
+#define VS_LATENCY_BUCKETS 20
+
+// Counters snapshot; all fields are uint64 so ctypes can mirror it. Only
+// filled when built with -DVS_ENABLE_STATS.
 typedef struct {
-  float *data;
-  size_t dimension;
-} Vector;
+  uint64_t adds;
+  uint64_t searches;
+  uint64_t vectors_scanned; // Similarity computations across all searches
+  uint64_t search_time_ns;  // Wall time summed over all searches
+  uint64_t latency_buckets[VS_LATENCY_BUCKETS];
+} VsStats;
+
+// Alignment of every row segment, one cache line
+#define VS_ALIGNMENT 64
+
+// Segments a store can grow to; each doubles its capacity, so even from
+// the smallest start these hold more than INT_MAX rows
+#define VS_MAX_SEGMENTS 32
 
+// Rows sharing a tag (e.g. one agent's memories). A full list is copied to
+// one twice the size, and vs_compact writes a list without removed rows;
+// the old copy is kept (see VectorStore.retired) for searches that are
+// still reading it. Entries at or past a search's row count are skipped.
 typedef struct {
-  Vector *vectors;
+  uint64_t tag;
+  int *rows; // NULL marks an empty hash slot
   size_t count;
   size_t capacity;
+  size_t live; // Listed rows not removed
+} VsPartition;
+
+// Open-addressed by tag
+typedef struct {
+  size_t slots; // Power of two
+  VsPartition entries[];
+} VsPartitionTable;
+
+// Compressed row formats for vs_quantize
+#define VS_QUANT_NONE 0
+#define VS_QUANT_INT8 1 // 1 byte per component + a float scale per row
+#define VS_QUANT_FP16 2 // IEEE half per component
+#define VS_QUANT_PQ 3   // 1 byte per slice (product quantization)
+
+struct VsHnsw;  // Approximate nearest-neighbour graph, see vs_hnsw.h
+struct VsQuant; // Compressed rows, see vs_quant.h
+
+// All vectors share one dimension and are normalized to unit length on
+// insert. They live row-major in append-only segments (see vs_segments.h):
+// segment 0 holds 2^segment_shift rows and each later one twice the
+// previous, so growing adds a segment and never moves a stored row.
+// Every row also has a uint64 ID, handed out in add order from 0 and
+// never reused, which stays with its vector when vs_compact moves it.
+//
+// One thread may add, remove and compact (vs_add*, vs_remove, vs_update,
+// vs_compact) while any number search. A row is complete before `count` is
+// raised past it, and a search reads `count` once and nothing beyond it,
+// so searches never wait for the writer and never see half a row; tag
+// lists and the tag table are replaced, not changed in place. A removed
+// row keeps its slot, marked in `tombstones`, until vs_compact moves a
+// later row into it, which it does only once every search that might still
+// read the row has ended (see vs_epoch.h). The ID table is the writer's
+// own: vs_find_id, vs_remove_id and vs_update_id belong on its thread,
+// while searches read IDs from `ids`. Every other change
+// (vs_set_weight, vs_enable_index, vs_quantize, vs_set_rerank, vs_free)
+// needs searches stopped, and an indexed store allows no concurrent use at
+// all.
+typedef struct {
+  float *data[VS_MAX_SEGMENTS]; // Per segment, VS_ALIGNMENT-aligned rows x
+                                // dimension floats; NULL once quantized
+                                // without full precision
+  float *weights[VS_MAX_SEGMENTS]; // Per-row score weights, while weighted
+  uint64_t *tags[VS_MAX_SEGMENTS]; // Per-row tags
+  uint64_t *ids[VS_MAX_SEGMENTS];  // Per-row IDs
+  uint64_t *tombstones[VS_MAX_SEGMENTS]; // Per segment, a bit per row set
+                                         // by vs_remove; NULL for none
+  unsigned segment_shift;
+  size_t segments; // Allocated so far
+  int weighted;    // Some weight is not 1; until then none are allocated
+  VsPartitionTable *partitions; // NULL before the first add
+  size_t partition_count;
+  // Tag lists and tables replaced by new copies, freed by vs_compact once
+  // no search can be reading them
+  void **retired;
+  size_t retired_count, retired_capacity, retired_bytes;
+  size_t removed; // Rows removed and not yet compacted away
+  // Each live ID's row + 1, open-addressed by ID (see vs_ids.h);
+  // id_slot_count is a power of two, 0 before the first add
+  uint32_t *id_slots;
+  size_t id_slot_count, id_count;
+  uint64_t next_id; // The next vs_add*'s
+  // Grace periods: searches count themselves in readers[epoch & 1] while
+  // they run, and vs_compact flips the epoch and waits for the old side
+  unsigned epoch;
+  size_t readers[2];
+  struct VsHnsw *index; // NULL until vs_enable_index
+  struct VsQuant *quant; // NULL until vs_quantize
+  int full_precision;    // Float rows kept; cleared by vs_quantize only
+  size_t rerank;         // Candidates re-scored per result, 0 for none
+  size_t dimension; // Fixed by the first vs_add, 0 while empty
+  size_t count;     // Raised (release order) once a row is complete
+  size_t capacity;  // Rows the segments hold
+  const void *mapping;  // File opened by vs_open_mmap, NULL for heap stores
+  size_t mapping_bytes; // Its size; the arrays above point into it
+#ifdef VS_ENABLE_STATS
+  VsStats stats;
+#endif
 } VectorStore;
 
 // Initialize a new store
 VectorStore *vs_create(size_t initial_capacity);
 
-// Add a vector to the store (copies data)
-void vs_add(VectorStore *store, float *data, size_t dim);
+// Add a vector to the store (copies it, normalized to unit length). The
+// first vector fixes the store's dimension; returns 0, or -1 for another
+// dimension, a zero or non-finite vector, or when out of memory. One
+// thread may add while others search (see VectorStore).
+int vs_add(VectorStore *store, float *data, size_t dim);
+
+// vs_add with a weight (e.g. a memory's importance) that multiplies the
+// vector's score in vs_search_topk; -1 also for a non-finite weight
+int vs_add_weighted(VectorStore *store, float *data, size_t dim,
+                    float weight);
+
+// vs_add_weighted with a tag; rows added without one have tag 0. Each tag
+// keeps its own list of rows, so searches by tag skip every other row
+int vs_add_tagged(VectorStore *store, float *data, size_t dim, uint64_t tag,
+                  float weight);
+
+// Add n vectors at once from buffers a binding can pass straight through
+// (a C-contiguous float32 numpy array, say): data is row-major n x dim,
+// tags and weights n entries each (NULL for tag 0 and weight 1 apiece).
+// Vector i's ID goes to out_ids[i] unless out_ids is NULL. Returns how
+// many were added, which is n unless one fails as vs_add_tagged would,
+// ending the batch there. Vectors are normalized and encoded in parallel
+// on the vs_set_threads pool, and linked into the index in rounds rather
+// than one at a time (see vs_hnsw_insert_batch), a few thousand per step;
+// searches see each step's rows together, once all are linked.
+int vs_add_batch(VectorStore *store, const float *data, size_t n, size_t dim,
+                 const uint64_t *tags, const float *weights,
+                 uint64_t *out_ids);
+
+// Make room for `rows` rows in all, so adds up to that many allocate
+// nothing for rows. Before the first add the first segment is sized to
+// hold them all. Returns 0, or -1 when out of memory, for more than
+// INT_MAX rows, or for a mapped store.
+int vs_reserve(VectorStore *store, size_t rows);
+
+// Add every vector of a file of raw row-major float32 rows, `dim` each (a
+// numpy array's tofile, say), reading a few megabytes at a time and
+// adding them with vs_add_batch after one vs_reserve for the lot. Returns
+// the number added, which stops at a vector vs_add would refuse or a read
+// error; -1 if the file cannot be opened, is not whole rows or has more
+// than INT_MAX of them, when out of memory, or for a mapped store.
+int vs_add_file(VectorStore *store, const char *path, size_t dim);
+
+// Remove stored vector `index`: searches skip it from now on and its slot
+// is reclaimed by vs_compact. Returns 0, or -1 if out of range, already
+// removed, or the store is mapped.
+int vs_remove(VectorStore *store, size_t index);
+
+// Replace stored vector `index` with `data`, keeping its tag, weight and
+// ID: the new vector is added (so it gets a new index) and the old one
+// removed, and a search in between may see both. Returns the new index, or
+// -1 as vs_add or vs_remove would; on failure the old vector stays.
+int vs_update(VectorStore *store, size_t index, float *data, size_t dim);
+
+// One incremental compaction step: moves up to max_moves of the last live
+// rows into the lowest removed slots, drops removed rows off the end, and
+// rebuilds the tag lists and index entries of the rows involved. Memory the
+// store no longer uses (trailing segments, replaced tag lists) is freed
+// once the searches that began before the call have ended; the call waits
+// for them, though it never stops new ones. A search running meanwhile may
+// miss a row that is moving. If moved_from and moved_to are not NULL (room
+// for max_moves entries each), row moved_from[i] is now row moved_to[i].
+// Returns the number of rows moved, or -1 for a mapped store or out of
+// memory; the store is compact once vs_count_removed is 0.
+int vs_compact(VectorStore *store, size_t max_moves, int *moved_from,
+               int *moved_to);
+
+// Removed rows that vs_compact has not reclaimed yet
+size_t vs_count_removed(const VectorStore *store);
+
+// ID of stored vector `index` into *out; returns 0, or -1 if out of range
+// or removed
+int vs_get_id(const VectorStore *store, size_t index, uint64_t *out);
+
+// Index of the stored vector with ID `id`, or -1 if there is none (never
+// given out, or removed). On a heap store, call it from the thread that
+// adds; a mapped store answers from its file, from any thread.
+int vs_find_id(const VectorStore *store, uint64_t id);
+
+// vs_remove and vs_update by ID; both return 0, or -1 as vs_find_id, or the
+// call by index, would
+int vs_remove_id(VectorStore *store, uint64_t id);
+int vs_update_id(VectorStore *store, uint64_t id, float *data, size_t dim);
+
+// Tag of stored vector `index` into *out; returns 0, or -1 if out of range
+// or removed
+int vs_get_tag(const VectorStore *store, size_t index, uint64_t *out);
+
+// Number of stored vectors with `tag`, not counting removed ones
+size_t vs_count_tag(const VectorStore *store, uint64_t tag);
+
+// Change a stored vector's weight; returns 0, or -1 if out of range,
+// removed or not finite
+int vs_set_weight(VectorStore *store, size_t index, float weight);
+
+// Stored (unit-length) vector `index`, or NULL if out of range, removed or
+// the store keeps no full-precision rows. The pointer stays valid until
+// vs_compact.
+const float *vs_get(const VectorStore *store, size_t index);
 
 // Calculate dot product
-float vs_dot_product(float *v1, float *v2, size_t dim);
+float vs_dot_product(const float *v1, const float *v2, size_t dim);
+
+// Name of the dot-product kernel in use: "avx512", "avx2", "neon" or
+// "scalar", the best the CPU supports unless overridden
+const char *vs_kernel_name(void);
+
+// Switch every store to the named kernel (for tests and benchmarks); returns
+// 0, or -1 if it is unknown or unsupported here. Not safe while searching
+int vs_use_kernel(const char *name);
 
-// Find index of most similar vector (cosine similarity)
+// Find index of most similar vector (cosine similarity); -1 if the store is
+// empty, dim differs from the store's or the query is zero
 int vs_find_nearest(VectorStore *store, float *query, size_t dim);
 
+// The k best vectors by cosine similarity x weight, best first, written to
+// out_idx/out_scores (k entries each); ties rank the lower index first.
+// Returns the number written (k, or fewer if the store is smaller), or -1 if
+// dim differs from the store's, the query is zero or a buffer is NULL
+int vs_search_topk(VectorStore *store, float *query, size_t dim, size_t k,
+                   int *out_idx, float *out_scores);
+
+// vs_search_topk over the vectors with `tag` only; costs one pass over
+// that tag's rows, whatever the store's size
+int vs_search_topk_tag(VectorStore *store, uint64_t tag, float *query,
+                       size_t dim, size_t k, int *out_idx, float *out_scores);
+
+// vs_search_topk for num_queries queries at once: queries is row-major
+// (num_queries x dim) and query q's results go to out_idx/out_scores
+// + q * k. Rows are scored against blocks of queries together, so each is
+// read from memory once per block rather than once per query. Returns the
+// number written per query, or -1 for a dim mismatch, a zero query (all are
+// checked before any is searched) or a NULL buffer. Quantized stores scan
+// once per query.
+int vs_search_batch(VectorStore *store, const float *queries,
+                    size_t num_queries, size_t dim, size_t k, int *out_idx,
+                    float *out_scores);
+
+// vs_search_batch reporting IDs: query q's are the first (returned count)
+// entries of out_ids/out_scores + q * k. The rows are read and their IDs
+// looked up in one go, so a vs_compact alongside cannot mix them up.
+// Returns as vs_search_batch does, or -1 also when out of memory.
+int vs_search_ids(VectorStore *store, const float *queries,
+                  size_t num_queries, size_t dim, size_t k, uint64_t *out_ids,
+                  float *out_scores);
+
+// vs_search_ids over the vectors with `tag` only, each query costing one
+// pass over that tag's rows as in vs_search_topk_tag
+int vs_search_tag_ids(VectorStore *store, uint64_t tag, const float *queries,
+                      size_t num_queries, size_t dim, size_t k,
+                      uint64_t *out_ids, float *out_scores);
+
+// Default vs_set_threads threshold: below this many rows a scan is too
+// short to pay for waking other threads
+#define VS_PARALLEL_MIN_ROWS 16384
+
+// Split full scans (vs_find_nearest, vs_search_topk, and the code pass of
+// quantized stores) of stores with at least min_rows rows over `threads`
+// threads, the caller included; each scans cache-sized shards into its own
+// top-k heap and the heaps are merged, so results equal a serial scan's.
+// The threads persist between searches. 1 (the default) keeps every scan
+// on the caller. Process-wide; not safe while searching. Returns 0, or -1
+// for 0 threads or if they cannot be started (then scans stay serial).
+int vs_set_threads(size_t threads, size_t min_rows);
+
+// Index the store with an HNSW graph: m links per node and layer (16 is a
+// good start; more raises recall and memory), ef_construction candidates
+// per insert (200; more builds slower and better). Indexes existing rows,
+// then every vs_add; returns 0, or -1 for m < 2, ef_construction == 0 or
+// out of memory. An indexed store must not be searched or grown from two
+// threads at once.
+int vs_enable_index(VectorStore *store, size_t m, size_t ef_construction);
+
+// vs_search_topk through the index, if there is one (else exact): the
+// graph search keeps the ef most similar rows and the k best of those by
+// score are returned. Larger ef trades latency for recall; ef < k acts as
+// k. Weights are applied to the candidates, not while walking the graph.
+int vs_search_ann(VectorStore *store, float *query, size_t dim, size_t k,
+                  size_t ef, int *out_idx, float *out_scores);
+
+// Compress the store: the rows so far, and every later vs_add, are also
+// kept as `kind` codes, and searches other than vs_search_ann score the
+// codes. PQ trains on the current rows (up to 256 centroids per slice) and
+// splits vectors into pq_subspaces slices, which must divide the dimension
+// (dimension / 4 is a good start; fewer slices are smaller and coarser).
+// Unless keep_full, the float rows are freed, and vs_get, re-ranking and
+// indexing are unavailable. VS_QUANT_NONE drops the codes again, if the
+// float rows are still there. Returns 0, or -1 for an empty store, a bad
+// kind or slice count, an indexed store losing its rows, or out of memory.
+int vs_quantize(VectorStore *store, int kind, size_t pq_subspaces,
+                int keep_full);
+
+// Re-score the best k x factor code matches against the full-precision
+// rows and return the k best of those (0 turns it off); returns 0, or -1
+// without full-precision rows
+int vs_set_rerank(VectorStore *store, size_t factor);
+
+// Heap bytes held by the store's rows, codes, weights, tags, IDs and index
+// (of a mapped store only the tag table, the rest being in the page cache)
+size_t vs_memory_bytes(const VectorStore *store);
+
+// Write the store to `path` (replaced atomically, through a temporary file
+// beside it): rows, weights, tags, IDs (with a table to find them by),
+// codes and index, each section aligned so it can be searched straight
+// from a mapping. Files are native-endian.
+// Like a search, it may run alongside vs_add and saves the rows added
+// before it began. Returns 0, or -1 when the file cannot be written.
+int vs_save(const VectorStore *store, const char *path);
+
+// Open a file written by vs_save without reading it: the store's arrays
+// point into a shared read-only mapping, so opening takes the same time
+// for any size, pages are read as searches touch them, and processes
+// opening the same file share one copy in the page cache. The store is
+// read-only: vs_add*, vs_remove*, vs_update*, vs_compact, vs_set_weight,
+// vs_reserve, vs_enable_index and vs_quantize return -1 (vs_add_batch
+// 0). The file must not be modified while open (vs_save replaces it with a
+// new file, so it may). Only the layout is checked, not row and link
+// contents: open files from vs_save only. NULL if the file is missing,
+// from another version or byte order, malformed, or out of memory.
+VectorStore *vs_open_mmap(const char *path);
+
+// Copy the store's counters into *out; returns 0, or -1 (and zeroes *out)
+// when built without VS_ENABLE_STATS
+int vs_get_stats(const VectorStore *store, VsStats *out);
+void vs_reset_stats(VectorStore *store);
+
 // Free memory
 void vs_free(VectorStore *store);
 
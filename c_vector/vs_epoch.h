@@ -0,0 +1,46 @@
+#ifndef VS_EPOCH_H
+#define VS_EPOCH_H
+
+#include "vector_store.h"
+#include <sched.h>
+
+// Grace periods for memory that searches may still be reading (see
+// VectorStore.epoch). A search counts itself in on the side of the current
+// epoch; vs_compact flips the epoch and waits for the old side to empty,
+// after which no search can hold anything it replaced before the flip.
+// Searches never wait: only the writer does, for searches already running.
+
+// The counters are bookkeeping beside the store, bumped by searches that
+// otherwise only read it
+static inline size_t *vs_epoch_readers(const VectorStore *store) {
+  return (size_t *)store->readers;
+}
+
+// Returns the epoch to hand to vs_read_end
+static inline unsigned vs_read_begin(const VectorStore *store) {
+  for (;;) {
+    const unsigned epoch = __atomic_load_n(&store->epoch, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&vs_epoch_readers(store)[epoch & 1], 1,
+                       __ATOMIC_SEQ_CST);
+    // Counted before the flip, or the writer would not wait for us
+    if (__atomic_load_n(&store->epoch, __ATOMIC_SEQ_CST) == epoch)
+      return epoch;
+    __atomic_fetch_sub(&vs_epoch_readers(store)[epoch & 1], 1,
+                       __ATOMIC_SEQ_CST);
+  }
+}
+
+static inline void vs_read_end(const VectorStore *store, unsigned epoch) {
+  __atomic_fetch_sub(&vs_epoch_readers(store)[epoch & 1], 1,
+                     __ATOMIC_RELEASE);
+}
+
+// Returns once every search that began before the call has ended
+static inline void vs_wait_for_readers(VectorStore *store) {
+  const unsigned epoch = store->epoch; // Only the writer changes it
+  __atomic_store_n(&store->epoch, epoch + 1, __ATOMIC_SEQ_CST);
+  while (__atomic_load_n(&store->readers[epoch & 1], __ATOMIC_ACQUIRE))
+    sched_yield();
+}
+
+#endif
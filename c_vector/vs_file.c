@@ -0,0 +1,511 @@
+#define _POSIX_C_SOURCE 200809L // mmap, fsync, O_CLOEXEC
+#include "vs_file.h"
+#include "vector_store.h"
+#include "vs_epoch.h"
+#include "vs_hnsw.h"
+#include "vs_ids.h"
+#include "vs_quant.h"
+#include "vs_segments.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define VS_FILE_MAGIC "CONCORDV"
+// Written as a native uint32; a file from a machine of the other byte order
+// reads back as 0x04030201
+#define VS_BYTE_ORDER 0x01020304u
+
+// Offset 0: where to find everything else. Section offsets are 0 when the
+// section is absent (the header occupies offset 0, so none starts there).
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t file_bytes; // Catches truncated files
+  uint64_t dimension, count, rerank;
+  uint64_t data;    // count x dimension floats, if full precision is kept
+  uint64_t weights; // count floats, if any weight is not 1
+  uint64_t tags;    // count uint64s
+  uint64_t partitions; // partition_slots FilePartition entries
+  uint64_t partition_slots, partition_count;
+  uint64_t partition_rows; // The partitions' row lists, back to back
+  uint64_t partition_row_count;
+  uint64_t quant, index; // Sections described by vs_quant.c and vs_hnsw.c
+  uint64_t tombstones;   // A bit per row, 64 to a uint64, if any is removed
+  uint64_t removed;      // Rows with the bit set
+  uint64_t ids;          // count uint64s
+  // The saved rows' ID table (vs_ids.h), id_slot_count uint32s; absent
+  // for an empty store
+  uint64_t id_slots, id_slot_count;
+  uint64_t next_id;
+} FileHeader;
+
+// One slot of the tag table, in the same position as in memory so opening
+// a file does not rehash
+typedef struct {
+  uint64_t tag;
+  uint64_t count; // 0 for an empty slot
+  uint64_t first; // Index of its first row in the partition_rows list
+} FilePartition;
+
+static void write_padding(VsWriter *writer, size_t bytes) {
+  static const unsigned char zeros[4096] = {0};
+  for (size_t n; bytes > 0; bytes -= n) {
+    n = bytes < sizeof(zeros) ? bytes : sizeof(zeros);
+    vs_write_bytes(writer, zeros, n);
+  }
+}
+
+static int bit_set(const uint64_t *bits, size_t i) {
+  return (int)(bits[i / 64] >> (i % 64) & 1);
+}
+
+uint64_t vs_write_begin(VsWriter *writer) {
+  const size_t gap =
+      (VS_ALIGNMENT - writer->offset % VS_ALIGNMENT) % VS_ALIGNMENT;
+  write_padding(writer, gap);
+  return writer->offset;
+}
+
+void vs_write_bytes(VsWriter *writer, const void *data, size_t bytes) {
+  if (writer->failed || bytes == 0)
+    return;
+  if (fwrite(data, 1, bytes, writer->file) != bytes)
+    writer->failed = 1;
+  writer->offset += bytes;
+}
+
+void vs_write_segments(VsWriter *writer, const void *const *segments,
+                       unsigned shift, size_t bytes, size_t count,
+                       const uint64_t *rows) {
+  for (size_t s = 0, done = 0; done < count; s++) {
+    const size_t size = vs_segment_rows(s, shift);
+    const size_t n = count - done < size ? count - done : size;
+    const char *segment = (const char *)segments[s];
+    // Runs of entries kept, or zeroed, alike
+    for (size_t i = 0, j; i < n; i = j) {
+      const int kept = !rows || bit_set(rows, done + i);
+      for (j = i + 1; j < n && (!rows || bit_set(rows, done + j)) == kept;)
+        j++;
+      if (kept)
+        vs_write_bytes(writer, segment + i * bytes, (j - i) * bytes);
+      else
+        write_padding(writer, (j - i) * bytes);
+    }
+    done += n;
+  }
+}
+
+const void *vs_mapped(const VsMapping *map, uint64_t offset, uint64_t bytes) {
+  if (offset % VS_ALIGNMENT || offset > map->bytes ||
+      bytes > map->bytes - offset)
+    return NULL;
+  return map->base + offset;
+}
+
+void vs_unmap(const void *base, size_t bytes) {
+  if (base)
+    munmap((void *)base, bytes);
+}
+
+// What a search starting now would see: the row count, then each tag list
+// (loaded as a search loads them), and the rows on them below the count
+// and not removed, marked in `listed`. A row is saved as live only if
+// listed, so the file stays consistent with a vs_add, vs_remove or
+// vs_compact alongside: those only decide whether their rows are in it.
+typedef struct {
+  size_t count;
+  const VsPartitionTable *table; // Loaded after the count, so every row
+                                 // below it is on one of its lists
+  const int **rows; // Per slot
+  size_t *lengths;
+  uint64_t *listed; // A bit per row
+  size_t live;
+} Snapshot;
+
+static int take_snapshot(const VectorStore *store, Snapshot *snap) {
+  snap->count = __atomic_load_n(&store->count, __ATOMIC_ACQUIRE);
+  const VsPartitionTable *table = snap->table =
+      __atomic_load_n(&store->partitions, __ATOMIC_ACQUIRE);
+  const size_t slots = table ? table->slots : 0;
+  snap->rows = (const int **)malloc(sizeof(int *) * (slots ? slots : 1));
+  snap->lengths = (size_t *)malloc(sizeof(size_t) * (slots ? slots : 1));
+  snap->listed =
+      (uint64_t *)calloc(snap->count / 64 + 1, sizeof(uint64_t));
+  snap->live = 0;
+  if (!snap->rows || !snap->lengths || !snap->listed)
+    return -1;
+  for (size_t i = 0; i < slots; i++) {
+    const VsPartition *p = &table->entries[i];
+    snap->lengths[i] = __atomic_load_n(&p->count, __ATOMIC_ACQUIRE);
+    snap->rows[i] = __atomic_load_n(&p->rows, __ATOMIC_ACQUIRE);
+    for (size_t j = 0; j < snap->lengths[i]; j++) {
+      const size_t row = (size_t)snap->rows[i][j];
+      if (row < snap->count &&
+          !vs_row_marked(store->tombstones, store->segment_shift, row)) {
+        snap->listed[row / 64] |= (uint64_t)1 << (row % 64);
+        snap->live++;
+      }
+    }
+  }
+  return 0;
+}
+
+static int listed(const Snapshot *snap, int row) {
+  return (size_t)row < snap->count && bit_set(snap->listed, (size_t)row);
+}
+
+// A new table of the listed rows' IDs: the store's own is the writer's, so
+// it cannot be read here
+static void write_id_table(const VectorStore *store, const Snapshot *snap,
+                           VsWriter *writer, FileHeader *header) {
+  const size_t slots = vs_id_slots_for(snap->live);
+  uint32_t *table = (uint32_t *)calloc(slots, sizeof(uint32_t));
+  if (!table) {
+    writer->failed = 1;
+    return;
+  }
+  for (size_t row = 0; row < snap->count; row++) {
+    if (!bit_set(snap->listed, row))
+      continue;
+    const uint64_t id = vs_row_value(store->ids, store->segment_shift, row);
+    table[vs_id_probe(table, slots, store->ids, store->segment_shift,
+                      snap->count, id)] = (uint32_t)(row + 1);
+  }
+  header->id_slots = vs_write_begin(writer);
+  vs_write_bytes(writer, table, sizeof(uint32_t) * slots);
+  header->id_slot_count = slots;
+  free(table);
+}
+
+static void write_sections(const VectorStore *store, VsWriter *writer,
+                           FileHeader *header) {
+  Snapshot snap;
+  const int failed = take_snapshot(store, &snap) != 0;
+  const int weighted = __atomic_load_n(&store->weighted, __ATOMIC_ACQUIRE);
+  const VsPartitionTable *table = snap.table;
+  const size_t slots = table ? table->slots : 0;
+  if (failed) {
+    writer->failed = 1;
+    free(snap.rows);
+    free(snap.lengths);
+    free(snap.listed);
+    return;
+  }
+  const size_t count = snap.count;
+  header->count = count;
+  // After the count: at least one past every saved row's ID
+  header->next_id = __atomic_load_n(&store->next_id, __ATOMIC_RELAXED);
+
+  const unsigned shift = store->segment_shift;
+  if (store->full_precision) {
+    // The graph still routes through removed rows until vs_compact, so an
+    // indexed store keeps their vectors; the tombstones hide them
+    header->data = vs_write_begin(writer);
+    vs_write_segments(writer, (const void *const *)store->data, shift,
+                      sizeof(float) * store->dimension, count,
+                      store->index ? NULL : snap.listed);
+  }
+  if (weighted) {
+    header->weights = vs_write_begin(writer);
+    vs_write_segments(writer, (const void *const *)store->weights, shift,
+                      sizeof(float), count, snap.listed);
+  }
+  header->tags = vs_write_begin(writer);
+  vs_write_segments(writer, (const void *const *)store->tags, shift,
+                    sizeof(uint64_t), count, snap.listed);
+  header->ids = vs_write_begin(writer);
+  vs_write_segments(writer, (const void *const *)store->ids, shift,
+                    sizeof(uint64_t), count, snap.listed);
+  if (count)
+    write_id_table(store, &snap, writer, header);
+
+  if (snap.live < count) {
+    header->removed = count - snap.live;
+    header->tombstones = vs_write_begin(writer);
+    for (size_t w = 0; w < (count + 63) / 64; w++) {
+      const uint64_t tail = count - 64 * w < 64
+                                ? ((uint64_t)1 << (count - 64 * w)) - 1
+                                : ~(uint64_t)0;
+      const uint64_t bits = ~snap.listed[w] & tail;
+      vs_write_bytes(writer, &bits, sizeof(bits));
+    }
+  }
+
+  // Listed rows in list order; slot i's are the next `lengths` of them
+  header->partition_rows = vs_write_begin(writer);
+  for (size_t i = 0; i < slots; i++) {
+    size_t kept = 0;
+    for (size_t j = 0; j < snap.lengths[i]; j++) {
+      if (listed(&snap, snap.rows[i][j])) {
+        vs_write_bytes(writer, &snap.rows[i][j], sizeof(int));
+        kept++;
+      }
+    }
+    snap.lengths[i] = kept;
+  }
+  header->partitions = vs_write_begin(writer);
+  for (size_t i = 0; i < slots; i++) {
+    const FilePartition slot = {table->entries[i].tag, snap.lengths[i],
+                                header->partition_row_count};
+    vs_write_bytes(writer, &slot, sizeof(slot));
+    header->partition_row_count += slot.count;
+    header->partition_count += slot.count > 0;
+  }
+  header->partition_slots = slots;
+
+  if (store->quant)
+    header->quant = vs_quant_save(store->quant, count, snap.listed, writer);
+  if (store->index)
+    header->index = vs_hnsw_save(store->index, writer);
+  free(snap.rows);
+  free(snap.lengths);
+  free(snap.listed);
+}
+
+int vs_save(const VectorStore *store, const char *path) {
+  // Written beside `path` and renamed over it, so a reader (or a crash)
+  // sees the old file or the new one, never half of either
+  const size_t length = strlen(path);
+  char *temp = (char *)malloc(length + sizeof(".tmp"));
+  if (!temp)
+    return -1;
+  memcpy(temp, path, length);
+  memcpy(temp + length, ".tmp", sizeof(".tmp"));
+  FILE *file = fopen(temp, "wb");
+  if (!file) {
+    free(temp);
+    return -1;
+  }
+
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  VsWriter writer = {file, 0, 0};
+  vs_write_bytes(&writer, &header, sizeof(header)); // Filled in below
+  // A search, as far as vs_compact is concerned: nothing it reads is
+  // reused until it is done
+  const unsigned epoch = vs_read_begin(store);
+  write_sections(store, &writer, &header);
+  vs_read_end(store, epoch);
+  memcpy(header.magic, VS_FILE_MAGIC, sizeof(header.magic));
+  header.version = VS_FILE_VERSION;
+  header.byte_order = VS_BYTE_ORDER;
+  header.file_bytes = writer.offset;
+  header.dimension = store->dimension;
+  header.rerank = store->rerank;
+  if (fseek(file, 0, SEEK_SET) != 0 ||
+      fwrite(&header, sizeof(header), 1, file) != 1)
+    writer.failed = 1;
+  if (fflush(file) != 0 || fsync(fileno(file)) != 0)
+    writer.failed = 1;
+  if (fclose(file) != 0)
+    writer.failed = 1;
+  if (writer.failed || rename(temp, path) != 0) {
+    remove(temp);
+    free(temp);
+    return -1;
+  }
+  free(temp);
+  return 0;
+}
+
+static int valid_header(const FileHeader *header, size_t bytes) {
+  if (memcmp(header->magic, VS_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != VS_FILE_VERSION ||
+      header->byte_order != VS_BYTE_ORDER || header->file_bytes != bytes ||
+      header->count > INT_MAX)
+    return 0;
+  if (header->count == 0)
+    return 1;
+  // Rows to scan, and a row array size that fits in memory
+  return header->dimension > 0 &&
+         header->dimension <= SIZE_MAX / sizeof(float) / header->count &&
+         (header->data || header->quant) && (header->data || !header->index);
+}
+
+// Points the store's arrays into the mapping; the row lists get a heap
+// table, one entry per tag slot
+static int map_sections(VectorStore *store, const VsMapping *map,
+                        const FileHeader *header) {
+  const size_t count = (size_t)header->count;
+  store->dimension = (size_t)header->dimension;
+  store->count = store->capacity = count;
+  store->rerank = (size_t)header->rerank;
+  store->full_precision = header->data != 0;
+  // Rows are back to back in the file: one segment holds them all
+  store->segment_shift = vs_segment_shift(count);
+  store->segments = count > 0;
+  if (header->data) {
+    store->data[0] = (float *)vs_mapped(
+        map, header->data, sizeof(float) * count * store->dimension);
+    if (!store->data[0])
+      return -1;
+  }
+  if (header->weights) {
+    store->weights[0] =
+        (float *)vs_mapped(map, header->weights, sizeof(float) * count);
+    if (!store->weights[0])
+      return -1;
+    store->weighted = 1;
+  }
+  if (count) {
+    store->tags[0] =
+        (uint64_t *)vs_mapped(map, header->tags, sizeof(uint64_t) * count);
+    if (!store->tags[0])
+      return -1;
+  }
+  if (count) {
+    store->ids[0] =
+        (uint64_t *)vs_mapped(map, header->ids, sizeof(uint64_t) * count);
+    // No larger than for a table of every row, so the size cannot wrap
+    const uint64_t slots = header->id_slot_count;
+    if (!store->ids[0] || slots > vs_id_slots_for(count) ||
+        slots < VS_MIN_ID_SLOTS || (slots & (slots - 1)))
+      return -1;
+    store->id_slots = (uint32_t *)vs_mapped(map, header->id_slots,
+                                            sizeof(uint32_t) * slots);
+    if (!store->id_slots)
+      return -1;
+    store->id_slot_count = (size_t)slots;
+  }
+  store->next_id = header->next_id;
+  if (header->removed > count || (header->removed && !header->tombstones))
+    return -1;
+  if (header->tombstones) {
+    store->tombstones[0] = (uint64_t *)vs_mapped(
+        map, header->tombstones, sizeof(uint64_t) * ((count + 63) / 64));
+    if (!store->tombstones[0])
+      return -1;
+    store->removed = (size_t)header->removed;
+  }
+  store->id_count = count - store->removed;
+
+  const size_t slots = (size_t)header->partition_slots;
+  // Every live row is in exactly one list; the table is at most 3/4 full
+  const size_t live = count - store->removed;
+  if (header->partition_slots > 4 * (uint64_t)count + 16 ||
+      (slots & (slots - 1)) || header->partition_count > slots ||
+      header->partition_row_count != live)
+    return -1;
+  const FilePartition *table = (const FilePartition *)vs_mapped(
+      map, header->partitions, sizeof(FilePartition) * slots);
+  const int *rows = (const int *)vs_mapped(map, header->partition_rows,
+                                           sizeof(int) * live);
+  if (slots && (!table || !rows))
+    return -1;
+  if (slots) {
+    store->partitions = (VsPartitionTable *)calloc(
+        1, sizeof(VsPartitionTable) + slots * sizeof(VsPartition));
+    if (!store->partitions)
+      return -1;
+    store->partitions->slots = slots;
+    store->partition_count = (size_t)header->partition_count;
+  }
+  for (size_t i = 0; i < slots; i++) {
+    const FilePartition *slot = &table[i];
+    if (!slot->count)
+      continue;
+    if (slot->first > live || slot->count > live - slot->first)
+      return -1;
+    VsPartition *p = &store->partitions->entries[i];
+    p->tag = slot->tag;
+    p->rows = (int *)rows + slot->first;
+    p->count = p->capacity = p->live = (size_t)slot->count;
+  }
+
+  if (header->quant) {
+    store->quant = vs_quant_map(map, header->quant, store->dimension, count);
+    if (!store->quant)
+      return -1;
+  }
+  if (header->index) {
+    store->index = vs_hnsw_map(map, header->index);
+    if (!store->index)
+      return -1;
+  }
+  return 0;
+}
+
+VectorStore *vs_open_mmap(const char *path) {
+  const int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(FileHeader) ||
+      (uint64_t)info.st_size > SIZE_MAX) {
+    close(fd);
+    return NULL;
+  }
+  const size_t bytes = (size_t)info.st_size;
+  // Shared and read-only: every process opening the file reads the same
+  // page-cache pages, and nothing is read until a search touches it
+  void *base = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return NULL;
+
+  const VsMapping map = {(const unsigned char *)base, bytes};
+  VectorStore *store = valid_header((const FileHeader *)base, bytes)
+                           ? vs_create(0)
+                           : NULL;
+  if (!store) {
+    munmap(base, bytes);
+    return NULL;
+  }
+  store->mapping = base;
+  store->mapping_bytes = bytes;
+  if (map_sections(store, &map, (const FileHeader *)base) != 0) {
+    vs_free(store);
+    return NULL;
+  }
+  return store;
+}
+
+// vs_add_file reads about this many bytes of rows at a time
+#define VS_LOAD_BYTES ((size_t)4 << 20)
+
+int vs_add_file(VectorStore *store, const char *path, size_t dim) {
+  if (store->mapping || dim == 0 || dim > SIZE_MAX / sizeof(float))
+    return -1;
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return -1;
+  const size_t row_bytes = sizeof(float) * dim;
+  struct stat info;
+  if (fstat(fileno(file), &info) != 0 || info.st_size < 0 ||
+      (uint64_t)info.st_size % row_bytes != 0 ||
+      (uint64_t)info.st_size / row_bytes > INT_MAX) {
+    fclose(file);
+    return -1;
+  }
+  const size_t rows = (size_t)((uint64_t)info.st_size / row_bytes);
+  size_t step = VS_LOAD_BYTES / row_bytes ? VS_LOAD_BYTES / row_bytes : 1;
+  if (step > rows)
+    step = rows ? rows : 1;
+  float *buffer = (float *)malloc(row_bytes * step);
+  if (!buffer) {
+    fclose(file);
+    return -1;
+  }
+  // Only a hint: short of memory, the batches grow the store as they go
+  vs_reserve(store, store->count + rows);
+  size_t added = 0;
+  while (added < rows) {
+    const size_t n = rows - added < step ? rows - added : step;
+    // A read error ends the load as a refused vector would
+    if (fread(buffer, row_bytes, n, file) != n)
+      break;
+    const size_t batch = (size_t)vs_add_batch(store, buffer, n, dim, NULL,
+                                              NULL, NULL);
+    added += batch;
+    if (batch < n)
+      break;
+  }
+  free(buffer);
+  fclose(file);
+  return (int)added;
+}
@@ -0,0 +1,51 @@
+#ifndef VS_FILE_H
+#define VS_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Store files (vs_save, vs_open_mmap): a header, then sections, each
+// starting on a VS_ALIGNMENT boundary so a mapping can be scanned in place.
+// Sections hold native-endian arrays exactly as the store keeps them in
+// memory; the index and quantizer write their own, described by a small
+// struct at the section's start.
+#define VS_FILE_VERSION 3
+
+// Appends sections to a file being written; a failed write sets `failed`
+// and makes the rest no-ops
+typedef struct {
+  FILE *file;
+  uint64_t offset; // Bytes written so far
+  int failed;
+} VsWriter;
+
+// Pads to the next VS_ALIGNMENT boundary and returns it, the offset of the
+// section about to be written
+uint64_t vs_write_begin(VsWriter *writer);
+
+// Appends bytes to the current section
+void vs_write_bytes(VsWriter *writer, const void *data, size_t bytes);
+
+// Appends the first `count` entries, `bytes` each, of an array kept in
+// segments of the vs_segments.h shape given by `shift`. Unless `rows` is
+// NULL, entries whose bit in it is clear are written as zeros without
+// being read (vs_compact may be rewriting them).
+void vs_write_segments(VsWriter *writer, const void *const *segments,
+                       unsigned shift, size_t bytes, size_t count,
+                       const uint64_t *rows);
+
+// A read-only mapping of a whole store file
+typedef struct {
+  const unsigned char *base;
+  size_t bytes;
+} VsMapping;
+
+// Pointer to bytes [offset, offset + bytes) of the mapping, or NULL if that
+// runs past its end or offset is not VS_ALIGNMENT-aligned
+const void *vs_mapped(const VsMapping *map, uint64_t offset, uint64_t bytes);
+
+// Unmaps a vs_open_mmap store's file (base NULL: nothing to do)
+void vs_unmap(const void *base, size_t bytes);
+
+#endif
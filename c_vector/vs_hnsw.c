@@ -0,0 +1,796 @@
+#include "vs_hnsw.h"
+#include "vs_kernels.h"
+#include "vs_pool.h"
+#include "vs_segments.h"
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Highest layer a node can reach; with m >= 2 the odds of drawing it are
+// below 2^-31
+#define VS_HNSW_MAX_LEVEL 31
+
+// vs_hnsw_insert_batch links at most one row per this many already linked
+// in a round. A round's rows search the graph as it was before the round
+// and miss each other, so rounds stay small beside the graph.
+#define VS_HNSW_ROUND_SHARE 16
+
+// Min-heap of (score, row); the root is the lowest score
+typedef struct {
+  float *score;
+  int *row;
+  size_t count;
+  size_t capacity;
+} Heap;
+
+// Search and neighbour selection state: the index's own, and one per
+// participant while vs_hnsw_insert_batch searches in parallel
+typedef struct {
+  unsigned *visited; // A node is visited when its mark equals the stamp
+  unsigned stamp;
+  Heap candidates; // Scores negated, so the root is the best candidate
+  Heap results;    // Best ef found, root the worst of them
+  // Neighbour selection, max(ef_construction, m0 + 1) long
+  float *pick_score;
+  int *pick_row;
+  int *pruned;
+  int failed; // A heap could not grow (batch participants' heaps start small)
+} Scratch;
+
+struct VsHnsw {
+  size_t m, m0; // Links per node above / on the bottom layer
+  size_t ef_construction;
+  double level_mult; // 1 / ln(m): each layer holds ~1/m of the one below
+  uint64_t rng;
+
+  size_t count;    // Rows linked
+  size_t capacity; // Rows the arrays below hold
+  int *links0;     // capacity x (m0 + 1): link count, then links
+  int **upper;     // Per row, levels x (m + 1) links, NULL on layer 0 only
+  unsigned char *levels;
+  // A mapped index keeps every row's upper links back to back in one pool
+  // instead, row r's at upper_pool + upper_offsets[r]; upper is NULL then.
+  // links0, levels and both of these point into the file and are not freed.
+  const uint64_t *upper_offsets;
+  int *upper_pool;
+  int mapped;
+  int pending; // Row whose level vs_hnsw_reserve drew, -1 if none
+  int entry;   // Top of the graph, -1 while empty
+  int max_level;
+
+  // Sized for every row, so its heaps never need to grow
+  Scratch scratch;
+  size_t pick_capacity;
+};
+
+static void heap_push(Heap *h, float score, int row) {
+  size_t i = h->count++;
+  while (i > 0) {
+    const size_t parent = (i - 1) / 2;
+    if (h->score[parent] <= score)
+      break;
+    h->score[i] = h->score[parent];
+    h->row[i] = h->row[parent];
+    i = parent;
+  }
+  h->score[i] = score;
+  h->row[i] = row;
+}
+
+static void heap_pop(Heap *h) {
+  const float score = h->score[--h->count];
+  const int row = h->row[h->count];
+  size_t i = 0;
+  for (;;) {
+    size_t child = 2 * i + 1;
+    if (child >= h->count)
+      break;
+    if (child + 1 < h->count && h->score[child + 1] < h->score[child])
+      child++;
+    if (score <= h->score[child])
+      break;
+    h->score[i] = h->score[child];
+    h->row[i] = h->row[child];
+    i = child;
+  }
+  h->score[i] = score;
+  h->row[i] = row;
+}
+
+static uint64_t next_random(VsHnsw *index) {
+  uint64_t z = (index->rng += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+// Link list of `row` on `level`: element 0 is the count
+static int *links(const VsHnsw *index, int row, int level) {
+  if (level == 0)
+    return index->links0 + (size_t)row * (index->m0 + 1);
+  const int *base =
+      index->upper ? index->upper[row]
+                   : index->upper_pool + index->upper_offsets[row];
+  return (int *)base + (size_t)(level - 1) * (index->m + 1);
+}
+
+// Graph neighbours sit anywhere in the store, out of the hardware
+// prefetcher's reach; fetching the next one while scoring this one hides
+// most of the miss
+static void prefetch_row(const VsRows *rows, int row) {
+#if defined(__GNUC__)
+  const char *line = (const char *)vs_row(rows, (size_t)row);
+  for (size_t offset = 0; offset < rows->dim * sizeof(float); offset += 64)
+    __builtin_prefetch(line + offset);
+#else
+  (void)rows, (void)row;
+#endif
+}
+
+static int alloc_picks(Scratch *scratch, size_t capacity) {
+  scratch->pick_score = (float *)malloc(sizeof(float) * capacity);
+  scratch->pick_row = (int *)malloc(sizeof(int) * capacity);
+  scratch->pruned = (int *)malloc(sizeof(int) * capacity);
+  return scratch->pick_score && scratch->pick_row && scratch->pruned ? 0 : -1;
+}
+
+static void free_scratch(Scratch *scratch) {
+  free(scratch->visited);
+  free(scratch->candidates.score);
+  free(scratch->candidates.row);
+  free(scratch->results.score);
+  free(scratch->results.row);
+  free(scratch->pick_score);
+  free(scratch->pick_row);
+  free(scratch->pruned);
+}
+
+VsHnsw *vs_hnsw_create(size_t m, size_t ef_construction) {
+  if (m < 2 || ef_construction == 0 || m > 1024)
+    return NULL;
+  VsHnsw *index = (VsHnsw *)calloc(1, sizeof(VsHnsw));
+  if (!index)
+    return NULL;
+  index->m = m;
+  index->m0 = 2 * m;
+  index->ef_construction = ef_construction;
+  index->level_mult = 1.0 / log((double)m);
+  index->rng = 0x484e5357ull; // "HNSW": the same graph on every run
+  index->pending = -1;
+  index->entry = -1;
+  index->pick_capacity =
+      ef_construction > index->m0 + 1 ? ef_construction : index->m0 + 1;
+  if (alloc_picks(&index->scratch, index->pick_capacity) != 0) {
+    vs_hnsw_free(index);
+    return NULL;
+  }
+  return index;
+}
+
+// Grows an array to `capacity` elements of `size` bytes, zeroing the new
+// ones; NULL (leaving the array as it was) when out of memory
+static void *grow(void *array, size_t old_capacity, size_t capacity,
+                  size_t size) {
+  char *grown = (char *)realloc(array, capacity * size);
+  if (grown)
+    memset(grown + old_capacity * size, 0, (capacity - old_capacity) * size);
+  return grown;
+}
+
+static int grow_heap(Heap *heap, size_t old_capacity, size_t capacity) {
+  float *score =
+      (float *)grow(heap->score, old_capacity, capacity, sizeof(float));
+  if (!score)
+    return -1;
+  heap->score = score;
+  int *row = (int *)grow(heap->row, old_capacity, capacity, sizeof(int));
+  if (!row)
+    return -1;
+  heap->row = row;
+  heap->capacity = capacity;
+  return 0;
+}
+
+// Room for one more entry in the heap, doubling it when full
+static int heap_room(Heap *heap) {
+  if (heap->count < heap->capacity)
+    return 0;
+  return grow_heap(heap, heap->capacity, 2 * heap->capacity);
+}
+
+static int grow_arrays(VsHnsw *index, size_t capacity) {
+  const size_t old = index->capacity, width = index->m0 + 1;
+  int *links0 =
+      (int *)grow(index->links0, old * width, capacity * width, sizeof(int));
+  if (!links0)
+    return -1;
+  index->links0 = links0;
+  int **upper = (int **)grow(index->upper, old, capacity, sizeof(int *));
+  if (!upper)
+    return -1;
+  index->upper = upper;
+  unsigned char *levels =
+      (unsigned char *)grow(index->levels, old, capacity, 1);
+  if (!levels)
+    return -1;
+  index->levels = levels;
+  Scratch *scratch = &index->scratch;
+  unsigned *visited =
+      (unsigned *)grow(scratch->visited, old, capacity, sizeof(unsigned));
+  if (!visited)
+    return -1;
+  scratch->visited = visited;
+  // Heaps can hold every row, plus the one a full result heap takes in
+  // before dropping its worst
+  if (grow_heap(&scratch->candidates, scratch->candidates.capacity,
+                capacity + 1) != 0 ||
+      grow_heap(&scratch->results, scratch->results.capacity,
+                capacity + 1) != 0)
+    return -1;
+  index->capacity = capacity;
+  return 0;
+}
+
+int vs_hnsw_reserve(VsHnsw *index, size_t count) {
+  if (count > index->capacity) {
+    size_t capacity = index->capacity ? 2 * index->capacity : 16;
+    if (capacity < count)
+      capacity = count;
+    if (grow_arrays(index, capacity) != 0)
+      return -1;
+  }
+
+  const int row = (int)(count - 1);
+  if ((size_t)row < index->count || index->pending == row)
+    return 0;
+  // Layer drawn from an exponential distribution, as in the paper
+  const double u = ((next_random(index) >> 11) + 1) * 0x1.0p-53;
+  double level = floor(-log(u) * index->level_mult);
+  if (level > VS_HNSW_MAX_LEVEL)
+    level = VS_HNSW_MAX_LEVEL;
+  free(index->upper[row]);
+  index->upper[row] = NULL;
+  if (level > 0) {
+    index->upper[row] =
+        (int *)malloc(sizeof(int) * (size_t)level * (index->m + 1));
+    if (!index->upper[row])
+      return -1;
+  }
+  index->levels[row] = (unsigned char)level;
+  index->pending = row;
+  return 0;
+}
+
+static void next_stamp(const VsHnsw *index, Scratch *scratch) {
+  if (++scratch->stamp == 0) {
+    memset(scratch->visited, 0, sizeof(unsigned) * index->capacity);
+    scratch->stamp = 1;
+  }
+}
+
+// Moves from `entry` to the most similar node on `level`, one hop at a time
+static int greedy(const VsHnsw *index, const VsRows *rows, vs_dot_fn dot,
+                  const float *query, int entry, int level, size_t *scanned) {
+  float best = dot(vs_row(rows, (size_t)entry), query, rows->dim);
+  for (int moved = 1; moved;) {
+    moved = 0;
+    const int *list = links(index, entry, level);
+    for (int i = 1; i <= list[0]; i++) {
+      if (i < list[0])
+        prefetch_row(rows, list[i + 1]);
+      const float d = dot(vs_row(rows, (size_t)list[i]), query, rows->dim);
+      if (d > best) {
+        best = d;
+        entry = list[i];
+        moved = 1;
+      }
+    }
+    *scanned += (size_t)list[0];
+  }
+  return entry;
+}
+
+// Best-first search of one layer from `entry`; leaves up to ef results in
+// scratch->results. Sets scratch->failed and stops early if a heap cannot
+// grow.
+static void search_layer(const VsHnsw *index, Scratch *scratch,
+                         const VsRows *rows, vs_dot_fn dot, const float *query,
+                         int entry, size_t ef, int level, size_t *scanned) {
+  Heap *candidates = &scratch->candidates, *results = &scratch->results;
+  next_stamp(index, scratch);
+  candidates->count = results->count = 0;
+  if (heap_room(candidates) != 0 || heap_room(results) != 0) {
+    scratch->failed = 1;
+    return;
+  }
+  const float d = dot(vs_row(rows, (size_t)entry), query, rows->dim);
+  scratch->visited[entry] = scratch->stamp;
+  heap_push(candidates, -d, entry);
+  heap_push(results, d, entry);
+  (*scanned)++;
+
+  while (candidates->count) {
+    const float best = -candidates->score[0];
+    const int node = candidates->row[0];
+    // Every candidate left is worse than all ef results
+    if (results->count >= ef && best < results->score[0])
+      break;
+    heap_pop(candidates);
+    const int *list = links(index, node, level);
+    for (int i = 1; i <= list[0]; i++) {
+      const int next = list[i];
+      if (i < list[0])
+        prefetch_row(rows, list[i + 1]);
+      if (scratch->visited[next] == scratch->stamp)
+        continue;
+      scratch->visited[next] = scratch->stamp;
+      const float s = dot(vs_row(rows, (size_t)next), query, rows->dim);
+      (*scanned)++;
+      if (results->count < ef || s > results->score[0]) {
+        if (heap_room(candidates) != 0 || heap_room(results) != 0) {
+          scratch->failed = 1;
+          return;
+        }
+        heap_push(candidates, -s, next);
+        heap_push(results, s, next);
+        if (results->count > ef)
+          heap_pop(results);
+      }
+    }
+  }
+}
+
+// Picks up to `cap` of the n candidates in pick_row/pick_score (best first)
+// into out[1..], out[0] the count. The paper's heuristic keeps a candidate
+// only if it is more similar to the new node than to any kept neighbour, so
+// links spread in all directions; the rest fill any spare slots.
+static void select_neighbours(Scratch *scratch, const VsRows *rows,
+                              vs_dot_fn dot, size_t n, size_t cap, int *out) {
+  size_t kept = 0, pruned = 0;
+  for (size_t i = 0; i < n && kept < cap; i++) {
+    const float *candidate = vs_row(rows, (size_t)scratch->pick_row[i]);
+    int diverse = 1;
+    for (size_t j = 0; j < kept && diverse; j++)
+      diverse =
+          dot(candidate, vs_row(rows, (size_t)out[1 + j]), rows->dim) <
+          scratch->pick_score[i];
+    if (diverse)
+      out[1 + kept++] = scratch->pick_row[i];
+    else
+      scratch->pruned[pruned++] = scratch->pick_row[i];
+  }
+  for (size_t i = 0; i < pruned && kept < cap; i++)
+    out[1 + kept++] = scratch->pruned[i];
+  out[0] = (int)kept;
+}
+
+// Links `from` to `to` on `level`, re-selecting from's links when full
+static void add_link(VsHnsw *index, const VsRows *rows, vs_dot_fn dot,
+                     int from, int to, int level) {
+  Scratch *scratch = &index->scratch;
+  int *list = links(index, from, level);
+  const size_t cap = level ? index->m : index->m0;
+  if ((size_t)list[0] < cap) {
+    list[1 + list[0]++] = to;
+    return;
+  }
+  // Candidates are the current links plus the new one, sorted best first
+  const float *base = vs_row(rows, (size_t)from);
+  size_t n = 0;
+  for (int i = 0; i <= list[0]; i++) {
+    const int row = i < list[0] ? list[1 + i] : to;
+    const float s = dot(base, vs_row(rows, (size_t)row), rows->dim);
+    size_t j = n++;
+    for (; j > 0 && scratch->pick_score[j - 1] < s; j--) {
+      scratch->pick_score[j] = scratch->pick_score[j - 1];
+      scratch->pick_row[j] = scratch->pick_row[j - 1];
+    }
+    scratch->pick_score[j] = s;
+    scratch->pick_row[j] = row;
+  }
+  select_neighbours(scratch, rows, dot, n, cap, list);
+}
+
+// Chooses row's links on every layer it shares with the graph, searching
+// the graph as it stands without changing it. Returns 0, or -1 if one of
+// scratch's heaps could not grow.
+static int find_links(const VsHnsw *index, Scratch *scratch, const VsRows *rows,
+                      vs_dot_fn dot, int row) {
+  const int level = index->levels[row];
+  index->links0[(size_t)row * (index->m0 + 1)] = 0;
+  for (int l = 1; l <= level; l++)
+    links(index, row, l)[0] = 0;
+  if (index->entry < 0)
+    return 0;
+
+  const float *query = vs_row(rows, (size_t)row);
+  size_t scanned = 0;
+  int entry = index->entry;
+  for (int l = index->max_level; l > level; l--)
+    entry = greedy(index, rows, dot, query, entry, l, &scanned);
+  for (int l = level < index->max_level ? level : index->max_level; l >= 0;
+       l--) {
+    search_layer(index, scratch, rows, dot, query, entry,
+                 index->ef_construction, l, &scanned);
+    if (scratch->failed)
+      return -1;
+    // Popping the min-heap yields worst first; fill pick_* from the back
+    Heap *results = &scratch->results;
+    const size_t n = results->count;
+    for (size_t i = n; i > 0; i--) {
+      scratch->pick_score[i - 1] = results->score[0];
+      scratch->pick_row[i - 1] = results->row[0];
+      heap_pop(results);
+    }
+    entry = scratch->pick_row[0];
+    select_neighbours(scratch, rows, dot, n, index->m, links(index, row, l));
+  }
+  return 0;
+}
+
+// Links row's neighbours, as find_links chose them, back to it. A search
+// never reads the layer it links on, so choosing every layer's links first
+// builds the same graph as linking each layer as it is searched.
+static void link_back(VsHnsw *index, const VsRows *rows, vs_dot_fn dot,
+                      int row) {
+  const int level = index->levels[row];
+  index->count++;
+  if (index->entry < 0) {
+    index->entry = row;
+    index->max_level = level;
+    return;
+  }
+  for (int l = level < index->max_level ? level : index->max_level; l >= 0;
+       l--) {
+    const int *list = links(index, row, l);
+    for (int i = 1; i <= list[0]; i++)
+      add_link(index, rows, dot, list[i], row, l);
+  }
+  if (level > index->max_level) {
+    index->entry = row;
+    index->max_level = level;
+  }
+}
+
+void vs_hnsw_insert(VsHnsw *index, const VsRows *rows, int row) {
+  const vs_dot_fn dot = vs_kernel()->dot;
+  index->pending = -1;
+  // The index's own scratch holds every row and cannot fail
+  find_links(index, &index->scratch, rows, dot, row);
+  link_back(index, rows, dot, row);
+}
+
+// A round of vs_hnsw_insert_batch: rows first.. first + n - 1 find their
+// links in the graph as it was before the round, in parallel
+typedef struct {
+  const VsHnsw *index;
+  const VsRows *rows;
+  Scratch **scratch; // Per participant, NULL if it could not get any
+  size_t participants;
+  int first;
+  size_t n;
+  size_t next;          // Rows claimed
+  unsigned char *found; // Per row, whether its links were found
+} Round;
+
+static void find_round(void *ctx, size_t worker) {
+  Round *round = (Round *)ctx;
+  if (worker >= round->participants || !round->scratch[worker])
+    return;
+  Scratch *scratch = round->scratch[worker];
+  const vs_dot_fn dot = vs_kernel()->dot;
+  for (;;) {
+    const size_t i = __atomic_fetch_add(&round->next, 1, __ATOMIC_RELAXED);
+    if (i >= round->n)
+      return;
+    // A participant whose heaps ran out leaves the rest to others, or to
+    // the serial pass that links each row
+    round->found[i] = find_links(round->index, scratch, round->rows, dot,
+                                 round->first + (int)i) == 0;
+    if (!round->found[i])
+      return;
+  }
+}
+
+static Scratch *create_scratch(const VsHnsw *index) {
+  Scratch *scratch = (Scratch *)calloc(1, sizeof(Scratch));
+  if (!scratch)
+    return NULL;
+  // Heaps start at a few ef and grow as a search needs
+  const size_t heap = 4 * index->ef_construction + 2;
+  scratch->visited = (unsigned *)calloc(index->capacity, sizeof(unsigned));
+  if (!scratch->visited || grow_heap(&scratch->candidates, 0, heap) != 0 ||
+      grow_heap(&scratch->results, 0, heap) != 0 ||
+      alloc_picks(scratch, index->pick_capacity) != 0) {
+    free_scratch(scratch);
+    free(scratch);
+    return NULL;
+  }
+  return scratch;
+}
+
+void vs_hnsw_insert_batch(VsHnsw *index, const VsRows *rows, int first,
+                          size_t n) {
+  const vs_dot_fn dot = vs_kernel()->dot;
+  index->pending = -1;
+  const size_t participants = vs_pool_size();
+  Scratch **scratch = (Scratch **)calloc(participants, sizeof(Scratch *));
+  unsigned char *found = (unsigned char *)malloc(n ? n : 1);
+  if (scratch) {
+    scratch[0] = &index->scratch;
+    for (size_t w = 1; w < participants; w++)
+      scratch[w] = create_scratch(index);
+  }
+
+  for (size_t done = 0; done < n;) {
+    size_t size = index->count / VS_HNSW_ROUND_SHARE;
+    if (size < 1 || !scratch || !found)
+      size = 1;
+    if (size > n - done)
+      size = n - done;
+    const int start = first + (int)done;
+    if (size == 1) {
+      vs_hnsw_insert(index, rows, start);
+      done++;
+      continue;
+    }
+    Round round = {index, rows, scratch, participants, start, size, 0, found};
+    memset(found, 0, size);
+    vs_pool_run(find_round, &round);
+    for (size_t i = 0; i < size; i++) {
+      if (!found[i])
+        find_links(index, &index->scratch, rows, dot, start + (int)i);
+      link_back(index, rows, dot, start + (int)i);
+    }
+    done += size;
+  }
+
+  if (scratch) {
+    for (size_t w = 1; w < participants; w++) {
+      if (scratch[w]) {
+        free_scratch(scratch[w]);
+        free(scratch[w]);
+      }
+    }
+  }
+  free(scratch);
+  free(found);
+}
+
+// Keeps the `cap` most similar to `base` of the candidates offered, best
+// first in pick_row/pick_score; *n is how many are kept so far
+static void offer_pick(Scratch *scratch, const VsRows *rows, vs_dot_fn dot,
+                       const float *base, int row, size_t cap, size_t *n) {
+  const float s = dot(base, vs_row(rows, (size_t)row), rows->dim);
+  if (*n == cap && scratch->pick_score[cap - 1] >= s)
+    return;
+  size_t j = *n < cap ? (*n)++ : cap - 1;
+  for (; j > 0 && scratch->pick_score[j - 1] < s; j--) {
+    scratch->pick_score[j] = scratch->pick_score[j - 1];
+    scratch->pick_row[j] = scratch->pick_row[j - 1];
+  }
+  scratch->pick_score[j] = s;
+  scratch->pick_row[j] = row;
+}
+
+// Replaces row's links to removed rows on `level` by the best of its other
+// links and the live rows reached through the removed ones, as FreshDiskANN
+// repairs a deleted node's in-neighbours; numbering is still the old one.
+// Heavy removal leaves removed rows whose links are all removed too, so
+// chains of them are followed, up to pick_capacity removed rows per repair.
+static void repair_links(VsHnsw *index, const VsRows *rows, vs_dot_fn dot,
+                         const int *remap, int row, int level) {
+  int *list = links(index, row, level);
+  int removed = 0;
+  for (int i = 1; i <= list[0] && !removed; i++)
+    removed = remap[list[i]] < 0;
+  if (!removed)
+    return;
+  const float *base = vs_row(rows, (size_t)row);
+  const size_t cap = level ? index->m : index->m0;
+  Scratch *scratch = &index->scratch;
+  // Idle while compacting, and it holds every row: the removed rows to walk
+  int *queue = scratch->candidates.row;
+  size_t head = 0, tail = 0, n = 0;
+  next_stamp(index, scratch);
+  scratch->visited[row] = scratch->stamp;
+  for (int i = 1; i <= list[0]; i++) {
+    const int next = list[i];
+    if (scratch->visited[next] == scratch->stamp)
+      continue;
+    scratch->visited[next] = scratch->stamp;
+    if (remap[next] >= 0)
+      offer_pick(scratch, rows, dot, base, next, index->pick_capacity, &n);
+    else
+      queue[tail++] = next;
+  }
+  while (head < tail && head < index->pick_capacity) {
+    const int *around = links(index, queue[head++], level);
+    for (int j = 1; j <= around[0]; j++) {
+      const int near = around[j];
+      if (scratch->visited[near] == scratch->stamp)
+        continue;
+      scratch->visited[near] = scratch->stamp;
+      if (remap[near] >= 0)
+        offer_pick(scratch, rows, dot, base, near, index->pick_capacity, &n);
+      else
+        queue[tail++] = near;
+    }
+  }
+  select_neighbours(scratch, rows, dot, n, cap, list);
+}
+
+void vs_hnsw_compact(VsHnsw *index, const VsRows *rows, const int *remap,
+                     size_t count) {
+  const vs_dot_fn dot = vs_kernel()->dot;
+  const size_t old_count = index->count;
+  for (size_t r = 0; r < old_count; r++) {
+    if (remap[r] < 0)
+      continue;
+    for (int l = 0; l <= index->levels[r]; l++)
+      repair_links(index, rows, dot, remap, (int)r, l);
+  }
+  for (size_t r = 0; r < old_count; r++) {
+    if (remap[r] < 0)
+      continue;
+    for (int l = 0; l <= index->levels[r]; l++) {
+      int *list = links(index, (int)r, l);
+      for (int i = 1; i <= list[0]; i++)
+        list[i] = remap[list[i]];
+    }
+  }
+  // Removed rows leave the graph; those a partial compaction leaves in
+  // place stay as unlinked level-0 nodes nothing points to
+  const size_t width = index->m0 + 1;
+  for (size_t r = 0; r < old_count; r++) {
+    if (remap[r] < 0) {
+      free(index->upper[r]);
+      index->upper[r] = NULL;
+      index->levels[r] = 0;
+      index->links0[r * width] = 0;
+    }
+  }
+  // A node only moves down, into a removed row or one already moved
+  for (size_t r = 0; r < old_count; r++) {
+    const size_t to = remap[r] < 0 ? r : (size_t)remap[r];
+    if (to == r)
+      continue;
+    memcpy(index->links0 + to * width, index->links0 + r * width,
+           sizeof(int) * width);
+    index->levels[to] = index->levels[r];
+    index->upper[to] = index->upper[r];
+    index->upper[r] = NULL;
+  }
+  index->count = count;
+  index->pending = -1;
+  if (index->entry >= 0 && remap[index->entry] >= 0) {
+    index->entry = remap[index->entry];
+    return;
+  }
+  // The top node went; the highest one left takes over
+  index->entry = -1;
+  index->max_level = 0;
+  for (size_t r = 0; r < old_count; r++) {
+    const int to = remap[r];
+    if (to >= 0 && (index->entry < 0 || index->levels[to] > index->max_level)) {
+      index->entry = to;
+      index->max_level = index->levels[to];
+    }
+  }
+}
+
+size_t vs_hnsw_search(VsHnsw *index, const VsRows *rows, const float *query,
+                      size_t ef, const int **out_rows, const float **out_dots,
+                      size_t *scanned) {
+  Scratch *scratch = &index->scratch;
+  scratch->results.count = 0;
+  *out_rows = scratch->results.row;
+  *out_dots = scratch->results.score;
+  if (index->entry < 0 || ef == 0)
+    return 0;
+  const vs_dot_fn dot = vs_kernel()->dot;
+  int entry = index->entry;
+  for (int l = index->max_level; l > 0; l--)
+    entry = greedy(index, rows, dot, query, entry, l, scanned);
+  search_layer(index, scratch, rows, dot, query, entry, ef, 0, scanned);
+  return scratch->results.count;
+}
+
+// Section layout: this struct, then the arrays it points to
+typedef struct {
+  uint64_t m, ef_construction, count;
+  int64_t entry, max_level;
+  uint64_t links0;        // count x (m0 + 1) ints
+  uint64_t levels;        // count bytes
+  uint64_t upper_offsets; // count uint64s, into the pool in ints
+  uint64_t upper_pool;    // pool_ints ints
+  uint64_t pool_ints;
+} HnswSection;
+
+uint64_t vs_hnsw_save(const VsHnsw *index, VsWriter *writer) {
+  const size_t count = index->count, width = index->m + 1;
+  HnswSection section = {index->m, index->ef_construction, count,
+                         index->entry, index->max_level, 0, 0, 0, 0, 0};
+  section.links0 = vs_write_begin(writer);
+  vs_write_bytes(writer, index->links0, sizeof(int) * count * (index->m0 + 1));
+  section.levels = vs_write_begin(writer);
+  vs_write_bytes(writer, index->levels, count);
+  section.upper_offsets = vs_write_begin(writer);
+  for (size_t r = 0; r < count; r++) {
+    vs_write_bytes(writer, &section.pool_ints, sizeof(uint64_t));
+    section.pool_ints += index->levels[r] * width;
+  }
+  section.upper_pool = vs_write_begin(writer);
+  for (size_t r = 0; r < count; r++) {
+    if (index->levels[r])
+      vs_write_bytes(writer, links(index, (int)r, 1),
+                     sizeof(int) * index->levels[r] * width);
+  }
+  const uint64_t offset = vs_write_begin(writer);
+  vs_write_bytes(writer, &section, sizeof(section));
+  return offset;
+}
+
+VsHnsw *vs_hnsw_map(const VsMapping *map, uint64_t offset) {
+  const HnswSection *section =
+      (const HnswSection *)vs_mapped(map, offset, sizeof(HnswSection));
+  if (!section || section->count > INT_MAX || section->m > 1024 ||
+      section->entry < -1 || section->entry >= (int64_t)section->count ||
+      section->max_level < 0 || section->max_level > VS_HNSW_MAX_LEVEL)
+    return NULL;
+  const size_t count = section->count, m0 = 2 * section->m;
+  const int *links0 = (const int *)vs_mapped(
+      map, section->links0, sizeof(int) * (uint64_t)count * (m0 + 1));
+  const unsigned char *levels =
+      (const unsigned char *)vs_mapped(map, section->levels, count);
+  const uint64_t *upper_offsets = (const uint64_t *)vs_mapped(
+      map, section->upper_offsets, sizeof(uint64_t) * count);
+  const int *upper_pool =
+      section->pool_ints > SIZE_MAX / sizeof(int)
+          ? NULL
+          : (const int *)vs_mapped(map, section->upper_pool,
+                                   sizeof(int) * section->pool_ints);
+  if (!links0 || !levels || !upper_offsets || !upper_pool)
+    return NULL;
+  VsHnsw *index = vs_hnsw_create(section->m, section->ef_construction);
+  if (!index)
+    return NULL;
+  // Only the search scratch is allocated; calloc'd pages stay untouched
+  // until a search visits a node
+  Scratch *scratch = &index->scratch;
+  scratch->visited = (unsigned *)calloc(count ? count : 1, sizeof(unsigned));
+  index->mapped = 1;
+  if (!scratch->visited ||
+      grow_heap(&scratch->candidates, 0, count + 1) != 0 ||
+      grow_heap(&scratch->results, 0, count + 1) != 0) {
+    vs_hnsw_free(index);
+    return NULL;
+  }
+  // The file is read-only; an index read from it is never written
+  index->links0 = (int *)links0;
+  index->levels = (unsigned char *)levels;
+  index->upper_offsets = upper_offsets;
+  index->upper_pool = (int *)upper_pool;
+  index->count = index->capacity = count;
+  index->entry = (int)section->entry;
+  index->max_level = (int)section->max_level;
+  return index;
+}
+
+void vs_hnsw_free(VsHnsw *index) {
+  if (!index)
+    return;
+  if (index->upper) {
+    for (size_t i = 0; i < index->capacity; i++)
+      free(index->upper[i]);
+  }
+  free(index->upper);
+  if (!index->mapped) {
+    free(index->links0);
+    free(index->levels);
+  }
+  free_scratch(&index->scratch);
+  free(index);
+}
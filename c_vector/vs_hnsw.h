@@ -0,0 +1,63 @@
+#ifndef VS_HNSW_H
+#define VS_HNSW_H
+
+#include "vs_file.h"
+#include "vs_segments.h"
+#include <stddef.h>
+
+// Hierarchical navigable small world graph over a store's rows (Malkov and
+// Yashunin, 2016). The graph holds row indices only; every call takes a
+// view of the store's rows. Similarity is the dot product of unit-length
+// rows. Not safe for concurrent use, searches included: they share the
+// index's visited marks and heaps.
+typedef struct VsHnsw VsHnsw;
+
+// m neighbours per node and layer (2 x m on the bottom layer);
+// ef_construction candidates kept while linking a new node
+VsHnsw *vs_hnsw_create(size_t m, size_t ef_construction);
+
+// Allocates everything linking row `count - 1` needs, so vs_hnsw_insert
+// cannot fail; returns 0, or -1 when out of memory
+int vs_hnsw_reserve(VsHnsw *index, size_t count);
+
+// Links `row`, the next row after those already indexed, into the graph;
+// vs_hnsw_reserve(index, row + 1) must have succeeded
+void vs_hnsw_insert(VsHnsw *index, const VsRows *rows, int row);
+
+// Links rows first .. first + n - 1, the next n after those indexed, in
+// rounds: a round's rows find their links in the graph as it was before
+// the round, in parallel on the vs_pool threads, then are linked back to
+// in row order. The graph is not the one vs_hnsw_insert would build, but
+// does not depend on the thread count. vs_hnsw_reserve(index, r + 1) must
+// have succeeded for each row r in turn.
+void vs_hnsw_insert_batch(VsHnsw *index, const VsRows *rows, int first,
+                          size_t n);
+
+// Drops removed rows from the graph and renumbers the rest: old row r
+// becomes row remap[r] (never above r), or is removed if remap[r] < 0,
+// leaving `count` rows. Links to a removed row are replaced by the best of
+// its live neighbours. `rows` must still hold every kept row at its old
+// number.
+void vs_hnsw_compact(VsHnsw *index, const VsRows *rows, const int *remap,
+                     size_t count);
+
+// Up to `ef` rows most similar to query, in no particular order, with
+// their dot products; the arrays belong to the index and stay valid until
+// its next call. Returns the number found and adds the similarities it
+// computed to *scanned.
+size_t vs_hnsw_search(VsHnsw *index, const VsRows *rows, const float *query,
+                      size_t ef, const int **out_rows, const float **out_dots,
+                      size_t *scanned);
+
+// Writes the graph as a section of a store file, returning its offset
+uint64_t vs_hnsw_save(const VsHnsw *index, VsWriter *writer);
+
+// A read-only index over the section at `offset` of a mapped file; the
+// graph stays in the file and only search scratch is allocated. NULL if the
+// section is malformed or out of memory. Must not be reserved or inserted
+// into; the mapping must outlive it.
+VsHnsw *vs_hnsw_map(const VsMapping *map, uint64_t offset);
+
+void vs_hnsw_free(VsHnsw *index);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef VS_IDS_H
+#define VS_IDS_H
+
+#include "vs_segments.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// A store's ID table (VectorStore.id_slots): each slot holds a row + 1, 0
+// when empty, and a row's ID is read from the store's per-row IDs, so a
+// slot is 4 bytes. Linear probing from a splitmix64 hash spreads IDs
+// handed out in sequence. vs_save writes a table of the rows it saves in
+// the same layout, so a mapped store looks IDs up in place.
+
+// Smallest table, in slots; it doubles at 3/4 full
+#define VS_MIN_ID_SLOTS 16
+
+// Where `id`'s probe starts
+static inline size_t vs_id_home(uint64_t id, size_t slots) {
+  id = (id ^ (id >> 30)) * 0xbf58476d1ce4e5b9ull;
+  id = (id ^ (id >> 27)) * 0x94d049bb133111ebull;
+  return (size_t)(id ^ (id >> 31)) & (slots - 1);
+}
+
+// Entry `row` of a per-segment uint64 array (a store's IDs)
+static inline uint64_t vs_row_value(uint64_t *const *segments, unsigned shift,
+                                    size_t row) {
+  size_t offset;
+  return segments[vs_segment_of(row, shift, &offset)][offset];
+}
+
+// The slot holding `id`, or the empty one where it would go; `ids`,
+// `shift` and `count` are the store's. Slots past the count are passed
+// over, so a table from a file cannot send the probe outside the IDs.
+static inline size_t vs_id_probe(const uint32_t *table, size_t slots,
+                                 uint64_t *const *ids, unsigned shift,
+                                 size_t count, uint64_t id) {
+  size_t slot = vs_id_home(id, slots);
+  while (table[slot] && (table[slot] > count ||
+                         vs_row_value(ids, shift, table[slot] - 1) != id))
+    slot = (slot + 1) & (slots - 1);
+  return slot;
+}
+
+// Slots for a table of `ids` IDs, at most 3/4 full
+static inline size_t vs_id_slots_for(size_t ids) {
+  size_t slots = VS_MIN_ID_SLOTS;
+  while (4 * ids > 3 * slots)
+    slots *= 2;
+  return slots;
+}
+
+#endif
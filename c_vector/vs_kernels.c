@@ -0,0 +1,623 @@
+#include "vs_kernels.h"
+#include "vector_store.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VS_HAVE_X86 1
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__) || (defined(__ARM_NEON) && defined(__ARM_FP))
+#define VS_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Rows per step of the block kernels; each chunk of the query is loaded
+// once per group and the group's accumulators stay in registers
+#define VS_BLOCK_ROWS 4
+
+// Queries per step of the tile kernels, whose VS_TILE_QUERIES x
+// VS_BLOCK_ROWS sums fill most of the 32 vector registers of AVX-512 and
+// NEON; AVX2 has 16, so its tiles take half as many queries
+#define VS_TILE_QUERIES 4
+#define VS_TILE_QUERIES_AVX2 2
+
+// Tile loops have fixed trip counts; unrolled, their arrays of sums become
+// registers instead of stack slots
+#if defined(__GNUC__)
+#define VS_UNROLL _Pragma("GCC unroll 4")
+#else
+#define VS_UNROLL
+#endif
+
+// Portable fallback. Four independent sums break the dependency on one
+// accumulator, so the loop runs at the FPUs' throughput, not their latency.
+static float dot_scalar(const float *a, const float *b, size_t dim) {
+  float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+  size_t i = 0;
+  for (; i + 4 <= dim; i += 4) {
+    s0 += a[i] * b[i];
+    s1 += a[i + 1] * b[i + 1];
+    s2 += a[i + 2] * b[i + 2];
+    s3 += a[i + 3] * b[i + 3];
+  }
+  for (; i < dim; i++)
+    s0 += a[i] * b[i];
+  return (s0 + s1) + (s2 + s3);
+}
+
+static void dot_block_scalar(const float *rows, size_t count, size_t dim,
+                             const float *query, float *out) {
+  for (size_t r = 0; r < count; r++)
+    out[r] = dot_scalar(rows + r * dim, query, dim);
+}
+
+static void dot_tile_scalar(const float *rows, size_t count, size_t dim,
+                            const float *queries, size_t num_queries,
+                            float *out) {
+  for (size_t q = 0; q < num_queries; q++)
+    dot_block_scalar(rows, count, dim, queries + q * dim, out + q * count);
+}
+
+uint16_t vs_float_to_half(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000u);
+  const uint32_t magnitude = bits & 0x7fffffffu;
+  if (magnitude > 0x7f800000u)
+    return sign | 0x7e00u; // NaN
+  const int exponent = (int)(magnitude >> 23) - 127 + 15;
+  if (exponent >= 31)
+    return sign | 0x7c00u; // Overflows to infinity
+  uint32_t mantissa = magnitude & 0x7fffffu;
+  int shift = 13;
+  uint32_t half;
+  if (exponent <= 0) {
+    // Subnormal: the implicit bit moves into the mantissa
+    if (exponent < -10)
+      return sign;
+    mantissa |= 0x800000u;
+    shift = 14 - exponent;
+    half = mantissa >> shift;
+  } else {
+    half = ((uint32_t)exponent << 10) | (mantissa >> shift);
+  }
+  // A carry out of the mantissa correctly bumps the exponent
+  const uint32_t rest = mantissa & ((1u << shift) - 1);
+  const uint32_t halfway = 1u << (shift - 1);
+  if (rest > halfway || (rest == halfway && (half & 1)))
+    half++;
+  return sign | (uint16_t)half;
+}
+
+float vs_half_to_float(uint16_t half) {
+  const uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+  const uint32_t exponent = (half >> 10) & 0x1fu;
+  const uint32_t mantissa = half & 0x3ffu;
+  if (exponent == 0) {
+    const float value = ldexpf((float)mantissa, -24);
+    return sign ? -value : value;
+  }
+  const uint32_t bits =
+      exponent == 31 ? sign | 0x7f800000u | (mantissa << 13)
+                     : sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static float dot_i8_scalar(const float *query, const int8_t *code,
+                           size_t dim) {
+  float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+  size_t i = 0;
+  for (; i + 4 <= dim; i += 4) {
+    s0 += query[i] * code[i];
+    s1 += query[i + 1] * code[i + 1];
+    s2 += query[i + 2] * code[i + 2];
+    s3 += query[i + 3] * code[i + 3];
+  }
+  for (; i < dim; i++)
+    s0 += query[i] * code[i];
+  return (s0 + s1) + (s2 + s3);
+}
+
+static float dot_f16_scalar(const float *query, const uint16_t *code,
+                            size_t dim) {
+  float s0 = 0.0f, s1 = 0.0f;
+  size_t i = 0;
+  for (; i + 2 <= dim; i += 2) {
+    s0 += query[i] * vs_half_to_float(code[i]);
+    s1 += query[i + 1] * vs_half_to_float(code[i + 1]);
+  }
+  for (; i < dim; i++)
+    s0 += query[i] * vs_half_to_float(code[i]);
+  return s0 + s1;
+}
+
+#ifdef VS_HAVE_X86
+__attribute__((target("avx2,fma"))) static float hsum256(__m256 v) {
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v),
+                        _mm256_extractf128_ps(v, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_movehdup_ps(s));
+  return _mm_cvtss_f32(s);
+}
+
+__attribute__((target("avx2,fma"))) static float
+dot_avx2(const float *a, const float *b, size_t dim) {
+  __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+  __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 32 <= dim; i += 32) {
+    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+    s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8),
+                         _mm256_loadu_ps(b + i + 8), s1);
+    s2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16),
+                         _mm256_loadu_ps(b + i + 16), s2);
+    s3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24),
+                         _mm256_loadu_ps(b + i + 24), s3);
+  }
+  for (; i + 8 <= dim; i += 8)
+    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+  float sum = hsum256(_mm256_add_ps(_mm256_add_ps(s0, s1),
+                                    _mm256_add_ps(s2, s3)));
+  // Tails here and in every FMA kernel call fmaf: whether `s += a * b`
+  // fuses depends on -ffp-contract, and the single and batched kernels must
+  // round alike for their scores to match bit for bit
+  for (; i < dim; i++)
+    sum = fmaf(a[i], b[i], sum);
+  return sum;
+}
+
+__attribute__((target("avx2,fma"))) static void
+dot_block_avx2(const float *rows, size_t count, size_t dim,
+               const float *query, float *out) {
+  size_t r = 0;
+  for (; r + VS_BLOCK_ROWS <= count; r += VS_BLOCK_ROWS) {
+    const float *r0 = rows + r * dim, *r1 = r0 + dim;
+    const float *r2 = r1 + dim, *r3 = r2 + dim;
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m256 s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= dim; i += 8) {
+      const __m256 q = _mm256_loadu_ps(query + i);
+      s0 = _mm256_fmadd_ps(_mm256_loadu_ps(r0 + i), q, s0);
+      s1 = _mm256_fmadd_ps(_mm256_loadu_ps(r1 + i), q, s1);
+      s2 = _mm256_fmadd_ps(_mm256_loadu_ps(r2 + i), q, s2);
+      s3 = _mm256_fmadd_ps(_mm256_loadu_ps(r3 + i), q, s3);
+    }
+    float t0 = hsum256(s0), t1 = hsum256(s1);
+    float t2 = hsum256(s2), t3 = hsum256(s3);
+    for (; i < dim; i++) {
+      t0 = fmaf(r0[i], query[i], t0);
+      t1 = fmaf(r1[i], query[i], t1);
+      t2 = fmaf(r2[i], query[i], t2);
+      t3 = fmaf(r3[i], query[i], t3);
+    }
+    out[r] = t0;
+    out[r + 1] = t1;
+    out[r + 2] = t2;
+    out[r + 3] = t3;
+  }
+  for (; r < count; r++)
+    out[r] = dot_avx2(rows + r * dim, query, dim);
+}
+
+__attribute__((target("avx2,fma"))) static void
+dot_tile_avx2(const float *rows, size_t count, size_t dim,
+              const float *queries, size_t num_queries, float *out) {
+  size_t q = 0;
+  for (; q + VS_TILE_QUERIES_AVX2 <= num_queries; q += VS_TILE_QUERIES_AVX2) {
+    const float *query = queries + q * dim;
+    float *tile = out + q * count;
+    size_t r = 0;
+    for (; r + VS_BLOCK_ROWS <= count; r += VS_BLOCK_ROWS) {
+      const float *row = rows + r * dim;
+      __m256 s[VS_TILE_QUERIES_AVX2][VS_BLOCK_ROWS];
+      VS_UNROLL for (int a = 0; a < VS_TILE_QUERIES_AVX2; a++) {
+        VS_UNROLL for (int b = 0; b < VS_BLOCK_ROWS; b++)
+          s[a][b] = _mm256_setzero_ps();
+      }
+      size_t i = 0;
+      for (; i + 8 <= dim; i += 8) {
+        __m256 x[VS_BLOCK_ROWS];
+        VS_UNROLL for (int b = 0; b < VS_BLOCK_ROWS; b++)
+          x[b] = _mm256_loadu_ps(row + b * dim + i);
+        VS_UNROLL for (int a = 0; a < VS_TILE_QUERIES_AVX2; a++) {
+          const __m256 v = _mm256_loadu_ps(query + a * dim + i);
+          VS_UNROLL for (int b = 0; b < VS_BLOCK_ROWS; b++)
+            s[a][b] = _mm256_fmadd_ps(x[b], v, s[a][b]);
+        }
+      }
+      VS_UNROLL for (int a = 0; a < VS_TILE_QUERIES_AVX2; a++) {
+        VS_UNROLL for (int b = 0; b < VS_BLOCK_ROWS; b++) {
+          float t = hsum256(s[a][b]);
+          for (size_t j = i; j < dim; j++)
+            t = fmaf(row[b * dim + j], query[a * dim + j], t);
+          tile[a * count + r + b] = t;
+        }
+      }
+    }
+    for (; r < count; r++) {
+      for (size_t a = 0; a < VS_TILE_QUERIES_AVX2; a++)
+        tile[a * count + r] = dot_avx2(rows + r * dim, query + a * dim, dim);
+    }
+  }
+  for (; q < num_queries; q++)
+    dot_block_avx2(rows, count, dim, queries + q * dim, out + q * count);
+}
+
+__attribute__((target("avx2,fma"))) static float
+dot_i8_avx2(const float *query, const int8_t *code, size_t dim) {
+  __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    const __m128i bytes = _mm_loadu_si128((const __m128i *)(code + i));
+    const __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+    const __m256 hi = _mm256_cvtepi32_ps(
+        _mm256_cvtepi8_epi32(_mm_unpackhi_epi64(bytes, bytes)));
+    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(query + i), lo, s0);
+    s1 = _mm256_fmadd_ps(_mm256_loadu_ps(query + i + 8), hi, s1);
+  }
+  float sum = hsum256(_mm256_add_ps(s0, s1));
+  for (; i < dim; i++)
+    sum = fmaf(query[i], code[i], sum);
+  return sum;
+}
+
+__attribute__((target("avx2,fma,f16c"))) static float
+dot_f16_avx2(const float *query, const uint16_t *code, size_t dim) {
+  __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    const __m256 lo =
+        _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(code + i)));
+    const __m256 hi =
+        _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(code + i + 8)));
+    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(query + i), lo, s0);
+    s1 = _mm256_fmadd_ps(_mm256_loadu_ps(query + i + 8), hi, s1);
+  }
+  float sum = hsum256(_mm256_add_ps(s0, s1));
+  for (; i < dim; i++)
+    sum = fmaf(query[i], vs_half_to_float(code[i]), sum);
+  return sum;
+}
+
+__attribute__((target("avx512f"))) static float
+dot_avx512(const float *a, const float *b, size_t dim) {
+  __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+  __m512 s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 64 <= dim; i += 64) {
+    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), s0);
+    s1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16),
+                         _mm512_loadu_ps(b + i + 16), s1);
+    s2 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 32),
+                         _mm512_loadu_ps(b + i + 32), s2);
+    s3 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 48),
+                         _mm512_loadu_ps(b + i + 48), s3);
+  }
+  for (; i + 16 <= dim; i += 16)
+    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), s0);
+  if (i < dim) {
+    // Masked loads read only the tail, never past the end
+    const __mmask16 tail = (__mmask16)((1u << (dim - i)) - 1);
+    s1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, a + i),
+                         _mm512_maskz_loadu_ps(tail, b + i), s1);
+  }
+  return _mm512_reduce_add_ps(
+      _mm512_add_ps(_mm512_add_ps(s0, s1), _mm512_add_ps(s2, s3)));
+}
+
+__attribute__((target("avx512f"))) static void
+dot_block_avx512(const float *rows, size_t count, size_t dim,
+                 const float *query, float *out) {
+  const __mmask16 tail = (__mmask16)((1u << (dim % 16)) - 1);
+  const size_t body = dim - dim % 16;
+  size_t r = 0;
+  for (; r + VS_BLOCK_ROWS <= count; r += VS_BLOCK_ROWS) {
+    const float *r0 = rows + r * dim, *r1 = r0 + dim;
+    const float *r2 = r1 + dim, *r3 = r2 + dim;
+    __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+    __m512 s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+    for (size_t i = 0; i < body; i += 16) {
+      const __m512 q = _mm512_loadu_ps(query + i);
+      s0 = _mm512_fmadd_ps(_mm512_loadu_ps(r0 + i), q, s0);
+      s1 = _mm512_fmadd_ps(_mm512_loadu_ps(r1 + i), q, s1);
+      s2 = _mm512_fmadd_ps(_mm512_loadu_ps(r2 + i), q, s2);
+      s3 = _mm512_fmadd_ps(_mm512_loadu_ps(r3 + i), q, s3);
+    }
+    if (tail) {
+      const __m512 q = _mm512_maskz_loadu_ps(tail, query + body);
+      s0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, r0 + body), q, s0);
+      s1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, r1 + body), q, s1);
+      s2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, r2 + body), q, s2);
+      s3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, r3 + body), q, s3);
+    }
+    out[r] = _mm512_reduce_add_ps(s0);
+    out[r + 1] = _mm512_reduce_add_ps(s1);
+    out[r + 2] = _mm512_reduce_add_ps(s2);
+    out[r + 3] = _mm512_reduce_add_ps(s3);
+  }
+  for (; r < count; r++)
+    out[r] = dot_avx512(rows + r * dim, query, dim);
+}
+
+__attribute__((target("avx512f"))) static void
+dot_tile_avx512(const float *rows, size_t count, size_t dim,
+                const float *queries, size_t num_queries, float *out) {
+  const __mmask16 tail = (__mmask16)((1u << (dim % 16)) - 1);
+  size_t q = 0;
+  for (; q + VS_TILE_QUERIES <= num_queries; q += VS_TILE_QUERIES) {
+    const float *query = queries + q * dim;
+    float *tile = out + q * count;
+    size_t r = 0;
+    for (; r + VS_BLOCK_ROWS <= count; r += VS_BLOCK_ROWS) {
+      const float *row = rows + r * dim;
+      __m512 s[VS_TILE_QUERIES][VS_BLOCK_ROWS];
+      VS_UNROLL for (int a = 0; a < VS_TILE_QUERIES; a++) {
+        VS_UNROLL for (int b = 0; b < VS_BLOCK_ROWS; b++)
+          s[a][b] = _mm512_setzero_ps();
+      }
+      // The last chunk is masked, so the tail needs no loop of its own
+      for (size_t i = 0; i < dim; i += 16) {
+        const __mmask16 mask = dim - i >= 16 ? (__mmask16)0xffff : tail;
+        __m512 x[VS_BLOCK_ROWS];
+        VS_UNROLL for (int b = 0; b < VS_BLOCK_ROWS; b++)
+          x[b] = _mm512_maskz_loadu_ps(mask, row + b * dim + i);
+        VS_UNROLL for (int a = 0; a < VS_TILE_QUERIES; a++) {
+          const __m512 v = _mm512_maskz_loadu_ps(mask, query + a * dim + i);
+          VS_UNROLL for (int b = 0; b < VS_BLOCK_ROWS; b++)
+            s[a][b] = _mm512_fmadd_ps(x[b], v, s[a][b]);
+        }
+      }
+      VS_UNROLL for (int a = 0; a < VS_TILE_QUERIES; a++) {
+        VS_UNROLL for (int b = 0; b < VS_BLOCK_ROWS; b++)
+          tile[a * count + r + b] = _mm512_reduce_add_ps(s[a][b]);
+      }
+    }
+    for (; r < count; r++) {
+      for (size_t a = 0; a < VS_TILE_QUERIES; a++)
+        tile[a * count + r] =
+            dot_avx512(rows + r * dim, query + a * dim, dim);
+    }
+  }
+  for (; q < num_queries; q++)
+    dot_block_avx512(rows, count, dim, queries + q * dim, out + q * count);
+}
+
+__attribute__((target("avx512f"))) static float
+dot_i8_avx512(const float *query, const int8_t *code, size_t dim) {
+  __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 32 <= dim; i += 32) {
+    const __m512 lo = _mm512_cvtepi32_ps(
+        _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(code + i))));
+    const __m512 hi = _mm512_cvtepi32_ps(_mm512_cvtepi8_epi32(
+        _mm_loadu_si128((const __m128i *)(code + i + 16))));
+    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(query + i), lo, s0);
+    s1 = _mm512_fmadd_ps(_mm512_loadu_ps(query + i + 16), hi, s1);
+  }
+  for (; i + 16 <= dim; i += 16) {
+    const __m512 c = _mm512_cvtepi32_ps(
+        _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(code + i))));
+    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(query + i), c, s0);
+  }
+  float sum = _mm512_reduce_add_ps(_mm512_add_ps(s0, s1));
+  for (; i < dim; i++)
+    sum = fmaf(query[i], code[i], sum);
+  return sum;
+}
+
+__attribute__((target("avx512f"))) static float
+dot_f16_avx512(const float *query, const uint16_t *code, size_t dim) {
+  __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 32 <= dim; i += 32) {
+    const __m512 lo =
+        _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(code + i)));
+    const __m512 hi = _mm512_cvtph_ps(
+        _mm256_loadu_si256((const __m256i *)(code + i + 16)));
+    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(query + i), lo, s0);
+    s1 = _mm512_fmadd_ps(_mm512_loadu_ps(query + i + 16), hi, s1);
+  }
+  for (; i + 16 <= dim; i += 16) {
+    const __m512 c =
+        _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(code + i)));
+    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(query + i), c, s0);
+  }
+  float sum = _mm512_reduce_add_ps(_mm512_add_ps(s0, s1));
+  for (; i < dim; i++)
+    sum = fmaf(query[i], vs_half_to_float(code[i]), sum);
+  return sum;
+}
+#endif // VS_HAVE_X86
+
+#ifdef VS_HAVE_NEON
+static float dot_neon(const float *a, const float *b, size_t dim) {
+  float32x4_t s0 = vdupq_n_f32(0.0f), s1 = vdupq_n_f32(0.0f);
+  float32x4_t s2 = vdupq_n_f32(0.0f), s3 = vdupq_n_f32(0.0f);
+  size_t i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    s0 = vfmaq_f32(s0, vld1q_f32(a + i), vld1q_f32(b + i));
+    s1 = vfmaq_f32(s1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    s2 = vfmaq_f32(s2, vld1q_f32(a + i + 8), vld1q_f32(b + i + 8));
+    s3 = vfmaq_f32(s3, vld1q_f32(a + i + 12), vld1q_f32(b + i + 12));
+  }
+  for (; i + 4 <= dim; i += 4)
+    s0 = vfmaq_f32(s0, vld1q_f32(a + i), vld1q_f32(b + i));
+  float sum = vaddvq_f32(vaddq_f32(vaddq_f32(s0, s1), vaddq_f32(s2, s3)));
+  for (; i < dim; i++)
+    sum = fmaf(a[i], b[i], sum);
+  return sum;
+}
+
+static void dot_block_neon(const float *rows, size_t count, size_t dim,
+                           const float *query, float *out) {
+  size_t r = 0;
+  for (; r + VS_BLOCK_ROWS <= count; r += VS_BLOCK_ROWS) {
+    const float *r0 = rows + r * dim, *r1 = r0 + dim;
+    const float *r2 = r1 + dim, *r3 = r2 + dim;
+    float32x4_t s0 = vdupq_n_f32(0.0f), s1 = vdupq_n_f32(0.0f);
+    float32x4_t s2 = vdupq_n_f32(0.0f), s3 = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= dim; i += 4) {
+      const float32x4_t q = vld1q_f32(query + i);
+      s0 = vfmaq_f32(s0, vld1q_f32(r0 + i), q);
+      s1 = vfmaq_f32(s1, vld1q_f32(r1 + i), q);
+      s2 = vfmaq_f32(s2, vld1q_f32(r2 + i), q);
+      s3 = vfmaq_f32(s3, vld1q_f32(r3 + i), q);
+    }
+    float t0 = vaddvq_f32(s0), t1 = vaddvq_f32(s1);
+    float t2 = vaddvq_f32(s2), t3 = vaddvq_f32(s3);
+    for (; i < dim; i++) {
+      t0 = fmaf(r0[i], query[i], t0);
+      t1 = fmaf(r1[i], query[i], t1);
+      t2 = fmaf(r2[i], query[i], t2);
+      t3 = fmaf(r3[i], query[i], t3);
+    }
+    out[r] = t0;
+    out[r + 1] = t1;
+    out[r + 2] = t2;
+    out[r + 3] = t3;
+  }
+  for (; r < count; r++)
+    out[r] = dot_neon(rows + r * dim, query, dim);
+}
+
+static void dot_tile_neon(const float *rows, size_t count, size_t dim,
+                          const float *queries, size_t num_queries,
+                          float *out) {
+  size_t q = 0;
+  for (; q + VS_TILE_QUERIES <= num_queries; q += VS_TILE_QUERIES) {
+    const float *query = queries + q * dim;
+    float *tile = out + q * count;
+    size_t r = 0;
+    for (; r + VS_BLOCK_ROWS <= count; r += VS_BLOCK_ROWS) {
+      const float *row = rows + r * dim;
+      float32x4_t s[VS_TILE_QUERIES][VS_BLOCK_ROWS];
+      VS_UNROLL for (int a = 0; a < VS_TILE_QUERIES; a++) {
+        VS_UNROLL for (int b = 0; b < VS_BLOCK_ROWS; b++)
+          s[a][b] = vdupq_n_f32(0.0f);
+      }
+      size_t i = 0;
+      for (; i + 4 <= dim; i += 4) {
+        float32x4_t x[VS_BLOCK_ROWS];
+        VS_UNROLL for (int b = 0; b < VS_BLOCK_ROWS; b++)
+          x[b] = vld1q_f32(row + b * dim + i);
+        VS_UNROLL for (int a = 0; a < VS_TILE_QUERIES; a++) {
+          const float32x4_t v = vld1q_f32(query + a * dim + i);
+          VS_UNROLL for (int b = 0; b < VS_BLOCK_ROWS; b++)
+            s[a][b] = vfmaq_f32(s[a][b], x[b], v);
+        }
+      }
+      VS_UNROLL for (int a = 0; a < VS_TILE_QUERIES; a++) {
+        VS_UNROLL for (int b = 0; b < VS_BLOCK_ROWS; b++) {
+          float t = vaddvq_f32(s[a][b]);
+          for (size_t j = i; j < dim; j++)
+            t = fmaf(row[b * dim + j], query[a * dim + j], t);
+          tile[a * count + r + b] = t;
+        }
+      }
+    }
+    for (; r < count; r++) {
+      for (size_t a = 0; a < VS_TILE_QUERIES; a++)
+        tile[a * count + r] = dot_neon(rows + r * dim, query + a * dim, dim);
+    }
+  }
+  for (; q < num_queries; q++)
+    dot_block_neon(rows, count, dim, queries + q * dim, out + q * count);
+}
+static float dot_i8_neon(const float *query, const int8_t *code,
+                         size_t dim) {
+  float32x4_t s0 = vdupq_n_f32(0.0f), s1 = vdupq_n_f32(0.0f);
+  size_t i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    const int16x8_t wide = vmovl_s8(vld1_s8(code + i));
+    s0 = vfmaq_f32(s0, vld1q_f32(query + i),
+                   vcvtq_f32_s32(vmovl_s16(vget_low_s16(wide))));
+    s1 = vfmaq_f32(s1, vld1q_f32(query + i + 4),
+                   vcvtq_f32_s32(vmovl_s16(vget_high_s16(wide))));
+  }
+  float sum = vaddvq_f32(vaddq_f32(s0, s1));
+  for (; i < dim; i++)
+    sum = fmaf(query[i], code[i], sum);
+  return sum;
+}
+
+static float dot_f16_neon(const float *query, const uint16_t *code,
+                          size_t dim) {
+  float32x4_t s0 = vdupq_n_f32(0.0f), s1 = vdupq_n_f32(0.0f);
+  size_t i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    const float32x4_t lo =
+        vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(code + i)));
+    const float32x4_t hi =
+        vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(code + i + 4)));
+    s0 = vfmaq_f32(s0, vld1q_f32(query + i), lo);
+    s1 = vfmaq_f32(s1, vld1q_f32(query + i + 4), hi);
+  }
+  float sum = vaddvq_f32(vaddq_f32(s0, s1));
+  for (; i < dim; i++)
+    sum = fmaf(query[i], vs_half_to_float(code[i]), sum);
+  return sum;
+}
+#endif // VS_HAVE_NEON
+
+static const VsKernel kernels[] = {
+#ifdef VS_HAVE_X86
+    {"avx512", dot_avx512, dot_block_avx512, dot_tile_avx512, dot_i8_avx512,
+     dot_f16_avx512},
+    {"avx2", dot_avx2, dot_block_avx2, dot_tile_avx2, dot_i8_avx2,
+     dot_f16_avx2},
+#endif
+#ifdef VS_HAVE_NEON
+    {"neon", dot_neon, dot_block_neon, dot_tile_neon, dot_i8_neon,
+     dot_f16_neon},
+#endif
+    {"scalar", dot_scalar, dot_block_scalar, dot_tile_scalar, dot_i8_scalar,
+     dot_f16_scalar},
+};
+#define NUM_KERNELS (sizeof(kernels) / sizeof(*kernels))
+
+static int supported(const VsKernel *kernel) {
+#ifdef VS_HAVE_X86
+  if (!strcmp(kernel->name, "avx512"))
+    return __builtin_cpu_supports("avx512f");
+  if (!strcmp(kernel->name, "avx2"))
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+           __builtin_cpu_supports("f16c");
+#endif
+  (void)kernel;
+  return 1; // NEON is baseline wherever it is compiled in
+}
+
+// Until the constructor runs (or without one), the scalar kernel answers
+static const VsKernel *active = &kernels[NUM_KERNELS - 1];
+
+// Kernels are listed best first, so the first supported one wins
+__attribute__((constructor)) static void select_kernel(void) {
+#ifdef VS_HAVE_X86
+  __builtin_cpu_init();
+#endif
+  for (size_t i = 0; i < NUM_KERNELS; i++) {
+    if (supported(&kernels[i])) {
+      active = &kernels[i];
+      return;
+    }
+  }
+}
+
+const VsKernel *vs_kernel(void) { return active; }
+
+const char *vs_kernel_name(void) { return active->name; }
+
+int vs_use_kernel(const char *name) {
+  for (size_t i = 0; i < NUM_KERNELS; i++) {
+    if (!strcmp(kernels[i].name, name) && supported(&kernels[i])) {
+      active = &kernels[i];
+      return 0;
+    }
+  }
+  return -1;
+}
@@ -0,0 +1,50 @@
+#ifndef VS_KERNELS_H
+#define VS_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Similarity kernels behind vs_dot_product and the store's scans. Each
+// instruction set gets its own implementation; the best one the CPU
+// supports is picked when the library loads (vs_use_kernel overrides it).
+
+// Dot product of two dim-length vectors
+typedef float (*vs_dot_fn)(const float *a, const float *b, size_t dim);
+
+// out[i] = dot(rows + i * dim, query) for count contiguous rows. Each chunk
+// of the query is loaded once and multiplied into several rows at a time.
+typedef void (*vs_dot_block_fn)(const float *rows, size_t count, size_t dim,
+                                const float *query, float *out);
+
+// out[q * count + i] = dot(rows + i * dim, queries + q * dim) for count
+// rows and num_queries queries. A tile of rows and queries is multiplied in
+// registers, so each chunk of a row is loaded once for several queries.
+typedef void (*vs_dot_tile_fn)(const float *rows, size_t count, size_t dim,
+                               const float *queries, size_t num_queries,
+                               float *out);
+
+// Dot product of a float query with int8 or fp16 (IEEE half) codes; the
+// caller applies any per-row scale
+typedef float (*vs_dot_i8_fn)(const float *query, const int8_t *code,
+                              size_t dim);
+typedef float (*vs_dot_f16_fn)(const float *query, const uint16_t *code,
+                               size_t dim);
+
+typedef struct {
+  const char *name;
+  vs_dot_fn dot;
+  vs_dot_block_fn dot_block;
+  vs_dot_tile_fn dot_tile;
+  vs_dot_i8_fn dot_i8;
+  vs_dot_f16_fn dot_f16;
+} VsKernel;
+
+// IEEE half conversions (round to nearest even), for encoding and the
+// scalar kernel
+uint16_t vs_float_to_half(float value);
+float vs_half_to_float(uint16_t half);
+
+// The kernel in use; valid from load time on
+const VsKernel *vs_kernel(void);
+
+#endif
@@ -0,0 +1,101 @@
+#define _POSIX_C_SOURCE 200809L // pthreads
+#include "vs_pool.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER; // A run, or stop
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER; // Last worker back
+// Held by the caller for a whole run; a second caller finds it taken and
+// runs its task alone rather than queueing
+static pthread_mutex_t running = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t *threads;
+static size_t num_workers;
+// Bumped by every run. Workers start from the value at vs_pool_resize, so
+// one scheduled late still sees every run after that.
+static unsigned long generation, base_generation;
+static vs_task_fn current_task;
+static void *current_ctx;
+static size_t pending; // Workers still in the current run
+static int stopping;
+
+static void *worker_main(void *arg) {
+  const size_t worker = (size_t)(uintptr_t)arg;
+  pthread_mutex_lock(&lock);
+  unsigned long seen = base_generation;
+  for (;;) {
+    while (generation == seen && !stopping)
+      pthread_cond_wait(&wake, &lock);
+    if (stopping)
+      break;
+    seen = generation;
+    const vs_task_fn task = current_task;
+    void *ctx = current_ctx;
+    pthread_mutex_unlock(&lock);
+    task(ctx, worker);
+    pthread_mutex_lock(&lock);
+    if (--pending == 0)
+      pthread_cond_signal(&done);
+  }
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+static void stop_workers(void) {
+  pthread_mutex_lock(&lock);
+  stopping = 1;
+  pthread_cond_broadcast(&wake);
+  pthread_mutex_unlock(&lock);
+  for (size_t i = 0; i < num_workers; i++)
+    pthread_join(threads[i], NULL);
+  free(threads);
+  threads = NULL;
+  num_workers = 0;
+  stopping = 0;
+}
+
+size_t vs_pool_size(void) { return num_workers + 1; }
+
+void vs_pool_run(vs_task_fn task, void *ctx) {
+  if (num_workers == 0 || pthread_mutex_trylock(&running) != 0) {
+    task(ctx, 0);
+    return;
+  }
+  pthread_mutex_lock(&lock);
+  current_task = task;
+  current_ctx = ctx;
+  pending = num_workers;
+  generation++;
+  pthread_cond_broadcast(&wake);
+  pthread_mutex_unlock(&lock);
+
+  task(ctx, 0);
+  pthread_mutex_lock(&lock);
+  while (pending)
+    pthread_cond_wait(&done, &lock);
+  pthread_mutex_unlock(&lock);
+  pthread_mutex_unlock(&running);
+}
+
+int vs_pool_resize(size_t participants) {
+  if (participants == 0)
+    return -1;
+  stop_workers();
+  if (participants == 1)
+    return 0;
+  threads = (pthread_t *)malloc(sizeof(pthread_t) * (participants - 1));
+  if (!threads)
+    return -1;
+  base_generation = generation;
+  for (size_t i = 0; i + 1 < participants; i++) {
+    if (pthread_create(&threads[i], NULL, worker_main,
+                       (void *)(uintptr_t)(i + 1)) != 0) {
+      stop_workers();
+      return -1;
+    }
+    num_workers = i + 1;
+  }
+  return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef VS_POOL_H
+#define VS_POOL_H
+
+#include <stddef.h>
+
+// Process-wide persistent threads that split one search over cores (the C
+// side's counterpart of cpp_sim's WorkerPool). Idle workers sleep on a
+// condition variable, so a parallel scan costs a wake-up and a join, not
+// thread startups.
+
+// Task body, run once by each participant: worker is in [0, participants)
+typedef void (*vs_task_fn)(void *ctx, size_t worker);
+
+// Participants per run, the caller included; 1 until vs_pool_resize
+size_t vs_pool_size(void);
+
+// Runs task(ctx, w) for every participant w, the caller being 0, and
+// returns when all are done. If another run is in progress (another thread
+// searching, or a task calling in), the caller runs task(ctx, 0) alone.
+void vs_pool_run(vs_task_fn task, void *ctx);
+
+// Stops the workers and starts `participants - 1` new ones; returns 0, or
+// -1 (leaving just the caller) if a thread cannot be started. Not safe
+// during a run.
+int vs_pool_resize(size_t participants);
+
+#endif
@@ -0,0 +1,448 @@
+#include "vs_quant.h"
+#include "vector_store.h"
+#include "vs_kernels.h"
+#include "vs_segments.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// At most this many rows train the PQ centroids, and this many k-means
+// rounds; 64 rows per centroid is plenty for a stable codebook
+#define VS_PQ_MAX_CENTROIDS 256
+#define VS_PQ_TRAIN_ROWS (64 * VS_PQ_MAX_CENTROIDS)
+#define VS_PQ_ROUNDS 10
+
+struct VsQuant {
+  int kind;
+  size_t dim;
+  size_t code_bytes; // Per row
+  // Segments of codes and (int8) per-row dequantization scales, laid out
+  // as vs_segments.h describes; they never move, so a search can score
+  // rows while vs_quant_encode fills later ones
+  unsigned char *codes[VS_MAX_SEGMENTS];
+  float *scales[VS_MAX_SEGMENTS];
+  unsigned shift;
+  size_t segments;
+
+  // PQ: the vector is `subspaces` slices of sub_dim components. Centroids
+  // are stored transposed, slice by slice: component j of centroid c at
+  // transposed[(s * sub_dim + j) * centroids + c], so loops over all
+  // centroids of a component are contiguous and vectorize.
+  size_t subspaces, sub_dim, centroids;
+  float *transposed;
+  float *norms; // subspaces x centroids squared centroid norms
+
+  int mapped; // The arrays point into a store file and are not freed
+};
+
+static uint64_t pq_random(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+// dist[c] = |c|^2 - 2 x.c for every centroid of slice s; the argmin is the
+// nearest centroid since |x|^2 is the same for all
+static void centroid_distances(const VsQuant *quant, size_t s, const float *x,
+                               double scale, float *dist) {
+  const size_t k = quant->centroids;
+  memcpy(dist, quant->norms + s * k, sizeof(float) * k);
+  for (size_t j = 0; j < quant->sub_dim; j++) {
+    const float xj = (float)(-2.0 * x[j] * scale);
+    const float *column = quant->transposed + (s * quant->sub_dim + j) * k;
+    for (size_t c = 0; c < k; c++)
+      dist[c] += xj * column[c];
+  }
+}
+
+static size_t nearest(const float *dist, size_t k) {
+  size_t best = 0;
+  for (size_t c = 1; c < k; c++) {
+    if (dist[c] < dist[best])
+      best = c;
+  }
+  return best;
+}
+
+static void update_norms(VsQuant *quant, size_t s) {
+  const size_t k = quant->centroids;
+  float *norms = quant->norms + s * k;
+  memset(norms, 0, sizeof(float) * k);
+  for (size_t j = 0; j < quant->sub_dim; j++) {
+    const float *column = quant->transposed + (s * quant->sub_dim + j) * k;
+    for (size_t c = 0; c < k; c++)
+      norms[c] += column[c] * column[c];
+  }
+}
+
+// Lloyd's k-means on every slice, from distinct sample rows
+static int train_pq(VsQuant *quant, const VsRows *train, size_t count) {
+  const size_t k = quant->centroids, sub_dim = quant->sub_dim;
+  const size_t n = count < VS_PQ_TRAIN_ROWS ? count : VS_PQ_TRAIN_ROWS;
+  size_t *samples = (size_t *)malloc(sizeof(size_t) * n);
+  size_t *assigned = (size_t *)malloc(sizeof(size_t) * n);
+  size_t *members = (size_t *)malloc(sizeof(size_t) * k);
+  double *sums = (double *)malloc(sizeof(double) * k * sub_dim);
+  float *dist = (float *)malloc(sizeof(float) * k);
+  int status = -1;
+  if (!samples || !assigned || !members || !sums || !dist)
+    goto done;
+
+  // Evenly spaced rows, shuffled so the first k seed the centroids
+  uint64_t rng = 0x5051ull; // "PQ"
+  for (size_t i = 0; i < n; i++)
+    samples[i] = i * count / n;
+  for (size_t i = n - 1; i > 0; i--) {
+    const size_t j = pq_random(&rng) % (i + 1);
+    const size_t t = samples[i];
+    samples[i] = samples[j];
+    samples[j] = t;
+  }
+
+  for (size_t s = 0; s < quant->subspaces; s++) {
+    float *slice = quant->transposed + s * sub_dim * k;
+    for (size_t c = 0; c < k; c++) {
+      const float *x = vs_row(train, samples[c]) + s * sub_dim;
+      for (size_t j = 0; j < sub_dim; j++)
+        slice[j * k + c] = x[j];
+    }
+    for (int round = 0; round < VS_PQ_ROUNDS; round++) {
+      update_norms(quant, s);
+      for (size_t i = 0; i < n; i++) {
+        const float *x = vs_row(train, samples[i]) + s * sub_dim;
+        centroid_distances(quant, s, x, 1.0, dist);
+        assigned[i] = nearest(dist, k);
+      }
+      memset(members, 0, sizeof(size_t) * k);
+      memset(sums, 0, sizeof(double) * k * sub_dim);
+      for (size_t i = 0; i < n; i++) {
+        const float *x = vs_row(train, samples[i]) + s * sub_dim;
+        members[assigned[i]]++;
+        for (size_t j = 0; j < sub_dim; j++)
+          sums[assigned[i] * sub_dim + j] += x[j];
+      }
+      for (size_t c = 0; c < k; c++) {
+        // An empty cluster restarts on a random sample
+        const float *restart =
+            members[c]
+                ? NULL
+                : vs_row(train, samples[pq_random(&rng) % n]) + s * sub_dim;
+        for (size_t j = 0; j < sub_dim; j++) {
+          slice[j * k + c] =
+              restart ? restart[j]
+                      : (float)(sums[c * sub_dim + j] / (double)members[c]);
+        }
+      }
+    }
+    update_norms(quant, s);
+  }
+  status = 0;
+
+done:
+  free(samples);
+  free(assigned);
+  free(members);
+  free(sums);
+  free(dist);
+  return status;
+}
+
+VsQuant *vs_quant_create(int kind, size_t dim, size_t subspaces,
+                         const VsRows *train, size_t count) {
+  if (dim == 0 || (kind != VS_QUANT_INT8 && kind != VS_QUANT_FP16 &&
+                   kind != VS_QUANT_PQ))
+    return NULL;
+  if (kind == VS_QUANT_PQ &&
+      (subspaces == 0 || dim % subspaces != 0 || count == 0))
+    return NULL;
+  VsQuant *quant = (VsQuant *)calloc(1, sizeof(VsQuant));
+  if (!quant)
+    return NULL;
+  quant->kind = kind;
+  quant->dim = dim;
+  quant->shift = train->shift;
+  if (kind == VS_QUANT_INT8) {
+    quant->code_bytes = dim;
+  } else if (kind == VS_QUANT_FP16) {
+    quant->code_bytes = dim * sizeof(uint16_t);
+  } else {
+    quant->code_bytes = subspaces;
+    quant->subspaces = subspaces;
+    quant->sub_dim = dim / subspaces;
+    quant->centroids =
+        count < VS_PQ_MAX_CENTROIDS ? count : VS_PQ_MAX_CENTROIDS;
+    quant->transposed = (float *)malloc(sizeof(float) * dim * quant->centroids);
+    quant->norms =
+        (float *)malloc(sizeof(float) * subspaces * quant->centroids);
+    if (!quant->transposed || !quant->norms ||
+        train_pq(quant, train, count) != 0) {
+      vs_quant_free(quant);
+      return NULL;
+    }
+  }
+  return quant;
+}
+
+int vs_quant_reserve(VsQuant *quant, size_t capacity) {
+  while (vs_segments_capacity(quant->segments, quant->shift) < capacity) {
+    const size_t s = quant->segments;
+    const size_t rows = vs_segment_rows(s, quant->shift);
+    if (s == VS_MAX_SEGMENTS || rows > SIZE_MAX / quant->code_bytes)
+      return -1;
+    quant->codes[s] = (unsigned char *)malloc(rows * quant->code_bytes);
+    if (!quant->codes[s])
+      return -1;
+    if (quant->kind == VS_QUANT_INT8) {
+      quant->scales[s] = (float *)malloc(sizeof(float) * rows);
+      if (!quant->scales[s]) {
+        free(quant->codes[s]);
+        quant->codes[s] = NULL;
+        return -1;
+      }
+    }
+    quant->segments++;
+  }
+  return 0;
+}
+
+void vs_quant_encode(VsQuant *quant, size_t row, const float *data,
+                     double scale) {
+  size_t offset;
+  const size_t segment = vs_segment_of(row, quant->shift, &offset);
+  unsigned char *code = quant->codes[segment] + offset * quant->code_bytes;
+  if (quant->kind == VS_QUANT_INT8) {
+    double max = 0.0;
+    for (size_t i = 0; i < quant->dim; i++) {
+      const double x = fabs(data[i] * scale);
+      max = x > max ? x : max;
+    }
+    // Unit vectors have max > 0; the step maps it to +-127
+    const double step = max / 127.0;
+    int8_t *bytes = (int8_t *)code;
+    for (size_t i = 0; i < quant->dim; i++) {
+      long q = lrint(data[i] * scale / step);
+      bytes[i] = (int8_t)(q > 127 ? 127 : q < -127 ? -127 : q);
+    }
+    quant->scales[segment][offset] = (float)step;
+  } else if (quant->kind == VS_QUANT_FP16) {
+    uint16_t *halves = (uint16_t *)code;
+    for (size_t i = 0; i < quant->dim; i++)
+      halves[i] = vs_float_to_half((float)(data[i] * scale));
+  } else {
+    float dist[VS_PQ_MAX_CENTROIDS];
+    for (size_t s = 0; s < quant->subspaces; s++) {
+      centroid_distances(quant, s, data + s * quant->sub_dim, scale, dist);
+      code[s] = (unsigned char)nearest(dist, quant->centroids);
+    }
+  }
+}
+
+void vs_quant_copy(VsQuant *quant, size_t from, size_t to) {
+  size_t from_offset, to_offset;
+  const size_t fs = vs_segment_of(from, quant->shift, &from_offset);
+  const size_t ts = vs_segment_of(to, quant->shift, &to_offset);
+  memcpy(quant->codes[ts] + to_offset * quant->code_bytes,
+         quant->codes[fs] + from_offset * quant->code_bytes,
+         quant->code_bytes);
+  if (quant->kind == VS_QUANT_INT8)
+    quant->scales[ts][to_offset] = quant->scales[fs][from_offset];
+}
+
+void vs_quant_trim(VsQuant *quant, size_t capacity) {
+  while (quant->segments &&
+         vs_segments_capacity(quant->segments - 1, quant->shift) >= capacity) {
+    const size_t s = --quant->segments;
+    free(quant->codes[s]);
+    free(quant->scales[s]);
+    quant->codes[s] = NULL;
+    quant->scales[s] = NULL;
+  }
+}
+
+size_t vs_quant_row_bytes(const VsQuant *quant) {
+  return quant->code_bytes +
+         (quant->kind == VS_QUANT_INT8 ? sizeof(float) : 0);
+}
+
+size_t vs_quant_table_bytes(const VsQuant *quant) {
+  return sizeof(float) * quant->centroids * (quant->dim + quant->subspaces);
+}
+
+int vs_quant_prepare(const VsQuant *quant, const float *query,
+                     VsQuantQuery *out) {
+  out->query = query;
+  out->table = NULL;
+  if (quant->kind != VS_QUANT_PQ)
+    return 0;
+  // table[s][c] = query slice s . centroid c, so a row's score is a sum of
+  // one lookup per slice
+  const size_t k = quant->centroids;
+  out->table = (float *)calloc(quant->subspaces * k, sizeof(float));
+  if (!out->table)
+    return -1;
+  for (size_t s = 0; s < quant->subspaces; s++) {
+    float *entry = out->table + s * k;
+    for (size_t j = 0; j < quant->sub_dim; j++) {
+      const float qj = query[s * quant->sub_dim + j];
+      const float *column = quant->transposed + (s * quant->sub_dim + j) * k;
+      for (size_t c = 0; c < k; c++)
+        entry[c] += qj * column[c];
+    }
+  }
+  return 0;
+}
+
+void vs_quant_release(VsQuantQuery *prepared) {
+  free(prepared->table);
+  prepared->table = NULL;
+}
+
+static float score_pq(const VsQuant *quant, const float *table,
+                      const unsigned char *code) {
+  const size_t k = quant->centroids;
+  float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+  size_t s = 0;
+  for (; s + 4 <= quant->subspaces; s += 4) {
+    s0 += table[s * k + code[s]];
+    s1 += table[(s + 1) * k + code[s + 1]];
+    s2 += table[(s + 2) * k + code[s + 2]];
+    s3 += table[(s + 3) * k + code[s + 3]];
+  }
+  for (; s < quant->subspaces; s++)
+    s0 += table[s * k + code[s]];
+  return (s0 + s1) + (s2 + s3);
+}
+
+// Score of row `offset` of segment s
+static float score_code(const VsQuant *quant, const VsQuantQuery *prepared,
+                        size_t s, size_t offset) {
+  const unsigned char *code = quant->codes[s] + offset * quant->code_bytes;
+  const VsKernel *kernel = vs_kernel();
+  if (quant->kind == VS_QUANT_INT8)
+    return quant->scales[s][offset] *
+           kernel->dot_i8(prepared->query, (const int8_t *)code, quant->dim);
+  if (quant->kind == VS_QUANT_FP16)
+    return kernel->dot_f16(prepared->query, (const uint16_t *)code,
+                           quant->dim);
+  return score_pq(quant, prepared->table, code);
+}
+
+float vs_quant_score(const VsQuant *quant, const VsQuantQuery *prepared,
+                     size_t row) {
+  size_t offset;
+  const size_t s = vs_segment_of(row, quant->shift, &offset);
+  return score_code(quant, prepared, s, offset);
+}
+
+void vs_quant_score_block(const VsQuant *quant, const VsQuantQuery *prepared,
+                          size_t start, size_t count, float *out) {
+  size_t offset;
+  size_t s = vs_segment_of(start, quant->shift, &offset);
+  for (size_t r = 0; r < count; r++) {
+    if (offset == vs_segment_rows(s, quant->shift)) {
+      s++;
+      offset = 0;
+    }
+    out[r] = score_code(quant, prepared, s, offset++);
+  }
+}
+
+// Section layout: this struct, then the arrays it points to
+typedef struct {
+  uint64_t kind, dim, count, subspaces, centroids;
+  uint64_t codes, scales, transposed, norms; // 0 when the kind has none
+} QuantSection;
+
+uint64_t vs_quant_save(const VsQuant *quant, size_t count,
+                       const uint64_t *rows, VsWriter *writer) {
+  QuantSection section = {(uint64_t)quant->kind, quant->dim, count,
+                          quant->subspaces, quant->centroids, 0, 0, 0, 0};
+  section.codes = vs_write_begin(writer);
+  vs_write_segments(writer, (const void *const *)quant->codes, quant->shift,
+                    quant->code_bytes, count, rows);
+  if (quant->kind == VS_QUANT_INT8) {
+    section.scales = vs_write_begin(writer);
+    vs_write_segments(writer, (const void *const *)quant->scales,
+                      quant->shift, sizeof(float), count, rows);
+  }
+  if (quant->transposed) {
+    section.transposed = vs_write_begin(writer);
+    vs_write_bytes(writer, quant->transposed,
+                   sizeof(float) * quant->dim * quant->centroids);
+    section.norms = vs_write_begin(writer);
+    vs_write_bytes(writer, quant->norms,
+                   sizeof(float) * quant->subspaces * quant->centroids);
+  }
+  const uint64_t offset = vs_write_begin(writer);
+  vs_write_bytes(writer, &section, sizeof(section));
+  return offset;
+}
+
+VsQuant *vs_quant_map(const VsMapping *map, uint64_t offset, size_t dim,
+                      size_t count) {
+  const QuantSection *section =
+      (const QuantSection *)vs_mapped(map, offset, sizeof(QuantSection));
+  if (!section || section->dim != dim || section->count != count ||
+      dim == 0 || dim > SIZE_MAX / sizeof(float) / VS_PQ_MAX_CENTROIDS)
+    return NULL;
+  VsQuant *quant = (VsQuant *)calloc(1, sizeof(VsQuant));
+  if (!quant)
+    return NULL;
+  // The file is read-only; a quantizer read from it never encodes
+  quant->mapped = 1;
+  quant->kind = (int)section->kind;
+  quant->dim = dim;
+  // Rows are back to back in the file: one segment holds them all
+  quant->shift = vs_segment_shift(count);
+  quant->segments = 1;
+  int valid = 1;
+  if (section->kind == VS_QUANT_INT8) {
+    quant->code_bytes = dim;
+    quant->scales[0] =
+        (float *)vs_mapped(map, section->scales, sizeof(float) * count);
+    valid = quant->scales[0] != NULL;
+  } else if (section->kind == VS_QUANT_FP16) {
+    quant->code_bytes = dim * sizeof(uint16_t);
+  } else if (section->kind == VS_QUANT_PQ && section->subspaces &&
+             dim % section->subspaces == 0 && section->centroids &&
+             section->centroids <= VS_PQ_MAX_CENTROIDS) {
+    quant->code_bytes = quant->subspaces = section->subspaces;
+    quant->sub_dim = dim / quant->subspaces;
+    quant->centroids = section->centroids;
+    quant->transposed = (float *)vs_mapped(
+        map, section->transposed, sizeof(float) * dim * quant->centroids);
+    quant->norms = (float *)vs_mapped(
+        map, section->norms,
+        sizeof(float) * quant->subspaces * quant->centroids);
+    valid = quant->transposed && quant->norms;
+  } else {
+    valid = 0;
+  }
+  if (valid && count > SIZE_MAX / quant->code_bytes)
+    valid = 0;
+  if (valid) {
+    quant->codes[0] = (unsigned char *)vs_mapped(map, section->codes,
+                                                 count * quant->code_bytes);
+    valid = quant->codes[0] != NULL;
+  }
+  if (!valid) {
+    vs_quant_free(quant);
+    return NULL;
+  }
+  return quant;
+}
+
+void vs_quant_free(VsQuant *quant) {
+  if (!quant)
+    return;
+  if (!quant->mapped) {
+    for (size_t s = 0; s < quant->segments; s++) {
+      free(quant->codes[s]);
+      free(quant->scales[s]);
+    }
+    free(quant->transposed);
+    free(quant->norms);
+  }
+  free(quant);
+}
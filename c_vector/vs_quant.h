@@ -0,0 +1,79 @@
+#ifndef VS_QUANT_H
+#define VS_QUANT_H
+
+#include "vs_file.h"
+#include "vs_segments.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Compressed copies of a store's unit-length rows, scored against a float
+// query without decoding:
+//   int8: one signed byte per component plus a per-row scale (max |x| / 127)
+//   fp16: IEEE half per component
+//   PQ:   the vector split into `subspaces` equal slices, each replaced by
+//         the byte index of its nearest of up to 256 centroids; a query is
+//         scored from a table of its dot products with every centroid
+// Scoring only reads the quantizer, so concurrent searches are safe, also
+// alongside vs_quant_encode of rows they do not score.
+typedef struct VsQuant VsQuant;
+
+// `kind` is a VS_QUANT_* value other than VS_QUANT_NONE. PQ trains its
+// centroids (k-means) on the first `count` unit rows of `train`, which it
+// does not keep; int8 and fp16 ignore them. Codes are kept in segments of
+// train's shape. NULL for invalid arguments (PQ needs subspaces dividing
+// dim) or when out of memory.
+VsQuant *vs_quant_create(int kind, size_t dim, size_t subspaces,
+                         const VsRows *train, size_t count);
+
+// Room for `capacity` rows of codes, added as segments so rows already
+// encoded stay in place; returns 0, or -1 when out of memory
+int vs_quant_reserve(VsQuant *quant, size_t capacity);
+
+// Encodes row `row` from `data` x `scale` (the store's unnormalized input
+// and its inverse norm, so no normalized copy is needed)
+void vs_quant_encode(VsQuant *quant, size_t row, const float *data,
+                     double scale);
+
+// Copies row from's codes over row to's
+void vs_quant_copy(VsQuant *quant, size_t from, size_t to);
+
+// Frees the segments not needed to hold `capacity` rows
+void vs_quant_trim(VsQuant *quant, size_t capacity);
+
+// Bytes of codes (and scales) per row, and of shared tables
+size_t vs_quant_row_bytes(const VsQuant *quant);
+size_t vs_quant_table_bytes(const VsQuant *quant);
+
+// A query prepared for scoring; PQ allocates its distance table
+typedef struct {
+  const float *query;
+  float *table; // subspaces x centroids, PQ only
+} VsQuantQuery;
+
+int vs_quant_prepare(const VsQuant *quant, const float *query,
+                     VsQuantQuery *out);
+void vs_quant_release(VsQuantQuery *prepared);
+
+// Approximate dot products of the prepared query with rows
+// [start, start + count) into out
+void vs_quant_score_block(const VsQuant *quant, const VsQuantQuery *prepared,
+                          size_t start, size_t count, float *out);
+float vs_quant_score(const VsQuant *quant, const VsQuantQuery *prepared,
+                     size_t row);
+
+// Writes the first `count` rows' codes (zeros for rows not set in `rows`,
+// as vs_write_segments does) and the shared tables as a section of a store
+// file, returning its offset
+uint64_t vs_quant_save(const VsQuant *quant, size_t count,
+                       const uint64_t *rows, VsWriter *writer);
+
+// A read-only quantizer over the section at `offset` of a mapped file, for
+// `count` rows of `dim` components; the codes stay in the file. NULL if the
+// section is malformed or out of memory. Must not be reserved or encoded
+// into; the mapping must outlive it.
+VsQuant *vs_quant_map(const VsMapping *map, uint64_t offset, size_t dim,
+                      size_t count);
+
+void vs_quant_free(VsQuant *quant);
+
+#endif
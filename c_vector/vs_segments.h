@@ -0,0 +1,67 @@
+#ifndef VS_SEGMENTS_H
+#define VS_SEGMENTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Geometry of append-only row storage. With base = 1 << shift rows,
+// segment s holds base << s rows starting at row base x (2^s - 1): each
+// segment doubles the capacity, as a doubling slab would, but the rows
+// already stored stay where they are. Finding a row's segment is one bit
+// scan.
+
+// Segment of `row`, and the row's position in it into *offset
+static inline size_t vs_segment_of(size_t row, unsigned shift,
+                                   size_t *offset) {
+  const unsigned long long q = (unsigned long long)(row >> shift) + 1;
+  const size_t s = (size_t)(63 - __builtin_clzll(q));
+  *offset = row - ((((size_t)1 << s) - 1) << shift);
+  return s;
+}
+
+// Smallest shift whose segment 0 holds `rows` rows
+static inline unsigned vs_segment_shift(size_t rows) {
+  unsigned shift = 0;
+  while (((size_t)1 << shift) < rows)
+    shift++;
+  return shift;
+}
+
+// Rows in segment s
+static inline size_t vs_segment_rows(size_t s, unsigned shift) {
+  return (size_t)1 << (s + shift);
+}
+
+// Rows in the first `segments` segments
+static inline size_t vs_segments_capacity(size_t segments, unsigned shift) {
+  return (((size_t)1 << segments) - 1) << shift;
+}
+
+// Whether `row` is set in a bit array kept per segment (a store's
+// tombstones), NULL segments having none set. Acquire order, pairing with
+// the release that sets or clears the bit.
+static inline int vs_row_marked(uint64_t *const *bits, unsigned shift,
+                                size_t row) {
+  size_t offset;
+  const uint64_t *segment = bits[vs_segment_of(row, shift, &offset)];
+  if (!segment)
+    return 0;
+  const uint64_t word =
+      __atomic_load_n(&segment[offset / 64], __ATOMIC_ACQUIRE);
+  return (int)(word >> (offset % 64) & 1);
+}
+
+// A store's float rows, for code that reads them by number
+typedef struct {
+  float *const *segments;
+  unsigned shift;
+  size_t dim;
+} VsRows;
+
+static inline const float *vs_row(const VsRows *rows, size_t row) {
+  size_t offset;
+  const size_t s = vs_segment_of(row, rows->shift, &offset);
+  return rows->segments[s] + offset * rows->dim;
+}
+
+#endif
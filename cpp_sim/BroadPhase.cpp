@@ -0,0 +1,257 @@
+#include "BroadPhase.hpp"
+#include "DistanceKernels.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// 21 bits per axis; cell coordinates are biased to be non-negative
+constexpr int KEY_BITS = 21;
+constexpr double CELL_BIAS = 1 << (KEY_BITS - 1);
+// Clamped one cell short of both ends, so key +/- 1 along any axis never
+// borrows from the next axis. Far-out entities share the edge cells, which
+// costs speed but not correctness.
+constexpr double CELL_MIN = 1.0;
+constexpr double CELL_MAX = (1 << KEY_BITS) - 2.0;
+
+constexpr uint64_t KEY_X = 1;
+constexpr uint64_t KEY_Y = uint64_t{1} << KEY_BITS;
+constexpr uint64_t KEY_Z = uint64_t{1} << (2 * KEY_BITS);
+
+// Centres of the forward neighbour rows (dy, dz) = (1, 0), (-1, 1), (0, 1),
+// (1, 1); each row spans dx = -1..1. Together with the (1, 0, 0) cell they
+// are the 13 cells that sort after this one.
+constexpr uint64_t FORWARD_ROWS[] = {KEY_Y, KEY_Z - KEY_Y, KEY_Z,
+                                     KEY_Z + KEY_Y};
+constexpr size_t NUM_FORWARD_ROWS =
+    sizeof(FORWARD_ROWS) / sizeof(FORWARD_ROWS[0]);
+
+constexpr uint64_t AXIS_MASK = (uint64_t{1} << KEY_BITS) - 1;
+
+// Incremental re-sorts give up after this many shifts per entity
+constexpr size_t INSERTION_SORT_BUDGET = 8;
+
+// Dense start tables may hold this many cells per entity (or the minimum)
+constexpr uint64_t DENSE_CELLS_PER_ENTITY = 8;
+constexpr uint64_t DENSE_MIN_CELLS = 1 << 12;
+
+uint64_t cellCoord(double v, double inv_cell) {
+  // Clamped positive, truncation is floor; std::min/max also send NaN to an
+  // edge cell
+  const double c = v * inv_cell + CELL_BIAS;
+  return static_cast<uint64_t>(std::max(CELL_MIN, std::min(CELL_MAX, c)));
+}
+} // namespace
+
+void BroadPhase::setCellSize(double size) {
+  min_cell_size_ = size > 0.0 ? size : 0.0;
+  cell_size_ = 0.0; // Re-bin everything on the next update
+}
+
+void BroadPhase::update(const double *x, const double *y, const double *z,
+                        const double *radius, size_t count) {
+  double max_radius = 0.0;
+  for (size_t i = 0; i < count; i++)
+    max_radius = std::max(max_radius, radius[i]);
+  double required = std::max(min_cell_size_, 2.0 * max_radius);
+  if (required <= 0.0)
+    required = 1.0; // Points only: any cell size is correct
+
+  const bool reuse_order = count == entries_.size() && required <= cell_size_;
+  if (!reuse_order) {
+    cell_size_ = required;
+    entries_.resize(count);
+    for (size_t i = 0; i < count; i++)
+      entries_[i].id = static_cast<uint32_t>(i);
+  }
+
+  // Keys in input order stream through the coordinate arrays
+  const double inv_cell = 1.0 / cell_size_;
+  keys_by_id_.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    keys_by_id_[i] = cellCoord(z[i], inv_cell) * KEY_Z +
+                     cellCoord(y[i], inv_cell) * KEY_Y +
+                     cellCoord(x[i], inv_cell) * KEY_X;
+  }
+  for (Entry &entry : entries_)
+    entry.key = keys_by_id_[entry.id];
+  sortByKey(reuse_order);
+
+  // Gather in cell order so pair tests stream through memory; one input
+  // array per pass keeps each pass's random reads within cache
+  ids_.resize(count);
+  for (size_t slot = 0; slot < count; slot++)
+    ids_[slot] = entries_[slot].id;
+  auto gather = [&](std::vector<double> &dst, const double *src) {
+    dst.resize(count);
+    for (size_t slot = 0; slot < count; slot++)
+      dst[slot] = src[ids_[slot]];
+  };
+  gather(px_, x);
+  gather(py_, y);
+  gather(pz_, z);
+  gather(pr_, radius);
+
+  dense_ = buildDenseTable();
+  if (!dense_)
+    buildRuns();
+}
+
+void BroadPhase::sortByKey(bool reuse_order) {
+  auto by_key = [](const Entry &a, const Entry &b) { return a.key < b.key; };
+  if (reuse_order) {
+    // Entities that kept their cell are still in order; shift the rest
+    size_t budget = INSERTION_SORT_BUDGET * entries_.size();
+    for (size_t i = 1; i < entries_.size(); i++) {
+      const Entry entry = entries_[i];
+      size_t j = i;
+      for (; j > 0 && entries_[j - 1].key > entry.key && budget > 0; j--) {
+        entries_[j] = entries_[j - 1];
+        budget--;
+      }
+      entries_[j] = entry;
+      if (budget == 0)
+        break; // Too much movement; a full sort is cheaper
+    }
+    if (budget > 0)
+      return;
+  }
+  std::sort(entries_.begin(), entries_.end(), by_key);
+}
+
+bool BroadPhase::buildDenseTable() {
+  const size_t count = entries_.size();
+  if (count == 0)
+    return false;
+
+  // Sorted by key, so z bounds are at the ends
+  uint64_t x0 = AXIS_MASK, x1 = 0, y0 = AXIS_MASK, y1 = 0;
+  for (const Entry &entry : entries_) {
+    const uint64_t cx = entry.key & AXIS_MASK;
+    const uint64_t cy = (entry.key >> KEY_BITS) & AXIS_MASK;
+    x0 = std::min(x0, cx);
+    x1 = std::max(x1, cx);
+    y0 = std::min(y0, cy);
+    y1 = std::max(y1, cy);
+  }
+  const uint64_t z0 = entries_.front().key >> (2 * KEY_BITS);
+  const uint64_t z1 = entries_.back().key >> (2 * KEY_BITS);
+
+  // One empty cell of padding around the box keeps every neighbour lookup
+  // in range; a flat box needs none in z
+  flat_ = z0 == z1;
+  const uint64_t nx = x1 - x0 + 3, ny = y1 - y0 + 3;
+  const uint64_t nz = flat_ ? 1 : z1 - z0 + 3;
+  const uint64_t cells = nx * ny * nz;
+  if (cells > std::max(DENSE_CELLS_PER_ENTITY * count, DENSE_MIN_CELLS))
+    return false;
+  nx_ = static_cast<uint32_t>(nx);
+  ny_ = static_cast<uint32_t>(ny);
+  nz_ = static_cast<uint32_t>(nz);
+
+  // Counting pass, then prefix sums; slots are already in cell order
+  const uint64_t pad_z = flat_ ? 0 : 1;
+  slot_cell_.resize(count);
+  cell_start_.assign(cells + 1, 0);
+  for (size_t slot = 0; slot < count; slot++) {
+    const uint64_t key = entries_[slot].key;
+    const uint64_t cz = (key >> (2 * KEY_BITS)) - z0 + pad_z;
+    const uint64_t cy = ((key >> KEY_BITS) & AXIS_MASK) - y0 + 1;
+    const uint64_t cx = (key & AXIS_MASK) - x0 + 1;
+    const uint32_t cell = static_cast<uint32_t>((cz * ny + cy) * nx + cx);
+    slot_cell_[slot] = cell;
+    cell_start_[cell + 1]++;
+  }
+  for (size_t cell = 0; cell < cells; cell++)
+    cell_start_[cell + 1] += cell_start_[cell];
+  return true;
+}
+
+void BroadPhase::buildRuns() {
+  run_keys_.clear();
+  run_start_.clear();
+  for (size_t slot = 0; slot < entries_.size(); slot++) {
+    if (slot == 0 || entries_[slot].key != entries_[slot - 1].key) {
+      run_keys_.push_back(entries_[slot].key);
+      run_start_.push_back(static_cast<uint32_t>(slot));
+    }
+  }
+  run_start_.push_back(static_cast<uint32_t>(entries_.size()));
+}
+
+void BroadPhase::testRange(size_t a, size_t b, size_t end) {
+  // Branch-free: every candidate is written and only kept on a hit, since
+  // whether neighbours touch is too random to predict
+  if (pairs_.size() < found_ + 2 * (end - b + 1))
+    pairs_.resize(2 * (found_ + 2 * (end - b + 1)));
+  const double x = px_[a], y = py_[a], z = pz_[a], r = pr_[a];
+  for (; b < end; b++) {
+    const double dx = x - px_[b];
+    const double dy = y - py_[b];
+    const double dz = z - pz_[b];
+    const double reach = r + pr_[b];
+    const bool hit = squaredDistance(dx, dy, dz) <= reach * reach;
+    pairs_[found_] = std::min(ids_[a], ids_[b]);
+    pairs_[found_ + 1] = std::max(ids_[a], ids_[b]);
+    found_ += hit ? 2 : 0;
+  }
+}
+
+void BroadPhase::findDensePairs() {
+  const uint32_t *start = cell_start_.data();
+  const size_t nx = nx_;
+  const size_t nxy = static_cast<size_t>(nx_) * ny_;
+  for (size_t a = 0; a < ids_.size(); a++) {
+    const size_t cell = slot_cell_[a];
+    // Later slots of this cell and all of the (1, 0, 0) cell are contiguous
+    testRange(a, a + 1, start[cell + 2]);
+    // Rows of three cells: (dy, dz) = (1, 0), then (-1..1, 1)
+    testRange(a, start[cell + nx - 1], start[cell + nx + 2]);
+    if (flat_)
+      continue;
+    for (size_t row = cell + nxy - nx; row <= cell + nxy + nx; row += nx)
+      testRange(a, start[row - 1], start[row + 2]);
+  }
+}
+
+void BroadPhase::findSparsePairs() {
+  const uint32_t *start = run_start_.data();
+  // Run keys ascend, so each neighbour row's first candidate only moves
+  // forward: one cursor per row replaces per-cell lookups
+  const size_t runs = run_keys_.size();
+  size_t cursors[NUM_FORWARD_ROWS] = {};
+  for (size_t r = 0; r < runs; r++) {
+    const uint64_t key = run_keys_[r];
+    const size_t next =
+        (r + 1 < runs && run_keys_[r + 1] == key + KEY_X) ? r + 2 : r + 1;
+    for (size_t a = start[r]; a < start[r + 1]; a++)
+      testRange(a, a + 1, start[next]);
+
+    for (size_t k = 0; k < NUM_FORWARD_ROWS; k++) {
+      const uint64_t first = key + FORWARD_ROWS[k] - KEY_X;
+      const uint64_t last = key + FORWARD_ROWS[k] + KEY_X;
+      size_t &cursor = cursors[k];
+      while (cursor < runs && run_keys_[cursor] < first)
+        cursor++;
+      size_t end = cursor;
+      while (end < runs && run_keys_[end] <= last)
+        end++;
+      if (end == cursor)
+        continue;
+      for (size_t a = start[r]; a < start[r + 1]; a++)
+        testRange(a, start[cursor], start[end]);
+    }
+  }
+}
+
+size_t BroadPhase::findPairs(uint32_t *out_pairs, size_t capacity) {
+  found_ = 0;
+  if (dense_)
+    findDensePairs();
+  else
+    findSparsePairs();
+
+  const size_t count = found_ / 2;
+  if (count <= capacity)
+    std::copy(pairs_.begin(), pairs_.begin() + found_, out_pairs);
+  return count;
+}
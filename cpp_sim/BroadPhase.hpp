@@ -0,0 +1,99 @@
+#ifndef BROAD_PHASE_HPP
+#define BROAD_PHASE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class BroadPhase
+ * @brief Uniform-grid collision broad phase for many spheres.
+ *
+ * Entities are binned into cubic cells at least as wide as the largest
+ * diameter, so any overlapping pair lies in the same or adjacent cells.
+ * Entities are kept sorted by cell, which turns each cell into a contiguous
+ * slot range. Each cell is tested against itself and its 13 forward
+ * neighbours only, so every pair is visited once.
+ *
+ * When the occupied bounding box is small enough, a dense per-cell start
+ * table over the box finds neighbour ranges with two loads each. For scenes
+ * too sparse for that, runs of equal cell keys are swept in key order
+ * instead, with one cursor per neighbour row.
+ *
+ * Updates with the same entity count reuse the previous order: entities that
+ * stayed in their cell are already sorted, so re-sorting is an insertion
+ * sort over the few that moved.
+ */
+class BroadPhase {
+public:
+  /**
+   * @brief Sets a minimum cell edge; the default is 2 x the largest radius.
+   *
+   * Cells never get narrower than the largest diameter. Non-positive values
+   * restore the default.
+   */
+  void setCellSize(double size);
+  double cellSize() const { return cell_size_; }
+
+  /**
+   * @brief Re-bins @p count spheres given as structure-of-arrays.
+   *
+   * Radii must be non-negative. Entity ids are indices into these arrays.
+   */
+  void update(const double *x, const double *y, const double *z,
+              const double *radius, size_t count);
+
+  /**
+   * @brief All overlapping pairs (touching counts) as packed (a, b) entity
+   * ids with a < b.
+   *
+   * Nothing is written if there are more than @p capacity pairs.
+   * @return Number of overlapping pairs.
+   */
+  size_t findPairs(uint32_t *out_pairs, size_t capacity);
+
+  size_t size() const { return entries_.size(); }
+
+private:
+  struct Entry {
+    uint64_t key; // Packed cell coordinates, x in the low bits
+    uint32_t id;
+  };
+
+  void sortByKey(bool reuse_order);
+  bool buildDenseTable();
+  void buildRuns();
+
+  /** @brief Tests slot @p a against slots [b, end), appending hits. */
+  void testRange(size_t a, size_t b, size_t end);
+  void findDensePairs();
+  void findSparsePairs();
+
+  double min_cell_size_ = 0.0; // From setCellSize
+  double cell_size_ = 0.0;     // In use; grows only, so keys stay stable
+
+  std::vector<uint64_t> keys_by_id_; // Scratch, filled in input order
+  std::vector<Entry> entries_;       // Sorted by key
+
+  // Per-slot data in cell order
+  std::vector<uint32_t> ids_;
+  std::vector<double> px_, py_, pz_, pr_;
+
+  // Dense mode: padded box dimensions, each slot's cell and the first slot
+  // of every cell (plus an end sentinel)
+  bool dense_ = false;
+  bool flat_ = false; // Box is one cell deep in z
+  uint32_t nx_ = 0, ny_ = 0, nz_ = 0;
+  std::vector<uint32_t> slot_cell_;
+  std::vector<uint32_t> cell_start_;
+
+  // Sparse mode: one run per occupied cell, its key and first slot (plus an
+  // end sentinel)
+  std::vector<uint64_t> run_keys_;
+  std::vector<uint32_t> run_start_;
+
+  std::vector<uint32_t> pairs_; // Scratch reused across queries
+  size_t found_ = 0;            // Ids written to pairs_
+};
+
+#endif // BROAD_PHASE_HPP
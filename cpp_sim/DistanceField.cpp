@@ -0,0 +1,173 @@
+#include "DistanceField.hpp"
+#include "GridSearch.hpp"
+#include <algorithm>
+#include <mutex>
+
+std::shared_ptr<const DistanceField>
+DistanceField::build(const TerrainGrid &terrain, int32_t target, bool diagonal,
+                     PathWorkspace &ws) {
+  auto field = std::make_shared<DistanceField>();
+  field->target = target;
+  field->terrain_version = terrain.version();
+  field->diagonal = diagonal;
+  field->dist.assign(terrain.paddedSize(),
+                     std::numeric_limits<double>::infinity());
+  std::vector<double> &dist = field->dist;
+
+  // Reverse Dijkstra: stepping from a neighbour into `current` costs
+  // cost(current), which is what the neighbour pays on its way to target.
+  ws.begin(terrain.paddedSize());
+  dist[target] = 0.0;
+  ws.push({0.0, 0.0, target});
+  while (!ws.openEmpty()) {
+    SearchNode current = ws.pop();
+    if (current.g_score > dist[current.index])
+      continue;
+    // Blocked cells (including the padding) get a distance so that queries
+    // starting on them match A*, but nothing can route through them.
+    if (!terrain.passable(current.index))
+      continue;
+
+    const double cost = terrain.cost(current.index);
+    forEachGridMove(terrain, current.index, diagonal,
+                    [&](int32_t next, double multiplier) {
+                      const double next_g = current.g_score + cost * multiplier;
+                      if (next_g < dist[next]) {
+                        dist[next] = next_g;
+                        ws.push({next_g, next_g, next});
+                      }
+                    });
+  }
+
+  return field;
+}
+
+size_t DistanceField::writePath(const TerrainGrid &terrain, int32_t start,
+                                int32_t *out_xy, size_t capacity) const {
+  // Steepest descent: the best neighbour satisfies step(n) + dist[n] ==
+  // dist[current], so every step stays on a shortest path.
+  auto next_cell = [&](int32_t current) {
+    int32_t best = current;
+    double best_dist = std::numeric_limits<double>::infinity();
+    forEachGridMove(terrain, current, diagonal,
+                    [&](int32_t next, double multiplier) {
+                      if (!terrain.passable(next))
+                        return;
+                      const double d =
+                          terrain.cost(next) * multiplier + dist[next];
+                      if (d < best_dist) {
+                        best_dist = d;
+                        best = next;
+                      }
+                    });
+    return best;
+  };
+
+  size_t length = 1;
+  for (int32_t idx = start; idx != target; idx = next_cell(idx))
+    length++;
+  if (length > capacity)
+    return length; // Report the required size; no partial writes
+
+  size_t slot = 0;
+  for (int32_t idx = start;; idx = next_cell(idx)) {
+    out_xy[2 * slot] = terrain.xOf(idx);
+    out_xy[2 * slot + 1] = terrain.yOf(idx);
+    slot++;
+    if (idx == target)
+      break;
+  }
+  return length;
+}
+
+std::shared_ptr<const DistanceField>
+DistanceFieldCache::find(int32_t target, uint64_t terrain_version,
+                         bool diagonal) const {
+  if (count_.load(std::memory_order_acquire) == 0)
+    return nullptr;
+
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  for (const auto &entry : entries_) {
+    const DistanceField &field = *entry->field;
+    if (field.target == target && field.terrain_version == terrain_version &&
+        field.diagonal == diagonal) {
+      entry->last_used.store(clock_.fetch_add(1, std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+      return entry->field;
+    }
+  }
+  return nullptr;
+}
+
+bool DistanceFieldCache::insert(std::shared_ptr<const DistanceField> field) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  const size_t field_bytes = field->bytes();
+  if (capacity_ == 0 || field_bytes > max_bytes_)
+    return false;
+
+  const uint64_t now = clock_.fetch_add(1, std::memory_order_relaxed);
+  for (auto &entry : entries_) {
+    if (entry->field->target == field->target &&
+        entry->field->diagonal == field->diagonal) {
+      bytes_ += field_bytes - entry->field->bytes();
+      entry->field = std::move(field);
+      entry->last_used.store(now, std::memory_order_relaxed);
+      // The newest entry, so any eviction takes the others first
+      evictTo(capacity_, max_bytes_);
+      count_.store(entries_.size(), std::memory_order_release);
+      return true;
+    }
+  }
+
+  // Room for the new field: one slot, and its bytes
+  evictTo(capacity_ - 1, max_bytes_ - field_bytes);
+  auto entry = std::make_unique<Entry>();
+  entry->field = std::move(field);
+  entry->last_used.store(now, std::memory_order_relaxed);
+  entries_.push_back(std::move(entry));
+  bytes_ += field_bytes;
+  count_.store(entries_.size(), std::memory_order_release);
+  return true;
+}
+
+void DistanceFieldCache::evictTo(size_t limit, size_t byte_limit) {
+  while (entries_.size() > limit || bytes_ > byte_limit) {
+    auto lru = std::min_element(
+        entries_.begin(), entries_.end(), [](const auto &a, const auto &b) {
+          return a->last_used.load(std::memory_order_relaxed) <
+                 b->last_used.load(std::memory_order_relaxed);
+        });
+    bytes_ -= (*lru)->field->bytes();
+    entries_.erase(lru);
+  }
+}
+
+void DistanceFieldCache::setCapacity(size_t capacity) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  capacity_ = capacity;
+  evictTo(capacity_, max_bytes_);
+  count_.store(entries_.size(), std::memory_order_release);
+}
+
+void DistanceFieldCache::setMaxBytes(size_t max_bytes) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  max_bytes_ = max_bytes;
+  evictTo(capacity_, max_bytes_);
+  count_.store(entries_.size(), std::memory_order_release);
+}
+
+void DistanceFieldCache::clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  entries_.clear();
+  bytes_ = 0;
+  count_.store(0, std::memory_order_release);
+}
+
+size_t DistanceFieldCache::size() const {
+  return count_.load(std::memory_order_acquire);
+}
+
+size_t DistanceFieldCache::bytes() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return bytes_;
+}
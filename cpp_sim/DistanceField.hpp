@@ -0,0 +1,111 @@
+#ifndef DISTANCE_FIELD_HPP
+#define DISTANCE_FIELD_HPP
+
+#include "PathWorkspace.hpp"
+#include "TerrainGrid.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+/**
+ * @struct DistanceField
+ * @brief Cost-to-target for every cell, from a reverse Dijkstra flood.
+ *
+ * dist[i] is the cost of the cheapest path from padded cell i to the target
+ * (+inf if unreachable), so a path query towards the target is a single load
+ * and the path itself follows the gradient of the field. Costs are doubles,
+ * to match A* exactly, so a field takes 8 bytes per padded cell: 8 MB at
+ * 1024^2, 134 MB at 4096^2.
+ */
+struct DistanceField {
+  int32_t target;
+  uint64_t terrain_version;
+  bool diagonal; // Built for 8-connected movement
+  std::vector<double> dist;
+
+  /**
+   * @brief Floods @p terrain from @p target, using @p ws for the open set.
+   */
+  static std::shared_ptr<const DistanceField>
+  build(const TerrainGrid &terrain, int32_t target, bool diagonal,
+        PathWorkspace &ws);
+
+  /**
+   * @brief Writes the descent from @p start to the target as (x, y) pairs.
+   *
+   * Same buffer contract as writeParentPath. @p start must be reachable.
+   * @return Number of waypoints in the path.
+   */
+  size_t writePath(const TerrainGrid &terrain, int32_t start, int32_t *out_xy,
+                   size_t capacity) const;
+
+  size_t bytes() const { return sizeof(double) * dist.size(); }
+
+  bool reachable(int32_t idx) const {
+    return dist[idx] != std::numeric_limits<double>::infinity();
+  }
+};
+
+/**
+ * @class DistanceFieldCache
+ * @brief Small LRU cache of distance fields keyed by target cell and
+ * movement model.
+ *
+ * Bounded both by field count and by bytes: the defaults keep 8 fields of
+ * a 1024^2 map, but only one of a 4096^2 map.
+ *
+ * Lookups take a shared lock and stamp the entry's recency atomically, so
+ * concurrent path queries never serialize on each other; only inserts and
+ * evictions take the exclusive lock.
+ */
+class DistanceFieldCache {
+public:
+  static constexpr size_t DEFAULT_CAPACITY = 8;
+  static constexpr size_t DEFAULT_MAX_BYTES = size_t{256} << 20;
+
+  explicit DistanceFieldCache(size_t capacity = DEFAULT_CAPACITY,
+                              size_t max_bytes = DEFAULT_MAX_BYTES)
+      : capacity_(capacity), max_bytes_(max_bytes) {}
+
+  /**
+   * @brief Returns the field for @p target if cached for this terrain version.
+   */
+  std::shared_ptr<const DistanceField>
+  find(int32_t target, uint64_t terrain_version, bool diagonal) const;
+
+  /**
+   * @brief Inserts or replaces a field, evicting the least recently used.
+   * @return false (nothing cached) if the field alone exceeds the byte limit
+   * or the capacity is 0.
+   */
+  bool insert(std::shared_ptr<const DistanceField> field);
+
+  void setCapacity(size_t capacity);
+  void setMaxBytes(size_t max_bytes);
+  void clear();
+  size_t size() const;
+  /** @brief Bytes held by the cached fields. */
+  size_t bytes() const;
+
+private:
+  struct Entry {
+    std::shared_ptr<const DistanceField> field;
+    mutable std::atomic<uint64_t> last_used{0};
+  };
+
+  // Caller holds the exclusive lock
+  void evictTo(size_t limit, size_t byte_limit);
+
+  mutable std::shared_mutex mutex_;
+  std::vector<std::unique_ptr<Entry>> entries_;
+  std::atomic<size_t> count_{0}; // Lets empty-cache lookups skip the lock
+  mutable std::atomic<uint64_t> clock_{0};
+  size_t capacity_;
+  size_t max_bytes_;
+  size_t bytes_ = 0; // Guarded by mutex_
+};
+
+#endif // DISTANCE_FIELD_HPP
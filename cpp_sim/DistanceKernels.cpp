@@ -0,0 +1,329 @@
+#include "DistanceKernels.hpp"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PHYS_KERNELS_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define PHYS_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Every variant sums (dx^2 + dy^2) + dz^2 with separate multiplies and adds,
+// so on x86 all of them round identically to the scalar code.
+
+namespace {
+void distanceScalar(const double *x1, const double *y1, const double *z1,
+                    const double *x2, const double *y2, const double *z2,
+                    size_t count, double *out) {
+  for (size_t i = 0; i < count; i++)
+    out[i] = std::sqrt(
+        squaredDistance(x2[i] - x1[i], y2[i] - y1[i], z2[i] - z1[i]));
+}
+
+void overlapScalar(const double *x1, const double *y1, const double *z1,
+                   const double *r1, const double *x2, const double *y2,
+                   const double *z2, const double *r2, size_t count,
+                   uint8_t *out) {
+  for (size_t i = 0; i < count; i++) {
+    const double reach = r1[i] + r2[i];
+    out[i] = squaredDistance(x2[i] - x1[i], y2[i] - y1[i], z2[i] - z1[i]) <=
+             reach * reach;
+  }
+}
+
+size_t withinScalar(double cx, double cy, double cz, double radius,
+                    const double *x, const double *y, const double *z,
+                    size_t count, uint32_t *out_ids) {
+  const double reach = radius * radius;
+  size_t found = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (squaredDistance(x[i] - cx, y[i] - cy, z[i] - cz) <= reach) {
+      if (out_ids)
+        out_ids[found] = static_cast<uint32_t>(i);
+      found++;
+    }
+  }
+  return found;
+}
+
+/** @brief Appends base + the set bit positions of @p mask. */
+size_t emitMask(uint32_t mask, size_t base, uint32_t *out_ids, size_t found) {
+  if (!out_ids)
+    return found + __builtin_popcount(mask);
+  for (; mask != 0; mask &= mask - 1)
+    out_ids[found++] = static_cast<uint32_t>(base + __builtin_ctz(mask));
+  return found;
+}
+
+constexpr DistanceKernels SCALAR_KERNELS = {
+    SimdLevel::Scalar, "scalar", distanceScalar, overlapScalar, withinScalar};
+
+#ifdef PHYS_KERNELS_X86
+#define PHYS_AVX2 __attribute__((target("avx2")))
+#define PHYS_AVX512 __attribute__((target("avx512f")))
+
+PHYS_AVX2 inline __m256d squaredDistance4(__m256d dx, __m256d dy,
+                                          __m256d dz) {
+  return _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx),
+                                     _mm256_mul_pd(dy, dy)),
+                       _mm256_mul_pd(dz, dz));
+}
+
+PHYS_AVX2 void distanceAVX2(const double *x1, const double *y1,
+                            const double *z1, const double *x2,
+                            const double *y2, const double *z2, size_t count,
+                            double *out) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x2 + i),
+                                     _mm256_loadu_pd(x1 + i));
+    const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y2 + i),
+                                     _mm256_loadu_pd(y1 + i));
+    const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z2 + i),
+                                     _mm256_loadu_pd(z1 + i));
+    _mm256_storeu_pd(out + i, _mm256_sqrt_pd(squaredDistance4(dx, dy, dz)));
+  }
+  distanceScalar(x1 + i, y1 + i, z1 + i, x2 + i, y2 + i, z2 + i, count - i,
+                 out + i);
+}
+
+PHYS_AVX2 void overlapAVX2(const double *x1, const double *y1,
+                           const double *z1, const double *r1,
+                           const double *x2, const double *y2,
+                           const double *z2, const double *r2, size_t count,
+                           uint8_t *out) {
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x2 + i),
+                                     _mm256_loadu_pd(x1 + i));
+    const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y2 + i),
+                                     _mm256_loadu_pd(y1 + i));
+    const __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z2 + i),
+                                     _mm256_loadu_pd(z1 + i));
+    const __m256d reach = _mm256_add_pd(_mm256_loadu_pd(r1 + i),
+                                        _mm256_loadu_pd(r2 + i));
+    const int mask = _mm256_movemask_pd(
+        _mm256_cmp_pd(squaredDistance4(dx, dy, dz),
+                      _mm256_mul_pd(reach, reach), _CMP_LE_OQ));
+    for (int lane = 0; lane < 4; lane++)
+      out[i + lane] = (mask >> lane) & 1;
+  }
+  overlapScalar(x1 + i, y1 + i, z1 + i, r1 + i, x2 + i, y2 + i, z2 + i,
+                r2 + i, count - i, out + i);
+}
+
+PHYS_AVX2 size_t withinAVX2(double cx, double cy, double cz, double radius,
+                            const double *x, const double *y, const double *z,
+                            size_t count, uint32_t *out_ids) {
+  const __m256d px = _mm256_set1_pd(cx);
+  const __m256d py = _mm256_set1_pd(cy);
+  const __m256d pz = _mm256_set1_pd(cz);
+  const __m256d reach = _mm256_set1_pd(radius * radius);
+  size_t found = 0;
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m256d d2 =
+        squaredDistance4(_mm256_sub_pd(_mm256_loadu_pd(x + i), px),
+                         _mm256_sub_pd(_mm256_loadu_pd(y + i), py),
+                         _mm256_sub_pd(_mm256_loadu_pd(z + i), pz));
+    const int mask =
+        _mm256_movemask_pd(_mm256_cmp_pd(d2, reach, _CMP_LE_OQ));
+    found = emitMask(mask, i, out_ids, found);
+  }
+  for (; i < count; i++) {
+    if (squaredDistance(x[i] - cx, y[i] - cy, z[i] - cz) <= radius * radius)
+      found = emitMask(1, i, out_ids, found);
+  }
+  return found;
+}
+
+PHYS_AVX512 inline __m512d squaredDistance8(__m512d dx, __m512d dy,
+                                            __m512d dz) {
+  return _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(dx, dx),
+                                     _mm512_mul_pd(dy, dy)),
+                       _mm512_mul_pd(dz, dz));
+}
+
+// Lanes [0, n) of an 8-lane tail mask
+PHYS_AVX512 inline __mmask8 laneMask(size_t n) {
+  return n >= 8 ? 0xFF : static_cast<__mmask8>((1u << n) - 1);
+}
+
+PHYS_AVX512 void distanceAVX512(const double *x1, const double *y1,
+                                const double *z1, const double *x2,
+                                const double *y2, const double *z2,
+                                size_t count, double *out) {
+  // Masked loads and stores cover the tail without a scalar loop
+  for (size_t i = 0; i < count; i += 8) {
+    const __mmask8 m = laneMask(count - i);
+    const __m512d dx = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, x2 + i),
+                                     _mm512_maskz_loadu_pd(m, x1 + i));
+    const __m512d dy = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, y2 + i),
+                                     _mm512_maskz_loadu_pd(m, y1 + i));
+    const __m512d dz = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, z2 + i),
+                                     _mm512_maskz_loadu_pd(m, z1 + i));
+    const __m512d d2 = squaredDistance8(dx, dy, dz);
+    _mm512_mask_storeu_pd(out + i, m, _mm512_maskz_sqrt_pd(m, d2));
+  }
+}
+
+PHYS_AVX512 void overlapAVX512(const double *x1, const double *y1,
+                               const double *z1, const double *r1,
+                               const double *x2, const double *y2,
+                               const double *z2, const double *r2,
+                               size_t count, uint8_t *out) {
+  const __m512i one = _mm512_set1_epi64(1);
+  for (size_t i = 0; i < count; i += 8) {
+    const __mmask8 m = laneMask(count - i);
+    const __m512d dx = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, x2 + i),
+                                     _mm512_maskz_loadu_pd(m, x1 + i));
+    const __m512d dy = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, y2 + i),
+                                     _mm512_maskz_loadu_pd(m, y1 + i));
+    const __m512d dz = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, z2 + i),
+                                     _mm512_maskz_loadu_pd(m, z1 + i));
+    const __m512d reach = _mm512_add_pd(_mm512_maskz_loadu_pd(m, r1 + i),
+                                        _mm512_maskz_loadu_pd(m, r2 + i));
+    const __mmask8 hit =
+        _mm512_cmp_pd_mask(squaredDistance8(dx, dy, dz),
+                           _mm512_mul_pd(reach, reach), _CMP_LE_OQ);
+    // Narrow the 0/1 lanes to bytes
+    _mm512_mask_cvtepi64_storeu_epi8(out + i, m,
+                                     _mm512_maskz_mov_epi64(hit, one));
+  }
+}
+
+PHYS_AVX512 size_t withinAVX512(double cx, double cy, double cz,
+                                double radius, const double *x,
+                                const double *y, const double *z,
+                                size_t count, uint32_t *out_ids) {
+  const __m512d px = _mm512_set1_pd(cx);
+  const __m512d py = _mm512_set1_pd(cy);
+  const __m512d pz = _mm512_set1_pd(cz);
+  const __m512d reach = _mm512_set1_pd(radius * radius);
+  size_t found = 0;
+  for (size_t i = 0; i < count; i += 8) {
+    const __mmask8 m = laneMask(count - i);
+    const __m512d d2 = squaredDistance8(
+        _mm512_sub_pd(_mm512_maskz_loadu_pd(m, x + i), px),
+        _mm512_sub_pd(_mm512_maskz_loadu_pd(m, y + i), py),
+        _mm512_sub_pd(_mm512_maskz_loadu_pd(m, z + i), pz));
+    found = emitMask(_mm512_mask_cmp_pd_mask(m, d2, reach, _CMP_LE_OQ), i,
+                     out_ids, found);
+  }
+  return found;
+}
+
+constexpr DistanceKernels AVX2_KERNELS = {
+    SimdLevel::AVX2, "avx2", distanceAVX2, overlapAVX2, withinAVX2};
+constexpr DistanceKernels AVX512_KERNELS = {
+    SimdLevel::AVX512, "avx512", distanceAVX512, overlapAVX512,
+    withinAVX512};
+#endif // PHYS_KERNELS_X86
+
+#ifdef PHYS_KERNELS_NEON
+inline float64x2_t squaredDistance2(float64x2_t dx, float64x2_t dy,
+                                    float64x2_t dz) {
+  return vaddq_f64(vaddq_f64(vmulq_f64(dx, dx), vmulq_f64(dy, dy)),
+                   vmulq_f64(dz, dz));
+}
+
+void distanceNEON(const double *x1, const double *y1, const double *z1,
+                  const double *x2, const double *y2, const double *z2,
+                  size_t count, double *out) {
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const float64x2_t dx = vsubq_f64(vld1q_f64(x2 + i), vld1q_f64(x1 + i));
+    const float64x2_t dy = vsubq_f64(vld1q_f64(y2 + i), vld1q_f64(y1 + i));
+    const float64x2_t dz = vsubq_f64(vld1q_f64(z2 + i), vld1q_f64(z1 + i));
+    vst1q_f64(out + i, vsqrtq_f64(squaredDistance2(dx, dy, dz)));
+  }
+  distanceScalar(x1 + i, y1 + i, z1 + i, x2 + i, y2 + i, z2 + i, count - i,
+                 out + i);
+}
+
+void overlapNEON(const double *x1, const double *y1, const double *z1,
+                 const double *r1, const double *x2, const double *y2,
+                 const double *z2, const double *r2, size_t count,
+                 uint8_t *out) {
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const float64x2_t dx = vsubq_f64(vld1q_f64(x2 + i), vld1q_f64(x1 + i));
+    const float64x2_t dy = vsubq_f64(vld1q_f64(y2 + i), vld1q_f64(y1 + i));
+    const float64x2_t dz = vsubq_f64(vld1q_f64(z2 + i), vld1q_f64(z1 + i));
+    const float64x2_t reach = vaddq_f64(vld1q_f64(r1 + i), vld1q_f64(r2 + i));
+    const uint64x2_t hit = vcleq_f64(squaredDistance2(dx, dy, dz),
+                                     vmulq_f64(reach, reach));
+    out[i] = vgetq_lane_u64(hit, 0) & 1;
+    out[i + 1] = vgetq_lane_u64(hit, 1) & 1;
+  }
+  overlapScalar(x1 + i, y1 + i, z1 + i, r1 + i, x2 + i, y2 + i, z2 + i,
+                r2 + i, count - i, out + i);
+}
+
+size_t withinNEON(double cx, double cy, double cz, double radius,
+                  const double *x, const double *y, const double *z,
+                  size_t count, uint32_t *out_ids) {
+  const float64x2_t px = vdupq_n_f64(cx);
+  const float64x2_t py = vdupq_n_f64(cy);
+  const float64x2_t pz = vdupq_n_f64(cz);
+  const float64x2_t reach = vdupq_n_f64(radius * radius);
+  size_t found = 0;
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const float64x2_t d2 =
+        squaredDistance2(vsubq_f64(vld1q_f64(x + i), px),
+                         vsubq_f64(vld1q_f64(y + i), py),
+                         vsubq_f64(vld1q_f64(z + i), pz));
+    const uint64x2_t hit = vcleq_f64(d2, reach);
+    const uint32_t mask = (vgetq_lane_u64(hit, 0) & 1) |
+                          ((vgetq_lane_u64(hit, 1) & 1) << 1);
+    found = emitMask(mask, i, out_ids, found);
+  }
+  for (; i < count; i++) {
+    if (squaredDistance(x[i] - cx, y[i] - cy, z[i] - cz) <= radius * radius)
+      found = emitMask(1, i, out_ids, found);
+  }
+  return found;
+}
+
+constexpr DistanceKernels NEON_KERNELS = {
+    SimdLevel::NEON, "neon", distanceNEON, overlapNEON, withinNEON};
+#endif // PHYS_KERNELS_NEON
+
+// Widest first
+constexpr SimdLevel PREFERENCE[] = {SimdLevel::AVX512, SimdLevel::AVX2,
+                                    SimdLevel::NEON};
+
+const DistanceKernels *selectKernels() {
+  for (SimdLevel level : PREFERENCE) {
+    if (const DistanceKernels *kernels = distanceKernels(level))
+      return kernels;
+  }
+  return &SCALAR_KERNELS;
+}
+} // namespace
+
+const DistanceKernels *distanceKernels(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::Scalar:
+    return &SCALAR_KERNELS;
+#ifdef PHYS_KERNELS_X86
+  case SimdLevel::AVX2:
+    return __builtin_cpu_supports("avx2") ? &AVX2_KERNELS : nullptr;
+  case SimdLevel::AVX512:
+    return __builtin_cpu_supports("avx512f") ? &AVX512_KERNELS : nullptr;
+#endif
+#ifdef PHYS_KERNELS_NEON
+  case SimdLevel::NEON:
+    return &NEON_KERNELS; // Baseline on AArch64
+#endif
+  default:
+    return nullptr;
+  }
+}
+
+const DistanceKernels &activeDistanceKernels() {
+  static const DistanceKernels *kernels = selectKernels();
+  return *kernels;
+}
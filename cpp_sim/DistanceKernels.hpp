@@ -0,0 +1,69 @@
+#ifndef DISTANCE_KERNELS_HPP
+#define DISTANCE_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Instruction sets with a hand-written distance kernel.
+ */
+enum class SimdLevel : int32_t {
+  Scalar = 0,
+  NEON = 1,
+  AVX2 = 2,
+  AVX512 = 3,
+};
+
+/**
+ * @brief Squared Euclidean distance; compare against a squared radius
+ * instead of taking the root.
+ */
+inline double squaredDistance(double dx, double dy, double dz) {
+  return dx * dx + dy * dy + dz * dz;
+}
+
+/**
+ * @struct DistanceKernels
+ * @brief Batched distance kernels over structure-of-arrays coordinates.
+ *
+ * One table per instruction set; activeDistanceKernels() picks the widest
+ * one the CPU supports, once, on first use. All variants return the same
+ * results up to floating-point rounding of the sum.
+ */
+struct DistanceKernels {
+  SimdLevel level;
+  const char *name;
+
+  /** @brief out[i] = |p2_i - p1_i| for i < count. */
+  void (*distance)(const double *x1, const double *y1, const double *z1,
+                   const double *x2, const double *y2, const double *z2,
+                   size_t count, double *out);
+
+  /** @brief out[i] = 1 if spheres i touch (|p2_i - p1_i| <= r1_i + r2_i). */
+  void (*overlap)(const double *x1, const double *y1, const double *z1,
+                  const double *r1, const double *x2, const double *y2,
+                  const double *z2, const double *r2, size_t count,
+                  uint8_t *out);
+
+  /**
+   * @brief Indices of the points within @p radius of (cx, cy, cz).
+   *
+   * With @p out_ids null only counts; otherwise writes the indices in
+   * ascending order (the caller sizes the buffer from a counting call).
+   * @return Number of points in range.
+   */
+  size_t (*within)(double cx, double cy, double cz, double radius,
+                   const double *x, const double *y, const double *z,
+                   size_t count, uint32_t *out_ids);
+};
+
+/** @brief Kernels for the best instruction set this CPU supports. */
+const DistanceKernels &activeDistanceKernels();
+
+/**
+ * @brief Kernels for one instruction set, or nullptr if this build or CPU
+ * can't run them.
+ */
+const DistanceKernels *distanceKernels(SimdLevel level);
+
+#endif // DISTANCE_KERNELS_HPP
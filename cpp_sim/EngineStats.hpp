@@ -0,0 +1,143 @@
+#ifndef ENGINE_STATS_HPP
+#define ENGINE_STATS_HPP
+
+#include <cstdint>
+
+// Hot-path counters are compiled in only with -DPHYS_ENABLE_STATS; without
+// it PHYS_STAT statements vanish and queries carry no bookkeeping at all.
+// Every translation unit of a build must agree on the flag.
+#ifdef PHYS_ENABLE_STATS
+#define PHYS_STAT(statement) statement
+#else
+#define PHYS_STAT(statement)
+#endif
+
+/**
+ * @brief Path query latency buckets: bucket 0 counts calls under 1 us,
+ * bucket i calls in [2^(i-1), 2^i) us, and the last one everything slower.
+ */
+constexpr int PHYS_LATENCY_BUCKETS = 20;
+
+/**
+ * @struct PhysStats
+ * @brief Snapshot of an engine's counters, laid out for C callers.
+ *
+ * All fields are uint64, so a ctypes.Structure mirrors it directly. Path
+ * counters cover findShortestPath/findPath calls (each batch element counts
+ * as one), not distance field or hierarchy builds.
+ */
+struct PhysStats {
+  uint64_t path_queries;
+  uint64_t nodes_expanded; // Open-set pops, stale duplicates included
+  uint64_t open_pushes;
+  uint64_t peak_open_size; // Largest open set of any single query
+  uint64_t field_hits;     // Queries answered by a cached distance field
+  uint64_t field_misses;
+  uint64_t route_hits; // Terrain travel times served from the route cache
+  uint64_t route_misses;
+  uint64_t query_time_ns; // Wall time summed over all path queries
+  uint64_t latency_buckets[PHYS_LATENCY_BUCKETS];
+};
+
+#ifdef PHYS_ENABLE_STATS
+#include <atomic>
+#include <chrono>
+#include <initializer_list>
+
+/**
+ * @brief Per-search counts kept in a thread's PathWorkspace; plain integers,
+ * since only the owning thread touches them.
+ */
+struct SearchCounters {
+  uint64_t pops = 0;
+  uint64_t pushes = 0;
+  uint64_t peak_open = 0;
+};
+
+/**
+ * @class EngineStats
+ * @brief An engine's running totals, shared by all querying threads.
+ *
+ * Each query adds its counts once, with relaxed atomics, when it finishes,
+ * so the search loops themselves only bump thread-local integers.
+ */
+class EngineStats {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  void recordQuery(const SearchCounters &counters, Clock::duration elapsed);
+  void recordField(bool hit) { bump(hit ? field_hits_ : field_misses_, 1); }
+  void recordRoute(bool hit) { bump(hit ? route_hits_ : route_misses_, 1); }
+
+  PhysStats snapshot() const;
+  void reset();
+
+private:
+  static void bump(std::atomic<uint64_t> &counter, uint64_t n) {
+    counter.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> path_queries_{0};
+  std::atomic<uint64_t> nodes_expanded_{0};
+  std::atomic<uint64_t> open_pushes_{0};
+  std::atomic<uint64_t> peak_open_size_{0};
+  std::atomic<uint64_t> field_hits_{0};
+  std::atomic<uint64_t> field_misses_{0};
+  std::atomic<uint64_t> route_hits_{0};
+  std::atomic<uint64_t> route_misses_{0};
+  std::atomic<uint64_t> query_time_ns_{0};
+  std::atomic<uint64_t> latency_buckets_[PHYS_LATENCY_BUCKETS] = {};
+};
+
+inline void EngineStats::recordQuery(const SearchCounters &counters,
+                                     Clock::duration elapsed) {
+  bump(path_queries_, 1);
+  bump(nodes_expanded_, counters.pops);
+  bump(open_pushes_, counters.pushes);
+  uint64_t peak = peak_open_size_.load(std::memory_order_relaxed);
+  while (counters.peak_open > peak &&
+         !peak_open_size_.compare_exchange_weak(peak, counters.peak_open,
+                                                std::memory_order_relaxed))
+    ;
+
+  const uint64_t ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  bump(query_time_ns_, ns);
+  const uint64_t us = ns / 1000;
+  int bucket = 0;
+  while (bucket < PHYS_LATENCY_BUCKETS - 1 && us >= (uint64_t{1} << bucket))
+    bucket++;
+  bump(latency_buckets_[bucket], 1);
+}
+
+inline PhysStats EngineStats::snapshot() const {
+  auto get = [](const std::atomic<uint64_t> &counter) {
+    return counter.load(std::memory_order_relaxed);
+  };
+  PhysStats out;
+  out.path_queries = get(path_queries_);
+  out.nodes_expanded = get(nodes_expanded_);
+  out.open_pushes = get(open_pushes_);
+  out.peak_open_size = get(peak_open_size_);
+  out.field_hits = get(field_hits_);
+  out.field_misses = get(field_misses_);
+  out.route_hits = get(route_hits_);
+  out.route_misses = get(route_misses_);
+  out.query_time_ns = get(query_time_ns_);
+  for (int i = 0; i < PHYS_LATENCY_BUCKETS; i++)
+    out.latency_buckets[i] = get(latency_buckets_[i]);
+  return out;
+}
+
+inline void EngineStats::reset() {
+  for (std::atomic<uint64_t> *counter :
+       {&path_queries_, &nodes_expanded_, &open_pushes_, &peak_open_size_,
+        &field_hits_, &field_misses_, &route_hits_, &route_misses_,
+        &query_time_ns_})
+    counter->store(0, std::memory_order_relaxed);
+  for (std::atomic<uint64_t> &bucket : latency_buckets_)
+    bucket.store(0, std::memory_order_relaxed);
+}
+#endif // PHYS_ENABLE_STATS
+
+#endif // ENGINE_STATS_HPP
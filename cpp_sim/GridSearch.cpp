@@ -0,0 +1,319 @@
+#include "GridSearch.hpp"
+
+namespace {
+constexpr int32_t NONE = -1;
+
+int sign(int v) { return (v > 0) - (v < 0); }
+
+// 4-Directional movement vectors, then the diagonals
+constexpr int DX[] = {0, 0, 1, -1, 1, -1, 1, -1};
+constexpr int DY[] = {1, -1, 0, 0, 1, 1, -1, -1};
+
+/**
+ * @brief Plain A*; each step costs the entered cell (x sqrt(2) diagonally).
+ *
+ * With Bounded set, expansion is confined to @p region.
+ */
+template <bool Diagonal, bool Bounded>
+double aStar(const TerrainGrid &terrain, int32_t start, int32_t target,
+             const GridRegion *region, PathWorkspace &ws) {
+  const GridHeuristic heuristic{terrain.xOf(target), terrain.yOf(target),
+                                terrain.minCost(), Diagonal};
+
+  ws.begin(terrain.paddedSize());
+  ws.record(start, 0.0, PathWorkspace::NO_PARENT);
+  ws.push({heuristic(terrain.xOf(start), terrain.yOf(start)), 0.0, start});
+
+  const int32_t stride = terrain.stride();
+  const int directions = Diagonal ? 8 : 4;
+
+  while (!ws.openEmpty()) {
+    SearchNode current = ws.pop();
+
+    // Lazy deletion: a cheaper route to this cell was pushed later
+    if (current.g_score > ws.g(current.index))
+      continue;
+    if (current.index == target)
+      return current.g_score;
+
+    const int cx = terrain.xOf(current.index);
+    const int cy = terrain.yOf(current.index);
+    for (int i = 0; i < directions; i++) {
+      const int nx = cx + DX[i];
+      const int ny = cy + DY[i];
+      if (Bounded && !region->contains(nx, ny))
+        continue;
+      const int32_t next = current.index + DY[i] * stride + DX[i];
+
+      // Padded border cells are BLOCKED, so this also covers bounds
+      double step_cost = terrain.cost(next);
+      if (step_cost == TerrainGrid::BLOCKED)
+        continue;
+      if (i >= 4) {
+        if (!diagonalOpen(terrain, current.index, DX[i], DY[i] * stride))
+          continue;
+        step_cost *= SQRT2;
+      }
+
+      const double new_g_score = current.g_score + step_cost;
+      if (!ws.visited(next) || new_g_score < ws.g(next)) {
+        ws.record(next, new_g_score, current.index);
+        ws.push({new_g_score + heuristic(nx, ny), new_g_score, next});
+      }
+    }
+  }
+
+  return -1.0; // Unreachable
+}
+
+/**
+ * @brief Jump Point Search for 8-connected, uniform-cost, no-corner-cutting
+ * movement.
+ */
+class JumpPointSearch {
+public:
+  JumpPointSearch(const TerrainGrid &terrain, int32_t target)
+      : terrain_(terrain), target_(target), stride_(terrain.stride()) {}
+
+  double run(int32_t start, PathWorkspace &ws) {
+    const double cost = terrain_.minCost();
+    const GridHeuristic heuristic{terrain_.xOf(target_), terrain_.yOf(target_),
+                                  cost, true};
+
+    ws.begin(terrain_.paddedSize());
+    ws.record(start, 0.0, PathWorkspace::NO_PARENT);
+    ws.push({heuristic(terrain_.xOf(start), terrain_.yOf(start)), 0.0, start});
+
+    int32_t successors[8];
+    while (!ws.openEmpty()) {
+      SearchNode current = ws.pop();
+      if (current.g_score > ws.g(current.index))
+        continue;
+      if (current.index == target_)
+        return current.g_score;
+
+      const int cx = terrain_.xOf(current.index);
+      const int cy = terrain_.yOf(current.index);
+      const int count = expand(current.index, ws.parent(current.index),
+                               successors);
+      for (int i = 0; i < count; i++) {
+        const int32_t jump = successors[i];
+        const int jx = terrain_.xOf(jump);
+        const int jy = terrain_.yOf(jump);
+        const int ax = std::abs(jx - cx);
+        const int ay = std::abs(jy - cy);
+        // Runs are purely straight or purely diagonal
+        const double run_cost = cost * (ax == ay ? ax * SQRT2 : ax + ay);
+        const double new_g_score = current.g_score + run_cost;
+        if (!ws.visited(jump) || new_g_score < ws.g(jump)) {
+          ws.record(jump, new_g_score, current.index);
+          ws.push({new_g_score + heuristic(jx, jy), new_g_score, jump});
+        }
+      }
+    }
+    return -1.0; // Unreachable
+  }
+
+private:
+  bool open(int32_t idx) const { return terrain_.passable(idx); }
+
+  /**
+   * @brief Walks a straight run; stops at the target or a forced neighbour.
+   * @param side Offset perpendicular to @p step
+   */
+  int32_t jumpStraight(int32_t idx, int32_t step, int32_t side) const {
+    for (;;) {
+      idx += step;
+      if (!open(idx))
+        return NONE;
+      if (idx == target_)
+        return idx;
+      if ((open(idx + side) && !open(idx - step + side)) ||
+          (open(idx - side) && !open(idx - step - side)))
+        return idx;
+    }
+  }
+
+  /**
+   * @brief Walks a diagonal run; stops where a straight run finds something.
+   */
+  int32_t jumpDiagonal(int32_t idx, int32_t hstep, int32_t vstep) const {
+    for (;;) {
+      if (!diagonalOpen(terrain_, idx, hstep, vstep))
+        return NONE;
+      idx += hstep + vstep;
+      if (!open(idx))
+        return NONE;
+      if (idx == target_)
+        return idx;
+      if (jumpStraight(idx, hstep, stride_) != NONE ||
+          jumpStraight(idx, vstep, 1) != NONE)
+        return idx;
+    }
+  }
+
+  int32_t jump(int32_t from, int dx, int dy) const {
+    if (dx != 0 && dy != 0)
+      return jumpDiagonal(from, dx, dy * stride_);
+    if (dx != 0)
+      return jumpStraight(from, dx, stride_);
+    return jumpStraight(from, dy * stride_, 1);
+  }
+
+  /**
+   * @brief Jump points reachable from @p idx, pruned by arrival direction.
+   */
+  int expand(int32_t idx, int32_t parent, int32_t *out) const {
+    int dirs[8][2];
+    int n = 0;
+    auto add = [&](int dx, int dy) {
+      dirs[n][0] = dx;
+      dirs[n][1] = dy;
+      n++;
+    };
+
+    const int32_t s = stride_;
+    if (parent == PathWorkspace::NO_PARENT) {
+      for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+          if (dx != 0 || dy != 0)
+            add(dx, dy);
+    } else {
+      const int dx = sign(terrain_.xOf(idx) - terrain_.xOf(parent));
+      const int dy = sign(terrain_.yOf(idx) - terrain_.yOf(parent));
+      if (dx != 0 && dy != 0) {
+        add(0, dy);
+        add(dx, 0);
+        add(dx, dy);
+      } else if (dx != 0) {
+        add(dx, 0);
+        if (open(idx + s)) {
+          add(0, 1);
+          add(dx, 1);
+        }
+        if (open(idx - s)) {
+          add(0, -1);
+          add(dx, -1);
+        }
+      } else {
+        add(0, dy);
+        if (open(idx + 1)) {
+          add(1, 0);
+          add(1, dy);
+        }
+        if (open(idx - 1)) {
+          add(-1, 0);
+          add(-1, dy);
+        }
+      }
+    }
+
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+      const int32_t point = jump(idx, dirs[i][0], dirs[i][1]);
+      if (point != NONE)
+        out[count++] = point;
+    }
+    return count;
+  }
+
+  const TerrainGrid &terrain_;
+  const int32_t target_;
+  const int32_t stride_;
+};
+} // namespace
+
+double gridSearch(const TerrainGrid &terrain, int32_t start, int32_t target,
+                  const PathOptions &options, PathWorkspace &ws) {
+  if (!options.diagonal)
+    return aStar<false, false>(terrain, start, target, nullptr, ws);
+  if (options.algorithm == PathAlgorithm::JPS && terrain.uniformCost())
+    return JumpPointSearch(terrain, target).run(start, ws);
+  return aStar<true, false>(terrain, start, target, nullptr, ws);
+}
+
+double regionSearch(const TerrainGrid &terrain, int32_t start, int32_t target,
+                    const GridRegion &region, bool diagonal,
+                    PathWorkspace &ws) {
+  return diagonal ? aStar<true, true>(terrain, start, target, &region, ws)
+                  : aStar<false, true>(terrain, start, target, &region, ws);
+}
+
+void floodRegion(const TerrainGrid &terrain, int32_t origin,
+                 const GridRegion &region, bool diagonal, bool reverse,
+                 PathWorkspace &ws) {
+  const int32_t stride = terrain.stride();
+  const int directions = diagonal ? 8 : 4;
+
+  ws.begin(terrain.paddedSize());
+  ws.record(origin, 0.0, PathWorkspace::NO_PARENT);
+  ws.push({0.0, 0.0, origin});
+  while (!ws.openEmpty()) {
+    SearchNode current = ws.pop();
+    if (current.g_score > ws.g(current.index))
+      continue;
+    // Reverse floods pay for the cell being left, so walls can't relay
+    if (reverse && !terrain.passable(current.index))
+      continue;
+
+    const int cx = terrain.xOf(current.index);
+    const int cy = terrain.yOf(current.index);
+    for (int i = 0; i < directions; i++) {
+      if (!region.contains(cx + DX[i], cy + DY[i]))
+        continue;
+      const int32_t next = current.index + DY[i] * stride + DX[i];
+      if (!terrain.passable(next))
+        continue;
+      if (i >= 4 &&
+          !diagonalOpen(terrain, current.index, DX[i], DY[i] * stride))
+        continue;
+
+      const double cell_cost =
+          reverse ? terrain.cost(current.index) : terrain.cost(next);
+      const double new_g_score =
+          current.g_score + (i >= 4 ? cell_cost * SQRT2 : cell_cost);
+      if (!ws.visited(next) || new_g_score < ws.g(next)) {
+        ws.record(next, new_g_score, current.index);
+        ws.push({new_g_score, new_g_score, next});
+      }
+    }
+  }
+}
+
+size_t writeParentPath(const TerrainGrid &terrain, const PathWorkspace &ws,
+                       int32_t target, int32_t *out_xy, size_t capacity) {
+  // Consecutive parents may be a straight or diagonal run apart (JPS)
+  auto run_length = [&](int32_t a, int32_t b) {
+    return static_cast<size_t>(
+        std::max(std::abs(terrain.xOf(a) - terrain.xOf(b)),
+                 std::abs(terrain.yOf(a) - terrain.yOf(b))));
+  };
+
+  size_t length = 1;
+  for (int32_t idx = target; ws.parent(idx) != PathWorkspace::NO_PARENT;
+       idx = ws.parent(idx))
+    length += run_length(idx, ws.parent(idx));
+  if (length > capacity)
+    return length; // Report the required size; no partial writes
+
+  // Walk back from the target, filling the buffer from its end
+  size_t slot = length - 1;
+  int32_t idx = target;
+  out_xy[2 * slot] = terrain.xOf(idx);
+  out_xy[2 * slot + 1] = terrain.yOf(idx);
+  for (; ws.parent(idx) != PathWorkspace::NO_PARENT; idx = ws.parent(idx)) {
+    const int32_t parent = ws.parent(idx);
+    int x = terrain.xOf(idx);
+    int y = terrain.yOf(idx);
+    const int sx = sign(terrain.xOf(parent) - x);
+    const int sy = sign(terrain.yOf(parent) - y);
+    for (size_t i = run_length(idx, parent); i > 0; i--) {
+      x += sx;
+      y += sy;
+      slot--;
+      out_xy[2 * slot] = x;
+      out_xy[2 * slot + 1] = y;
+    }
+  }
+  return length;
+}
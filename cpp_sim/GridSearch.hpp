@@ -0,0 +1,134 @@
+#ifndef GRID_SEARCH_HPP
+#define GRID_SEARCH_HPP
+
+#include "PathWorkspace.hpp"
+#include "TerrainGrid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+constexpr double SQRT2 = 1.41421356237309504880;
+
+/**
+ * @brief Search algorithm used for grid path queries (values are C ABI).
+ */
+enum class PathAlgorithm : int32_t {
+  AStar = 0,
+  /** Jump Point Search; 8-connected only (PhysicsEngine rejects it without
+   *  diagonal moves). On terrain of mixed cost it runs A*. Returns the same
+   *  costs as A*. */
+  JPS = 1,
+  /** Hierarchical A* over cluster entrances (see PathHierarchy); near-optimal
+   *  rather than exact. Needs a built hierarchy, otherwise runs flat search. */
+  HPA = 2,
+};
+
+/**
+ * @brief Movement model and algorithm for path queries.
+ */
+struct PathOptions {
+  PathAlgorithm algorithm = PathAlgorithm::AStar;
+  /** 8-connected movement: diagonal steps cost sqrt(2) x the entered cell's
+   *  cost and may not cut corners past blocked cells. */
+  bool diagonal = false;
+};
+
+/**
+ * @brief Admissible grid heuristic towards a fixed target.
+ *
+ * Manhattan distance for 4-connected movement, octile distance for
+ * 8-connected; both scaled by the cheapest cell cost. Each is the exact
+ * step count on open terrain, so neither needs a square root.
+ */
+struct GridHeuristic {
+  int target_x, target_y;
+  double scale;
+  bool diagonal;
+
+  double operator()(int x, int y) const {
+    const double dx = std::abs(x - target_x);
+    const double dy = std::abs(y - target_y);
+    if (diagonal)
+      return scale * ((dx + dy) + (SQRT2 - 2.0) * std::min(dx, dy));
+    return scale * (dx + dy);
+  }
+};
+
+/**
+ * @brief True if a diagonal step from @p from by (hstep + vstep) is allowed.
+ *
+ * Both orthogonal cells next to the move must be passable (no corner cutting).
+ */
+inline bool diagonalOpen(const TerrainGrid &terrain, int32_t from,
+                         int32_t hstep, int32_t vstep) {
+  return terrain.passable(from + hstep) && terrain.passable(from + vstep);
+}
+
+/**
+ * @brief Calls fn(neighbour, step_multiplier) for every legal move from idx.
+ *
+ * Moves are symmetric (a diagonal's corner cells are the same both ways), so
+ * this serves reverse floods and forward descents alike. Neighbours may be
+ * blocked; entering one is up to the caller.
+ */
+template <typename Fn>
+void forEachGridMove(const TerrainGrid &terrain, int32_t idx, bool diagonal,
+                     Fn &&fn) {
+  const int32_t stride = terrain.stride();
+  const int32_t straight[] = {stride, -stride, 1, -1};
+  for (int32_t offset : straight)
+    fn(idx + offset, 1.0);
+  if (!diagonal)
+    return;
+  const int32_t hsteps[] = {1, -1, 1, -1};
+  const int32_t vsteps[] = {stride, stride, -stride, -stride};
+  for (int i = 0; i < 4; i++) {
+    if (diagonalOpen(terrain, idx, hsteps[i], vsteps[i]))
+      fn(idx + hsteps[i] + vsteps[i], SQRT2);
+  }
+}
+
+/**
+ * @brief Shortest path between two padded cell indices.
+ *
+ * Leaves the parent chain from @p target back to @p start in @p ws. With JPS
+ * consecutive parents are jump points joined by straight or diagonal runs;
+ * writeParentPath expands them.
+ *
+ * @return Total path cost, or -1.0 if unreachable.
+ */
+double gridSearch(const TerrainGrid &terrain, int32_t start, int32_t target,
+                  const PathOptions &options, PathWorkspace &ws);
+
+/**
+ * @brief A* that never leaves @p region (both endpoints must lie inside).
+ *
+ * Corner cells of a diagonal step may lie outside; they are only tested for
+ * passability, matching floodRegion.
+ */
+double regionSearch(const TerrainGrid &terrain, int32_t start, int32_t target,
+                    const GridRegion &region, bool diagonal,
+                    PathWorkspace &ws);
+
+/**
+ * @brief Dijkstra flood from @p origin over @p region.
+ *
+ * Afterwards ws.g(cell) holds the cost from @p origin to each visited cell,
+ * or with @p reverse the cost from each cell to @p origin.
+ */
+void floodRegion(const TerrainGrid &terrain, int32_t origin,
+                 const GridRegion &region, bool diagonal, bool reverse,
+                 PathWorkspace &ws);
+
+/**
+ * @brief Writes the cell-by-cell path ending at @p target as (x, y) pairs.
+ *
+ * Nothing is written if it needs more than @p capacity waypoints.
+ * @return Number of waypoints in the path.
+ */
+size_t writeParentPath(const TerrainGrid &terrain, const PathWorkspace &ws,
+                       int32_t target, int32_t *out_xy, size_t capacity);
+
+#endif // GRID_SEARCH_HPP
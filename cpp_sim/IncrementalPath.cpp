@@ -0,0 +1,322 @@
+#include "IncrementalPath.hpp"
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace {
+constexpr double INF = std::numeric_limits<double>::infinity();
+
+// Beyond this many unrepaired regions they merge into their bounding box
+constexpr size_t MAX_PENDING_REGIONS = 32;
+
+// Fibonacci hashing: the top bits of the product spread neighbouring
+// cells across the table
+size_t slotOf(int32_t cell, int shift) {
+  return (static_cast<uint32_t>(cell) * 0x9E3779B1u) >> shift;
+}
+} // namespace
+
+IncrementalPath::IncrementalPath(int startX, int startY, int targetX,
+                                 int targetY, bool diagonal)
+    : start_x_(startX), start_y_(startY), target_x_(targetX),
+      target_y_(targetY), diagonal_(diagonal),
+      heuristic_{startX, startY, 1.0, diagonal}, reached_{0, 0, 0, 0} {}
+
+void IncrementalPath::noteChange(const GridRegion &region) {
+  if (region.empty())
+    return;
+  if (pending_.size() < MAX_PENDING_REGIONS) {
+    pending_.push_back(region);
+    return;
+  }
+  GridRegion merged = region;
+  for (const GridRegion &other : pending_)
+    merged = {std::min(merged.x0, other.x0), std::min(merged.y0, other.y0),
+              std::max(merged.x1, other.x1), std::max(merged.y1, other.y1)};
+  pending_ = {merged};
+}
+
+void IncrementalPath::moveStart(const TerrainGrid &terrain, int x, int y) {
+  if (reload_ || !valid_) {
+    start_x_ = x;
+    start_y_ = y;
+    reload_ = true;
+    return;
+  }
+  const int32_t start = terrain.index(x, y);
+  if (start == start_)
+    return;
+
+  // Queued keys were computed against the old start; raising every new key
+  // by the distance moved keeps the old ones valid lower bounds
+  km_ += heuristic_(x, y);
+  start_x_ = heuristic_.target_x = x;
+  start_y_ = heuristic_.target_y = y;
+  start_ = start;
+  if (tracked(terrain, start_) && !terrain.passable(start_)) {
+    // Walls keep no rhs unless they are the start
+    state(start_).rhs = bestStep(terrain, start_);
+    updateCell(terrain, start_);
+  }
+}
+
+double IncrementalPath::cost(const TerrainGrid &terrain) {
+  // A lower cell cost would make the heuristic overestimate
+  if (reload_ || terrain.minCost() < heuristic_.scale)
+    reset(terrain);
+  if (!valid_)
+    return -1.0;
+  repair(terrain);
+  search(terrain);
+  if (!terrain.passable(target_))
+    return -1.0; // Like gridSearch, even from the target itself
+  const double best = at(start_).rhs;
+  return best == INF ? -1.0 : best;
+}
+
+size_t IncrementalPath::writePath(const TerrainGrid &terrain, int32_t *out_xy,
+                                  size_t capacity) const {
+  if (!valid_ || reload_ || at(start_).rhs == INF ||
+      !terrain.passable(target_))
+    return 0;
+
+  // Every step onto the best neighbour stays on a shortest route
+  auto next_cell = [&](int32_t current) {
+    int32_t best = current;
+    double best_cost = INF;
+    forEachGridMove(terrain, current, diagonal_,
+                    [&](int32_t next, double multiplier) {
+                      if (!terrain.passable(next))
+                        return;
+                      const double c =
+                          terrain.cost(next) * multiplier + at(next).g;
+                      if (c < best_cost) {
+                        best_cost = c;
+                        best = next;
+                      }
+                    });
+    return best;
+  };
+
+  size_t length = 1;
+  for (int32_t idx = start_; idx != target_; idx = next_cell(idx))
+    length++;
+  if (length > capacity)
+    return length; // Report the required size; no partial writes
+
+  size_t slot = 0;
+  for (int32_t idx = start_;; idx = next_cell(idx)) {
+    out_xy[2 * slot] = terrain.xOf(idx);
+    out_xy[2 * slot + 1] = terrain.yOf(idx);
+    slot++;
+    if (idx == target_)
+      break;
+  }
+  return length;
+}
+
+void IncrementalPath::reset(const TerrainGrid &terrain) {
+  reload_ = false;
+  pending_.clear();
+  open_.clear();
+  stamp_ = 0;
+  km_ = 0.0;
+  heuristic_ = {start_x_, start_y_, terrain.minCost(), diagonal_};
+  reached_ = {0, 0, 0, 0};
+  valid_ = terrain.inBounds(start_x_, start_y_) &&
+           terrain.inBounds(target_x_, target_y_);
+  if (!valid_)
+    return;
+
+  slots_.clear();
+  held_ = 0;
+  slot_shift_ = 32;
+  start_ = terrain.index(start_x_, start_y_);
+  target_ = terrain.index(target_x_, target_y_);
+  state(target_).rhs = 0.0;
+  updateCell(terrain, target_);
+}
+
+void IncrementalPath::repair(const TerrainGrid &terrain) {
+  for (const GridRegion &region : pending_) {
+    // Cells next to a changed one may have changed steps out of them. Only
+    // those next to a reached cell can have had a finite rhs.
+    const int x0 = std::max({region.x0 - 1, reached_.x0 - 1, 0});
+    const int y0 = std::max({region.y0 - 1, reached_.y0 - 1, 0});
+    const int x1 = std::min({region.x1 + 1, reached_.x1 + 1, terrain.width()});
+    const int y1 =
+        std::min({region.y1 + 1, reached_.y1 + 1, terrain.height()});
+    for (int y = y0; y < y1; y++) {
+      for (int x = x0; x < x1; x++) {
+        const int32_t cell = terrain.index(x, y);
+        if (!tracked(terrain, cell))
+          continue;
+        const double best = bestStep(terrain, cell);
+        const CellState &held = at(cell);
+        if (best == INF && held.rhs == INF && held.g == INF)
+          continue; // Unreached before and after: nothing to hold
+        state(cell).rhs = best;
+        updateCell(terrain, cell);
+      }
+    }
+  }
+  pending_.clear();
+}
+
+void IncrementalPath::search(const TerrainGrid &terrain) {
+  while (true) {
+    pruneOpen();
+    if (open_.empty())
+      break;
+    const OpenEntry top = open_.front();
+    const CellState &start = at(start_);
+    if (!(top.key < key(terrain, start_)) && start.rhs == start.g)
+      break;
+
+    std::pop_heap(open_.begin(), open_.end(), std::greater<>{});
+    open_.pop_back();
+    const int32_t u = top.cell;
+    const Key current = key(terrain, u);
+    if (top.key < current) {
+      // Queued before the start moved; requeue at its real key
+      push(terrain, u);
+      continue;
+    }
+    // Inserting a neighbour may move u's state: the loops below use copies
+    CellState &current_state = state(u);
+    current_state.queued = 0;
+    expansions_++;
+
+    if (current_state.g > current_state.rhs) {
+      // Overconsistent: settle u and offer it to its neighbours
+      const double g = current_state.g = current_state.rhs;
+      if (!terrain.passable(u))
+        continue; // Nothing steps through a wall
+      const double step = terrain.cost(u);
+      forEachGridMove(terrain, u, diagonal_,
+                      [&](int32_t s, double multiplier) {
+                        if (!tracked(terrain, s))
+                          return;
+                        const double via = step * multiplier + g;
+                        CellState &next = state(s);
+                        if (via < next.rhs) {
+                          next.rhs = via;
+                          updateCell(terrain, s);
+                        }
+                      });
+    } else {
+      // Underconsistent: u got dearer, so whoever relied on it looks again
+      const double old_g = current_state.g;
+      current_state.g = INF;
+      if (terrain.passable(u)) {
+        const double step = terrain.cost(u);
+        forEachGridMove(terrain, u, diagonal_,
+                        [&](int32_t s, double multiplier) {
+                          if (!tracked(terrain, s))
+                            return;
+                          CellState &next = state(s);
+                          if (next.rhs == step * multiplier + old_g)
+                            next.rhs = bestStep(terrain, s);
+                          updateCell(terrain, s);
+                        });
+      }
+      if (tracked(terrain, u))
+        state(u).rhs = bestStep(terrain, u);
+      updateCell(terrain, u);
+    }
+  }
+}
+
+IncrementalPath::Key IncrementalPath::key(const TerrainGrid &terrain,
+                                          int32_t cell) const {
+  const CellState &cell_state = at(cell);
+  const double best = std::min(cell_state.g, cell_state.rhs);
+  return {best + heuristic_(terrain.xOf(cell), terrain.yOf(cell)) + km_,
+          best};
+}
+
+double IncrementalPath::bestStep(const TerrainGrid &terrain,
+                                 int32_t cell) const {
+  double best = INF;
+  forEachGridMove(terrain, cell, diagonal_,
+                  [&](int32_t next, double multiplier) {
+                    if (terrain.passable(next))
+                      best = std::min(best, terrain.cost(next) * multiplier +
+                                                at(next).g);
+                  });
+  return best;
+}
+
+const IncrementalPath::CellState &
+IncrementalPath::at(int32_t cell) const {
+  static const CellState unreached;
+  if (slots_.empty())
+    return unreached;
+  const size_t mask = slots_.size() - 1;
+  for (size_t i = slotOf(cell, slot_shift_);; i = (i + 1) & mask) {
+    if (slots_[i].cell == cell)
+      return slots_[i].state;
+    if (slots_[i].cell < 0)
+      return unreached;
+  }
+}
+
+IncrementalPath::CellState &IncrementalPath::state(int32_t cell) {
+  size_t mask = slots_.size() - 1;
+  size_t i = slots_.empty() ? 0 : slotOf(cell, slot_shift_);
+  while (!slots_.empty() && slots_[i].cell >= 0) {
+    if (slots_[i].cell == cell)
+      return slots_[i].state;
+    i = (i + 1) & mask;
+  }
+  if (2 * (held_ + 1) > slots_.size()) {
+    // Doubling rehashes every held cell into the new table
+    std::vector<Slot> old(std::max<size_t>(2 * slots_.size(), 1024));
+    old.swap(slots_);
+    slot_shift_ = 32 - __builtin_ctzll(slots_.size());
+    mask = slots_.size() - 1;
+    for (const Slot &slot : old) {
+      if (slot.cell < 0)
+        continue;
+      size_t j = slotOf(slot.cell, slot_shift_);
+      while (slots_[j].cell >= 0)
+        j = (j + 1) & mask;
+      slots_[j] = slot;
+    }
+    for (i = slotOf(cell, slot_shift_); slots_[i].cell >= 0;)
+      i = (i + 1) & mask;
+  }
+  slots_[i].cell = cell;
+  held_++;
+  return slots_[i].state;
+}
+
+void IncrementalPath::updateCell(const TerrainGrid &terrain, int32_t cell) {
+  CellState &cell_state = state(cell);
+  if (cell_state.g != cell_state.rhs) {
+    push(terrain, cell);
+    const int x = terrain.xOf(cell), y = terrain.yOf(cell);
+    reached_ = reached_.empty()
+                   ? GridRegion{x, y, x + 1, y + 1}
+                   : GridRegion{std::min(reached_.x0, x),
+                                std::min(reached_.y0, y),
+                                std::max(reached_.x1, x + 1),
+                                std::max(reached_.y1, y + 1)};
+  } else {
+    cell_state.queued = 0;
+  }
+}
+
+void IncrementalPath::push(const TerrainGrid &terrain, int32_t cell) {
+  state(cell).queued = ++stamp_;
+  open_.push_back({key(terrain, cell), cell, stamp_});
+  std::push_heap(open_.begin(), open_.end(), std::greater<>{});
+}
+
+void IncrementalPath::pruneOpen() {
+  while (!open_.empty() &&
+         at(open_.front().cell).queued != open_.front().stamp) {
+    std::pop_heap(open_.begin(), open_.end(), std::greater<>{});
+    open_.pop_back();
+  }
+}
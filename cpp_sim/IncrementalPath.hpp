@@ -0,0 +1,135 @@
+#ifndef INCREMENTAL_PATH_HPP
+#define INCREMENTAL_PATH_HPP
+
+#include "GridSearch.hpp"
+#include "TerrainGrid.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * @class IncrementalPath
+ * @brief One start-target route kept shortest across terrain changes with
+ * D* Lite (Koenig and Likhachev, 2002).
+ *
+ * The search runs backwards from the target, so every reached cell knows its
+ * cost to the target and the start may move along (or off) the route without
+ * invalidating anything. After a change only the cells next to the changed
+ * region that the search had reached are re-examined, and repairs spread no
+ * further than they affect the start's cost: a change away from everything
+ * the search touched costs nothing. Moves follow the same rules as
+ * gridSearch, including stepping off a blocked start. Only cells the search
+ * reached hold state, 64 to 128 bytes each, so memory follows how far the
+ * search spread rather than the map's size: a short route on a 4096^2 map
+ * holds a few hundred cells.
+ */
+class IncrementalPath {
+public:
+  /** @brief Endpoints must be in bounds; the first cost() searches. */
+  IncrementalPath(int startX, int startY, int targetX, int targetY,
+                  bool diagonal);
+
+  /** @brief Cells of @p region changed cost or passability. */
+  void noteChange(const GridRegion &region);
+  /** @brief The map was replaced: the next cost() searches from scratch. */
+  void noteReload() { reload_ = true; }
+  /** @brief Moves the start to an in-bounds cell. */
+  void moveStart(const TerrainGrid &terrain, int x, int y);
+
+  /**
+   * @brief Repairs the search as far as the noted changes require.
+   * @return The route's cost, or -1.0 if the target is unreachable (or an
+   * endpoint lies outside a reloaded map).
+   */
+  double cost(const TerrainGrid &terrain);
+
+  /**
+   * @brief Writes the route found by the last cost() as (x, y) pairs.
+   *
+   * Nothing is written if it needs more than @p capacity waypoints.
+   * @return Number of waypoints, 0 if unreachable.
+   */
+  size_t writePath(const TerrainGrid &terrain, int32_t *out_xy,
+                   size_t capacity) const;
+
+  bool diagonal() const { return diagonal_; }
+  /** @brief Cells expanded over the path's lifetime, searches and repairs. */
+  uint64_t expansions() const { return expansions_; }
+  /** @brief Cells holding search state, 64 to 128 bytes each. */
+  size_t cellsHeld() const { return held_; }
+
+private:
+  struct Key {
+    double k1, k2;
+
+    bool operator<(const Key &other) const {
+      return k1 < other.k1 || (k1 == other.k1 && k2 < other.k2);
+    }
+  };
+
+  // A cell the search never reached has no entry: both costs infinite
+  struct CellState {
+    double g = std::numeric_limits<double>::infinity();
+    double rhs = std::numeric_limits<double>::infinity();
+    uint64_t queued = 0; // Stamp of the live open entry, 0 if none
+  };
+
+  // A cell's entry is live while its queued matches the entry's stamp;
+  // updates push a new entry instead of searching the heap for the old one
+  struct OpenEntry {
+    Key key;
+    int32_t cell;
+    uint64_t stamp;
+
+    // Heap inversion: lowest key has highest priority
+    bool operator>(const OpenEntry &other) const { return other.key < key; }
+  };
+
+  /** @brief The cell's state, or an unreached one without inserting it. */
+  const CellState &at(int32_t cell) const;
+  /** @brief The cell's state, inserted if unreached (which may move all). */
+  CellState &state(int32_t cell);
+
+  void reset(const TerrainGrid &terrain);
+  void repair(const TerrainGrid &terrain);
+  void search(const TerrainGrid &terrain);
+
+  Key key(const TerrainGrid &terrain, int32_t cell) const;
+  /** @brief Cheapest step plus cost-to-target over the neighbours of cell. */
+  double bestStep(const TerrainGrid &terrain, int32_t cell) const;
+  /** @brief Whether cell's rhs is kept: walls only matter as the start. */
+  bool tracked(const TerrainGrid &terrain, int32_t cell) const {
+    return cell != target_ && (terrain.passable(cell) || cell == start_);
+  }
+  /** @brief Queues cell if inconsistent, dequeues it otherwise. */
+  void updateCell(const TerrainGrid &terrain, int32_t cell);
+  void push(const TerrainGrid &terrain, int32_t cell);
+  /** @brief Drops dead entries off the top of the heap. */
+  void pruneOpen();
+
+  int start_x_, start_y_, target_x_, target_y_;
+  bool diagonal_;
+  bool reload_ = true;
+  bool valid_ = false; // Endpoints inside the current map
+  int32_t start_ = 0, target_ = 0;
+
+  // Open addressing by padded index, at most half full so probes stay
+  // short. Cells stay until the next reset.
+  struct Slot {
+    int32_t cell = -1;
+    CellState state;
+  };
+  std::vector<Slot> slots_;
+  size_t held_ = 0;
+  int slot_shift_ = 32; // Hash bits are the top 32 - slot_shift_
+  std::vector<OpenEntry> open_; // Min-heap on key
+  uint64_t stamp_ = 0;
+  double km_ = 0.0;          // Heuristic drift from start moves
+  GridHeuristic heuristic_;  // Towards the start, scaled at reset
+  GridRegion reached_;       // Bounds of cells with a finite rhs
+  std::vector<GridRegion> pending_;
+  uint64_t expansions_ = 0;
+};
+
+#endif // INCREMENTAL_PATH_HPP
@@ -0,0 +1,311 @@
+#include "PathHierarchy.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace {
+constexpr double INF = std::numeric_limits<double>::infinity();
+
+// Open border stretches at least this wide get a transition at each end
+constexpr int WIDE_ENTRANCE = 6;
+} // namespace
+
+PathHierarchy::PathHierarchy(const TerrainGrid &terrain, int cluster_size,
+                             bool diagonal, PathWorkspace &ws)
+    : cluster_size_(std::max(cluster_size, 2)),
+      clusters_x_((terrain.width() + cluster_size_ - 1) / cluster_size_),
+      clusters_y_((terrain.height() + cluster_size_ - 1) / cluster_size_),
+      diagonal_(diagonal), terrain_version_(terrain.version()) {
+  const size_t count = static_cast<size_t>(clusters_x_) * clusters_y_;
+  clusters_.resize(count);
+  right_border_.resize(count);
+  bottom_border_.resize(count);
+
+  for (int cy = 0; cy < clusters_y_; cy++) {
+    for (int cx = 0; cx < clusters_x_; cx++) {
+      Cluster &cluster = clusters_[cy * clusters_x_ + cx];
+      cluster.region = {cx * cluster_size_, cy * cluster_size_,
+                        std::min(terrain.width(), (cx + 1) * cluster_size_),
+                        std::min(terrain.height(), (cy + 1) * cluster_size_)};
+    }
+  }
+  for (size_t c = 0; c < count; c++) {
+    buildBorder(terrain, static_cast<int>(c), true);
+    buildBorder(terrain, static_cast<int>(c), false);
+  }
+  for (size_t c = 0; c < count; c++)
+    buildCluster(terrain, static_cast<int>(c), ws);
+}
+
+size_t PathHierarchy::nodeCount() const {
+  size_t total = 0;
+  for (const Cluster &cluster : clusters_)
+    total += cluster.nodes.size();
+  return total;
+}
+
+int PathHierarchy::localIndex(const Cluster &cluster, int32_t cell) {
+  auto it = std::lower_bound(cluster.nodes.begin(), cluster.nodes.end(), cell);
+  if (it == cluster.nodes.end() || *it != cell)
+    return -1;
+  return static_cast<int>(it - cluster.nodes.begin());
+}
+
+void PathHierarchy::buildBorder(const TerrainGrid &terrain, int cluster,
+                                bool vertical) {
+  std::vector<Transition> &border =
+      vertical ? right_border_[cluster] : bottom_border_[cluster];
+  border.clear();
+
+  const int cx = cluster % clusters_x_;
+  const int cy = cluster / clusters_x_;
+  if ((vertical && cx + 1 >= clusters_x_) ||
+      (!vertical && cy + 1 >= clusters_y_))
+    return;
+
+  // Walk along the border; `pos` runs down a vertical border, across a
+  // horizontal one
+  const GridRegion &region = clusters_[cluster].region;
+  const int begin = vertical ? region.y0 : region.x0;
+  const int end = vertical ? region.y1 : region.x1;
+  auto cells = [&](int pos) {
+    return vertical ? Transition{terrain.index(region.x1 - 1, pos),
+                                 terrain.index(region.x1, pos)}
+                    : Transition{terrain.index(pos, region.y1 - 1),
+                                 terrain.index(pos, region.y1)};
+  };
+  auto open = [&](int pos) {
+    const Transition t = cells(pos);
+    return terrain.passable(t.a) && terrain.passable(t.b);
+  };
+
+  for (int pos = begin; pos < end;) {
+    if (!open(pos)) {
+      pos++;
+      continue;
+    }
+    const int run_start = pos;
+    while (pos < end && open(pos))
+      pos++;
+    const int run_end = pos - 1;
+    if (run_end - run_start + 1 >= WIDE_ENTRANCE) {
+      border.push_back(cells(run_start));
+      border.push_back(cells(run_end));
+    } else {
+      border.push_back(cells((run_start + run_end) / 2));
+    }
+  }
+}
+
+void PathHierarchy::buildCluster(const TerrainGrid &terrain, int cluster,
+                                 PathWorkspace &ws) {
+  Cluster &c = clusters_[cluster];
+  const int cx = cluster % clusters_x_;
+  const int cy = cluster / clusters_x_;
+
+  // (from, to) pairs leaving this cluster; crossing costs the entered cell
+  std::vector<std::pair<int32_t, int32_t>> exits;
+  for (const Transition &t : right_border_[cluster])
+    exits.push_back({t.a, t.b});
+  for (const Transition &t : bottom_border_[cluster])
+    exits.push_back({t.a, t.b});
+  if (cx > 0) {
+    for (const Transition &t : right_border_[cluster - 1])
+      exits.push_back({t.b, t.a});
+  }
+  if (cy > 0) {
+    for (const Transition &t : bottom_border_[cluster - clusters_x_])
+      exits.push_back({t.b, t.a});
+  }
+
+  c.nodes.clear();
+  for (const auto &exit : exits)
+    c.nodes.push_back(exit.first);
+  std::sort(c.nodes.begin(), c.nodes.end());
+  c.nodes.erase(std::unique(c.nodes.begin(), c.nodes.end()), c.nodes.end());
+  const size_t n = c.nodes.size();
+
+  // Bucket the exits by source node
+  c.link_start.assign(n + 1, 0);
+  for (const auto &exit : exits)
+    c.link_start[localIndex(c, exit.first) + 1]++;
+  for (size_t i = 0; i < n; i++)
+    c.link_start[i + 1] += c.link_start[i];
+  c.links.resize(exits.size());
+  std::vector<uint32_t> fill(c.link_start.begin(), c.link_start.end() - 1);
+  for (const auto &exit : exits) {
+    c.links[fill[localIndex(c, exit.first)]++] = {exit.second,
+                                                   terrain.cost(exit.second)};
+  }
+
+  c.intra.assign(n * n, INF);
+  for (size_t i = 0; i < n; i++) {
+    floodRegion(terrain, c.nodes[i], c.region, diagonal_, false, ws);
+    for (size_t j = 0; j < n; j++) {
+      if (ws.visited(c.nodes[j]))
+        c.intra[i * n + j] = ws.g(c.nodes[j]);
+    }
+  }
+}
+
+void PathHierarchy::updateCell(const TerrainGrid &terrain, int x, int y,
+                               PathWorkspace &ws) {
+  updateRegion(terrain, {x, y, x + 1, y + 1}, ws);
+}
+
+void PathHierarchy::updateRegion(const TerrainGrid &terrain,
+                                 const GridRegion &changed,
+                                 PathWorkspace &ws) {
+  terrain_version_ = terrain.version();
+  const int x0 = std::max(changed.x0, 0);
+  const int y0 = std::max(changed.y0, 0);
+  const int x1 = std::min(changed.x1, terrain.width());
+  const int y1 = std::min(changed.y1, terrain.height());
+  if (x0 >= x1 || y0 >= y1)
+    return;
+
+  // Neighbouring clusters share borders, so collect the work before doing it
+  std::vector<char> dirty(clusters_.size(), 0);
+  std::vector<char> right(clusters_.size(), 0), bottom(clusters_.size(), 0);
+  for (int cy = y0 / cluster_size_; cy <= (y1 - 1) / cluster_size_; cy++) {
+    for (int cx = x0 / cluster_size_; cx <= (x1 - 1) / cluster_size_; cx++) {
+      const int cluster = cy * clusters_x_ + cx;
+      const GridRegion &region = clusters_[cluster].region;
+      dirty[cluster] = 1;
+
+      // Border cells also shape the transitions shared with the neighbour
+      if (x1 >= region.x1 && cx + 1 < clusters_x_) {
+        right[cluster] = 1;
+        dirty[cluster + 1] = 1;
+      }
+      if (x0 <= region.x0 && cx > 0) {
+        right[cluster - 1] = 1;
+        dirty[cluster - 1] = 1;
+      }
+      if (y1 >= region.y1 && cy + 1 < clusters_y_) {
+        bottom[cluster] = 1;
+        dirty[cluster + clusters_x_] = 1;
+      }
+      if (y0 <= region.y0 && cy > 0) {
+        bottom[cluster - clusters_x_] = 1;
+        dirty[cluster - clusters_x_] = 1;
+      }
+    }
+  }
+
+  for (size_t c = 0; c < clusters_.size(); c++) {
+    if (right[c])
+      buildBorder(terrain, static_cast<int>(c), true);
+    if (bottom[c])
+      buildBorder(terrain, static_cast<int>(c), false);
+  }
+  for (size_t c = 0; c < clusters_.size(); c++) {
+    if (dirty[c])
+      buildCluster(terrain, static_cast<int>(c), ws);
+  }
+}
+
+double PathHierarchy::findPath(const TerrainGrid &terrain, int32_t start,
+                               int32_t target, PathWorkspace &ws,
+                               std::vector<int32_t> *waypoints) const {
+  if (waypoints)
+    waypoints->clear();
+  if (start == target) {
+    if (waypoints)
+      *waypoints = {terrain.xOf(start), terrain.yOf(start)};
+    return 0.0;
+  }
+
+  const int start_cluster = clusterOf(terrain, start);
+  const int target_cluster = clusterOf(terrain, target);
+  const Cluster &sc = clusters_[start_cluster];
+  const Cluster &tc = clusters_[target_cluster];
+
+  // Connect start and target to their clusters' transitions
+  floodRegion(terrain, start, sc.region, diagonal_, false, ws);
+  std::vector<double> from_start(sc.nodes.size(), INF);
+  for (size_t k = 0; k < sc.nodes.size(); k++) {
+    if (ws.visited(sc.nodes[k]))
+      from_start[k] = ws.g(sc.nodes[k]);
+  }
+  const double direct = (start_cluster == target_cluster && ws.visited(target))
+                            ? ws.g(target)
+                            : INF;
+
+  floodRegion(terrain, target, tc.region, diagonal_, true, ws);
+  std::vector<double> to_target(tc.nodes.size(), INF);
+  for (size_t k = 0; k < tc.nodes.size(); k++) {
+    if (ws.visited(tc.nodes[k]))
+      to_target[k] = ws.g(tc.nodes[k]);
+  }
+
+  // A* over the abstract graph; workspace slots are indexed by cell
+  const GridHeuristic heuristic{terrain.xOf(target), terrain.yOf(target),
+                                terrain.minCost(), diagonal_};
+  ws.begin(terrain.paddedSize());
+  auto relax = [&](int32_t cell, double g, int32_t parent) {
+    if (g == INF || (ws.visited(cell) && g >= ws.g(cell)))
+      return;
+    ws.record(cell, g, parent);
+    ws.push({g + heuristic(terrain.xOf(cell), terrain.yOf(cell)), g, cell});
+  };
+  relax(start, 0.0, PathWorkspace::NO_PARENT);
+  relax(target, direct, start);
+
+  double cost = -1.0;
+  while (!ws.openEmpty()) {
+    SearchNode current = ws.pop();
+    if (current.g_score > ws.g(current.index))
+      continue;
+    if (current.index == target) {
+      cost = current.g_score;
+      break;
+    }
+
+    if (current.index == start) {
+      for (size_t k = 0; k < sc.nodes.size(); k++)
+        relax(sc.nodes[k], from_start[k], start);
+    }
+
+    const int cluster = clusterOf(terrain, current.index);
+    const Cluster &c = clusters_[cluster];
+    const int k = localIndex(c, current.index);
+    if (k < 0)
+      continue;
+    const size_t n = c.nodes.size();
+    for (size_t j = 0; j < n; j++)
+      relax(c.nodes[j], current.g_score + c.intra[k * n + j], current.index);
+    for (uint32_t l = c.link_start[k]; l < c.link_start[k + 1]; l++)
+      relax(c.links[l].to, current.g_score + c.links[l].cost, current.index);
+    if (cluster == target_cluster)
+      relax(target, current.g_score + to_target[k], current.index);
+  }
+
+  if (cost < 0 || !waypoints)
+    return cost;
+
+  // Refine: segments inside one cluster are re-searched within it, the
+  // rest are single steps across a border
+  std::vector<int32_t> route;
+  for (int32_t cell = target; cell != PathWorkspace::NO_PARENT;
+       cell = ws.parent(cell))
+    route.push_back(cell);
+  std::reverse(route.begin(), route.end());
+
+  waypoints->assign({terrain.xOf(start), terrain.yOf(start)});
+  std::vector<int32_t> segment;
+  for (size_t i = 1; i < route.size(); i++) {
+    const int32_t from = route[i - 1];
+    const int32_t to = route[i];
+    const int cluster = clusterOf(terrain, from);
+    if (cluster != clusterOf(terrain, to)) {
+      waypoints->push_back(terrain.xOf(to));
+      waypoints->push_back(terrain.yOf(to));
+      continue;
+    }
+    regionSearch(terrain, from, to, clusters_[cluster].region, diagonal_, ws);
+    segment.resize(2 * writeParentPath(terrain, ws, to, nullptr, 0));
+    writeParentPath(terrain, ws, to, segment.data(), segment.size() / 2);
+    waypoints->insert(waypoints->end(), segment.begin() + 2, segment.end());
+  }
+  return cost;
+}
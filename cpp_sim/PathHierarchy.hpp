@@ -0,0 +1,102 @@
+#ifndef PATH_HIERARCHY_HPP
+#define PATH_HIERARCHY_HPP
+
+#include "GridSearch.hpp"
+#include "PathWorkspace.hpp"
+#include "TerrainGrid.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class PathHierarchy
+ * @brief HPA* abstraction: square clusters linked through border entrances.
+ *
+ * Each maximal open stretch of a cluster border becomes one transition pair
+ * (two for wide stretches) straddling the border. Costs between the
+ * transitions of a cluster are precomputed with cluster-bounded floods.
+ * Queries connect start and target to their clusters' transitions, search
+ * the small abstract graph, and refine only the segments of the chosen route.
+ * Paths are near-optimal; costs are exact for the route returned.
+ *
+ * A single cell change rebuilds the cell's cluster, plus the neighbour across
+ * any border the cell lies on; a changed region rebuilds each cluster it
+ * touches that way, once.
+ */
+class PathHierarchy {
+public:
+  static constexpr int DEFAULT_CLUSTER_SIZE = 32;
+
+  /**
+   * @brief Builds the abstraction for @p terrain under one movement model.
+   */
+  PathHierarchy(const TerrainGrid &terrain, int cluster_size, bool diagonal,
+                PathWorkspace &ws);
+
+  bool diagonal() const { return diagonal_; }
+  int clusterSize() const { return cluster_size_; }
+  /** @brief Terrain version the abstraction currently reflects. */
+  uint64_t terrainVersion() const { return terrain_version_; }
+  /** @brief Total transition nodes in the abstract graph. */
+  size_t nodeCount() const;
+
+  /**
+   * @brief Re-derives the clusters affected by a change of cell (x, y).
+   */
+  void updateCell(const TerrainGrid &terrain, int x, int y, PathWorkspace &ws);
+
+  /**
+   * @brief Re-derives the clusters affected by a change of @p changed.
+   */
+  void updateRegion(const TerrainGrid &terrain, const GridRegion &changed,
+                    PathWorkspace &ws);
+
+  /**
+   * @brief Path cost between two padded cell indices, or -1.0 if unreachable.
+   *
+   * @param waypoints If non-null, receives the refined path as (x, y) pairs
+   */
+  double findPath(const TerrainGrid &terrain, int32_t start, int32_t target,
+                  PathWorkspace &ws, std::vector<int32_t> *waypoints) const;
+
+private:
+  /** @brief Cells facing each other across a border: a in the left/upper
+   *  cluster, b in the right/lower one. */
+  struct Transition {
+    int32_t a, b;
+  };
+
+  struct Link {
+    int32_t to;
+    double cost;
+  };
+
+  struct Cluster {
+    GridRegion region;
+    std::vector<int32_t> nodes; // Sorted padded cell indices
+    std::vector<double> intra;  // nodes.size()^2, +inf if disconnected
+    std::vector<uint32_t> link_start; // Per node, into links
+    std::vector<Link> links;          // Edges to the neighbouring clusters
+  };
+
+  int clusterAt(int x, int y) const {
+    return (y / cluster_size_) * clusters_x_ + (x / cluster_size_);
+  }
+  int clusterOf(const TerrainGrid &terrain, int32_t cell) const {
+    return clusterAt(terrain.xOf(cell), terrain.yOf(cell));
+  }
+  static int localIndex(const Cluster &cluster, int32_t cell);
+
+  void buildBorder(const TerrainGrid &terrain, int cluster, bool vertical);
+  void buildCluster(const TerrainGrid &terrain, int cluster, PathWorkspace &ws);
+
+  int cluster_size_;
+  int clusters_x_, clusters_y_;
+  bool diagonal_;
+  uint64_t terrain_version_;
+  std::vector<Cluster> clusters_;
+  // Transitions on each cluster's right and bottom border
+  std::vector<std::vector<Transition>> right_border_, bottom_border_;
+};
+
+#endif // PATH_HIERARCHY_HPP
@@ -0,0 +1,99 @@
+#ifndef PATH_WORKSPACE_HPP
+#define PATH_WORKSPACE_HPP
+
+#include "EngineStats.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Open-set entry for grid searches (cell index into a TerrainGrid).
+ */
+struct SearchNode {
+  double f_score; // g + heuristic
+  double g_score; // Cost from start
+  int32_t index;
+
+  // Priority queue inversion: lowest cost has highest priority
+  bool operator>(const SearchNode &other) const {
+    return f_score > other.f_score;
+  }
+};
+
+/**
+ * @class PathWorkspace
+ * @brief Preallocated per-search scratch: dense g/parent arrays and open set.
+ *
+ * A cell's g/parent entries are only valid when its stamp matches the current
+ * generation, so starting a new search is O(1) instead of clearing the
+ * arrays. Once sized for a grid, searches perform no heap allocations beyond
+ * the occasional growth of the open set's high-water mark.
+ */
+class PathWorkspace {
+public:
+  static constexpr int32_t NO_PARENT = -1;
+
+  /**
+   * @brief Starts a new search over a grid with @p cells padded cells.
+   */
+  void begin(size_t cells) {
+    if (stamp_.size() != cells) {
+      g_.assign(cells, 0.0);
+      parent_.assign(cells, NO_PARENT);
+      stamp_.assign(cells, 0);
+      generation_ = 0;
+      open_.reserve(INITIAL_OPEN_CAPACITY);
+    }
+    if (++generation_ == 0) {
+      // Wrapped around: stale stamps could alias, so clear them once
+      std::fill(stamp_.begin(), stamp_.end(), 0);
+      generation_ = 1;
+    }
+    open_.clear();
+  }
+
+  bool visited(int32_t idx) const { return stamp_[idx] == generation_; }
+  double g(int32_t idx) const { return g_[idx]; }
+  int32_t parent(int32_t idx) const { return parent_[idx]; }
+
+  void record(int32_t idx, double g_score, int32_t parent) {
+    g_[idx] = g_score;
+    parent_[idx] = parent;
+    stamp_[idx] = generation_;
+  }
+
+  bool openEmpty() const { return open_.empty(); }
+  size_t openSize() const { return open_.size(); }
+
+  void push(const SearchNode &node) {
+    open_.push_back(node);
+    std::push_heap(open_.begin(), open_.end(), std::greater<SearchNode>());
+    PHYS_STAT(counters.pushes++);
+    PHYS_STAT(counters.peak_open = std::max<uint64_t>(counters.peak_open,
+                                                      open_.size()));
+  }
+
+  SearchNode pop() {
+    PHYS_STAT(counters.pops++);
+    std::pop_heap(open_.begin(), open_.end(), std::greater<SearchNode>());
+    SearchNode node = open_.back();
+    open_.pop_back();
+    return node;
+  }
+
+  // Reset by the engine at the start of each query
+  PHYS_STAT(SearchCounters counters;)
+
+private:
+  static constexpr size_t INITIAL_OPEN_CAPACITY = 1024;
+
+  std::vector<double> g_;
+  std::vector<int32_t> parent_;
+  std::vector<uint32_t> stamp_;
+  std::vector<SearchNode> open_;
+  uint32_t generation_ = 0;
+};
+
+#endif // PATH_WORKSPACE_HPP
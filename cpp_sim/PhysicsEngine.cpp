@@ -1,122 +1,843 @@
 #include "PhysicsEngine.hpp"
-#include <map>
-#include <queue>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iterator>
 
 namespace {
-constexpr double SPEED_WALKING_KMH = 5.0;
-constexpr double SPEED_RUNNING_KMH = 10.0;
-constexpr double SPEED_DRIVING_KMH = 50.0;
-constexpr double SPEED_FLYING_KMH = 800.0;
-
-constexpr int GRID_SIZE = 100;
-
-// Obstacle definition (Mountain range simulation)
-const int OBSTACLE_X_MIN = 50;
-const int OBSTACLE_X_MAX = 60;
-const int OBSTACLE_Y_MIN = 50;
-const int OBSTACLE_Y_MAX = 60;
+// Batch block size: keeps the distance scratch for one block in L1
+constexpr size_t BATCH_BLOCK = 1024;
+
+// Path batches hand out this many queries per chunk at most; smaller chunks
+// only add locking, stealing already evens out long queries
+constexpr size_t PATH_BATCH_MAX_GRAIN = 64;
+
+// Thread-local engine id -> workspace cache; misses fall back to the
+// engine's mutex-protected registry
+constexpr size_t WORKSPACE_CACHE_SLOTS = 4;
+
+struct WorkspaceCacheEntry {
+  uint64_t engine_id = 0;
+  PathWorkspace *workspace = nullptr;
+};
+
+std::atomic<uint64_t> next_engine_id{1};
+
+#ifdef PHYS_ENABLE_STATS
+// Times one path query and adds its search counts to the engine's totals
+class QueryStatsScope {
+public:
+  QueryStatsScope(EngineStats &stats, PathWorkspace &ws)
+      : stats_(stats), ws_(ws), start_(EngineStats::Clock::now()) {
+    ws_.counters = {};
+  }
+  ~QueryStatsScope() {
+    stats_.recordQuery(ws_.counters, EngineStats::Clock::now() - start_);
+  }
+
+private:
+  EngineStats &stats_;
+  PathWorkspace &ws_;
+  EngineStats::Clock::time_point start_;
+};
+#endif
 } // namespace
 
+PhysicsEngine::PhysicsEngine()
+    : id_(next_engine_id.fetch_add(1, std::memory_order_relaxed)),
+      terrain_(TerrainGrid::makeDefault()),
+      transport_profiles_(std::begin(BUILTIN_TRANSPORT_PROFILES),
+                          std::end(BUILTIN_TRANSPORT_PROFILES)) {}
+
+PathWorkspace &PhysicsEngine::workspace() const {
+  thread_local WorkspaceCacheEntry cache[WORKSPACE_CACHE_SLOTS];
+  thread_local size_t next_victim = 0;
+
+  for (const WorkspaceCacheEntry &entry : cache) {
+    if (entry.engine_id == id_)
+      return *entry.workspace;
+  }
+
+  PathWorkspace *ws;
+  {
+    std::lock_guard<std::mutex> lock(workspaces_mutex_);
+    std::unique_ptr<PathWorkspace> &slot =
+        workspaces_[std::this_thread::get_id()];
+    if (!slot)
+      slot = std::make_unique<PathWorkspace>();
+    ws = slot.get();
+  }
+
+  WorkspaceCacheEntry &victim = cache[next_victim];
+  next_victim = (next_victim + 1) % WORKSPACE_CACHE_SLOTS;
+  victim = {id_, ws};
+  return *ws;
+}
+
+bool PhysicsEngine::loadTerrain(const float *costs, int width, int height) {
+  if (!terrain_.load(costs, width, height))
+    return false;
+  distance_fields_.clear();
+  hierarchy_.reset();
+  elevation_.clear();
+  routes_.clear();
+  std::lock_guard<std::mutex> lock(tracked_mutex_);
+  for (auto &entry : tracked_)
+    entry.second->noteReload();
+  return true;
+}
+
+bool PhysicsEngine::loadTerrain(const uint8_t *costs, int width, int height) {
+  if (!terrain_.load(costs, width, height))
+    return false;
+  distance_fields_.clear();
+  hierarchy_.reset();
+  elevation_.clear();
+  routes_.clear();
+  std::lock_guard<std::mutex> lock(tracked_mutex_);
+  for (auto &entry : tracked_)
+    entry.second->noteReload();
+  return true;
+}
+
+bool PhysicsEngine::setCellCost(int x, int y, float cost) {
+  if (!terrain_.setCost(x, y, cost))
+    return false;
+  terrainChanged({x, y, x + 1, y + 1});
+  return true;
+}
+
+int32_t PhysicsEngine::addObstacle(int minX, int minY, int maxX, int maxY) {
+  // Corners are inclusive; INT32_MAX already lies past any map edge
+  const GridRegion region = {minX, minY, maxX < INT32_MAX ? maxX + 1 : maxX,
+                             maxY < INT32_MAX ? maxY + 1 : maxY};
+  const int32_t id = terrain_.addObstacle(region);
+  if (id >= 0)
+    terrainChanged(region);
+  return id;
+}
+
+bool PhysicsEngine::removeObstacle(int32_t id) {
+  GridRegion cleared;
+  if (!terrain_.removeObstacle(id, &cleared))
+    return false;
+  terrainChanged(cleared);
+  return true;
+}
+
+void PhysicsEngine::terrainChanged(const GridRegion &changed) {
+  distance_fields_.clear();
+  if (hierarchy_)
+    hierarchy_->updateRegion(terrain_, changed, workspace());
+  std::lock_guard<std::mutex> lock(tracked_mutex_);
+  for (auto &entry : tracked_)
+    entry.second->noteChange(changed);
+}
+
+int32_t PhysicsEngine::trackPath(int startX, int startY, int targetX,
+                                 int targetY) {
+  if (!terrain_.inBounds(startX, startY) ||
+      !terrain_.inBounds(targetX, targetY))
+    return -1;
+  std::lock_guard<std::mutex> lock(tracked_mutex_);
+  const int32_t id = next_tracked_++;
+  tracked_.emplace(id, std::make_unique<IncrementalPath>(
+                           startX, startY, targetX, targetY,
+                           path_options_.diagonal));
+  return id;
+}
+
+double PhysicsEngine::trackedPath(int32_t id, int32_t *out_xy,
+                                  size_t capacity, size_t *out_len) {
+  *out_len = 0;
+  std::lock_guard<std::mutex> lock(tracked_mutex_);
+  const auto entry = tracked_.find(id);
+  if (entry == tracked_.end())
+    return -1.0;
+  IncrementalPath &path = *entry->second;
+  const double cost = path.cost(terrain_);
+  if (cost >= 0)
+    *out_len = path.writePath(terrain_, out_xy, capacity);
+  return cost;
+}
+
+bool PhysicsEngine::moveTrackedPath(int32_t id, int x, int y) {
+  if (!terrain_.inBounds(x, y))
+    return false;
+  std::lock_guard<std::mutex> lock(tracked_mutex_);
+  const auto entry = tracked_.find(id);
+  if (entry == tracked_.end())
+    return false;
+  entry->second->moveStart(terrain_, x, y);
+  return true;
+}
+
+bool PhysicsEngine::untrackPath(int32_t id) {
+  std::lock_guard<std::mutex> lock(tracked_mutex_);
+  return tracked_.erase(id) > 0;
+}
+
+bool PhysicsEngine::buildHierarchy(int clusterSize) {
+  if (clusterSize < 2)
+    return false;
+  hierarchy_ = std::make_unique<PathHierarchy>(
+      terrain_, clusterSize, path_options_.diagonal, workspace());
+  routes_.clear(); // HPA* routes may differ from the cached ones
+  return true;
+}
+
+bool PhysicsEngine::buildDistanceField(int targetX, int targetY) {
+  if (!terrain_.inBounds(targetX, targetY))
+    return false;
+  const int32_t target = terrain_.index(targetX, targetY);
+  if (!terrain_.passable(target))
+    return false;
+  return distance_fields_.insert(DistanceField::build(
+      terrain_, target, path_options_.diagonal, workspace()));
+}
+
+bool PhysicsEngine::setPathOptions(const PathOptions &options) {
+  if (options.algorithm == PathAlgorithm::JPS && !options.diagonal)
+    return false;
+  path_options_ = options;
+  routes_.clear();
+  return true;
+}
+
+void PhysicsEngine::setDistanceFieldCapacity(size_t capacity) {
+  distance_fields_.setCapacity(capacity);
+}
+
+void PhysicsEngine::setDistanceFieldMaxBytes(size_t max_bytes) {
+  distance_fields_.setMaxBytes(max_bytes);
+}
+
+std::shared_ptr<const DistanceField>
+PhysicsEngine::cachedField(int targetX, int targetY) const {
+  if (!terrain_.inBounds(targetX, targetY))
+    return nullptr;
+  return distance_fields_.find(terrain_.index(targetX, targetY),
+                               terrain_.version(), path_options_.diagonal);
+}
+
 double PhysicsEngine::calculateDistance(const Point3D &p1,
                                         const Point3D &p2) const {
-  return std::sqrt(std::pow(p2.x - p1.x, 2) + std::pow(p2.y - p1.y, 2) +
-                   std::pow(p2.z - p1.z, 2));
+  return std::sqrt(squaredDistance(p2.x - p1.x, p2.y - p1.y, p2.z - p1.z));
 }
 
 double PhysicsEngine::estimateTravelTime(const Point3D &p1, const Point3D &p2,
                                          const std::string &mode) const {
-  double dist_km = calculateDistance(p1, p2);
-  double speed_kmh = SPEED_WALKING_KMH;
+  return estimateTravelTime(p1, p2, transportModeId(mode.c_str()));
+}
 
-  if (mode == "driving")
-    speed_kmh = SPEED_DRIVING_KMH;
-  else if (mode == "running")
-    speed_kmh = SPEED_RUNNING_KMH;
-  else if (mode == "flying")
-    speed_kmh = SPEED_FLYING_KMH;
+double PhysicsEngine::estimateTravelTime(const Point3D &p1, const Point3D &p2,
+                                         int32_t mode) const {
+  const double dist_km = calculateDistance(p1, p2);
+  switch (mode) {
+  case static_cast<int32_t>(TransportMode::Walking):
+    return travelMinutes<TransportMode::Walking>(dist_km);
+  case static_cast<int32_t>(TransportMode::Running):
+    return travelMinutes<TransportMode::Running>(dist_km);
+  case static_cast<int32_t>(TransportMode::Driving):
+    return travelMinutes<TransportMode::Driving>(dist_km);
+  case static_cast<int32_t>(TransportMode::Flying):
+    return travelMinutes<TransportMode::Flying>(dist_km);
+  default:
+    if (mode >= NUM_BUILTIN_TRANSPORT_MODES &&
+        static_cast<size_t>(mode) < transport_profiles_.size())
+      return (dist_km / transport_profiles_[mode].speed_kmh) * 60.0;
+    return travelMinutes<TransportMode::Walking>(dist_km);
+  }
+}
+
+int32_t PhysicsEngine::transportModeId(const char *name) const {
+  const int32_t builtin = builtinTransportMode(name);
+  if (builtin >= 0)
+    return builtin;
+  for (size_t i = 0; i < custom_mode_names_.size(); i++) {
+    if (custom_mode_names_[i] == name)
+      return NUM_BUILTIN_TRANSPORT_MODES + static_cast<int32_t>(i);
+  }
+  return -1;
+}
+
+int32_t PhysicsEngine::registerTransportMode(const char *name,
+                                             double speed_kmh,
+                                             double terrain_multiplier) {
+  if (!name || !*name || builtinTransportMode(name) >= 0 ||
+      !(speed_kmh > 0.0) || !std::isfinite(speed_kmh) ||
+      !(terrain_multiplier >= 0.0) || !std::isfinite(terrain_multiplier))
+    return -1;
+  const TransportProfile profile{speed_kmh, 60.0 / speed_kmh,
+                                 terrain_multiplier};
+  int32_t mode = transportModeId(name);
+  if (mode < 0) {
+    mode = static_cast<int32_t>(transport_profiles_.size());
+    custom_mode_names_.push_back(name);
+    transport_profiles_.push_back(profile);
+  } else {
+    transport_profiles_[mode] = profile;
+  }
+  return mode;
+}
+
+void PhysicsEngine::estimateTravelTimeBatch(
+    const double *__restrict x1, const double *__restrict y1,
+    const double *__restrict z1, const double *__restrict x2,
+    const double *__restrict y2, const double *__restrict z2,
+    const int32_t *__restrict modes, size_t count,
+    double *__restrict out) const {
+  const auto distance = activeDistanceKernels().distance;
+  const TransportProfile *profiles = transport_profiles_.data();
+  const size_t num_profiles = transport_profiles_.size();
+  for (size_t base = 0; base < count; base += BATCH_BLOCK) {
+    const size_t end = std::min(count, base + BATCH_BLOCK);
+
+    // Pass 1: straight-line distance with the CPU's widest kernel
+    distance(x1 + base, y1 + base, z1 + base, x2 + base, y2 + base,
+             z2 + base, end - base, out + base);
+
+    // Pass 2: scale by the mode's pace while the block is still in cache
+    for (size_t i = base; i < end; i++) {
+      const uint32_t mode = static_cast<uint32_t>(modes[i]);
+      out[i] *= profiles[mode < num_profiles ? mode : 0].minutes_per_km;
+    }
+  }
+}
 
-  return (dist_km / speed_kmh) * 60.0; // Return minutes
+bool PhysicsEngine::loadElevation(const float *heights, int width,
+                                  int height) {
+  if (!heights || width != terrain_.width() || height != terrain_.height())
+    return false;
+  const size_t cells = static_cast<size_t>(width) * height;
+  if (!std::all_of(heights, heights + cells,
+                   [](float h) { return std::isfinite(h); }))
+    return false;
+  elevation_.assign(heights, heights + cells);
+  routes_.clear();
+  return true;
+}
+
+bool PhysicsEngine::setTravelOptions(const TravelOptions &options) {
+  if (!(options.cell_km > 0.0) || !std::isfinite(options.cell_km) ||
+      !(options.uphill_penalty >= 0.0) ||
+      !std::isfinite(options.uphill_penalty) ||
+      !(options.downhill_penalty >= 0.0) ||
+      !std::isfinite(options.downhill_penalty))
+    return false;
+  travel_options_ = options;
+  return true;
+}
+
+void PhysicsEngine::setRouteCacheCapacity(size_t capacity) {
+  routes_.setCapacity(capacity);
+}
+
+RouteSummary PhysicsEngine::route(int startX, int startY, int targetX,
+                                  int targetY) {
+  const int32_t start = terrain_.index(startX, startY);
+  const int32_t target = terrain_.index(targetX, targetY);
+  const bool diagonal = path_options_.diagonal;
+  RouteSummary summary;
+  const bool cached =
+      routes_.find(start, target, diagonal, terrain_.version(), summary);
+  PHYS_STAT(stats_.recordRoute(cached));
+  if (cached)
+    return summary;
+
+  // Guess twice the Chebyshev distance in waypoints; grow once if short
+  const size_t guess =
+      2 * static_cast<size_t>(std::max(std::abs(targetX - startX),
+                                       std::abs(targetY - startY)) +
+                              1);
+  std::vector<int32_t> xy(2 * guess);
+  size_t len = 0;
+  double cost =
+      findPath(startX, startY, targetX, targetY, xy.data(), guess, &len);
+  if (cost >= 0 && len > guess) {
+    xy.resize(2 * len);
+    cost = findPath(startX, startY, targetX, targetY, xy.data(), len, &len);
+  }
+  if (cost >= 0)
+    summary = RouteSummary::fromWaypoints(
+        terrain_, elevation_.empty() ? nullptr : elevation_.data(), xy.data(),
+        len);
+  routes_.insert(start, target, diagonal, terrain_.version(), summary);
+  return summary;
+}
+
+double PhysicsEngine::estimateTerrainTravelTime(int startX, int startY,
+                                                int targetX, int targetY,
+                                                int32_t mode) {
+  if (!terrain_.inBounds(startX, startY) ||
+      !terrain_.inBounds(targetX, targetY))
+    return -1.0;
+  const TransportProfile &profile = transportProfile(mode);
+  if (profile.terrain_multiplier == 0.0) {
+    const double km = travel_options_.cell_km;
+    double dz = 0.0;
+    if (!elevation_.empty()) {
+      const size_t width = static_cast<size_t>(terrain_.width());
+      dz = (static_cast<double>(elevation_[targetY * width + targetX]) -
+            elevation_[startY * width + startX]) /
+           1000.0;
+    }
+    return calculateDistance({startX * km, startY * km, 0.0},
+                             {targetX * km, targetY * km, dz}) *
+           profile.minutes_per_km;
+  }
+
+  const RouteSummary summary = route(startX, startY, targetX, targetY);
+  if (!summary.reachable)
+    return -1.0;
+  return summary.minutes(profile, travel_options_, terrain_.minCost());
 }
 
 bool PhysicsEngine::checkCollision(const Point3D &p1, double r1,
                                    const Point3D &p2, double r2) const {
-  return calculateDistance(p1, p2) <= (r1 + r2);
+  const double reach = r1 + r2;
+  return squaredDistance(p2.x - p1.x, p2.y - p1.y, p2.z - p1.z) <=
+         reach * reach;
+}
+
+void PhysicsEngine::calculateDistanceBatch(const double *x1, const double *y1,
+                                           const double *z1, const double *x2,
+                                           const double *y2, const double *z2,
+                                           size_t count, double *out) const {
+  activeDistanceKernels().distance(x1, y1, z1, x2, y2, z2, count, out);
+}
+
+void PhysicsEngine::checkCollisionBatch(
+    const double *x1, const double *y1, const double *z1, const double *r1,
+    const double *x2, const double *y2, const double *z2, const double *r2,
+    size_t count, uint8_t *out) const {
+  activeDistanceKernels().overlap(x1, y1, z1, r1, x2, y2, z2, r2, count, out);
+}
+
+size_t PhysicsEngine::queryRadius(const Point3D &center, double radius,
+                                  const double *x, const double *y,
+                                  const double *z, size_t count,
+                                  uint32_t *out_ids, size_t capacity) const {
+  const DistanceKernels &kernels = activeDistanceKernels();
+  const size_t found = kernels.within(center.x, center.y, center.z, radius, x,
+                                      y, z, count, nullptr);
+  if (found <= capacity)
+    kernels.within(center.x, center.y, center.z, radius, x, y, z, count,
+                   out_ids);
+  return found;
+}
+
+bool PhysicsEngine::updateEntities(const double *x, const double *y,
+                                   const double *z, const double *radius,
+                                   size_t count) {
+  if (count > UINT32_MAX)
+    return false;
+  broad_phase_.update(x, y, z, radius, count);
+  return true;
+}
+
+size_t PhysicsEngine::findOverlaps(uint32_t *out_pairs, size_t capacity) {
+  return broad_phase_.findPairs(out_pairs, capacity);
+}
+
+void PhysicsEngine::setBroadPhaseCellSize(double size) {
+  broad_phase_.setCellSize(size);
 }
 
 double PhysicsEngine::findShortestPath(int startX, int startY, int targetX,
                                        int targetY) {
-  // Bounds check
-  if (startX < 0 || startX >= GRID_SIZE || startY < 0 || startY >= GRID_SIZE)
-    return -1.0;
+  PHYS_STAT(QueryStatsScope query_stats(stats_, workspace()));
+  const auto field = cachedField(targetX, targetY);
+  PHYS_STAT(stats_.recordField(field != nullptr));
+  if (field) {
+    if (!terrain_.inBounds(startX, startY))
+      return -1.0;
+    const int32_t start = terrain_.index(startX, startY);
+    return field->reachable(start) ? field->dist[start] : -1.0;
+  }
+  return search(startX, startY, targetX, targetY, workspace());
+}
 
-  std::priority_queue<SearchNode, std::vector<SearchNode>,
-                      std::greater<SearchNode>>
-      open_set;
+void PhysicsEngine::findShortestPathBatch(
+    const int32_t *startX, const int32_t *startY, const int32_t *targetX,
+    const int32_t *targetY, size_t count, double *out, WorkerPool &pool) {
+  // ~32 chunks per thread leaves room to rebalance
+  const size_t grain = std::min(PATH_BATCH_MAX_GRAIN,
+                                count / (32 * pool.concurrency()) + 1);
+  pool.parallelFor(count, grain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      out[i] = findShortestPath(startX[i], startY[i], targetX[i], targetY[i]);
+  });
+}
 
-  // Heuristic: Straight line distance ignoring Z axis
-  double initial_h = calculateDistance({(double)startX, (double)startY, 0},
-                                       {(double)targetX, (double)targetY, 0});
-  open_set.push({startX, startY, 0.0, initial_h});
+double PhysicsEngine::findPath(int startX, int startY, int targetX,
+                               int targetY, int32_t *out_xy, size_t capacity,
+                               size_t *out_len) {
+  PathWorkspace &ws = workspace();
+  PHYS_STAT(QueryStatsScope query_stats(stats_, ws));
+  const auto field = cachedField(targetX, targetY);
+  PHYS_STAT(stats_.recordField(field != nullptr));
+  if (field) {
+    *out_len = 0;
+    if (!terrain_.inBounds(startX, startY))
+      return -1.0;
+    const int32_t start = terrain_.index(startX, startY);
+    if (!field->reachable(start))
+      return -1.0;
+    *out_len = field->writePath(terrain_, start, out_xy, capacity);
+    return field->dist[start];
+  }
 
-  std::map<std::pair<int, int>, double> g_scores;
-  g_scores[{startX, startY}] = 0.0;
+  int32_t start, target;
+  const bool valid =
+      resolveEndpoints(startX, startY, targetX, targetY, start, target);
+  if (const PathHierarchy *hierarchy = valid ? activeHierarchy(start)
+                                             : nullptr) {
+    *out_len = 0;
+    std::vector<int32_t> waypoints;
+    const double cost =
+        hierarchy->findPath(terrain_, start, target, ws, &waypoints);
+    if (cost < 0)
+      return cost;
+    *out_len = waypoints.size() / 2;
+    if (*out_len <= capacity)
+      std::copy(waypoints.begin(), waypoints.end(), out_xy);
+    return cost;
+  }
 
-  // 4-Directional movement vectors
-  const int dx[] = {0, 0, 1, -1};
-  const int dy[] = {1, -1, 0, 0};
+  const double cost = search(startX, startY, targetX, targetY, ws);
+  *out_len = cost < 0 ? 0
+                      : writeParentPath(terrain_, ws,
+                                        terrain_.index(targetX, targetY),
+                                        out_xy, capacity);
+  return cost;
+}
 
-  while (!open_set.empty()) {
-    SearchNode current = open_set.top();
-    open_set.pop();
+bool PhysicsEngine::resolveEndpoints(int startX, int startY, int targetX,
+                                     int targetY, int32_t &start,
+                                     int32_t &target) const {
+  // Bounds check
+  if (!terrain_.inBounds(startX, startY) ||
+      !terrain_.inBounds(targetX, targetY))
+    return false;
+  start = terrain_.index(startX, startY);
+  target = terrain_.index(targetX, targetY);
+  return terrain_.passable(target);
+}
 
-    if (current.x == targetX && current.y == targetY) {
-      return g_scores[{current.x, current.y}];
-    }
+const PathHierarchy *PhysicsEngine::activeHierarchy(int32_t start) const {
+  // Legacy queries may start on a wall and step straight off it, possibly
+  // into another cluster; only flat search models that
+  if (path_options_.algorithm != PathAlgorithm::HPA || !hierarchy_ ||
+      !terrain_.passable(start) ||
+      hierarchy_->diagonal() != path_options_.diagonal ||
+      hierarchy_->terrainVersion() != terrain_.version())
+    return nullptr;
+  return hierarchy_.get();
+}
 
-    for (int i = 0; i < 4; i++) {
-      int nextX = current.x + dx[i];
-      int nextY = current.y + dy[i];
-
-      // Validate bounds
-      if (nextX >= 0 && nextX < GRID_SIZE && nextY >= 0 && nextY < GRID_SIZE) {
-        // Validate obstacle (simulated terrain)
-        bool is_obstacle =
-            (nextX >= OBSTACLE_X_MIN && nextX <= OBSTACLE_X_MAX &&
-             nextY >= OBSTACLE_Y_MIN && nextY <= OBSTACLE_Y_MAX);
-
-        if (is_obstacle)
-          continue;
-
-        double new_g_score =
-            g_scores[{current.x, current.y}] + 1.0; // Cost is 1 per step
-
-        auto next_pos = std::make_pair(nextX, nextY);
-        if (g_scores.find(next_pos) == g_scores.end() ||
-            new_g_score < g_scores[next_pos]) {
-          g_scores[next_pos] = new_g_score;
-          double h = calculateDistance({(double)nextX, (double)nextY, 0},
-                                       {(double)targetX, (double)targetY, 0});
-          open_set.push({nextX, nextY, new_g_score, h});
-        }
-      }
-    }
-  }
+double PhysicsEngine::search(int startX, int startY, int targetX, int targetY,
+                             PathWorkspace &ws) const {
+  int32_t start, target;
+  if (!resolveEndpoints(startX, startY, targetX, targetY, start, target))
+    return -1.0;
+  if (const PathHierarchy *hierarchy = activeHierarchy(start))
+    return hierarchy->findPath(terrain_, start, target, ws, nullptr);
+  return gridSearch(terrain_, start, target, path_options_, ws);
+}
 
-  return -1.0; // Unreachable
+bool PhysicsEngine::stats(PhysStats &out) const {
+#ifdef PHYS_ENABLE_STATS
+  out = stats_.snapshot();
+  return true;
+#else
+  out = PhysStats{};
+  return false;
+#endif
 }
 
+void PhysicsEngine::resetStats() { PHYS_STAT(stats_.reset()); }
+
+namespace {
+// Shared engine behind the api_* functions so a loaded terrain persists
+PhysicsEngine &defaultEngine() {
+  static PhysicsEngine engine;
+  return engine;
+}
+} // namespace
+
 // C-API Implementation
 extern "C" {
+PhysicsEngine *phys_create(void) { return new PhysicsEngine(); }
+
+void phys_destroy(PhysicsEngine *engine) { delete engine; }
+
+int phys_load_terrain(PhysicsEngine *engine, const float *costs, int width,
+                      int height) {
+  return engine->loadTerrain(costs, width, height) ? 0 : -1;
+}
+
+int phys_load_terrain_u8(PhysicsEngine *engine, const uint8_t *costs,
+                         int width, int height) {
+  return engine->loadTerrain(costs, width, height) ? 0 : -1;
+}
+
+void phys_calculate_distance_batch(const PhysicsEngine *engine,
+                                   const double *x1, const double *y1,
+                                   const double *z1, const double *x2,
+                                   const double *y2, const double *z2,
+                                   size_t count, double *out) {
+  engine->calculateDistanceBatch(x1, y1, z1, x2, y2, z2, count, out);
+}
+
+void phys_check_collision_batch(const PhysicsEngine *engine, const double *x1,
+                                const double *y1, const double *z1,
+                                const double *r1, const double *x2,
+                                const double *y2, const double *z2,
+                                const double *r2, size_t count, uint8_t *out) {
+  engine->checkCollisionBatch(x1, y1, z1, r1, x2, y2, z2, r2, count, out);
+}
+
+size_t phys_query_radius(const PhysicsEngine *engine, double cx, double cy,
+                         double cz, double radius, const double *x,
+                         const double *y, const double *z, size_t count,
+                         uint32_t *out_ids, size_t capacity) {
+  return engine->queryRadius({cx, cy, cz}, radius, x, y, z, count, out_ids,
+                             capacity);
+}
+
+const char *phys_distance_kernel(void) {
+  return activeDistanceKernels().name;
+}
+
+int phys_update_entities(PhysicsEngine *engine, const double *x,
+                         const double *y, const double *z,
+                         const double *radius, size_t count) {
+  return engine->updateEntities(x, y, z, radius, count) ? 0 : -1;
+}
+
+size_t phys_find_overlaps(PhysicsEngine *engine, uint32_t *out_pairs,
+                          size_t capacity) {
+  return engine->findOverlaps(out_pairs, capacity);
+}
+
+void phys_set_broad_phase_cell_size(PhysicsEngine *engine, double size) {
+  engine->setBroadPhaseCellSize(size);
+}
+
+double phys_estimate_terrain_travel_time(PhysicsEngine *engine, int startX,
+                                         int startY, int targetX,
+                                         int targetY, int32_t mode) {
+  return engine->estimateTerrainTravelTime(startX, startY, targetX, targetY,
+                                           mode);
+}
+
+int phys_load_elevation(PhysicsEngine *engine, const float *heights,
+                        int width, int height) {
+  return engine->loadElevation(heights, width, height) ? 0 : -1;
+}
+
+int phys_set_travel_options(PhysicsEngine *engine, double cellKm,
+                            double uphillPenalty, double downhillPenalty) {
+  return engine->setTravelOptions({cellKm, uphillPenalty, downhillPenalty})
+             ? 0
+             : -1;
+}
+
+void phys_set_route_cache_capacity(PhysicsEngine *engine, size_t capacity) {
+  engine->setRouteCacheCapacity(capacity);
+}
+
+int phys_set_cell_cost(PhysicsEngine *engine, int x, int y, float cost) {
+  return engine->setCellCost(x, y, cost) ? 0 : -1;
+}
+
+int32_t phys_add_obstacle(PhysicsEngine *engine, int minX, int minY, int maxX,
+                          int maxY) {
+  return engine->addObstacle(minX, minY, maxX, maxY);
+}
+
+int phys_remove_obstacle(PhysicsEngine *engine, int32_t id) {
+  return engine->removeObstacle(id) ? 0 : -1;
+}
+
+int32_t phys_track_path(PhysicsEngine *engine, int startX, int startY,
+                        int targetX, int targetY) {
+  return engine->trackPath(startX, startY, targetX, targetY);
+}
+
+double phys_tracked_path(PhysicsEngine *engine, int32_t id, int32_t *out_xy,
+                         size_t capacity, size_t *out_len) {
+  return engine->trackedPath(id, out_xy, capacity, out_len);
+}
+
+int phys_move_tracked_path(PhysicsEngine *engine, int32_t id, int x, int y) {
+  return engine->moveTrackedPath(id, x, y) ? 0 : -1;
+}
+
+int phys_untrack_path(PhysicsEngine *engine, int32_t id) {
+  return engine->untrackPath(id) ? 0 : -1;
+}
+
+int phys_build_hierarchy(PhysicsEngine *engine, int clusterSize) {
+  if (clusterSize <= 0)
+    clusterSize = PathHierarchy::DEFAULT_CLUSTER_SIZE;
+  return engine->buildHierarchy(clusterSize) ? 0 : -1;
+}
+
+int phys_build_distance_field(PhysicsEngine *engine, int targetX,
+                              int targetY) {
+  return engine->buildDistanceField(targetX, targetY) ? 0 : -1;
+}
+
+void phys_set_distance_field_capacity(PhysicsEngine *engine, size_t capacity) {
+  engine->setDistanceFieldCapacity(capacity);
+}
+
+void phys_set_distance_field_max_bytes(PhysicsEngine *engine,
+                                       size_t max_bytes) {
+  engine->setDistanceFieldMaxBytes(max_bytes);
+}
+
+int phys_set_path_options(PhysicsEngine *engine, int32_t algorithm,
+                          int diagonal) {
+  if (algorithm < static_cast<int32_t>(PathAlgorithm::AStar) ||
+      algorithm > static_cast<int32_t>(PathAlgorithm::HPA))
+    return -1;
+  return engine->setPathOptions(
+             {static_cast<PathAlgorithm>(algorithm), diagonal != 0})
+             ? 0
+             : -1;
+}
+
+double phys_estimate_travel_time(const PhysicsEngine *engine, double x1,
+                                 double y1, double z1, double x2, double y2,
+                                 double z2, const char *mode) {
+  return engine->estimateTravelTime({x1, y1, z1}, {x2, y2, z2},
+                                    engine->transportModeId(mode));
+}
+
+double phys_estimate_travel_time_mode(const PhysicsEngine *engine, double x1,
+                                      double y1, double z1, double x2,
+                                      double y2, double z2, int32_t mode) {
+  return engine->estimateTravelTime({x1, y1, z1}, {x2, y2, z2}, mode);
+}
+
+int32_t phys_register_transport_mode(PhysicsEngine *engine, const char *name,
+                                     double speedKmh,
+                                     double terrainMultiplier) {
+  return engine->registerTransportMode(name, speedKmh, terrainMultiplier);
+}
+
+int32_t phys_transport_mode_id(const PhysicsEngine *engine,
+                               const char *name) {
+  return name ? engine->transportModeId(name) : -1;
+}
+
+void phys_estimate_travel_time_batch(const PhysicsEngine *engine,
+                                     const double *x1, const double *y1,
+                                     const double *z1, const double *x2,
+                                     const double *y2, const double *z2,
+                                     const int32_t *modes, size_t count,
+                                     double *out) {
+  engine->estimateTravelTimeBatch(x1, y1, z1, x2, y2, z2, modes, count, out);
+}
+
+double phys_find_shortest_path(PhysicsEngine *engine, int startX, int startY,
+                               int targetX, int targetY) {
+  return engine->findShortestPath(startX, startY, targetX, targetY);
+}
+
+void phys_find_shortest_path_batch(PhysicsEngine *engine,
+                                   const int32_t *startX,
+                                   const int32_t *startY,
+                                   const int32_t *targetX,
+                                   const int32_t *targetY, size_t count,
+                                   double *out) {
+  engine->findShortestPathBatch(startX, startY, targetX, targetY, count, out);
+}
+
+double phys_find_path(PhysicsEngine *engine, int startX, int startY,
+                      int targetX, int targetY, int32_t *out_xy,
+                      size_t capacity, size_t *out_len) {
+  return engine->findPath(startX, startY, targetX, targetY, out_xy, capacity,
+                          out_len);
+}
+
 double api_estimate_travel_time(double x1, double y1, double z1, double x2,
                                 double y2, double z2, const char *mode) {
-  PhysicsEngine engine;
+  PhysicsEngine &engine = defaultEngine();
   return engine.estimateTravelTime({x1, y1, z1}, {x2, y2, z2},
-                                   std::string(mode));
+                                   engine.transportModeId(mode));
+}
+
+double api_estimate_travel_time_mode(double x1, double y1, double z1,
+                                     double x2, double y2, double z2,
+                                     int32_t mode) {
+  return defaultEngine().estimateTravelTime({x1, y1, z1}, {x2, y2, z2}, mode);
+}
+
+int32_t api_register_transport_mode(const char *name, double speedKmh,
+                                    double terrainMultiplier) {
+  return defaultEngine().registerTransportMode(name, speedKmh,
+                                               terrainMultiplier);
+}
+
+void api_estimate_travel_time_batch(const double *x1, const double *y1,
+                                    const double *z1, const double *x2,
+                                    const double *y2, const double *z2,
+                                    const int32_t *modes, size_t count,
+                                    double *out) {
+  defaultEngine().estimateTravelTimeBatch(x1, y1, z1, x2, y2, z2, modes, count,
+                                          out);
 }
 
 double api_find_shortest_path(int startX, int startY, int targetX,
                               int targetY) {
-  PhysicsEngine engine;
-  return engine.findShortestPath(startX, startY, targetX, targetY);
+  return defaultEngine().findShortestPath(startX, startY, targetX, targetY);
+}
+
+void api_find_shortest_path_batch(const int32_t *startX, const int32_t *startY,
+                                  const int32_t *targetX,
+                                  const int32_t *targetY, size_t count,
+                                  double *out) {
+  defaultEngine().findShortestPathBatch(startX, startY, targetX, targetY,
+                                        count, out);
+}
+
+double api_find_path(int startX, int startY, int targetX, int targetY,
+                     int32_t *out_xy, size_t capacity, size_t *out_len) {
+  return defaultEngine().findPath(startX, startY, targetX, targetY, out_xy,
+                                  capacity, out_len);
+}
+
+int api_load_terrain(const float *costs, int width, int height) {
+  return defaultEngine().loadTerrain(costs, width, height) ? 0 : -1;
 }
+
+int api_load_terrain_u8(const uint8_t *costs, int width, int height) {
+  return defaultEngine().loadTerrain(costs, width, height) ? 0 : -1;
+}
+
+double api_estimate_terrain_travel_time(int startX, int startY, int targetX,
+                                        int targetY, int32_t mode) {
+  return defaultEngine().estimateTerrainTravelTime(startX, startY, targetX,
+                                                   targetY, mode);
+}
+
+int api_load_elevation(const float *heights, int width, int height) {
+  return defaultEngine().loadElevation(heights, width, height) ? 0 : -1;
+}
+
+int phys_get_stats(const PhysicsEngine *engine, PhysStats *out) {
+  return engine->stats(*out) ? 0 : -1;
+}
+
+void phys_reset_stats(PhysicsEngine *engine) { engine->resetStats(); }
+
+int api_get_stats(PhysStats *out) {
+  return defaultEngine().stats(*out) ? 0 : -1;
+}
+
+void api_reset_stats(void) { defaultEngine().resetStats(); }
 }
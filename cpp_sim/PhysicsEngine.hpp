@@ -1,8 +1,26 @@
 #ifndef PHYSICS_ENGINE_HPP
 #define PHYSICS_ENGINE_HPP
 
+#include "BroadPhase.hpp"
+#include "DistanceField.hpp"
+#include "DistanceKernels.hpp"
+#include "EngineStats.hpp"
+#include "GridSearch.hpp"
+#include "IncrementalPath.hpp"
+#include "PathHierarchy.hpp"
+#include "PathWorkspace.hpp"
+#include "TerrainGrid.hpp"
+#include "TerrainTravel.hpp"
+#include "TransportModes.hpp"
+#include "WorkerPool.hpp"
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -12,31 +30,21 @@ struct Point3D {
   double x, y, z;
 };
 
-/**
- * @brief Represents a node in the grid for pathfinding.
- */
-struct SearchNode {
-  int x, y;
-  double g_score; // Cost from start
-  double h_score; // Heuristic to goal
-
-  // Priority queue inversion: lowest cost has highest priority
-  bool operator>(const SearchNode &other) const {
-    return (g_score + h_score) > (other.g_score + other.h_score);
-  }
-};
-
 /**
  * @class PhysicsEngine
  * @brief Core engine for spatial calculations, collision detection, and
  * pathfinding.
  *
  * Handles simulation of entity movement and physical interactions within the
- * narrative world.
+ * narrative world. Const queries and path searches are safe to issue from
+ * several threads at once; each thread searches in its own PathWorkspace.
+ * Loading terrain must not race with in-flight queries.
  */
 class PhysicsEngine {
 public:
-  PhysicsEngine() = default;
+  PhysicsEngine();
+  PhysicsEngine(const PhysicsEngine &) = delete;
+  PhysicsEngine &operator=(const PhysicsEngine &) = delete;
 
   /**
    * @brief Calculates the Euclidean distance between two 3D points.
@@ -54,18 +62,343 @@ public:
   double estimateTravelTime(const Point3D &p1, const Point3D &p2,
                             const std::string &mode) const;
 
+  /**
+   * @brief Travel time for an integer mode id; never allocates.
+   *
+   * Built-in modes use their compile-time speed; registered modes look up
+   * their profile. Unknown ids fall back to walking.
+   */
+  double estimateTravelTime(const Point3D &p1, const Point3D &p2,
+                            int32_t mode) const;
+  double estimateTravelTime(const Point3D &p1, const Point3D &p2,
+                            TransportMode mode) const {
+    return estimateTravelTime(p1, p2, static_cast<int32_t>(mode));
+  }
+
+  /**
+   * @brief Id for a built-in or registered mode name, or -1 if unknown.
+   *
+   * Callers resolve names once and pass ids to the integer APIs afterwards.
+   */
+  int32_t transportModeId(const char *name) const;
+
+  /**
+   * @brief Adds a custom mode (mount, ship, teleport...) or updates an
+   * existing custom one with the same name.
+   *
+   * @param terrain_multiplier Share of terrain cost the mode pays in
+   * terrain-aware estimates (0 ignores terrain)
+   * @return The mode's id, or -1 for a built-in name, an empty name, a
+   * non-positive speed or a negative multiplier. Must not race with queries.
+   */
+  int32_t registerTransportMode(const char *name, double speed_kmh,
+                                double terrain_multiplier);
+
+  /** @brief Profile for @p mode, resolving unknown ids to walking. */
+  const TransportProfile &transportProfile(int32_t mode) const {
+    const size_t index = static_cast<uint32_t>(mode);
+    return transport_profiles_[index < transport_profiles_.size() ? index : 0];
+  }
+
+  /**
+   * @brief Estimates travel times for N (origin, destination, mode) tuples.
+   *
+   * Coordinates are passed as structure-of-arrays so numpy buffers can be
+   * handed over without copying. Writes minutes into out[0..count).
+   *
+   * @param modes Mode ids (built-in or registered), one per tuple
+   */
+  void estimateTravelTimeBatch(const double *x1, const double *y1,
+                               const double *z1, const double *x2,
+                               const double *y2, const double *z2,
+                               const int32_t *modes, size_t count,
+                               double *out) const;
+
+  /**
+   * @brief Travel time in minutes along the terrain route between two cells.
+   *
+   * The route is the one findPath returns. Each step costs its length times
+   * the mode's share of the entered cell's cost, plus slope penalties from
+   * the elevation map (see TravelOptions and RouteSummary::minutes). Modes
+   * that ignore terrain (multiplier 0) fly straight, walls included. Route
+   * totals are cached per endpoint pair, so repeated queries skip the
+   * search.
+   * @return Minutes, or -1.0 if out of bounds or unreachable.
+   */
+  double estimateTerrainTravelTime(int startX, int startY, int targetX,
+                                   int targetY, int32_t mode);
+
+  /**
+   * @brief Loads per-cell heights in metres (heights[y * width + x]).
+   *
+   * Dimensions must match the terrain; loading terrain drops the map.
+   * @return false on mismatched dimensions or non-finite heights.
+   */
+  bool loadElevation(const float *heights, int width, int height);
+
+  /** @brief false (options unchanged) for a non-positive or non-finite cell
+   *  size or a negative penalty. */
+  bool setTravelOptions(const TravelOptions &options);
+  const TravelOptions &travelOptions() const { return travel_options_; }
+
+  /** @brief Maximum number of cached routes for terrain travel times. */
+  void setRouteCacheCapacity(size_t capacity);
+
   /**
    * @brief Checks for collision between two spherical objects.
+   *
+   * Compares squared distances, so no square root is taken.
    */
   bool checkCollision(const Point3D &p1, double r1, const Point3D &p2,
                       double r2) const;
 
   /**
-   * @brief Finds the shortest path on a 100x100 grid using A* algorithm.
+   * @brief Distances for N point pairs (SoA), using the CPU's SIMD kernel.
+   */
+  void calculateDistanceBatch(const double *x1, const double *y1,
+                              const double *z1, const double *x2,
+                              const double *y2, const double *z2,
+                              size_t count, double *out) const;
+
+  /**
+   * @brief checkCollision for N sphere pairs; out[i] is 1 on contact.
+   */
+  void checkCollisionBatch(const double *x1, const double *y1,
+                           const double *z1, const double *r1,
+                           const double *x2, const double *y2,
+                           const double *z2, const double *r2, size_t count,
+                           uint8_t *out) const;
+
+  /**
+   * @brief Indices of the points within @p radius of @p center.
+   *
+   * Writes ascending indices into out_ids unless there are more than
+   * @p capacity, in which case nothing is written.
+   * @return Number of points in range.
+   */
+  size_t queryRadius(const Point3D &center, double radius, const double *x,
+                     const double *y, const double *z, size_t count,
+                     uint32_t *out_ids, size_t capacity) const;
+
+  /**
+   * @brief Re-bins the entity spheres used by findOverlaps.
+   *
+   * Structure-of-arrays input; entity ids are indices into the arrays.
+   * Calling this every tick with the same count is incremental. Must not
+   * race with other broad-phase calls on this engine.
+   * @return false if @p count does not fit 32-bit entity ids.
+   */
+  bool updateEntities(const double *x, const double *y, const double *z,
+                      const double *radius, size_t count);
+
+  /**
+   * @brief All overlapping entity pairs from the last updateEntities.
+   *
+   * Writes packed (a, b) uint32 id pairs with a < b. If there are more than
+   * @p capacity pairs nothing is written, so the caller can retry.
+   * @return Number of overlapping pairs.
+   */
+  size_t findOverlaps(uint32_t *out_pairs, size_t capacity);
+
+  /** @brief Minimum broad-phase cell edge; <= 0 sizes cells by radius. */
+  void setBroadPhaseCellSize(double size);
+
+  /**
+   * @brief Finds the shortest path on the terrain grid using A* algorithm.
    *
+   * Each step costs the terrain cost of the cell being entered.
    * @return Total path cost, or -1.0 if unreachable.
    */
   double findShortestPath(int startX, int startY, int targetX, int targetY);
+
+  /**
+   * @brief findShortestPath for N independent (start, target) queries.
+   *
+   * Queries are spread over @p pool; each pool thread searches in its own
+   * workspace. Writes costs (-1.0 if unreachable) into out[0..count).
+   */
+  void findShortestPathBatch(const int32_t *startX, const int32_t *startY,
+                             const int32_t *targetX, const int32_t *targetY,
+                             size_t count, double *out,
+                             WorkerPool &pool = WorkerPool::shared());
+
+  /**
+   * @brief Like findShortestPath, but also returns the waypoints.
+   *
+   * Writes the path (start and target included) as packed (x, y) int32
+   * pairs into out_xy. If the path has more than @p capacity waypoints,
+   * nothing is written and *out_len reports the required count, so the
+   * caller can retry with a larger buffer. *out_len is 0 if unreachable.
+   *
+   * @param capacity Buffer size in waypoints (out_xy holds 2 * capacity ints)
+   * @return Total path cost, or -1.0 if unreachable.
+   */
+  double findPath(int startX, int startY, int targetX, int targetY,
+                  int32_t *out_xy, size_t capacity, size_t *out_len);
+
+  /**
+   * @brief Selects the search algorithm and movement model.
+   *
+   * Applies to subsequent queries; must not race with in-flight queries.
+   * Distance fields are kept per movement model.
+   * @return false, leaving the options unchanged, for JPS without diagonal
+   * movement: its jumps are defined for 8-connected grids only.
+   */
+  bool setPathOptions(const PathOptions &options);
+  const PathOptions &pathOptions() const { return path_options_; }
+
+  /**
+   * @brief Precomputes and caches the distance field towards a target.
+   *
+   * Afterwards findShortestPath/findPath to that target are answered from the
+   * field (O(1) cost, gradient descent for waypoints) until the field is
+   * evicted or the terrain changes. Safe to call while other threads query.
+   * A field holds 8 bytes per padded cell (134 MB on a 4096^2 map).
+   * @return false if the target is out of bounds or impassable, or the field
+   * alone exceeds the cache's byte limit.
+   */
+  bool buildDistanceField(int targetX, int targetY);
+
+  /** @brief Maximum number of cached fields (LRU eviction beyond that). */
+  void setDistanceFieldCapacity(size_t capacity);
+  /** @brief Maximum bytes of cached fields, 256 MiB by default (LRU). */
+  void setDistanceFieldMaxBytes(size_t max_bytes);
+
+  /**
+   * @brief Replaces the terrain used by every subsequent path query.
+   *
+   * @return false if the map is invalid; the current terrain is kept.
+   */
+  bool loadTerrain(const float *costs, int width, int height);
+  bool loadTerrain(const uint8_t *costs, int width, int height);
+
+  /**
+   * @brief Changes one terrain cell (non-positive or non-finite = wall).
+   *
+   * Drops cached distance fields, rebuilds only the affected clusters of
+   * the hierarchy and marks the cell for tracked routes. Must not race with
+   * in-flight queries.
+   * @return false if (x, y) is out of bounds.
+   */
+  bool setCellCost(int x, int y, float cost);
+
+  /**
+   * @brief Blocks the cells [minX, maxX] x [minY, maxY], clipped to the map,
+   * until removeObstacle: a collapsed bridge, a barricade, a locked gate.
+   *
+   * Obstacles lie on top of cell costs, which return once no obstacle covers
+   * a cell. Adding or removing one has the same effect as editing its cells
+   * with setCellCost, at the cost of one hierarchy update. The demo map's
+   * mountain range is obstacle 0. Must not race with in-flight queries.
+   * @return The obstacle's id, or -1 if the rectangle misses the map.
+   */
+  int32_t addObstacle(int minX, int minY, int maxX, int maxY);
+  /** @brief false for an unknown id. */
+  bool removeObstacle(int32_t id);
+
+  /**
+   * @brief Starts a route the engine keeps shortest across terrain changes.
+   *
+   * Unlike findPath, repeated queries reuse the previous search (see
+   * IncrementalPath): after an edit only routes whose search reached the
+   * changed cells do any work, and only as much as the change affects
+   * them. Uses the current diagonal option for its whole life.
+   * @return The route's id, or -1 if an endpoint is out of bounds.
+   */
+  int32_t trackPath(int startX, int startY, int targetX, int targetY);
+
+  /**
+   * @brief Cost and waypoints of a tracked route, repaired as needed.
+   *
+   * Same buffer contract as findPath. Tracked-route calls may come from
+   * several threads; they are serialized.
+   * @return Total path cost, or -1.0 if unreachable or the id is unknown.
+   */
+  double trackedPath(int32_t id, int32_t *out_xy, size_t capacity,
+                     size_t *out_len);
+
+  /**
+   * @brief Moves a tracked route's start, for an agent walking it.
+   *
+   * The search runs from the target, so this keeps all of it.
+   * @return false for an unknown id or an out-of-bounds cell.
+   */
+  bool moveTrackedPath(int32_t id, int x, int y);
+  bool untrackPath(int32_t id);
+
+  /**
+   * @brief Builds the HPA* abstraction used when PathAlgorithm::HPA is set.
+   *
+   * Built for the current movement model; changing the model or loading a
+   * new map disables it until rebuilt. Must not race with queries.
+   * @return false if clusterSize < 2.
+   */
+  bool buildHierarchy(int clusterSize = PathHierarchy::DEFAULT_CLUSTER_SIZE);
+
+  const TerrainGrid &terrain() const { return terrain_; }
+
+  /**
+   * @brief Copies the hot-path counters into @p out.
+   *
+   * @return false (and zeroes @p out) unless built with PHYS_ENABLE_STATS.
+   */
+  bool stats(PhysStats &out) const;
+  void resetStats();
+
+private:
+  /**
+   * @brief This thread's search workspace for this engine.
+   *
+   * Lock-free after the first call on a thread: a thread-local cache maps
+   * engine ids to workspaces, which the engine owns and frees on destruction.
+   */
+  PathWorkspace &workspace() const;
+
+  /** @brief Padded endpoint indices; false if no path can exist. */
+  bool resolveEndpoints(int startX, int startY, int targetX, int targetY,
+                        int32_t &start, int32_t &target) const;
+
+  /** @brief The hierarchy if HPA is selected, up to date and usable from
+   *  @p start. */
+  const PathHierarchy *activeHierarchy(int32_t start) const;
+
+  /** @brief Bounds-checked search with the engine's path options. */
+  double search(int startX, int startY, int targetX, int targetY,
+                PathWorkspace &ws) const;
+
+  /** @brief Cached field for an in-bounds target, or nullptr. */
+  std::shared_ptr<const DistanceField> cachedField(int targetX,
+                                                   int targetY) const;
+
+  /** @brief Cached or freshly searched route totals between two cells. */
+  RouteSummary route(int startX, int startY, int targetX, int targetY);
+
+  /** @brief Propagates a change of @p changed to derived state. */
+  void terrainChanged(const GridRegion &changed);
+
+  const uint64_t id_; // Never reused, so stale thread-local entries can't alias
+  TerrainGrid terrain_;
+  PathOptions path_options_;
+  DistanceFieldCache distance_fields_;
+  std::unique_ptr<PathHierarchy> hierarchy_;
+  BroadPhase broad_phase_;
+  std::vector<float> elevation_; // Unpadded, empty for flat ground
+  TravelOptions travel_options_;
+  RouteCache routes_;
+
+  mutable std::mutex tracked_mutex_;
+  std::unordered_map<int32_t, std::unique_ptr<IncrementalPath>> tracked_;
+  int32_t next_tracked_ = 0;
+
+  // Built-in modes first, then registered ones in id order
+  std::vector<TransportProfile> transport_profiles_;
+  std::vector<std::string> custom_mode_names_;
+
+  PHYS_STAT(mutable EngineStats stats_;)
+
+  mutable std::mutex workspaces_mutex_;
+  mutable std::unordered_map<std::thread::id, std::unique_ptr<PathWorkspace>>
+      workspaces_;
 };
 
 // C-compatible interface for Python/Ctypes binding
@@ -73,7 +406,179 @@ extern "C" {
 double api_estimate_travel_time(double x1, double y1, double z1, double x2,
                                 double y2, double z2, const char *mode);
 
+// Integer-mode variant: a TransportMode or registered id, no string handling.
+double api_estimate_travel_time_mode(double x1, double y1, double z1,
+                                     double x2, double y2, double z2,
+                                     int32_t mode);
+
+// Custom modes on the shared engine; see phys_register_transport_mode.
+int32_t api_register_transport_mode(const char *name, double speedKmh,
+                                    double terrainMultiplier);
+
+void api_estimate_travel_time_batch(const double *x1, const double *y1,
+                                    const double *z1, const double *x2,
+                                    const double *y2, const double *z2,
+                                    const int32_t *modes, size_t count,
+                                    double *out);
+
 double api_find_shortest_path(int startX, int startY, int targetX, int targetY);
+
+// N path costs from int32 coordinate arrays into out[0..count), computed in
+// parallel on libphys's worker pool.
+void api_find_shortest_path_batch(const int32_t *startX, const int32_t *startY,
+                                  const int32_t *targetX,
+                                  const int32_t *targetY, size_t count,
+                                  double *out);
+
+// Path cost plus waypoints as packed (x, y) int32 pairs; see
+// PhysicsEngine::findPath for the buffer contract.
+double api_find_path(int startX, int startY, int targetX, int targetY,
+                     int32_t *out_xy, size_t capacity, size_t *out_len);
+
+// Handle-based API: engines keep terrain and search workspaces warm across
+// calls. A handle may be used from several threads concurrently, except that
+// phys_load_terrain* must not race with queries on the same handle.
+PhysicsEngine *phys_create(void);
+void phys_destroy(PhysicsEngine *engine);
+
+int phys_load_terrain(PhysicsEngine *engine, const float *costs, int width,
+                      int height);
+int phys_load_terrain_u8(PhysicsEngine *engine, const uint8_t *costs,
+                         int width, int height);
+
+double phys_estimate_travel_time(const PhysicsEngine *engine, double x1,
+                                 double y1, double z1, double x2, double y2,
+                                 double z2, const char *mode);
+
+double phys_estimate_travel_time_mode(const PhysicsEngine *engine, double x1,
+                                      double y1, double z1, double x2,
+                                      double y2, double z2, int32_t mode);
+
+void phys_estimate_travel_time_batch(const PhysicsEngine *engine,
+                                     const double *x1, const double *y1,
+                                     const double *z1, const double *x2,
+                                     const double *y2, const double *z2,
+                                     const int32_t *modes, size_t count,
+                                     double *out);
+
+double phys_find_shortest_path(PhysicsEngine *engine, int startX, int startY,
+                               int targetX, int targetY);
+
+void phys_find_shortest_path_batch(PhysicsEngine *engine,
+                                   const int32_t *startX,
+                                   const int32_t *startY,
+                                   const int32_t *targetX,
+                                   const int32_t *targetY, size_t count,
+                                   double *out);
+
+double phys_find_path(PhysicsEngine *engine, int startX, int startY,
+                      int targetX, int targetY, int32_t *out_xy,
+                      size_t capacity, size_t *out_len);
+
+// SIMD distance kernels over SoA arrays, dispatched on the CPU at first use.
+// phys_query_radius returns the number of points in range and writes their
+// indices only if they fit. phys_distance_kernel names the kernel in use
+// ("avx512", "avx2", "neon" or "scalar").
+void phys_calculate_distance_batch(const PhysicsEngine *engine,
+                                   const double *x1, const double *y1,
+                                   const double *z1, const double *x2,
+                                   const double *y2, const double *z2,
+                                   size_t count, double *out);
+void phys_check_collision_batch(const PhysicsEngine *engine, const double *x1,
+                                const double *y1, const double *z1,
+                                const double *r1, const double *x2,
+                                const double *y2, const double *z2,
+                                const double *r2, size_t count, uint8_t *out);
+size_t phys_query_radius(const PhysicsEngine *engine, double cx, double cy,
+                         double cz, double radius, const double *x,
+                         const double *y, const double *z, size_t count,
+                         uint32_t *out_ids, size_t capacity);
+const char *phys_distance_kernel(void);
+
+// Terrain-aware travel time between two cells; returns minutes, or -1 if an
+// endpoint is out of bounds or unreachable. Elevation is a row-major float
+// map in metres matching the terrain. Set options return 0 on success, -1 on
+// invalid arguments; none of the setters may race with queries.
+double phys_estimate_terrain_travel_time(PhysicsEngine *engine, int startX,
+                                         int startY, int targetX,
+                                         int targetY, int32_t mode);
+int phys_load_elevation(PhysicsEngine *engine, const float *heights,
+                        int width, int height);
+int phys_set_travel_options(PhysicsEngine *engine, double cellKm,
+                            double uphillPenalty, double downhillPenalty);
+void phys_set_route_cache_capacity(PhysicsEngine *engine, size_t capacity);
+
+// Custom transport modes. Register returns the new mode's id (reused when a
+// custom name is registered again) or -1 on invalid arguments; it must not
+// race with queries. phys_transport_mode_id resolves a name, -1 if unknown.
+int32_t phys_register_transport_mode(PhysicsEngine *engine, const char *name,
+                                     double speedKmh,
+                                     double terrainMultiplier);
+int32_t phys_transport_mode_id(const PhysicsEngine *engine, const char *name);
+
+// Collision broad phase over many spheres. phys_update_entities takes
+// structure-of-arrays positions and radii (returns -1 if count exceeds the
+// 32-bit id range); phys_find_overlaps writes packed (a, b) id pairs with
+// a < b and returns the pair count, writing nothing if capacity is short.
+int phys_update_entities(PhysicsEngine *engine, const double *x,
+                         const double *y, const double *z,
+                         const double *radius, size_t count);
+size_t phys_find_overlaps(PhysicsEngine *engine, uint32_t *out_pairs,
+                          size_t capacity);
+void phys_set_broad_phase_cell_size(PhysicsEngine *engine, double size);
+
+// Terrain edits and the HPA* abstraction; return 0 on success, -1 on invalid
+// arguments. Neither may race with queries on the same handle.
+int phys_set_cell_cost(PhysicsEngine *engine, int x, int y, float cost);
+int phys_build_hierarchy(PhysicsEngine *engine, int clusterSize);
+
+// Dynamic obstacles: add returns the new obstacle's id, -1 if the inclusive
+// rectangle misses the map; remove returns 0, or -1 for an unknown id. Same
+// threading rule as phys_set_cell_cost.
+int32_t phys_add_obstacle(PhysicsEngine *engine, int minX, int minY, int maxX,
+                          int maxY);
+int phys_remove_obstacle(PhysicsEngine *engine, int32_t id);
+
+// Tracked routes, repaired incrementally across terrain edits. Track returns
+// the route's id, -1 if an endpoint is out of bounds; phys_tracked_path has
+// the buffer contract of phys_find_path.
+int32_t phys_track_path(PhysicsEngine *engine, int startX, int startY,
+                        int targetX, int targetY);
+double phys_tracked_path(PhysicsEngine *engine, int32_t id, int32_t *out_xy,
+                         size_t capacity, size_t *out_len);
+int phys_move_tracked_path(PhysicsEngine *engine, int32_t id, int x, int y);
+int phys_untrack_path(PhysicsEngine *engine, int32_t id);
+
+// Distance fields for hot destinations. Return 0 on success, -1 if the target
+// is out of bounds or impassable, or its field exceeds the byte limit.
+int phys_build_distance_field(PhysicsEngine *engine, int targetX,
+                              int targetY);
+void phys_set_distance_field_capacity(PhysicsEngine *engine, size_t capacity);
+void phys_set_distance_field_max_bytes(PhysicsEngine *engine,
+                                       size_t max_bytes);
+
+// algorithm is a PathAlgorithm id (0 = A*, 1 = JPS, 2 = HPA*); diagonal != 0
+// enables 8-connected movement. Returns -1 for an unknown algorithm, or for
+// JPS without diagonal movement.
+int phys_set_path_options(PhysicsEngine *engine, int32_t algorithm,
+                          int diagonal);
+
+// Terrain loading for the shared engine behind the api_* functions. Must not
+// race with in-flight path queries. Return 0 on success, -1 on invalid input.
+int api_load_terrain(const float *costs, int width, int height);
+int api_load_terrain_u8(const uint8_t *costs, int width, int height);
+
+// Terrain-aware travel time and elevation on the shared engine.
+double api_estimate_terrain_travel_time(int startX, int startY, int targetX,
+                                        int targetY, int32_t mode);
+int api_load_elevation(const float *heights, int width, int height);
+
+// Hot-path counters (see PhysStats). Get returns 0, or -1 with a zeroed
+// struct when libphys was built without PHYS_ENABLE_STATS.
+int phys_get_stats(const PhysicsEngine *engine, PhysStats *out);
+void phys_reset_stats(PhysicsEngine *engine);
+int api_get_stats(PhysStats *out);
+void api_reset_stats(void);
 }
 
 #endif // PHYSICS_ENGINE_HPP
@@ -0,0 +1,173 @@
+#include "TerrainGrid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+constexpr int DEFAULT_GRID_SIZE = 100;
+
+// Obstacle definition (Mountain range simulation)
+constexpr int OBSTACLE_X_MIN = 50;
+constexpr int OBSTACLE_X_MAX = 60;
+constexpr int OBSTACLE_Y_MIN = 50;
+constexpr int OBSTACLE_Y_MAX = 60;
+
+// Padded indices are int32; leave room for neighbour offsets
+constexpr int64_t MAX_PADDED_CELLS = INT32_MAX / 2;
+
+inline float toCellCost(float cost) {
+  return (std::isfinite(cost) && cost > 0.0f) ? cost : TerrainGrid::BLOCKED;
+}
+
+inline float toCellCost(uint8_t cost) {
+  return cost == 0 ? TerrainGrid::BLOCKED : static_cast<float>(cost);
+}
+} // namespace
+
+TerrainGrid::CellBuffer TerrainGrid::allocate(size_t cells) {
+  // Round up so the buffer always ends on a cache-line boundary
+  size_t bytes = cells * sizeof(float);
+  bytes = (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  return CellBuffer(static_cast<float *>(
+      ::operator new(bytes, std::align_val_t{ALIGNMENT})));
+}
+
+TerrainGrid::TerrainGrid(const TerrainGrid &other)
+    : width_(other.width_), height_(other.height_), stride_(other.stride_),
+      min_cost_(other.min_cost_), uniform_cost_(other.uniform_cost_),
+      version_(other.version_), obstacles_(other.obstacles_),
+      covered_(other.covered_), next_obstacle_(other.next_obstacle_) {
+  if (other.cells_) {
+    cells_ = allocate(other.paddedSize());
+    std::memcpy(cells_.get(), other.cells_.get(),
+                other.paddedSize() * sizeof(float));
+  }
+}
+
+TerrainGrid &TerrainGrid::operator=(const TerrainGrid &other) {
+  if (this != &other)
+    *this = TerrainGrid(other);
+  return *this;
+}
+
+TerrainGrid TerrainGrid::makeDefault() {
+  std::vector<float> costs(DEFAULT_GRID_SIZE * DEFAULT_GRID_SIZE, 1.0f);
+  TerrainGrid grid;
+  grid.load(costs.data(), DEFAULT_GRID_SIZE, DEFAULT_GRID_SIZE);
+  grid.addObstacle({OBSTACLE_X_MIN, OBSTACLE_Y_MIN, OBSTACLE_X_MAX + 1,
+                    OBSTACLE_Y_MAX + 1});
+  return grid;
+}
+
+bool TerrainGrid::load(const float *costs, int width, int height) {
+  return loadImpl(costs, width, height);
+}
+
+bool TerrainGrid::load(const uint8_t *costs, int width, int height) {
+  return loadImpl(costs, width, height);
+}
+
+bool TerrainGrid::setCost(int x, int y, float cost) {
+  if (!inBounds(x, y))
+    return false;
+  const float cell = toCellCost(cost);
+  const int32_t idx = index(x, y);
+  const auto covered = covered_.find(idx);
+  if (covered != covered_.end())
+    covered->second.cost = cell;
+  else
+    cells_[idx] = cell;
+  noteCost(cell);
+  version_++;
+  return true;
+}
+
+void TerrainGrid::noteCost(float cell) {
+  if (cell == BLOCKED)
+    return;
+  // Raising a cost can leave min_cost_ low; that keeps the heuristic
+  // admissible, and uniformity is only ever revoked, never re-detected.
+  if (cell != min_cost_)
+    uniform_cost_ = false;
+  min_cost_ = std::min(min_cost_, cell);
+}
+
+int32_t TerrainGrid::addObstacle(GridRegion region) {
+  region = {std::max(region.x0, 0), std::max(region.y0, 0),
+            std::min(region.x1, width_), std::min(region.y1, height_)};
+  if (region.empty())
+    return -1;
+
+  for (int y = region.y0; y < region.y1; y++) {
+    for (int x = region.x0; x < region.x1; x++) {
+      const int32_t idx = index(x, y);
+      covered_.try_emplace(idx, Covered{cells_[idx], 0}).first->second.count++;
+      cells_[idx] = BLOCKED;
+    }
+  }
+  const int32_t id = next_obstacle_++;
+  obstacles_.emplace(id, region);
+  version_++;
+  return id;
+}
+
+bool TerrainGrid::removeObstacle(int32_t id, GridRegion *cleared) {
+  const auto obstacle = obstacles_.find(id);
+  if (obstacle == obstacles_.end())
+    return false;
+  const GridRegion region = obstacle->second;
+  obstacles_.erase(obstacle);
+
+  for (int y = region.y0; y < region.y1; y++) {
+    for (int x = region.x0; x < region.x1; x++) {
+      const auto cell = covered_.find(index(x, y));
+      if (--cell->second.count == 0) {
+        cells_[cell->first] = cell->second.cost;
+        covered_.erase(cell);
+      }
+    }
+  }
+  if (cleared)
+    *cleared = region;
+  version_++;
+  return true;
+}
+
+template <typename T>
+bool TerrainGrid::loadImpl(const T *costs, int width, int height) {
+  if (!costs || width <= 0 || height <= 0)
+    return false;
+  const int64_t padded = (int64_t(width) + 2) * (int64_t(height) + 2);
+  if (padded > MAX_PADDED_CELLS)
+    return false;
+
+  const int32_t stride = width + 2;
+  CellBuffer cells = allocate(static_cast<size_t>(padded));
+  float min_cost = BLOCKED;
+  float max_cost = 0.0f;
+
+  // Border rows/columns stay BLOCKED so neighbour lookups need no bounds test
+  std::fill(cells.get(), cells.get() + padded, BLOCKED);
+  for (int y = 0; y < height; y++) {
+    const T *src = costs + static_cast<size_t>(y) * width;
+    float *dst = cells.get() + static_cast<size_t>(y + 1) * stride + 1;
+    for (int x = 0; x < width; x++) {
+      dst[x] = toCellCost(src[x]);
+      min_cost = std::min(min_cost, dst[x]);
+      if (dst[x] != BLOCKED)
+        max_cost = std::max(max_cost, dst[x]);
+    }
+  }
+
+  cells_ = std::move(cells);
+  width_ = width;
+  height_ = height;
+  stride_ = stride;
+  min_cost_ = (min_cost == BLOCKED) ? 1.0f : min_cost;
+  uniform_cost_ = (min_cost == BLOCKED) || min_cost == max_cost;
+  obstacles_.clear();
+  covered_.clear();
+  version_++;
+  return true;
+}
@@ -0,0 +1,157 @@
+#ifndef TERRAIN_GRID_HPP
+#define TERRAIN_GRID_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <unordered_map>
+
+/**
+ * @brief Half-open rectangle of cells [x0, x1) x [y0, y1).
+ */
+struct GridRegion {
+  int x0, y0, x1, y1;
+
+  bool contains(int x, int y) const {
+    return x >= x0 && x < x1 && y >= y0 && y < y1;
+  }
+  bool empty() const { return x0 >= x1 || y0 >= y1; }
+};
+
+/**
+ * @class TerrainGrid
+ * @brief Flat, row-major per-cell movement cost map used by pathfinding.
+ *
+ * Cells hold the cost of stepping *into* them. Impassable cells hold
+ * TerrainGrid::BLOCKED. The array is padded with a one-cell BLOCKED border, so
+ * neighbour expansion never needs a bounds check: passability is a single
+ * indexed load.
+ *
+ * Obstacles are BLOCKED rectangles laid over the costs at run time. Cells
+ * under one keep their own cost aside and get it back when the last
+ * obstacle covering them is removed.
+ */
+class TerrainGrid {
+public:
+  static constexpr float BLOCKED = std::numeric_limits<float>::infinity();
+  static constexpr size_t ALIGNMENT = 64; // One cache line
+
+  TerrainGrid() = default;
+  TerrainGrid(const TerrainGrid &other);
+  TerrainGrid &operator=(const TerrainGrid &other);
+  TerrainGrid(TerrainGrid &&) noexcept = default;
+  TerrainGrid &operator=(TerrainGrid &&) noexcept = default;
+
+  /**
+   * @brief Built-in 100x100 demo map with a central mountain range.
+   *
+   * Used until a real map is loaded; matches the original hard-coded world.
+   * The mountain range is obstacle 0, so it can be lifted.
+   */
+  static TerrainGrid makeDefault();
+
+  /**
+   * @brief Loads a width x height row-major cost map (costs[y * width + x]).
+   *
+   * Non-finite or non-positive costs mark a cell as impassable. Obstacles
+   * are dropped with the old map.
+   * @return false (and leaves the grid untouched) on invalid dimensions.
+   */
+  bool load(const float *costs, int width, int height);
+
+  /**
+   * @brief Loads a compact byte cost map; 0 marks a cell as impassable.
+   */
+  bool load(const uint8_t *costs, int width, int height);
+
+  /**
+   * @brief Changes one cell's cost in place (same rules as load()).
+   *
+   * Under an obstacle the cell stays blocked and the cost applies once the
+   * obstacle is removed.
+   * @return false if (x, y) is out of bounds.
+   */
+  bool setCost(int x, int y, float cost);
+
+  /**
+   * @brief Blocks @p region, clipped to the map, until removeObstacle.
+   *
+   * Obstacles may overlap each other and walls.
+   * @return The obstacle's id (never reused), or -1 if the region misses the
+   * map.
+   */
+  int32_t addObstacle(GridRegion region);
+
+  /**
+   * @brief Lifts an obstacle; cells no other obstacle covers get their cost
+   * back.
+   *
+   * @param cleared If non-null, receives the obstacle's clipped region
+   * @return false for an unknown id.
+   */
+  bool removeObstacle(int32_t id, GridRegion *cleared);
+
+  size_t obstacleCount() const { return obstacles_.size(); }
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  /** @brief Row pitch of the padded array, in cells. */
+  int32_t stride() const { return stride_; }
+  /** @brief Number of cells in the padded array (valid index range). */
+  size_t paddedSize() const {
+    return static_cast<size_t>(stride_) * (height_ + 2);
+  }
+  /** @brief Lowest passable cell cost; scales the admissible heuristic. */
+  float minCost() const { return min_cost_; }
+  /** @brief True if every passable cell costs minCost() (enables JPS). */
+  bool uniformCost() const { return uniform_cost_; }
+  /** @brief Bumped on every change, so derived caches can detect staleness. */
+  uint64_t version() const { return version_; }
+
+  bool inBounds(int x, int y) const {
+    return x >= 0 && x < width_ && y >= 0 && y < height_;
+  }
+
+  /** @brief Padded array index of an in-bounds cell. */
+  int32_t index(int x, int y) const { return (y + 1) * stride_ + (x + 1); }
+  int xOf(int32_t idx) const { return idx % stride_ - 1; }
+  int yOf(int32_t idx) const { return idx / stride_ - 1; }
+
+  float cost(int32_t idx) const { return cells_[idx]; }
+  bool passable(int32_t idx) const { return cells_[idx] != BLOCKED; }
+  const float *data() const { return cells_.get(); }
+
+private:
+  struct AlignedDelete {
+    void operator()(float *p) const {
+      ::operator delete(p, std::align_val_t{ALIGNMENT});
+    }
+  };
+  using CellBuffer = std::unique_ptr<float[], AlignedDelete>;
+
+  static CellBuffer allocate(size_t cells);
+  template <typename T> bool loadImpl(const T *costs, int width, int height);
+  /** @brief Tracks a passable cost for min_cost_ and uniform_cost_. */
+  void noteCost(float cell);
+
+  /** @brief A cell under at least one obstacle. */
+  struct Covered {
+    float cost;     // What the cell holds once uncovered
+    uint32_t count; // Obstacles covering it
+  };
+
+  CellBuffer cells_;
+  int width_ = 0;
+  int height_ = 0;
+  int32_t stride_ = 0;
+  float min_cost_ = 1.0f;
+  bool uniform_cost_ = true;
+  uint64_t version_ = 0;
+  std::unordered_map<int32_t, GridRegion> obstacles_;
+  std::unordered_map<int32_t, Covered> covered_; // By padded index
+  int32_t next_obstacle_ = 0;
+};
+
+#endif // TERRAIN_GRID_HPP
@@ -0,0 +1,104 @@
+#include "TerrainTravel.hpp"
+#include "GridSearch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+RouteSummary RouteSummary::fromWaypoints(const TerrainGrid &terrain,
+                                         const float *elevation,
+                                         const int32_t *xy, size_t count) {
+  RouteSummary route;
+  route.reachable = true;
+  const size_t width = static_cast<size_t>(terrain.width());
+  auto height_at = [&](size_t i) {
+    return elevation ? elevation[xy[2 * i + 1] * width + xy[2 * i]] : 0.0f;
+  };
+  for (size_t i = 1; i < count; i++) {
+    const bool diagonal =
+        xy[2 * i] != xy[2 * i - 2] && xy[2 * i + 1] != xy[2 * i - 1];
+    const double step = diagonal ? SQRT2 : 1.0;
+    const double cost = terrain.cost(terrain.index(xy[2 * i], xy[2 * i + 1]));
+    route.length += step;
+    route.excess += step * (cost - 1.0);
+
+    const double rise = static_cast<double>(height_at(i)) - height_at(i - 1);
+    if (rise > 0.0)
+      route.ascent += rise;
+    else
+      route.descent -= rise;
+  }
+  return route;
+}
+
+double RouteSummary::minutes(const TransportProfile &profile,
+                             const TravelOptions &options,
+                             float min_cost) const {
+  const double m = profile.terrain_multiplier;
+  const double cells =
+      std::max(length + m * excess,
+               length * std::min(1.0, static_cast<double>(min_cost)));
+  const double climb_km = (options.uphill_penalty * ascent +
+                           options.downhill_penalty * descent) /
+                          1000.0;
+  return (cells * options.cell_km + m * climb_km) * profile.minutes_per_km;
+}
+
+bool RouteCache::find(int32_t start, int32_t target, bool diagonal,
+                      uint64_t terrain_version, RouteSummary &out) const {
+  const uint64_t k = key(start, target, diagonal);
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = young_.find(k);
+    if (it != young_.end()) {
+      if (it->second.terrain_version != terrain_version)
+        return false;
+      out = it->second.summary;
+      return true;
+    }
+    it = old_.find(k);
+    if (it == old_.end() || it->second.terrain_version != terrain_version)
+      return false;
+    out = it->second.summary;
+  }
+
+  // Old-generation hit: copy it forward so it survives the next rotation
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  insertLocked(k, {out, terrain_version});
+  return true;
+}
+
+void RouteCache::insert(int32_t start, int32_t target, bool diagonal,
+                        uint64_t terrain_version,
+                        const RouteSummary &summary) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  insertLocked(key(start, target, diagonal), {summary, terrain_version});
+}
+
+void RouteCache::insertLocked(uint64_t key, const Entry &entry) const {
+  const size_t generation = (capacity_ + 1) / 2;
+  if (generation == 0)
+    return;
+  if (young_.size() >= generation && !young_.count(key)) {
+    old_ = std::move(young_);
+    young_ = Map();
+  }
+  young_[key] = entry;
+}
+
+void RouteCache::setCapacity(size_t capacity) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  capacity_ = capacity;
+  young_.clear();
+  old_.clear();
+}
+
+void RouteCache::clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  young_.clear();
+  old_.clear();
+}
+
+size_t RouteCache::size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return young_.size() + old_.size();
+}
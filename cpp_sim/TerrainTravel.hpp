@@ -0,0 +1,110 @@
+#ifndef TERRAIN_TRAVEL_HPP
+#define TERRAIN_TRAVEL_HPP
+
+#include "TerrainGrid.hpp"
+#include "TransportModes.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief World scale and slope penalties for terrain-aware travel times.
+ *
+ * Penalties are flat-ground kilometres added per kilometre climbed or
+ * descended. The uphill default follows Naismith's rule (an hour per 600 m
+ * of ascent at walking pace); descending is free by default.
+ */
+struct TravelOptions {
+  double cell_km = 1.0;
+  double uphill_penalty = 8.0;
+  double downhill_penalty = 0.0;
+};
+
+/**
+ * @struct RouteSummary
+ * @brief Mode-independent totals along one grid route.
+ *
+ * Lengths are in cells (diagonal steps count sqrt(2)), so one summary serves
+ * every transport mode and world scale.
+ */
+struct RouteSummary {
+  bool reachable = false;
+  double length = 0.0;  // Horizontal route length
+  double excess = 0.0;  // Sum of step length x (cost of entered cell - 1)
+  double ascent = 0.0;  // Metres climbed
+  double descent = 0.0; // Metres descended
+
+  /**
+   * @brief Sums a path given as packed (x, y) waypoints.
+   *
+   * @param elevation Row-major heights in metres over the unpadded grid, or
+   * nullptr for flat ground
+   */
+  static RouteSummary fromWaypoints(const TerrainGrid &terrain,
+                                    const float *elevation,
+                                    const int32_t *xy, size_t count);
+
+  /**
+   * @brief Minutes along the route for @p profile.
+   *
+   * Each step pays its share of terrain cost, 1 + m x (cost - 1), and m x the
+   * slope penalty, where m is the mode's terrain multiplier. Multipliers
+   * above 1 only exaggerate rough ground: a route never gets cheaper than
+   * its length at the lowest terrain cost.
+   */
+  double minutes(const TransportProfile &profile,
+                 const TravelOptions &options, float min_cost) const;
+};
+
+/**
+ * @class RouteCache
+ * @brief Bounded cache of route summaries keyed by endpoints and movement
+ * model.
+ *
+ * Two generations approximate LRU in O(1): inserts go to the young map, and
+ * when it fills up it replaces the old one. Hits in the old generation are
+ * copied forward, so routes in use survive rotation. Lookups take a shared
+ * lock; entries record the terrain version they were summed on.
+ */
+class RouteCache {
+public:
+  static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+  explicit RouteCache(size_t capacity = DEFAULT_CAPACITY)
+      : capacity_(capacity) {}
+
+  /** @brief Copies the summary for a route into @p out if cached. */
+  bool find(int32_t start, int32_t target, bool diagonal,
+            uint64_t terrain_version, RouteSummary &out) const;
+
+  void insert(int32_t start, int32_t target, bool diagonal,
+              uint64_t terrain_version, const RouteSummary &summary);
+
+  /** @brief Maximum number of routes kept (both generations together). */
+  void setCapacity(size_t capacity);
+  void clear();
+  size_t size() const;
+
+private:
+  struct Entry {
+    RouteSummary summary;
+    uint64_t terrain_version;
+  };
+  using Map = std::unordered_map<uint64_t, Entry>;
+
+  static uint64_t key(int32_t start, int32_t target, bool diagonal) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(start)) << 33) |
+           (static_cast<uint64_t>(static_cast<uint32_t>(target)) << 1) |
+           (diagonal ? 1 : 0);
+  }
+  // Caller holds the exclusive lock
+  void insertLocked(uint64_t key, const Entry &entry) const;
+
+  mutable std::shared_mutex mutex_;
+  mutable Map young_, old_;
+  size_t capacity_;
+};
+
+#endif // TERRAIN_TRAVEL_HPP
@@ -0,0 +1,102 @@
+#ifndef TRANSPORT_MODES_HPP
+#define TRANSPORT_MODES_HPP
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Integer transport mode identifiers used by the batched APIs.
+ *
+ * Values are part of the C ABI; ids outside this range fall back to walking,
+ * matching the string overload's behaviour for unknown modes. Custom modes
+ * registered on an engine take ids from NUM_BUILTIN_TRANSPORT_MODES upwards.
+ */
+enum class TransportMode : int32_t {
+  Walking = 0,
+  Running = 1,
+  Driving = 2,
+  Flying = 3,
+};
+
+constexpr int32_t NUM_BUILTIN_TRANSPORT_MODES = 4;
+
+/**
+ * @brief Compile-time speed and name of each built-in mode.
+ *
+ * terrain_multiplier scales terrain cost in terrain-aware estimates: 1 pays
+ * the full cost, 0 ignores the ground entirely.
+ */
+template <TransportMode Mode> struct TransportTraits;
+
+template <> struct TransportTraits<TransportMode::Walking> {
+  static constexpr const char *name = "walking";
+  static constexpr double speed_kmh = 5.0;
+  static constexpr double terrain_multiplier = 1.0;
+};
+
+template <> struct TransportTraits<TransportMode::Running> {
+  static constexpr const char *name = "running";
+  static constexpr double speed_kmh = 10.0;
+  static constexpr double terrain_multiplier = 1.0;
+};
+
+template <> struct TransportTraits<TransportMode::Driving> {
+  static constexpr const char *name = "driving";
+  static constexpr double speed_kmh = 50.0;
+  static constexpr double terrain_multiplier = 1.0;
+};
+
+template <> struct TransportTraits<TransportMode::Flying> {
+  static constexpr const char *name = "flying";
+  static constexpr double speed_kmh = 800.0;
+  static constexpr double terrain_multiplier = 0.0;
+};
+
+/**
+ * @brief Minutes to cover @p km in mode @p Mode; the speed is a constant.
+ */
+template <TransportMode Mode> constexpr double travelMinutes(double km) {
+  return (km / TransportTraits<Mode>::speed_kmh) * 60.0;
+}
+
+/**
+ * @brief Runtime record for one mode, built-in or registered.
+ */
+struct TransportProfile {
+  double speed_kmh;
+  double minutes_per_km;
+  double terrain_multiplier;
+};
+
+template <TransportMode Mode> constexpr TransportProfile builtinProfile() {
+  return {TransportTraits<Mode>::speed_kmh,
+          60.0 / TransportTraits<Mode>::speed_kmh,
+          TransportTraits<Mode>::terrain_multiplier};
+}
+
+/** @brief Built-in profiles, indexed by TransportMode. */
+constexpr TransportProfile BUILTIN_TRANSPORT_PROFILES[] = {
+    builtinProfile<TransportMode::Walking>(),
+    builtinProfile<TransportMode::Running>(),
+    builtinProfile<TransportMode::Driving>(),
+    builtinProfile<TransportMode::Flying>(),
+};
+
+/**
+ * @brief Built-in mode id for @p name, or -1 if it names none.
+ */
+inline int32_t builtinTransportMode(const char *name) {
+  constexpr const char *NAMES[] = {
+      TransportTraits<TransportMode::Walking>::name,
+      TransportTraits<TransportMode::Running>::name,
+      TransportTraits<TransportMode::Driving>::name,
+      TransportTraits<TransportMode::Flying>::name,
+  };
+  for (int32_t mode = 0; mode < NUM_BUILTIN_TRANSPORT_MODES; mode++) {
+    if (std::strcmp(name, NAMES[mode]) == 0)
+      return mode;
+  }
+  return -1;
+}
+
+#endif // TRANSPORT_MODES_HPP
@@ -0,0 +1,124 @@
+#include "WorkerPool.hpp"
+#include <algorithm>
+
+namespace {
+size_t resolveConcurrency(size_t requested) {
+  if (requested > 0)
+    return requested;
+  return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+} // namespace
+
+WorkerPool::WorkerPool(size_t concurrency)
+    : slots_(resolveConcurrency(concurrency)),
+      slices_(new Slice[slots_]) {
+  // Slot 0 belongs to whichever thread calls parallelFor
+  threads_.reserve(slots_ - 1);
+  for (size_t slot = 1; slot < slots_; slot++)
+    threads_.emplace_back(&WorkerPool::workerLoop, this, slot);
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &thread : threads_)
+    thread.join();
+}
+
+WorkerPool &WorkerPool::shared() {
+  static WorkerPool pool;
+  return pool;
+}
+
+void WorkerPool::parallelFor(size_t count, size_t grain, const RangeFn &body) {
+  grain = std::max<size_t>(grain, 1);
+  std::unique_lock<std::mutex> job(job_mutex_, std::try_to_lock);
+  if (slots_ == 1 || count <= grain || !job.owns_lock()) {
+    for (size_t begin = 0; begin < count; begin += grain)
+      body(begin, std::min(count, begin + grain));
+    return;
+  }
+
+  // Even initial split; stealing fixes up whatever imbalance the items have
+  for (size_t slot = 0; slot < slots_; slot++) {
+    std::lock_guard<std::mutex> lock(slices_[slot].mutex);
+    slices_[slot].begin = count * slot / slots_;
+    slices_[slot].end = count * (slot + 1) / slots_;
+  }
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    body_ = &body;
+    grain_ = grain;
+    running_ = threads_.size();
+    generation_++;
+  }
+  wake_.notify_all();
+
+  drain(0);
+
+  std::unique_lock<std::mutex> lock(state_mutex_);
+  done_.wait(lock, [this] { return running_ == 0; });
+  body_ = nullptr;
+}
+
+void WorkerPool::workerLoop(size_t slot) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(state_mutex_);
+      wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+      if (stopping_)
+        return;
+      seen = generation_;
+    }
+    drain(slot);
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    if (--running_ == 0)
+      done_.notify_one();
+  }
+}
+
+void WorkerPool::drain(size_t slot) {
+  size_t begin, end;
+  do {
+    while (take(slot, begin, end))
+      (*body_)(begin, end);
+  } while (steal(slot));
+}
+
+bool WorkerPool::take(size_t slot, size_t &begin, size_t &end) {
+  Slice &slice = slices_[slot];
+  std::lock_guard<std::mutex> lock(slice.mutex);
+  if (slice.begin >= slice.end)
+    return false;
+  begin = slice.begin;
+  end = std::min(slice.end, begin + grain_);
+  slice.begin = end;
+  return true;
+}
+
+bool WorkerPool::steal(size_t thief) {
+  for (size_t offset = 1; offset < slots_; offset++) {
+    Slice &victim = slices_[(thief + offset) % slots_];
+    size_t begin, end;
+    {
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (victim.begin >= victim.end)
+        continue;
+      const size_t remaining = victim.end - victim.begin;
+      // Leave the victim the front half; tiny slices go whole
+      end = victim.end;
+      begin = remaining <= grain_ ? victim.begin : end - remaining / 2;
+      victim.end = begin;
+    }
+    Slice &own = slices_[thief];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    own.begin = begin;
+    own.end = end;
+    return true;
+  }
+  return false; // Whatever is left is already being processed
+}
@@ -0,0 +1,81 @@
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class WorkerPool
+ * @brief Persistent threads running index ranges with work stealing.
+ *
+ * A job over [0, count) starts as one contiguous slice per participant (the
+ * workers plus the calling thread). Each participant takes small chunks off
+ * the front of its own slice; once that is empty it steals the back half of
+ * another participant's slice. Uneven items, such as path queries of very
+ * different lengths, therefore still keep every thread busy.
+ *
+ * Threads stay alive between jobs, so anything they cache thread-locally
+ * (search workspaces, for instance) stays warm across calls.
+ */
+class WorkerPool {
+public:
+  /** @brief Range body: processes items [begin, end). */
+  using RangeFn = std::function<void(size_t begin, size_t end)>;
+
+  /**
+   * @param concurrency Threads per job including the caller; 0 picks the
+   * hardware concurrency
+   */
+  explicit WorkerPool(size_t concurrency = 0);
+  ~WorkerPool();
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  /** @brief Process-wide pool, started on first use. */
+  static WorkerPool &shared();
+
+  size_t concurrency() const { return slots_; }
+
+  /**
+   * @brief Runs @p body over [0, count) in chunks of at most @p grain items
+   * and returns once all of them are done.
+   *
+   * The caller takes part in the work. Runs inline if the pool is busy with
+   * another job (including calls made from inside a body).
+   */
+  void parallelFor(size_t count, size_t grain, const RangeFn &body);
+
+private:
+  // One participant's remaining slice; the owner eats from the front,
+  // thieves cut off the back
+  struct alignas(64) Slice {
+    std::mutex mutex;
+    size_t begin = 0, end = 0;
+  };
+
+  void workerLoop(size_t slot);
+  void drain(size_t slot);
+  bool take(size_t slot, size_t &begin, size_t &end);
+  bool steal(size_t thief);
+
+  const size_t slots_;
+  std::unique_ptr<Slice[]> slices_;
+  std::vector<std::thread> threads_;
+
+  std::mutex job_mutex_; // Admits one job at a time
+  std::mutex state_mutex_;
+  std::condition_variable wake_, done_;
+  const RangeFn *body_ = nullptr;
+  size_t grain_ = 1;
+  uint64_t generation_ = 0;
+  size_t running_ = 0; // Workers still inside the current job
+  bool stopping_ = false;
+};
+
+#endif // WORKER_POOL_HPP
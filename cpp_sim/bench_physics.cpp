@@ -0,0 +1,340 @@
+// libphys benchmarks. Workloads come from fixed seeds and a portable
+// generator, so every run on every platform measures the same inputs.
+// Results go to stdout as JSON (ns/op and heap allocations per op), progress
+// to stderr:
+//
+//   ./bench_phys [--filter SUBSTRING] [--min-time SECONDS] > results.json
+#include "PhysicsEngine.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+std::atomic<uint64_t> heap_allocs{0};
+std::atomic<uint64_t> heap_bytes{0};
+
+void *countedAlloc(size_t size, size_t alignment) {
+  heap_allocs.fetch_add(1, std::memory_order_relaxed);
+  heap_bytes.fetch_add(size, std::memory_order_relaxed);
+  void *p = nullptr;
+  if (alignment <= alignof(std::max_align_t))
+    p = std::malloc(size ? size : 1);
+  else if (posix_memalign(&p, alignment, size ? size : 1) != 0)
+    p = nullptr;
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+} // namespace
+
+// Every C++ allocation in the process, pool threads included, is counted
+void *operator new(size_t size) {
+  return countedAlloc(size, alignof(std::max_align_t));
+}
+void *operator new[](size_t size) {
+  return countedAlloc(size, alignof(std::max_align_t));
+}
+void *operator new(size_t size, std::align_val_t al) {
+  return countedAlloc(size, static_cast<size_t>(al));
+}
+void *operator new[](size_t size, std::align_val_t al) {
+  return countedAlloc(size, static_cast<size_t>(al));
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+namespace {
+constexpr uint64_t SEED = 0x434f4e434f5244; // "CONCORD"
+
+// splitmix64: unlike <random> distributions, identical on every standard
+// library
+struct Rng {
+  uint64_t state;
+  uint64_t next() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+  double uniform(double lo, double hi) {
+    return lo + (hi - lo) * (next() >> 11) * 0x1.0p-53;
+  }
+  uint32_t below(uint32_t n) { return static_cast<uint32_t>(next() % n); }
+};
+
+struct Result {
+  std::string name;
+  uint64_t iterations;
+  size_t items;
+  double ns_per_op;
+  double allocs_per_op;
+  double bytes_per_op;
+};
+
+struct Options {
+  const char *filter = nullptr;
+  double min_time = 0.5;
+};
+
+Options options;
+std::vector<Result> results;
+volatile double sink;
+
+/**
+ * @brief Times fn() (which does @p items operations) until a run takes at
+ * least min_time; "op" is one item.
+ */
+template <typename Fn> void bench(const std::string &name, size_t items,
+                                  Fn &&fn) {
+  if (options.filter && name.find(options.filter) == std::string::npos)
+    return;
+  std::fprintf(stderr, "%-36s", name.c_str());
+  fn(); // Warm caches and lazily built state
+
+  uint64_t iterations = 1;
+  for (;;) {
+    const uint64_t allocs = heap_allocs.load();
+    const uint64_t bytes = heap_bytes.load();
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; i++)
+      fn();
+    const double elapsed = std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+    if (elapsed >= options.min_time || iterations >= (uint64_t{1} << 40)) {
+      const double ops = static_cast<double>(iterations) * items;
+      results.push_back({name, iterations, items, elapsed * 1e9 / ops,
+                         (heap_allocs.load() - allocs) / ops,
+                         (heap_bytes.load() - bytes) / ops});
+      std::fprintf(stderr, "%14.1f ns/op %10.3f allocs/op\n",
+                   results.back().ns_per_op, results.back().allocs_per_op);
+      return;
+    }
+    // Aim 40% past the target so the next run usually is the last
+    const double scale = elapsed > 0 ? options.min_time * 1.4 / elapsed : 100;
+    iterations = static_cast<uint64_t>(
+        iterations * std::max(2.0, std::min(100.0, scale)));
+  }
+}
+
+void writeJson() {
+  char date[32];
+  const std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+  std::printf("{\n  \"context\": {\n");
+  std::printf("    \"library\": \"libphys\",\n");
+  std::printf("    \"date\": \"%s\",\n", date);
+  std::printf("    \"seed\": %llu,\n", static_cast<unsigned long long>(SEED));
+  std::printf("    \"hardware_threads\": %zu,\n",
+              WorkerPool::shared().concurrency());
+  std::printf("    \"distance_kernel\": \"%s\",\n", phys_distance_kernel());
+  std::printf("    \"min_time_s\": %g\n  },\n", options.min_time);
+  std::printf("  \"benchmarks\": [");
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    std::printf("%s\n    {\"name\": \"%s\", \"iterations\": %llu, "
+                "\"items_per_iteration\": %zu, \"ns_per_op\": %.3f, "
+                "\"allocs_per_op\": %.4f, \"bytes_per_op\": %.1f}",
+                i ? "," : "", r.name.c_str(),
+                static_cast<unsigned long long>(r.iterations), r.items,
+                r.ns_per_op, r.allocs_per_op, r.bytes_per_op);
+  }
+  std::printf("\n  ]\n}\n");
+}
+
+// Perfect maze on odd cells (recursive backtracker); walls are 0
+std::vector<float> makeMaze(int size, Rng &rng) {
+  std::vector<float> costs(static_cast<size_t>(size) * size, 0.0f);
+  std::vector<int> stack = {size + 1};
+  costs[stack.back()] = 1.0f;
+  const int steps[] = {2, -2, 2 * size, -2 * size};
+  while (!stack.empty()) {
+    const int cell = stack.back();
+    int open[4], count = 0;
+    for (int step : steps) {
+      const int next = cell + step;
+      const int x = next % size, y = next / size;
+      // Steps off either side wrap onto column 0 or size - 1, both walls
+      if (x >= 1 && x < size - 1 && y >= 1 && y < size - 1 &&
+          costs[next] == 0.0f)
+        open[count++] = step;
+    }
+    if (count == 0) {
+      stack.pop_back();
+      continue;
+    }
+    const int step = open[rng.below(count)];
+    costs[cell + step / 2] = 1.0f;
+    costs[cell + step] = 1.0f;
+    stack.push_back(cell + step);
+  }
+  return costs;
+}
+
+void benchTravelTime(Rng &rng) {
+  PhysicsEngine engine;
+  bench("travel_time/string", 1, [&] {
+    sink = phys_estimate_travel_time(&engine, 0, 0, 0, 3, 4, 0, "running");
+  });
+  bench("travel_time/mode", 1, [&] {
+    sink = phys_estimate_travel_time_mode(&engine, 0, 0, 0, 3, 4, 0, 1);
+  });
+
+  const size_t n = 1 << 16;
+  std::vector<double> c[6];
+  for (std::vector<double> &axis : c) {
+    axis.resize(n);
+    for (double &v : axis)
+      v = rng.uniform(-50.0, 50.0);
+  }
+  std::vector<int32_t> modes(n);
+  for (int32_t &mode : modes)
+    mode = static_cast<int32_t>(rng.below(NUM_BUILTIN_TRANSPORT_MODES));
+  std::vector<double> out(n);
+  bench("travel_time/batch/65536", n, [&] {
+    engine.estimateTravelTimeBatch(c[0].data(), c[1].data(), c[2].data(),
+                                   c[3].data(), c[4].data(), c[5].data(),
+                                   modes.data(), n, out.data());
+  });
+
+  bench("travel_time/terrain_cached", 1, [&] {
+    sink = engine.estimateTerrainTravelTime(10, 10, 90, 90, 0);
+  });
+}
+
+void benchPaths(Rng &rng) {
+  const int empty_size = 256;
+  std::vector<float> empty(static_cast<size_t>(empty_size) * empty_size,
+                           1.0f);
+  PhysicsEngine engine;
+  engine.loadTerrain(empty.data(), empty_size, empty_size);
+  bench("astar/empty/256", 1, [&] {
+    sink = engine.findShortestPath(0, 0, empty_size - 1, empty_size - 1);
+  });
+  engine.setPathOptions({PathAlgorithm::JPS, true});
+  bench("jps/empty/256", 1, [&] {
+    sink = engine.findShortestPath(0, 0, empty_size - 1, empty_size - 1);
+  });
+
+  const int maze_size = 255;
+  const std::vector<float> maze = makeMaze(maze_size, rng);
+  engine.loadTerrain(maze.data(), maze_size, maze_size);
+  engine.setPathOptions({PathAlgorithm::AStar, false});
+  bench("astar/maze/255", 1, [&] {
+    sink = engine.findShortestPath(1, 1, maze_size - 2, maze_size - 2);
+  });
+
+  const int large_size = 1024;
+  std::vector<float> large(static_cast<size_t>(large_size) * large_size);
+  for (float &cost : large)
+    cost = static_cast<float>(1 + rng.below(9));
+  engine.loadTerrain(large.data(), large_size, large_size);
+  bench("astar/large/1024", 1, [&] {
+    sink = engine.findShortestPath(0, 0, large_size - 1, large_size - 1);
+  });
+
+  // A barricade ahead of an agent crossing the map goes up and comes down;
+  // an op is one edit plus the repaired route
+  const int32_t tracked =
+      engine.trackPath(0, 0, large_size - 1, large_size - 1);
+  int32_t barricade = -1;
+  bench("tracked/repair/1024", 1, [&] {
+    if (barricade < 0) {
+      barricade = engine.addObstacle(40, 0, 40, 100);
+    } else {
+      engine.removeObstacle(barricade);
+      barricade = -1;
+    }
+    size_t len;
+    sink = engine.trackedPath(tracked, nullptr, 0, &len);
+  });
+  engine.removeObstacle(barricade);
+  engine.untrackPath(tracked);
+
+  engine.setPathOptions({PathAlgorithm::HPA, false});
+  engine.buildHierarchy();
+  bench("hpa/large/1024", 1, [&] {
+    sink = engine.findShortestPath(0, 0, large_size - 1, large_size - 1);
+  });
+
+  const size_t queries = 256;
+  std::vector<int32_t> sx(queries), sy(queries), tx(queries), ty(queries);
+  for (size_t i = 0; i < queries; i++) {
+    sx[i] = rng.below(large_size);
+    sy[i] = rng.below(large_size);
+    tx[i] = rng.below(large_size);
+    ty[i] = rng.below(large_size);
+  }
+  std::vector<double> costs(queries);
+  bench("hpa/batch/1024", queries, [&] {
+    engine.findShortestPathBatch(sx.data(), sy.data(), tx.data(), ty.data(),
+                                 queries, costs.data());
+  });
+}
+
+void benchBroadPhase(Rng &rng) {
+  // ~1 neighbour per entity: 100k radius-0.5 spheres in a 2D 600 x 600 box
+  const size_t n = 100000;
+  std::vector<double> x(n), y(n), z(n, 0.0), r(n, 0.5);
+  for (size_t i = 0; i < n; i++) {
+    x[i] = rng.uniform(0.0, 600.0);
+    y[i] = rng.uniform(0.0, 600.0);
+  }
+  PhysicsEngine engine;
+  std::vector<uint32_t> pairs(2 * n);
+  std::vector<double> jitter(n);
+  for (double &j : jitter)
+    j = rng.uniform(-0.05, 0.05);
+  bool forward = true;
+  bench("broad_phase/update/100000", n, [&] {
+    // Small moves each tick, as in a running simulation
+    for (size_t i = 0; i < n; i++)
+      x[i] += forward ? jitter[i] : -jitter[i];
+    forward = !forward;
+    engine.updateEntities(x.data(), y.data(), z.data(), r.data(), n);
+  });
+  bench("broad_phase/pairs/100000", n, [&] {
+    sink = static_cast<double>(engine.findOverlaps(pairs.data(), n));
+  });
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) {
+      options.filter = argv[++i];
+    } else if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc) {
+      options.min_time = std::atof(argv[++i]);
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--filter SUBSTRING] [--min-time SECONDS]\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+
+  // Each group draws from its own stream, so filtering keeps inputs fixed
+  Rng travel_rng{SEED}, path_rng{SEED + 1}, broad_rng{SEED + 2};
+  benchTravelTime(travel_rng);
+  benchPaths(path_rng);
+  benchBroadPhase(broad_rng);
+  writeJson();
+  return 0;
+}
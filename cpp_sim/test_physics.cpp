@@ -1,6 +1,12 @@
 #include "PhysicsEngine.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
 
 int main() {
   PhysicsEngine engine;
@@ -17,6 +23,749 @@ int main() {
   std::cout << "Time (Driving 5km): " << time << " mins" << std::endl;
   assert(std::abs(time - 6.0) < 0.001); // 5km / 50kmh = 0.1h = 6 mins
 
+  // Test Batched Travel Time (matches the scalar path per mode)
+  const double bx1[] = {0, 0, 0, 0, 1};
+  const double by1[] = {0, 0, 0, 0, 1};
+  const double bz1[] = {0, 0, 0, 0, 1};
+  const double bx2[] = {3, 3, 3, 3, 1};
+  const double by2[] = {4, 4, 4, 4, 1};
+  const double bz2[] = {0, 0, 0, 0, 1};
+  const int32_t bmodes[] = {0, 1, 2, 3, 2};
+  const char *bnames[] = {"walking", "running", "driving", "flying",
+                          "driving"};
+  double bout[5];
+  engine.estimateTravelTimeBatch(bx1, by1, bz1, bx2, by2, bz2, bmodes, 5,
+                                 bout);
+  for (int i = 0; i < 5; i++) {
+    double expected = engine.estimateTravelTime(
+        {bx1[i], by1[i], bz1[i]}, {bx2[i], by2[i], bz2[i]}, bnames[i]);
+    assert(std::abs(bout[i] - expected) < 1e-9);
+  }
+  std::cout << "Batch (Flying 5km): " << bout[3] << " mins" << std::endl;
+
+  // Test Pathfinding on the default map (detour around the mountain range)
+  double open_cost = engine.findShortestPath(0, 0, 99, 99);
+  assert(std::abs(open_cost - 198.0) < 1e-9);
+  double detour_cost = engine.findShortestPath(55, 40, 55, 70);
+  std::cout << "Path (detour): " << detour_cost << std::endl;
+  assert(std::abs(detour_cost - 42.0) < 1e-9);
+  assert(engine.findShortestPath(0, 0, 55, 55) < 0); // Inside the mountain
+
+  // Test Custom Terrain: wall with one gap, expensive swamp cell
+  const float costs[] = {
+      1, 1, 1, 1, 1, //
+      0, 0, 0, 1, 0, //
+      1, 1, 5, 1, 1, //
+  };
+  PhysicsEngine custom;
+  assert(custom.loadTerrain(costs, 5, 3));
+  assert(custom.terrain().width() == 5 && custom.terrain().height() == 3);
+  assert(std::abs(custom.findShortestPath(0, 0, 0, 2) - 12.0) < 1e-9);
+  assert(std::abs(custom.findShortestPath(0, 2, 4, 2) - 8.0) < 1e-9);
+  assert(custom.findShortestPath(0, 0, 0, 1) < 0); // Target is a wall
+  assert(!custom.loadTerrain(costs, 0, 3));
+
+  // Test Path Output: through the gap at (3, 1), buffer contract
+  int32_t path[2 * 16];
+  size_t path_len = 0;
+  double path_cost = custom.findPath(0, 0, 0, 2, path, 2, &path_len);
+  assert(std::abs(path_cost - 12.0) < 1e-9);
+  assert(path_len == 9); // Too small: required size only
+  path[0] = -7;
+  assert(custom.findPath(0, 0, 0, 2, path, 2, &path_len) >= 0);
+  assert(path[0] == -7); // No partial write
+  custom.findPath(0, 0, 0, 2, path, 16, &path_len);
+  assert(path_len == 9);
+  assert(path[0] == 0 && path[1] == 0);
+  assert(path[2 * 4] == 3 && path[2 * 4 + 1] == 1);
+  assert(path[2 * 8] == 0 && path[2 * 8 + 1] == 2);
+  for (size_t i = 1; i < path_len; i++) {
+    int step = std::abs(path[2 * i] - path[2 * i - 2]) +
+               std::abs(path[2 * i + 1] - path[2 * i - 1]);
+    assert(step == 1);
+  }
+  assert(custom.findPath(0, 0, 0, 1, path, 16, &path_len) < 0);
+  assert(path_len == 0);
+
+  const uint8_t bytes[] = {1, 0, 1, 1, 1, 1};
+  assert(custom.loadTerrain(bytes, 3, 2));
+  assert(std::abs(custom.findShortestPath(0, 0, 2, 0) - 4.0) < 1e-9);
+
+  // Test Distance Fields: same costs as A*, valid descent paths
+  PhysicsEngine hub_engine;
+  std::vector<double> astar_costs;
+  for (int i = 0; i < 20; i++) {
+    astar_costs.push_back(
+        hub_engine.findShortestPath(i * 5, 99 - i * 3, 55, 70));
+  }
+  assert(hub_engine.buildDistanceField(55, 70));
+  assert(!hub_engine.buildDistanceField(55, 55)); // Inside the mountain
+  for (int i = 0; i < 20; i++) {
+    double field_cost = hub_engine.findShortestPath(i * 5, 99 - i * 3, 55, 70);
+    assert(std::abs(field_cost - astar_costs[i]) < 1e-9);
+  }
+  int32_t hub_path[2 * 256];
+  size_t hub_len = 0;
+  double hub_cost =
+      hub_engine.findPath(55, 40, 55, 70, hub_path, 256, &hub_len);
+  assert(std::abs(hub_cost - 42.0) < 1e-9 && hub_len == 43);
+  assert(hub_path[0] == 55 && hub_path[1] == 40);
+  assert(hub_path[2 * 42] == 55 && hub_path[2 * 42 + 1] == 70);
+  hub_engine.setDistanceFieldCapacity(1);
+  assert(hub_engine.buildDistanceField(0, 0)); // Evicts the (55, 70) field
+  assert(std::abs(hub_engine.findShortestPath(55, 40, 55, 70) - 42.0) < 1e-9);
+  assert(std::abs(hub_engine.findShortestPath(99, 99, 0, 0) - 198.0) < 1e-9);
+  hub_engine.setDistanceFieldMaxBytes(1024);
+  assert(!hub_engine.buildDistanceField(99, 99)); // Larger than the limit
+  assert(std::abs(hub_engine.findShortestPath(0, 0, 99, 99) - 198.0) < 1e-9);
+
+  // The cache is bounded by bytes as well as count: a field that does not
+  // fit evicts the least recently used, and one over the limit is refused
+  {
+    auto field = [](int32_t target, size_t cells) {
+      auto made = std::make_shared<DistanceField>();
+      made->target = target;
+      made->terrain_version = 0;
+      made->diagonal = false;
+      made->dist.assign(cells, 0.0);
+      return std::shared_ptr<const DistanceField>(made);
+    };
+    DistanceFieldCache cache(8, 3000 * sizeof(double));
+    assert(cache.insert(field(1, 1000)) && cache.insert(field(2, 1000)));
+    assert(cache.find(1, 0, false)); // Leaves 2 least recently used
+    assert(cache.insert(field(3, 1500)));
+    assert(cache.size() == 2 && !cache.find(2, 0, false));
+    assert(cache.bytes() == 2500 * sizeof(double));
+    assert(!cache.insert(field(4, 4000)) && cache.size() == 2);
+    cache.setMaxBytes(1500 * sizeof(double));
+    assert(cache.size() == 1 && cache.find(3, 0, false));
+    assert(cache.insert(field(3, 500)));
+    assert(cache.bytes() == 500 * sizeof(double));
+  }
+
+  // Test 8-connected movement: octile cost on open ground
+  PhysicsEngine diag_engine;
+  diag_engine.setPathOptions({PathAlgorithm::AStar, true});
+  assert(std::abs(diag_engine.findShortestPath(0, 0, 3, 3) - 3 * SQRT2) <
+         1e-9);
+  assert(std::abs(diag_engine.findShortestPath(0, 0, 5, 2) -
+                  (3 + 2 * SQRT2)) < 1e-9);
+  const double diag_detour = diag_engine.findShortestPath(55, 40, 55, 70);
+  assert(diag_engine.buildDistanceField(55, 70));
+  assert(std::abs(diag_engine.findShortestPath(55, 40, 55, 70) -
+                  diag_detour) < 1e-9);
+
+  // Test JPS: identical costs to 8-connected A* on random maps
+  std::mt19937 rng(42);
+  for (int map = 0; map < 50; map++) {
+    const int w = 8 + rng() % 32;
+    const int h = 8 + rng() % 32;
+    std::vector<uint8_t> cells(w * h);
+    for (uint8_t &cell : cells)
+      cell = (rng() % 100) < 25 ? 0 : 1;
+    PhysicsEngine astar_map, jps_map;
+    astar_map.loadTerrain(cells.data(), w, h);
+    jps_map.loadTerrain(cells.data(), w, h);
+    astar_map.setPathOptions({PathAlgorithm::AStar, true});
+    jps_map.setPathOptions({PathAlgorithm::JPS, true});
+    for (int q = 0; q < 10; q++) {
+      const int sx = rng() % w, sy = rng() % h;
+      const int tx = rng() % w, ty = rng() % h;
+      const double expected = astar_map.findShortestPath(sx, sy, tx, ty);
+      int32_t jps_path[2 * 40 * 40];
+      size_t jps_len = 0;
+      const double got =
+          jps_map.findPath(sx, sy, tx, ty, jps_path, 40 * 40, &jps_len);
+      assert(std::abs(expected - got) < 1e-9);
+      // Jump points are expanded back into unit steps
+      double walked = 0.0;
+      for (size_t i = 1; i < jps_len; i++) {
+        const int ddx = std::abs(jps_path[2 * i] - jps_path[2 * i - 2]);
+        const int ddy = std::abs(jps_path[2 * i + 1] - jps_path[2 * i - 1]);
+        assert(ddx <= 1 && ddy <= 1 && ddx + ddy > 0);
+        walked += (ddx && ddy) ? SQRT2 : 1.0;
+      }
+      assert(got < 0 || std::abs(walked - got) < 1e-9);
+    }
+  }
+  // JPS jumps are for 8-connected grids: without diagonals it is refused
+  // rather than quietly running A*, and the options in force stay
+  {
+    PhysicsEngine refused;
+    assert(refused.setPathOptions({PathAlgorithm::AStar, true}));
+    assert(!refused.setPathOptions({PathAlgorithm::JPS, false}));
+    assert(phys_set_path_options(&refused, 1, 0) == -1);
+    assert(refused.pathOptions().algorithm == PathAlgorithm::AStar &&
+           refused.pathOptions().diagonal);
+    assert(phys_set_path_options(&refused, 1, 1) == 0);
+  }
+
+  // Test HPA*: same reachability as A*, valid and near-optimal paths
+  for (int map = 0; map < 20; map++) {
+    const int w = 20 + rng() % 60;
+    const int h = 20 + rng() % 60;
+    std::vector<float> cells(w * h);
+    for (float &cell : cells)
+      cell = (rng() % 100) < 20 ? 0.0f : static_cast<float>(1 + rng() % 3);
+    const bool diagonal = map % 2 == 1;
+    PhysicsEngine flat, hpa;
+    flat.loadTerrain(cells.data(), w, h);
+    hpa.loadTerrain(cells.data(), w, h);
+    flat.setPathOptions({PathAlgorithm::AStar, diagonal});
+    hpa.setPathOptions({PathAlgorithm::HPA, diagonal});
+    assert(hpa.buildHierarchy(8));
+    for (int q = 0; q < 20; q++) {
+      if (q == 10) {
+        // Incremental cluster rebuilds must keep both engines in step
+        for (int k = 0; k < 5; k++) {
+          const int x = rng() % w, y = rng() % h;
+          flat.setCellCost(x, y, 0.0f);
+          hpa.setCellCost(x, y, 0.0f);
+        }
+      }
+      const int sx = rng() % w, sy = rng() % h;
+      const int tx = rng() % w, ty = rng() % h;
+      const double optimal = flat.findShortestPath(sx, sy, tx, ty);
+      std::vector<int32_t> hpa_path(2 * w * h);
+      size_t hpa_len = 0;
+      const double got =
+          hpa.findPath(sx, sy, tx, ty, hpa_path.data(), w * h, &hpa_len);
+      assert((optimal < 0) == (got < 0));
+      if (got < 0)
+        continue;
+      assert(got >= optimal - 1e-9 && got <= 1.5 * optimal + 1e-9);
+      double walked = 0.0;
+      for (size_t i = 1; i < hpa_len; i++) {
+        const int ddx = std::abs(hpa_path[2 * i] - hpa_path[2 * i - 2]);
+        const int ddy = std::abs(hpa_path[2 * i + 1] - hpa_path[2 * i - 1]);
+        assert(ddx <= 1 && ddy <= 1 && ddx + ddy > 0);
+        assert(diagonal || ddx + ddy == 1);
+        const TerrainGrid &grid = hpa.terrain();
+        const float cell =
+            grid.cost(grid.index(hpa_path[2 * i], hpa_path[2 * i + 1]));
+        assert(cell != TerrainGrid::BLOCKED);
+        walked += (ddx && ddy) ? cell * SQRT2 : cell;
+      }
+      assert(std::abs(walked - got) < 1e-6);
+    }
+  }
+
+  // Test Handle API: one handle shared by several threads
+  PhysicsEngine *handle = phys_create();
+  assert(phys_load_terrain(handle, costs, 5, 3) == 0);
+  assert(phys_load_terrain(handle, costs, -1, 3) == -1);
+  std::vector<std::thread> workers;
+  std::vector<int> failures(4, 0);
+  for (int t = 0; t < 4; t++) {
+    workers.emplace_back([handle, &failures, t] {
+      for (int i = 0; i < 200; i++) {
+        if (std::abs(phys_find_shortest_path(handle, 0, 0, 0, 2) - 12.0) >
+            1e-9)
+          failures[t]++;
+      }
+    });
+  }
+  for (std::thread &worker : workers)
+    worker.join();
+  for (int f : failures)
+    assert(f == 0);
+  assert(std::abs(phys_estimate_travel_time(handle, 0, 0, 0, 3, 4, 0,
+                                            "driving") -
+                  6.0) < 1e-9);
+  phys_destroy(handle);
+
+  // Test WorkerPool: every index runs exactly once, even with uneven items
+  WorkerPool pool(4);
+  for (size_t n : {0u, 1u, 7u, 1000u}) {
+    std::vector<std::atomic<int>> hits(n);
+    pool.parallelFor(n, 3, [&](size_t begin, size_t end) {
+      assert(end - begin <= 3);
+      for (size_t i = begin; i < end; i++) {
+        if (i % 97 == 0)
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+        hits[i]++;
+      }
+    });
+    for (const std::atomic<int> &h : hits)
+      assert(h == 1);
+  }
+
+  // Test Batch Paths: parallel results match one-by-one queries
+  {
+    const int w = 64, h = 64;
+    std::vector<float> cells(w * h);
+    for (float &cell : cells)
+      cell = (rng() % 100) < 25 ? 0.0f : static_cast<float>(1 + rng() % 4);
+    PhysicsEngine batch_engine;
+    batch_engine.loadTerrain(cells.data(), w, h);
+    const size_t n = 500;
+    std::vector<int32_t> sx(n), sy(n), tx(n), ty(n);
+    for (size_t i = 0; i < n; i++) {
+      sx[i] = rng() % (w + 2) - 1; // Some out of bounds
+      sy[i] = rng() % h;
+      tx[i] = rng() % w;
+      ty[i] = rng() % h;
+    }
+    std::vector<double> parallel(n), shared_pool(n);
+    batch_engine.findShortestPathBatch(sx.data(), sy.data(), tx.data(),
+                                       ty.data(), n, parallel.data(), pool);
+    phys_find_shortest_path_batch(&batch_engine, sx.data(), sy.data(),
+                                  tx.data(), ty.data(), n,
+                                  shared_pool.data());
+    for (size_t i = 0; i < n; i++) {
+      const double expected =
+          batch_engine.findShortestPath(sx[i], sy[i], tx[i], ty[i]);
+      assert(parallel[i] == expected && shared_pool[i] == expected);
+    }
+  }
+
+  // Test Transport Modes: integer ids match the string API; custom modes
+  {
+    PhysicsEngine modes;
+    const char *names[] = {"walking", "running", "driving", "flying"};
+    for (int32_t m = 0; m < NUM_BUILTIN_TRANSPORT_MODES; m++) {
+      assert(modes.transportModeId(names[m]) == m);
+      assert(modes.estimateTravelTime(p1, p2, m) ==
+             modes.estimateTravelTime(p1, p2, names[m]));
+    }
+    assert(modes.estimateTravelTime(p1, p2, 99) ==
+           modes.estimateTravelTime(p1, p2, "teleport")); // Walking
+    assert(api_estimate_travel_time_mode(0, 0, 0, 3, 4, 0, 2) ==
+           api_estimate_travel_time(0, 0, 0, 3, 4, 0, "driving"));
+
+    assert(phys_register_transport_mode(&modes, "walking", 3.0, 1.0) == -1);
+    assert(phys_register_transport_mode(&modes, "ship", 0.0, 0.0) == -1);
+    assert(phys_register_transport_mode(&modes, "ship", 20.0, -1.0) == -1);
+    const int32_t horse =
+        phys_register_transport_mode(&modes, "horse", 25.0, 0.5);
+    const int32_t ship = phys_register_transport_mode(&modes, "ship", 30.0,
+                                                      0.0);
+    assert(horse == NUM_BUILTIN_TRANSPORT_MODES && ship == horse + 1);
+    assert(phys_transport_mode_id(&modes, "ship") == ship);
+    assert(phys_transport_mode_id(&modes, "zeppelin") == -1);
+    // 5 km at 25 km/h = 12 minutes, by id, by name and in batches
+    assert(std::abs(modes.estimateTravelTime(p1, p2, horse) - 12.0) < 1e-9);
+    assert(std::abs(modes.estimateTravelTime(p1, p2, "horse") - 12.0) < 1e-9);
+    assert(std::abs(modes.transportProfile(horse).terrain_multiplier - 0.5) <
+           1e-12);
+    const double zero = 0.0, three = 3.0, four = 4.0;
+    double batch_minutes = 0.0;
+    modes.estimateTravelTimeBatch(&zero, &zero, &zero, &three, &four, &zero,
+                                  &ship, 1, &batch_minutes);
+    assert(std::abs(batch_minutes - 10.0) < 1e-9);
+    // Re-registering a custom name updates it in place
+    assert(phys_register_transport_mode(&modes, "horse", 50.0, 0.5) == horse);
+    assert(std::abs(modes.estimateTravelTime(p1, p2, horse) - 6.0) < 1e-9);
+  }
+
+  // Test Terrain Travel: route costs, slopes, mode multipliers and caching
+  {
+    PhysicsEngine travel;
+    const float corridor[] = {1.0f, 1.0f, 3.0f, 1.0f, 1.0f};
+    assert(phys_load_terrain(&travel, corridor, 5, 1) == 0);
+    const int32_t walking = static_cast<int32_t>(TransportMode::Walking);
+    const int32_t flying = static_cast<int32_t>(TransportMode::Flying);
+    // 4 steps entering costs 1, 3, 1, 1: 6 km-equivalents at 5 km/h
+    assert(std::abs(travel.estimateTerrainTravelTime(0, 0, 4, 0, walking) -
+                    72.0) < 1e-9);
+    // Half the terrain surcharge for a horse: 5 km at 25 km/h
+    const int32_t horse = travel.registerTransportMode("horse", 25.0, 0.5);
+    assert(std::abs(travel.estimateTerrainTravelTime(0, 0, 4, 0, horse) -
+                    12.0) < 1e-9);
+    // Flying ignores the ground: 4 km straight at 800 km/h
+    assert(std::abs(travel.estimateTerrainTravelTime(0, 0, 4, 0, flying) -
+                    0.3) < 1e-9);
+
+    // 200 m up, 100 m down; Naismith adds 1.6 km, the descent is free
+    const float heights[] = {0.0f, 100.0f, 200.0f, 200.0f, 100.0f};
+    assert(phys_load_elevation(&travel, heights, 4, 1) == -1);
+    assert(phys_load_elevation(&travel, heights, 5, 1) == 0);
+    assert(std::abs(travel.estimateTerrainTravelTime(0, 0, 4, 0, walking) -
+                    91.2) < 1e-9);
+    assert(phys_set_travel_options(&travel, 0.0, 8.0, 0.0) == -1);
+    assert(phys_set_travel_options(&travel, 1.0, 8.0, 2.0) == 0);
+    assert(std::abs(phys_estimate_terrain_travel_time(&travel, 0, 0, 4, 0,
+                                                      walking) -
+                    93.6) < 1e-9);
+    // Cached routes follow terrain edits
+    assert(phys_set_cell_cost(&travel, 2, 0, 1.0f) == 0);
+    assert(std::abs(travel.estimateTerrainTravelTime(0, 0, 4, 0, walking) -
+                    69.6) < 1e-9);
+    assert(phys_set_cell_cost(&travel, 2, 0, 0.0f) == 0);
+    assert(travel.estimateTerrainTravelTime(0, 0, 4, 0, walking) == -1.0);
+    assert(travel.estimateTerrainTravelTime(0, 0, 5, 0, walking) == -1.0);
+
+    // The default map's mountain makes crossing it slower than going round
+    PhysicsEngine world;
+    const double around = world.estimateTerrainTravelTime(45, 55, 65, 55,
+                                                          walking);
+    assert(around > world.estimateTravelTime({45, 55, 0}, {65, 55, 0},
+                                             TransportMode::Walking));
+    assert(world.estimateTerrainTravelTime(45, 55, 65, 55, walking) == around);
+  }
+
+  // Test Distance Kernels: every SIMD level agrees with scalar, tails too
+  {
+    std::uniform_real_distribution<double> coord(-100.0, 100.0);
+    const size_t n = 203;
+    std::vector<double> a[4], b[4];
+    for (int k = 0; k < 4; k++) {
+      a[k].resize(n);
+      b[k].resize(n);
+      for (size_t i = 0; i < n; i++) {
+        a[k][i] = coord(rng);
+        b[k][i] = coord(rng);
+      }
+    }
+    for (size_t i = 0; i < n; i++) {
+      a[3][i] = std::abs(a[3][i]); // Radii
+      b[3][i] = std::abs(b[3][i]);
+    }
+    const DistanceKernels *scalar = distanceKernels(SimdLevel::Scalar);
+    for (int32_t level = 0; level <= 3; level++) {
+      const DistanceKernels *k =
+          distanceKernels(static_cast<SimdLevel>(level));
+      if (!k)
+        continue;
+      for (size_t len : {size_t{0}, size_t{1}, size_t{7}, n}) {
+        std::vector<double> d(n + 1, -1.0), want(n);
+        k->distance(a[0].data(), a[1].data(), a[2].data(), b[0].data(),
+                    b[1].data(), b[2].data(), len, d.data());
+        scalar->distance(a[0].data(), a[1].data(), a[2].data(), b[0].data(),
+                         b[1].data(), b[2].data(), len, want.data());
+        for (size_t i = 0; i < len; i++)
+          assert(std::abs(d[i] - want[i]) <= 1e-12 * want[i]);
+        assert(d[len] == -1.0); // No writes past the end
+
+        std::vector<uint8_t> hit(n + 1, 9);
+        k->overlap(a[0].data(), a[1].data(), a[2].data(), a[3].data(),
+                   b[0].data(), b[1].data(), b[2].data(), b[3].data(), len,
+                   hit.data());
+        for (size_t i = 0; i < len; i++)
+          assert(hit[i] == engine.checkCollision({a[0][i], a[1][i], a[2][i]},
+                                                 a[3][i],
+                                                 {b[0][i], b[1][i], b[2][i]},
+                                                 b[3][i]));
+        assert(hit[len] == 9);
+
+        const size_t in_range = k->within(1.0, 2.0, 3.0, 90.0, a[0].data(),
+                                          a[1].data(), a[2].data(), len,
+                                          nullptr);
+        std::vector<uint32_t> ids(in_range);
+        assert(k->within(1.0, 2.0, 3.0, 90.0, a[0].data(), a[1].data(),
+                         a[2].data(), len, ids.data()) == in_range);
+        std::vector<uint32_t> want_ids(in_range);
+        scalar->within(1.0, 2.0, 3.0, 90.0, a[0].data(), a[1].data(),
+                       a[2].data(), len, want_ids.data());
+        assert(ids == want_ids);
+      }
+    }
+    std::cout << "Distance kernel: " << phys_distance_kernel() << std::endl;
+
+    // Radius queries follow the buffer contract
+    const size_t count = phys_query_radius(&engine, 0, 0, 0, 120.0,
+                                           a[0].data(), a[1].data(),
+                                           a[2].data(), n, nullptr, 0);
+    assert(count > 0);
+    std::vector<uint32_t> ids(count, UINT32_MAX);
+    assert(phys_query_radius(&engine, 0, 0, 0, 120.0, a[0].data(),
+                             a[1].data(), a[2].data(), n, ids.data(),
+                             count - 1) == count &&
+           ids[0] == UINT32_MAX);
+  }
+
+  // Test Broad Phase: matches brute force across ticks, dense and sparse
+  for (int scene = 0; scene < 8; scene++) {
+    const size_t n = 400;
+    std::vector<double> x(n), y(n), z(n), r(n);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    for (size_t i = 0; i < n; i++) {
+      // Odd scenes put three clusters far apart (sparse cell keys)
+      x[i] = unit(rng) * 40.0 + (scene % 2 ? (i % 3) * 1e5 : 0.0);
+      y[i] = unit(rng) * 40.0 - 20.0;
+      z[i] = scene % 4 < 2 ? 0.0 : unit(rng) * 10.0;
+      r[i] = unit(rng) * (scene % 3 ? 1.5 : 0.2);
+    }
+    PhysicsEngine world;
+    for (int tick = 0; tick < 3; tick++) {
+      assert(phys_update_entities(&world, x.data(), y.data(), z.data(),
+                                  r.data(), n) == 0);
+      std::vector<std::pair<uint32_t, uint32_t>> expected;
+      for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+          if (engine.checkCollision({x[i], y[i], z[i]}, r[i],
+                                    {x[j], y[j], z[j]}, r[j]))
+            expected.push_back({static_cast<uint32_t>(i),
+                                static_cast<uint32_t>(j)});
+        }
+      }
+      const size_t count = phys_find_overlaps(&world, nullptr, 0);
+      assert(count == expected.size());
+      std::vector<uint32_t> flat(2 * count + 2, 7);
+      if (count > 0)
+        assert(phys_find_overlaps(&world, flat.data(), count - 1) == count &&
+               flat[0] == 7); // Too small: nothing written
+      assert(phys_find_overlaps(&world, flat.data(), count + 1) == count);
+      std::vector<std::pair<uint32_t, uint32_t>> got;
+      for (size_t k = 0; k < count; k++)
+        got.push_back({flat[2 * k], flat[2 * k + 1]});
+      std::sort(got.begin(), got.end());
+      assert(got == expected);
+
+      // Small moves keep most entities in their cells
+      for (size_t i = 0; i < n; i++) {
+        x[i] += unit(rng) - 0.5;
+        y[i] += unit(rng) - 0.5;
+      }
+    }
+  }
+
+  // Test Dynamic Obstacles: the mountain is obstacle 0 and can be lifted
+  {
+    PhysicsEngine world;
+    assert(std::abs(world.findShortestPath(55, 40, 55, 70) - 42.0) < 1e-9);
+    assert(phys_remove_obstacle(&world, 0) == 0);
+    assert(phys_remove_obstacle(&world, 0) == -1);
+    assert(std::abs(world.findShortestPath(55, 40, 55, 70) - 30.0) < 1e-9);
+    assert(std::abs(world.findShortestPath(0, 0, 55, 55) - 110.0) < 1e-9);
+    assert(phys_add_obstacle(&world, 200, 200, 300, 300) == -1);
+
+    // A wall across the map with a gap at x = 99, then a second obstacle
+    // over the gap; the gap reopens at its own cost once both are gone
+    const int32_t wall = phys_add_obstacle(&world, -5, 50, 98, 50);
+    assert(wall > 0 && world.terrain().obstacleCount() == 1);
+    assert(std::abs(world.findShortestPath(0, 40, 0, 60) - 218.0) < 1e-9);
+    const int32_t plug = world.addObstacle(95, 45, 120, 55);
+    assert(plug > wall && world.findShortestPath(0, 40, 0, 60) < 0);
+    assert(world.setCellCost(99, 50, 5.0f));
+    assert(world.findShortestPath(0, 40, 0, 60) < 0); // Still covered
+    assert(!world.removeObstacle(plug + 1));
+    assert(world.removeObstacle(wall));
+    assert(std::abs(world.findShortestPath(0, 40, 0, 60) - 20.0) < 1e-9);
+    assert(world.addObstacle(0, 50, 98, 50) > plug);
+    assert(world.findShortestPath(0, 40, 0, 60) < 0); // The plug is back
+    assert(world.removeObstacle(plug));
+    assert(std::abs(world.findShortestPath(0, 40, 0, 60) - 222.0) < 1e-9);
+    std::cout << "Obstacles: gap at cost 5 -> "
+              << world.findShortestPath(0, 40, 0, 60) << std::endl;
+  }
+
+  // Test Obstacle Hierarchy Updates: incremental updates match a rebuild
+  for (int diagonal = 0; diagonal < 2; diagonal++) {
+    const int w = 48, h = 40;
+    std::vector<float> grid(w * h);
+    for (float &cell : grid)
+      cell = (rng() % 100) < 15 ? 0.0f : 1.0f + rng() % 3;
+    PhysicsEngine incremental, rebuilt;
+    for (PhysicsEngine *e : {&incremental, &rebuilt}) {
+      e->loadTerrain(grid.data(), w, h);
+      e->setPathOptions({PathAlgorithm::HPA, diagonal != 0});
+    }
+    incremental.buildHierarchy(8);
+    std::vector<int32_t> placed;
+    for (int step = 0; step < 30; step++) {
+      if (placed.empty() || rng() % 3) {
+        const int x = rng() % w, y = rng() % h;
+        const int x1 = x + rng() % 12, y1 = y + rng() % 12;
+        const int32_t id = incremental.addObstacle(x, y, x1, y1);
+        assert(rebuilt.addObstacle(x, y, x1, y1) == id);
+        placed.push_back(id);
+      } else {
+        const size_t k = rng() % placed.size();
+        assert(incremental.removeObstacle(placed[k]));
+        assert(rebuilt.removeObstacle(placed[k]));
+        placed.erase(placed.begin() + k);
+      }
+      rebuilt.buildHierarchy(8);
+      for (int q = 0; q < 10; q++) {
+        const int sx = rng() % w, sy = rng() % h;
+        const int tx = rng() % w, ty = rng() % h;
+        assert(incremental.findShortestPath(sx, sy, tx, ty) ==
+               rebuilt.findShortestPath(sx, sy, tx, ty));
+      }
+    }
+  }
+
+  // Test Tracked Paths: repaired routes cost what a fresh A* search does
+  for (int diagonal = 0; diagonal < 2; diagonal++) {
+    const int w = 40, h = 36;
+    std::vector<float> grid(w * h);
+    for (float &cell : grid)
+      cell = (rng() % 100) < 10 ? 0.0f : 1.0f + rng() % 4;
+    PhysicsEngine world;
+    world.loadTerrain(grid.data(), w, h);
+    world.setPathOptions({PathAlgorithm::AStar, diagonal != 0});
+    struct Route {
+      int32_t id;
+      int sx, sy, tx, ty;
+    };
+    std::vector<Route> routes;
+    for (int k = 0; k < 6; k++) {
+      Route r = {0, int(rng() % w), int(rng() % h), int(rng() % w),
+                 int(rng() % h)};
+      r.id = phys_track_path(&world, r.sx, r.sy, r.tx, r.ty);
+      assert(r.id >= 0);
+      routes.push_back(r);
+    }
+    assert(phys_track_path(&world, -1, 0, 0, 0) == -1);
+
+    std::vector<int32_t> placed;
+    std::vector<int32_t> waypoints(2 * w * h);
+    for (int step = 0; step < 80; step++) {
+      const int kind = rng() % 5;
+      if (kind == 0 && !placed.empty()) {
+        const size_t k = rng() % placed.size();
+        assert(world.removeObstacle(placed[k]));
+        placed.erase(placed.begin() + k);
+      } else if (kind <= 2) {
+        const int x = rng() % w, y = rng() % h;
+        placed.push_back(
+            world.addObstacle(x, y, x + rng() % 6, y + rng() % 6));
+      } else if (kind == 3) {
+        world.setCellCost(rng() % w, rng() % h,
+                          (rng() % 4) ? 1.0f + rng() % 4 : 0.0f);
+      } else if (step == 40) {
+        // A new map of a different size: routes start over, or give up on
+        // endpoints it lacks
+        std::vector<float> smaller(30 * 30, 2.0f);
+        world.loadTerrain(smaller.data(), 30, 30);
+        placed.clear();
+      }
+
+      for (Route &r : routes) {
+        size_t len = 0;
+        const double got =
+            world.trackedPath(r.id, waypoints.data(), w * h, &len);
+        const double expected = world.findShortestPath(r.sx, r.sy, r.tx, r.ty);
+        assert(std::abs(got - expected) < 1e-9);
+        if (got < 0) {
+          assert(len == 0);
+          continue;
+        }
+        assert(len >= 1 && waypoints[0] == r.sx && waypoints[1] == r.sy);
+        assert(waypoints[2 * len - 2] == r.tx &&
+               waypoints[2 * len - 1] == r.ty);
+        const TerrainGrid &terrain = world.terrain();
+        double walked = 0.0;
+        for (size_t i = 1; i < len; i++) {
+          const int ddx = std::abs(waypoints[2 * i] - waypoints[2 * i - 2]);
+          const int ddy = std::abs(waypoints[2 * i + 1] - waypoints[2 * i - 1]);
+          assert(ddx <= 1 && ddy <= 1 && ddx + ddy > 0);
+          assert(diagonal || ddx + ddy == 1);
+          const float cell = terrain.cost(
+              terrain.index(waypoints[2 * i], waypoints[2 * i + 1]));
+          walked += (ddx && ddy) ? cell * SQRT2 : cell;
+        }
+        assert(std::abs(walked - got) < 1e-9);
+
+        // Agents walk a step or two along their routes now and then
+        if (len > 2 && rng() % 3 == 0) {
+          r.sx = waypoints[2];
+          r.sy = waypoints[3];
+          assert(phys_move_tracked_path(&world, r.id, r.sx, r.sy) == 0);
+        }
+      }
+    }
+    assert(phys_move_tracked_path(&world, routes[0].id, 500, 0) == -1);
+    assert(phys_untrack_path(&world, routes[0].id) == 0);
+    assert(phys_untrack_path(&world, routes[0].id) == -1);
+    size_t len = 7;
+    assert(world.trackedPath(routes[0].id, waypoints.data(), w * h, &len) <
+               0 &&
+           len == 0);
+  }
+
+  // Test Incremental Repair: changes cost work only where the search went
+  {
+    const int n = 256;
+    std::vector<float> hills(n * n);
+    for (float &cell : hills)
+      cell = 1.0f + rng() % 4;
+    TerrainGrid terrain;
+    terrain.load(hills.data(), n, n);
+    IncrementalPath path(10, 128, 245, 128, false);
+    const double initial_cost = path.cost(terrain);
+    const uint64_t initial = path.expansions();
+
+    // Nowhere near the search: no work at all
+    const GridRegion corner = {0, 0, 4, 4};
+    terrain.addObstacle(corner);
+    path.noteChange(corner);
+    assert(path.cost(terrain) == initial_cost);
+    assert(path.expansions() == initial);
+
+    // Across the route ahead of the agent: repaired with far fewer
+    // expansions than a new search (the search runs from the target, so
+    // changes near the start are the cheap ones)
+    const GridRegion wall = {30, 110, 31, 147};
+    const int32_t wall_id = terrain.addObstacle(wall);
+    path.noteChange(wall);
+    const double detour = path.cost(terrain);
+    const uint64_t repair = path.expansions() - initial;
+    IncrementalPath fresh(10, 128, 245, 128, false);
+    assert(fresh.cost(terrain) == detour && detour > initial_cost);
+    assert(2 * repair < fresh.expansions());
+
+    // The agent walks on: moving the start keeps the search
+    std::vector<int32_t> route(2 * n * n);
+    const size_t len = path.writePath(terrain, route.data(), n * n);
+    path.moveStart(terrain, route[2], route[3]);
+    const uint64_t before_move = path.expansions();
+    const float first_step = terrain.cost(terrain.index(route[2], route[3]));
+    assert(path.cost(terrain) == detour - first_step);
+    const uint64_t moved = path.expansions() - before_move;
+    assert(path.writePath(terrain, route.data(), n * n) == len - 1);
+
+    GridRegion cleared;
+    assert(terrain.removeObstacle(wall_id, &cleared));
+    path.noteChange(cleared);
+    IncrementalPath reopened(route[0], route[1], 245, 128, false);
+    assert(path.cost(terrain) == reopened.cost(terrain));
+    std::cout << "Incremental repair: " << repair << " expansions vs "
+              << fresh.expansions() << " for a new search, " << moved
+              << " after a step, " << path.cellsHeld() << " cells held"
+              << std::endl;
+
+    // State is held only where the search went: a short route on a large
+    // map holds a few cells, not the map
+    const int big = 2048;
+    std::vector<float> flat(static_cast<size_t>(big) * big, 1.0f);
+    TerrainGrid open_map;
+    open_map.load(flat.data(), big, big);
+    IncrementalPath nearby(1000, 1000, 1030, 1010, true);
+    assert(nearby.cost(open_map) > 0.0);
+    std::cout << "Short route on " << big << "^2: " << nearby.cellsHeld()
+              << " cells held" << std::endl;
+    assert(nearby.cellsHeld() < 4096);
+  }
+
+  // Test Stats: counters follow queries when built with PHYS_ENABLE_STATS
+  {
+    PhysicsEngine counted;
+    PhysStats stats;
+    const bool enabled = phys_get_stats(&counted, &stats) == 0;
+    counted.findShortestPath(0, 0, 99, 99);
+    counted.buildDistanceField(99, 99);
+    counted.findShortestPath(0, 0, 99, 99);
+    phys_get_stats(&counted, &stats);
+    if (enabled) {
+      assert(stats.path_queries == 2);
+      assert(stats.field_hits == 1 && stats.field_misses == 1);
+      assert(stats.nodes_expanded > 0);
+      assert(stats.nodes_expanded <= stats.open_pushes);
+      assert(stats.peak_open_size > 0);
+      assert(stats.peak_open_size <= stats.open_pushes);
+      uint64_t timed = 0;
+      for (uint64_t bucket : stats.latency_buckets)
+        timed += bucket;
+      assert(timed == 2);
+      phys_reset_stats(&counted);
+      phys_get_stats(&counted, &stats);
+    }
+    assert(stats.path_queries == 0 && stats.open_pushes == 0);
+    std::cout << "Stats: " << (enabled ? "enabled" : "disabled") << std::endl;
+  }
+
   std::cout << "ALL TESTS PASSED" << std::endl;
   return 0;
 }